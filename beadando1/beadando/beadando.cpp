@@ -14,14 +14,23 @@
 #include "context.h"
 #include "crystal.h"
 #include "imgui_integration.h"
+#include "memory_allocator.h"
+#include "object_cache.h"
 #include "pedestal.h"
+#include "sampler_cache.h"
 #include "star.h"
 #include "swapchain.h"
 #include "wrappers.h"
 #include "texture.h"
+#include "texture_atlas.h"
+#include "attachment_pool.h"
 #include "lightning_pass.h"
 #include "shadow_map.h"
 
+#include "crystal_texture.jpg_include.h"
+#include "pedestal_texture.jpg_include.h"
+#include "star_texture.png_include.h"
+
 #include <iostream>
 
 void KeyCallback(GLFWwindow* window, int key, int /*scancode*/, int /*action*/, int /*mods*/)
@@ -133,8 +142,16 @@ int main(int /*argc*/, char** /*argv*/)
         throw std::runtime_error("Failed to create window surface!");
     }
 
+    // Every set of the application is bound through the lib, descriptor buffers can be used when supported
+    context.RequestDescriptorBackend(DescriptorBackend::Buffer);
+    // The objects only bind their textures and materials through the bindless table
+    context.RequireBindless();
+
     VkPhysicalDevice phyDevice      = context.SelectPhysicalDevice(surface);
     VkDevice         device         = context.CreateDevice({});
+    if (device == VK_NULL_HANDLE) {
+        throw std::runtime_error("Failed to create Vulkan Device");
+    }
     uint32_t         queueFamilyIdx = context.queueFamilyIdx();
     VkQueue          queue          = context.queue();
 
@@ -146,14 +163,15 @@ int main(int /*argc*/, char** /*argv*/)
 
     std::vector<VkCommandBuffer> cmdBuffers = AllocateCommandBuffers(device, cmdPool, swapchain.images().size());
 
+    // Descriptor sets written for a single frame, reset when the frame's command buffer is recorded again
+    FrameDescriptorAllocator& frameDescriptors = context.CreateFrameDescriptors((uint32_t)swapchain.images().size());
+
     VkFence     imageFence       = CreateFence(device);
     VkSemaphore presentSemaphore = CreateSemaphore(device);
 
     imIntegration.CreateContext(context, swapchain);
 
-    VkFormat depthFormat  = VK_FORMAT_D32_SFLOAT;
-    Texture  depthTexture = Texture::Create2D(context.physicalDevice(), context.device(), depthFormat,
-                                              swapchain.surfaceExtent(), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    const VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
 
     struct LightInfo {
         glm::vec4 position;
@@ -185,19 +203,83 @@ int main(int /*argc*/, char** /*argv*/)
     }
 
     Pedestal pedestal;
-    pedestal.Create(context, swapchain.format(), commonPushConstantRange.size);
+    Crystal  crystal;
+    Star     star1;
+    Star     star2;
+    Star     star3;
+    Star     star4;
 
-    Crystal crystal;
-    crystal.Create(context, swapchain.format(), commonPushConstantRange.size);
+    {
+        // The textures are baked into the executable (add_texture): creating them only queues their uploads,
+        // there is no file to find or decode. They are packed into one atlas, so every object samples the same
+        // image. Should the device not sample the baked block format, the source images are decoded as before.
+        // Both paths take the format the objects sample their textures in.
+        TextureCache&           textureCache  = context.textureCache();
+        const VkFormat          textureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        const VkImageUsageFlags textureUsage  = VK_IMAGE_USAGE_SAMPLED_BIT;
+
+        TextureRef  pedestalTexture;
+        TextureRef  crystalTexture;
+        TextureRef  starTexture;
+        AtlasRegion pedestalRegion;
+        AtlasRegion crystalRegion;
+        AtlasRegion starRegion;
+
+        DecodedImage pedestalImage;
+        DecodedImage crystalImage;
+        DecodedImage starImage;
+
+        const VkPhysicalDevice phyDevice = context.physicalDevice();
+        const bool             decoded   =
+            Texture::DecodeData(phyDevice, "pedestal_texture.jpg", TEX_pedestal_texture, sizeof(TEX_pedestal_texture),
+                                textureFormat, &pedestalImage)
+            && Texture::DecodeData(phyDevice, "crystal_texture.jpg", TEX_crystal_texture, sizeof(TEX_crystal_texture),
+                                   textureFormat, &crystalImage)
+            && Texture::DecodeData(phyDevice, "star_texture.png", TEX_star_texture, sizeof(TEX_star_texture),
+                                   textureFormat, &starImage);
+
+        AtlasBuilder   atlasBuilder;
+        const uint32_t pedestalIdx = atlasBuilder.Add(pedestalImage);
+        const uint32_t crystalIdx  = atlasBuilder.Add(crystalImage);
+        const uint32_t starIdx     = atlasBuilder.Add(starImage);
+
+        TextureAtlas atlas;
+        if (decoded && atlasBuilder.Build(&atlas)) {
+            Texture* atlasTexture = Texture::CreateFromDecoded(phyDevice, device, context.uploads(), atlas.image,
+                                                               textureUsage);
+            if (atlasTexture != nullptr) {
+                pedestalTexture = textureCache.Adopt("material_atlas", atlasTexture);
+                crystalTexture  = pedestalTexture;
+                starTexture     = pedestalTexture;
+                pedestalRegion  = atlas.regions[pedestalIdx];
+                crystalRegion   = atlas.regions[crystalIdx];
+                starRegion      = atlas.regions[starIdx];
+            }
+        }
 
-    Star star1;
-    star1.Create(context, swapchain.format(), commonPushConstantRange.size);
-    Star star2;
-    star2.Create(context, swapchain.format(), commonPushConstantRange.size);
-    Star star3;
-    star3.Create(context, swapchain.format(), commonPushConstantRange.size);
-    Star star4;
-    star4.Create(context, swapchain.format(), commonPushConstantRange.size);
+        if (!pedestalTexture.IsValid()) {
+            pedestalTexture = textureCache.Acquire("../../images/pedestal_texture.jpg", textureFormat, textureUsage);
+            crystalTexture  = textureCache.Acquire("../../images/crystal_texture.jpg", textureFormat, textureUsage);
+            starTexture     = textureCache.Acquire("../../images/star_texture.png", textureFormat, textureUsage);
+        }
+
+        // Per material filtering: the large pedestal surfaces are seen at grazing angles, the stars are small
+        // and blur quickly when minified. Anisotropy is clamped to the device limit by the sampler cache.
+        const SamplerSettings pedestalSampler = { .maxAnisotropy = 16.0f };
+        const SamplerSettings crystalSampler  = { .maxAnisotropy = 4.0f };
+        const SamplerSettings starSampler     = { .lodBias = -0.5f };
+
+        const uint32_t pushConstantStart = commonPushConstantRange.size;
+        pedestal.Create(context, swapchain.format(), pushConstantStart, pedestalTexture, pedestalSampler, pedestalRegion);
+        crystal.Create(context, swapchain.format(), pushConstantStart, crystalTexture, crystalSampler, crystalRegion);
+        star1.Create(context, swapchain.format(), pushConstantStart, starTexture, starSampler, starRegion);
+        star2.Create(context, swapchain.format(), pushConstantStart, starTexture, starSampler, starRegion);
+        star3.Create(context, swapchain.format(), pushConstantStart, starTexture, starSampler, starRegion);
+        star4.Create(context, swapchain.format(), pushConstantStart, starTexture, starSampler, starRegion);
+    }
+
+    // Upload all static geometry and textures in one go
+    context.FlushUploads();
 
     glfwShowWindow(window);
 
@@ -215,7 +297,26 @@ int main(int /*argc*/, char** /*argv*/)
         .extent = swapchain.surfaceExtent(),
     };
 
-    ShadowMap shadowMap(depthFormat, commonPushConstantRange.size, swapchain.surfaceExtent());
+    // Frame pass order, attachments share memory based on which passes use them
+    enum FramePass : uint32_t {
+        PASS_SHADOW   = 0,
+        PASS_LIGHTING = 1,
+        PASS_PRESENT  = 2, // lighting color blit into the swapchain image
+    };
+
+    ShadowMap     shadowMap(depthFormat, commonPushConstantRange.size, swapchain.surfaceExtent());
+    LightningPass lightningPass(swapchain.format(), depthFormat, commonPushConstantRange.size,
+                                swapchain.surfaceExtent());
+
+    AttachmentPool attachments;
+    shadowMap.DeclareAttachments(attachments, PASS_SHADOW, PASS_LIGHTING);
+    lightningPass.DeclareAttachments(attachments, PASS_LIGHTING, PASS_PRESENT);
+    {
+        VkResult result = attachments.Build(context.physicalDevice(), device);
+        assert((result == VK_SUCCESS) && "Attachment creation failed");
+        attachments.PrintReport();
+    }
+
     shadowMap.Create(context);
 
     DirectionalLight directionalLight1 = {
@@ -230,10 +331,11 @@ int main(int /*argc*/, char** /*argv*/)
         glm::mat4(1.0f),
     };
 
-    LightningPass lightningPass(swapchain.format(), depthFormat, commonPushConstantRange.size,
-                                swapchain.surfaceExtent());
     lightningPass.Create(context, shadowMap.Depth());
 
+    // Every pipeline exists by now: compare with the previous run to see what the cache saved
+    context.pipelineCache().PrintStats();
+
     int32_t color = 0;
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
@@ -274,7 +376,47 @@ int main(int /*argc*/, char** /*argv*/)
             const glm::vec3& targetPosition = camera.lookAtPosition();
             ImGui::Text("Target position x: %.3f y: %.3f z: %.3f", targetPosition.x, targetPosition.y, targetPosition.z);
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            ImGui::Text("Attachments %.2f MiB (%.2f MiB saved by aliasing/lazy allocation)",
+                        attachments.AllocatedBytes() / (1024.0 * 1024.0), attachments.SavedBytes() / (1024.0 * 1024.0));
+            const TextureCache::Stats textureStats = context.textureCache().GetStats();
+            ImGui::Text("Texture cache %u hits, %u misses, %u resident (%.2f MiB)", textureStats.hits,
+                        textureStats.misses, textureStats.residentCount, textureStats.residentBytes / (1024.0 * 1024.0));
+            const SamplerCache& samplers = SamplerCache::Get(context.device());
+            ImGui::Text("Samplers %u shared (anisotropy %s, max %.0fx)", samplers.SamplerCount(),
+                        samplers.IsAnisotropyEnabled() ? "on" : "off", samplers.MaxAnisotropy());
+            const ObjectCache::Stats objectStats = ObjectCache::Get(context.device()).GetStats();
+            ImGui::Text("Object cache %u set layouts, %u pipeline layouts (%llu hits, %llu misses)",
+                        objectStats.descriptorSetLayouts.count, objectStats.pipelineLayouts.count,
+                        (unsigned long long)(objectStats.descriptorSetLayouts.hits + objectStats.pipelineLayouts.hits),
+                        (unsigned long long)(objectStats.descriptorSetLayouts.misses
+                                             + objectStats.pipelineLayouts.misses));
+            const DescriptorAllocator::Stats& descriptorStats = context.descriptorPool().GetStats();
+            ImGui::Text("Descriptor sets %llu in %u pools (%u growths), %u/frame (peak %u, %u growths)",
+                        (unsigned long long)descriptorStats.setsAllocated, descriptorStats.poolCount,
+                        descriptorStats.growthEvents, frameDescriptors.SetsLastFrame(),
+                        frameDescriptors.HighWaterMark(), frameDescriptors.GrowthEvents());
+            const PushDescriptors& pushDescriptors = context.pushDescriptors();
+            ImGui::Text("Push descriptors %s, %llu pushes (%llu fallback sets)",
+                        pushDescriptors.IsSupported() ? "on" : "off",
+                        (unsigned long long)pushDescriptors.GetStats().pushes,
+                        (unsigned long long)pushDescriptors.GetStats().fallbackSets);
+            if (const DescriptorBuffer* descriptorBuffer = context.descriptorBuffer()) {
+                const DescriptorBuffer::Stats bufferStats = descriptorBuffer->GetStats();
+                ImGui::Text("Descriptor buffer %.1f of %.1f KiB in %u ranges, %llu descriptor writes",
+                            bufferStats.usedBytes / 1024.0, bufferStats.size / 1024.0, bufferStats.rangeCount,
+                            (unsigned long long)bufferStats.descriptorWrites);
+            } else {
+                ImGui::Text("Descriptor buffer off, using descriptor sets");
+            }
+            const PipelineCache::Stats& pipelineStats = context.pipelineCache().GetStats();
+            ImGui::Text("Pipeline cache %s, %u pipelines created in %.2f ms", pipelineStats.warm ? "warm" : "cold",
+                        pipelineStats.pipelineCount, pipelineStats.createMs);
+            ImGui::Text("Bindless table %u textures, %u materials", context.bindless().TextureCount(),
+                        context.bindless().MaterialCount());
             ImGui::End();
+
+            imIntegration.MemoryWindow(context);
+
             ImGui::Render();
 
             float cameraSpeed = static_cast<float>(3 * 0.05);
@@ -311,6 +453,9 @@ int main(int /*argc*/, char** /*argv*/)
 
         vkWaitForFences(device, 1, &imageFence, VK_TRUE, UINT64_MAX);
 
+        frameDescriptors.BeginFrame();
+        context.textureCache().BeginFrame();
+
         // Get command buffer based on swapchain image index
         VkCommandBuffer cmdBuffer = cmdBuffers[swapchainImage.idx];
         {
@@ -482,12 +627,20 @@ int main(int /*argc*/, char** /*argv*/)
         vkDeviceWaitIdle(device);
     }
 
+    // Statistics of the run, the lib only collects them
+    MemoryAllocator::Get(phyDevice, device).PrintStats();
+    context.textureCache().PrintStats();
+    ObjectCache::Get(device).PrintStats();
+    if (const DescriptorBuffer* descriptorBuffer = context.descriptorBuffer()) {
+        descriptorBuffer->PrintStats();
+    }
+
     shadowMap.Destroy(context);
     lightningPass.Destroy(device);
+    attachments.Destroy(device);
 
     vkDestroyPipelineLayout(device, commonLayout, nullptr);
 
-    depthTexture.Destroy(context.device());
     imIntegration.Destroy(context);
 
     vkDestroyFence(device, imageFence, nullptr);
@@ -505,6 +658,13 @@ int main(int /*argc*/, char** /*argv*/)
     swapchain.Destroy();
     context.Destroy();
 
+    // Saved by Context::Destroy, the statistics outlive the cache
+    const PipelineCache::Stats& pipelineCacheStats = context.pipelineCache().GetStats();
+    if (pipelineCacheStats.savedBytes > 0) {
+        printf("Pipeline cache: %llu bytes saved (%u merged from other processes)\n",
+               (unsigned long long)pipelineCacheStats.savedBytes, pipelineCacheStats.mergedFiles);
+    }
+
     glfwDestroyWindow(window);
 
     glfwTerminate();
@@ -1,6 +1,7 @@
 #include "crystal.h"
 
 #include <GLFW/glfw3.h>
+#include <cassert>
 #include <cstdint>
 
 #include <vector>
@@ -8,7 +9,7 @@
 
 #include "buffer.h"
 #include "context.h"
-#include "descriptors.h"
+#include "object_cache.h"
 #include "texture.h"
 #include "wrappers.h"
 #include "vertex_tools.h"
@@ -74,6 +75,7 @@ static std::vector<Vertex> buildCrystal(const float* crystalVertices, const size
 
 
 VkPipeline CreateSimplePipeline(const VkDevice         device,
+                                PipelineCache&         pipelineCache,
                                 const VkFormat         colorFormat,
                                 const VkPipelineLayout pipelineLayout,
                                 const VkShaderModule   shaderVertex,
@@ -275,7 +277,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
         .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext               = &renderingInfo,
-        .flags               = 0,
+        .flags               = DescriptorBuffer::PipelineCreateFlags(device),
         .stageCount          = 2,
         .pStages             = shaders,
         .pVertexInputState   = &vertexInputInfo,
@@ -295,7 +297,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &pipeline);
     assert(result == VK_SUCCESS);
 
     return pipeline;
@@ -310,7 +312,12 @@ Crystal::Crystal()
 {
 }
 
-VkResult Crystal::Create(Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart)
+VkResult Crystal::Create(Context&               context,
+                         const VkFormat         colorFormat,
+                         const uint32_t         pushConstantStart,
+                         const TextureRef&      texture,
+                         const SamplerSettings& samplerSettings,
+                         const AtlasRegion&     uvRegion)
 {
     const VkDevice       device         = context.device();
     const VkShaderModule shaderVertex   = CreateShaderModule(device, SPV_crystal_vert, sizeof(SPV_crystal_vert));
@@ -318,67 +325,41 @@ VkResult Crystal::Create(Context& context, const VkFormat colorFormat, const uin
 
     m_device = device;
 
-    const std::string imagePath = "../../images/crystal_texture.jpg";
-    m_texture = *Texture::LoadFromFile(context.physicalDevice(), device, context.queue(), context.commandPool(),
-                                       imagePath, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
-
-    const std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {
-        VkDescriptorSetLayoutBinding{
-            .binding            = 0,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-        VkDescriptorSetLayoutBinding{
-            .binding            = 1,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-    };
+    m_texture = texture;
 
-    m_descSetLayout = context.descriptorPool().createLayout(layoutBindings);
+    assert(context.HasBindless() && "Context::RequireBindless must be called before CreateDevice");
+    BindlessTable& bindless = context.bindless();
 
     m_constantOffset = pushConstantStart;
-    m_pipelineLayout = CreatePipelineLayout(device, {m_descSetLayout}, m_constantOffset + sizeof(ModelPushConstant));
-    m_pipeline       = CreateSimplePipeline(device, colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
+    // Every object drawn from the bindless table ends up with the same layout, the object cache shares it
+    m_pipelineLayout = ObjectCache::Get(device).GetPipelineLayout({bindless.layout()},
+                                                                  m_constantOffset + sizeof(ModelPushConstant));
+    m_pipeline       = CreateSimplePipeline(device, context.pipelineCache(), colorFormat, m_pipelineLayout,
+                                            shaderVertex, shaderFragment);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
 
     {
-        const std::vector<Vertex> vertexData     = buildCrystal(g_crystalVertices, std::size(g_crystalVertices), indexList);
-        const uint32_t            vertexDataSize = vertexData.size() * sizeof(vertexData[0]);
-        m_vertexBuffer =
-            BufferInfo::Create(context.physicalDevice(), device, vertexDataSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-        m_vertexBuffer.Update(device, vertexData.data(), vertexDataSize);
+        std::vector<Vertex> vertexData     = buildCrystal(g_crystalVertices, std::size(g_crystalVertices), indexList);
+        applyAtlasRegion(vertexData, uvRegion);
+        const uint32_t      vertexDataSize = vertexData.size() * sizeof(vertexData[0]);
+        m_vertexBuffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), vertexData.data(),
+                                                  vertexDataSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
     }
 
     {
         const std::vector<uint32_t> indexData     = indexList;
         const uint32_t              indexDataSize = indexData.size() * sizeof(indexData[0]);
-        m_indexBuffer =
-            BufferInfo::Create(context.physicalDevice(), device, indexDataSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-        m_indexBuffer.Update(device, indexData.data(), indexDataSize);
+        m_indexBuffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), indexData.data(),
+                                                 indexDataSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
         m_vertexCount = indexData.size();
     }
 
-    m_uniformBuffer = BufferInfo::Create(context.physicalDevice(), device, sizeof(UniformBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
-    const UniformBuffer data = {
-        .color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
-        .time  = (float)glfwGetTime(),
-    };
-    m_uniformBuffer.Update(device, &data, sizeof(data));
-
-    m_modelSet = context.descriptorPool().createSet(m_descSetLayout);
-
-    DescriptorSetMgmt setMgmt(m_modelSet);
-    setMgmt.SetBuffer(0, m_uniformBuffer.buffer);
-    setMgmt.SetImage(1, m_texture.view(), m_texture.sampler());
-    setMgmt.Update(device);
+    // No descriptor set of its own: the draw selects its material in the bindless table by index
+    const VkSampler sampler    = SamplerCache::Get(device).Get(samplerSettings);
+    const uint32_t  textureIdx = bindless.AddTexture(m_texture->view(), sampler);
+    m_materialIdx              = bindless.AddMaterial({.textureIdx = textureIdx});
 
     return VK_SUCCESS;
 }
@@ -387,27 +368,22 @@ void Crystal::Destroy(Context& context)
 {
     const VkDevice device = context.device();
 
-    m_texture.Destroy(device);
-    m_uniformBuffer.Destroy(device);
+    m_texture.Reset();
     m_vertexBuffer.Destroy(device);
     m_indexBuffer.Destroy(device);
     vkDestroyPipeline(device, m_pipeline, nullptr);
-    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
 }
 
 void Crystal::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
 {
-    const UniformBuffer data = {
-        .color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
-        .time  = (float)glfwGetTime(),
-    };
-    m_uniformBuffer.Update(m_device, &data, sizeof(data));
+    const float time = (float)glfwGetTime();
 
     ModelPushConstant modelData = {
-        .model = glm::mat4(1.0f) * m_position * m_rotation,
+        .model       = glm::mat4(1.0f) * m_position * m_rotation,
+        .materialIdx = m_materialIdx,
     };
 
-    modelData.model = glm::rotate( glm::translate(modelData.model, glm::vec3(0.0f, 1.0f, 0.0f)), data.time, glm::vec3(0.0f, 1.0f, 0.0f));
+    modelData.model = glm::rotate( glm::translate(modelData.model, glm::vec3(0.0f, 1.0f, 0.0f)), time, glm::vec3(0.0f, 1.0f, 0.0f));
 
     if (bindPipeline) {
         vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
@@ -415,8 +391,6 @@ void Crystal::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
     vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, m_constantOffset,
                        sizeof(ModelPushConstant), &modelData);
 
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_modelSet, 0,
-                                nullptr);
     VkDeviceSize nullOffset = 0u;
     vkCmdBindVertexBuffers(cmdBuffer, 0u, 1u, &m_vertexBuffer.buffer, &nullOffset);
     vkCmdBindIndexBuffer(cmdBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
@@ -4,7 +4,10 @@
 
 #include "glm_config.h"
 #include "buffer.h"
+#include "sampler_cache.h"
 #include "texture.h"
+#include "texture_atlas.h"
+#include "texture_cache.h"
 
 
 class Context;
@@ -13,16 +16,21 @@ class Crystal {
 public:
     struct ModelPushConstant {
         glm::mat4 model;
-    };
-
-    struct UniformBuffer {
-        glm::vec4 color;
-        float     time;
+        uint32_t  materialIdx; // into the bindless material table
     };
 
     Crystal();
 
-    VkResult Create(Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart);
+    // The texture is acquired up front from context.textureCache(), so decodes of several objects overlap.
+    // The sampler settings select the filtering of the material, the sampler is shared through the SamplerCache.
+    // When the texture is an atlas, 'uvRegion' is the part of it holding the image of this object.
+    // Texture and material are registered in context.bindless(), the table must be bound before Draw.
+    VkResult Create(Context&               context,
+                    const VkFormat         colorFormat,
+                    const uint32_t         pushConstantStart,
+                    const TextureRef&      texture,
+                    const SamplerSettings& samplerSettings = {},
+                    const AtlasRegion&     uvRegion        = {});
     void     Destroy(Context& context);
     void     Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline = true);
 
@@ -39,11 +47,8 @@ private:
     glm::mat4        m_position       = glm::mat4(1.0f);
     glm::mat4        m_rotation       = glm::mat4(1.0f);
 
-    BufferInfo            m_uniformBuffer = {};
-    VkDescriptorPool      m_pool          = VK_NULL_HANDLE;
-    VkDescriptorSetLayout m_descSetLayout = VK_NULL_HANDLE;
-    VkDescriptorSet       m_modelSet      = VK_NULL_HANDLE;
-    VkDevice              m_device        = VK_NULL_HANDLE;
+    uint32_t m_materialIdx = 0;
+    VkDevice m_device      = VK_NULL_HANDLE;
 
-    Texture m_texture = {};
+    TextureRef m_texture = {};
 };
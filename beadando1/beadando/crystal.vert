@@ -4,11 +4,6 @@ layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec2 in_uv;
 layout(location = 2) in vec3 in_normal;
 
-layout(set = 0, binding = 0) uniform UniformBuffer {
-    vec4 color;
-    float time;
-} UBO;
-
 layout(push_constant) uniform PushConstants {
     // common
     vec4 cameraPosition;
@@ -18,6 +13,7 @@ layout(push_constant) uniform PushConstants {
     vec4 light2Position;
     // model spec
     mat4 model;
+    uint materialIdx;
 } constants;
 
 layout(location = 0) out vec2 out_uv;
@@ -4,6 +4,7 @@
 
 #include "glm_config.h"
 
+#include "attachment_pool.h"
 #include "context.h"
 #include "buffer.h"
 #include "texture.h"
@@ -17,19 +18,23 @@ public:
                   const uint32_t pushConstantStart,
                   VkExtent2D     extent);
 
+    // Declares the color output (used up to lastColorReaderPassIdx) and the depth buffer
+    // (only used in this pass, transient), call before Create
+    void DeclareAttachments(AttachmentPool& attachments, uint32_t passIdx, uint32_t lastColorReaderPassIdx);
+
     bool Create(Context& context, Texture& shadowMap);
     void Destroy(Context& context);
     void BeginPass(const VkCommandBuffer cmdBuffer);
     void EndPass(const VkCommandBuffer cmdBuffer);
 
-    void BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout);
+    void BuildPipeline(const VkDevice device, PipelineCache& pipelineCache, const VkPipelineLayout pipelineLayout);
 
     void Destroy(const VkDevice device);
 
     VkPipeline SimplePipeline() const { return m_simplePipeline; }
     VkPipeline ShadowMapPipeline() const { return m_shadowMapPipeline; }
 
-    Texture& colorOutput() { return m_colorOutput; }
+    Texture& colorOutput() { return *m_colorOutput; }
 
     void updateLightInfo(Context& context, DirectionalLight& lightInfo);
 
@@ -45,9 +50,12 @@ private:
     VkPipeline       m_simplePipeline    = VK_NULL_HANDLE;
     VkPipeline       m_shadowMapPipeline = VK_NULL_HANDLE;
 
-    VkDescriptorSet m_lightSet;
-    BufferInfo      m_lightBuffer;
+    BindlessTable*    m_bindless        = nullptr;        // owned by the context
+    PushDescriptors*  m_pushDescriptors = nullptr;        // owned by the context
+    DescriptorSetMgmt m_lightDescriptors;                 // light matrix and shadow map, pushed as set 1
+    BufferInfo        m_lightBuffer;
 
-    Texture m_colorOutput;
-    Texture m_depthOutput;
+    // Owned by the AttachmentPool
+    Texture* m_colorOutput = nullptr;
+    Texture* m_depthOutput = nullptr;
 };
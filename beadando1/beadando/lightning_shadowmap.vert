@@ -18,6 +18,7 @@ layout(push_constant) uniform PushConstants {
     vec4 light2Position;
     // model spec
     mat4 model;
+    uint materialIdx;
 } constants;
 
 layout(location = 0) out vec2 out_uv;
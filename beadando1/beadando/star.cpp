@@ -1,6 +1,7 @@
 #include "star.h"
 
 #include <GLFW/glfw3.h>
+#include <cassert>
 #include <cstdint>
 
 #include <vector>
@@ -8,7 +9,7 @@
 
 #include "buffer.h"
 #include "context.h"
-#include "descriptors.h"
+#include "object_cache.h"
 #include "texture.h"
 #include "vertex_tools.h"
 #include "wrappers.h"
@@ -73,6 +74,7 @@ static std::vector<Vertex> buildStar(const float* starVertices, const size_t arr
 
 
 VkPipeline CreateSimplePipeline(const VkDevice         device,
+                                PipelineCache&         pipelineCache,
                                 const VkFormat         colorFormat,
                                 const VkPipelineLayout pipelineLayout,
                                 const VkShaderModule   shaderVertex,
@@ -274,7 +276,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
         .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext               = &renderingInfo,
-        .flags               = 0,
+        .flags               = DescriptorBuffer::PipelineCreateFlags(device),
         .stageCount          = 2,
         .pStages             = shaders,
         .pVertexInputState   = &vertexInputInfo,
@@ -294,7 +296,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &pipeline);
     assert(result == VK_SUCCESS);
 
     return pipeline;
@@ -309,7 +311,12 @@ Star::Star()
 {
 }
 
-VkResult Star::Create(Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart)
+VkResult Star::Create(Context&               context,
+                      const VkFormat         colorFormat,
+                      const uint32_t         pushConstantStart,
+                      const TextureRef&      texture,
+                      const SamplerSettings& samplerSettings,
+                      const AtlasRegion&     uvRegion)
 {
     const VkDevice       device         = context.device();
     const VkShaderModule shaderVertex   = CreateShaderModule(device, SPV_star_vert, sizeof(SPV_star_vert));
@@ -317,67 +324,41 @@ VkResult Star::Create(Context& context, const VkFormat colorFormat, const uint32
 
     m_device = device;
 
-    const std::string imagePath = "../../images/star_texture.png";
-    m_texture = *Texture::LoadFromFile(context.physicalDevice(), device, context.queue(), context.commandPool(),
-                                       imagePath, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
-
-    const std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {
-        VkDescriptorSetLayoutBinding{
-            .binding            = 0,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-        VkDescriptorSetLayoutBinding{
-            .binding            = 1,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-    };
+    m_texture = texture;
 
-    m_descSetLayout = context.descriptorPool().createLayout(layoutBindings);
+    assert(context.HasBindless() && "Context::RequireBindless must be called before CreateDevice");
+    BindlessTable& bindless = context.bindless();
 
     m_constantOffset = pushConstantStart;
-    m_pipelineLayout = CreatePipelineLayout(device, {m_descSetLayout}, m_constantOffset + sizeof(ModelPushConstant));
-    m_pipeline       = CreateSimplePipeline(device, colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
+    // Every object drawn from the bindless table ends up with the same layout, the object cache shares it
+    m_pipelineLayout = ObjectCache::Get(device).GetPipelineLayout({bindless.layout()},
+                                                                  m_constantOffset + sizeof(ModelPushConstant));
+    m_pipeline       = CreateSimplePipeline(device, context.pipelineCache(), colorFormat, m_pipelineLayout,
+                                            shaderVertex, shaderFragment);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
 
     {
-        const std::vector<Vertex> vertexData     = buildStar(g_starVertices, std::size(g_starVertices), indexList);
-        const uint32_t            vertexDataSize = vertexData.size() * sizeof(vertexData[0]);
-        m_vertexBuffer =
-            BufferInfo::Create(context.physicalDevice(), device, vertexDataSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-        m_vertexBuffer.Update(device, vertexData.data(), vertexDataSize);
+        std::vector<Vertex> vertexData     = buildStar(g_starVertices, std::size(g_starVertices), indexList);
+        applyAtlasRegion(vertexData, uvRegion);
+        const uint32_t      vertexDataSize = vertexData.size() * sizeof(vertexData[0]);
+        m_vertexBuffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), vertexData.data(),
+                                                  vertexDataSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
     }
 
     {
         const std::vector<uint32_t> indexData     = indexList;
         const uint32_t              indexDataSize = indexData.size() * sizeof(indexData[0]);
-        m_indexBuffer =
-            BufferInfo::Create(context.physicalDevice(), device, indexDataSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-        m_indexBuffer.Update(device, indexData.data(), indexDataSize);
+        m_indexBuffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), indexData.data(),
+                                                 indexDataSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
         m_vertexCount = indexData.size();
     }
 
-    m_uniformBuffer = BufferInfo::Create(context.physicalDevice(), device, sizeof(UniformBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
-    const UniformBuffer data = {
-        .color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
-        .time  = (float)glfwGetTime(),
-    };
-    m_uniformBuffer.Update(device, &data, sizeof(data));
-
-    m_modelSet = context.descriptorPool().createSet(m_descSetLayout);
-
-    DescriptorSetMgmt setMgmt(m_modelSet);
-    setMgmt.SetBuffer(0, m_uniformBuffer.buffer);
-    setMgmt.SetImage(1, m_texture.view(), m_texture.sampler());
-    setMgmt.Update(device);
+    // No descriptor set of its own: the draw selects its material in the bindless table by index
+    const VkSampler sampler    = SamplerCache::Get(device).Get(samplerSettings);
+    const uint32_t  textureIdx = bindless.AddTexture(m_texture->view(), sampler);
+    m_materialIdx              = bindless.AddMaterial({.textureIdx = textureIdx});
 
     return VK_SUCCESS;
 }
@@ -386,24 +367,17 @@ void Star::Destroy(Context& context)
 {
     const VkDevice device = context.device();
 
-    m_texture.Destroy(device);
-    m_uniformBuffer.Destroy(device);
+    m_texture.Reset();
     m_vertexBuffer.Destroy(device);
     m_indexBuffer.Destroy(device);
     vkDestroyPipeline(device, m_pipeline, nullptr);
-    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
 }
 
 void Star::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
 {
-    const UniformBuffer data = {
-        .color = glm::vec4(1.0f, 0.9f, 0.2f, 1.0f),
-        .time  = (float)glfwGetTime(),
-    };
-    m_uniformBuffer.Update(m_device, &data, sizeof(data));
-
     ModelPushConstant modelData = {
-        .model = glm::mat4(1.0f) * m_position * m_rotation,
+        .model       = glm::mat4(1.0f) * m_position * m_rotation,
+        .materialIdx = m_materialIdx,
     };
 
     modelData.model = glm::scale(modelData.model, glm::vec3(0.3f)); //legyen kisebb a csillag
@@ -415,8 +389,6 @@ void Star::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
     vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, m_constantOffset,
                            sizeof(ModelPushConstant), &modelData);
 
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_modelSet, 0,
-                                    nullptr);
     VkDeviceSize nullOffset = 0u;
     vkCmdBindVertexBuffers(cmdBuffer, 0u, 1u, &m_vertexBuffer.buffer, &nullOffset);
     vkCmdBindIndexBuffer(cmdBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "glm_config.h"
+#include "texture_atlas.h"
 #include "vertex.h"
 
 /**
@@ -59,3 +60,15 @@ inline void generateVertexNormals(std::vector<Vertex>& vertices, const std::vect
     }
   }
 }
+
+
+/**
+ * Move the texture coordinates into the region of a texture atlas (identity for the default region).
+ */
+inline void applyAtlasRegion(std::vector<Vertex>& vertices, const AtlasRegion& region){
+  for (auto& v : vertices) {
+    const glm::vec2 uv = region.Apply({v.u, v.v});
+    v.u = uv.x;
+    v.v = uv.y;
+  }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "memory_allocator.h"
+#include "texture.h"
+
+/**
+ * Render target memory shared by attachments whose lifetimes within a frame do not overlap.
+ *
+ * Attachments are declared with the first and last pass (in frame order) that use them.
+ * Build places them into a single allocation: attachments with overlapping pass ranges get
+ * disjoint ranges, the others may reuse the same bytes. Transient attachments
+ * (VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) get lazily allocated memory of their own when
+ * the device has such a memory type.
+ *
+ * Aliased attachments lose their contents between users, so their first pass must transition
+ * them from VK_IMAGE_LAYOUT_UNDEFINED and must not load the previous contents.
+ */
+class AttachmentPool {
+public:
+    // The returned texture is valid after Build and owned by the pool.
+    Texture* Add(const std::string& name,
+                 const VkFormat     format,
+                 VkExtent2D         extent,
+                 VkImageUsageFlags  usage,
+                 uint32_t           firstPass,
+                 uint32_t           lastPass);
+
+    VkResult Build(const VkPhysicalDevice phyDevice, const VkDevice device);
+    void     Destroy(const VkDevice device);
+
+    // Bytes the attachments would need with one allocation each
+    VkDeviceSize RequiredBytes() const { return m_requiredBytes; }
+    // Bytes of physical memory actually backing the attachments
+    VkDeviceSize AllocatedBytes() const { return m_allocatedBytes; }
+    VkDeviceSize SavedBytes() const { return m_requiredBytes - m_allocatedBytes; }
+
+    void PrintReport() const;
+
+private:
+    struct Entry {
+        std::string              name;
+        std::unique_ptr<Texture> texture;
+        VkFormat                 format       = VK_FORMAT_UNDEFINED;
+        VkExtent2D               extent       = {0, 0};
+        VkImageUsageFlags        usage        = 0;
+        uint32_t                 firstPass    = 0;
+        uint32_t                 lastPass     = 0;
+        VkMemoryRequirements     requirements = {};
+        VkDeviceSize             offset       = 0;
+        bool                     aliased      = false; // shares bytes with another attachment
+        bool                     lazy         = false; // has its own lazily allocated memory
+    };
+
+    static bool Overlaps(const Entry& lhs, const Entry& rhs);
+
+    VkDeviceSize PlaceAliased(std::vector<Entry*>& placed, Entry& entry) const;
+
+    std::vector<Entry> m_entries;
+    MemoryAllocation   m_memory;
+    VkDeviceSize       m_requiredBytes  = 0;
+    VkDeviceSize       m_allocatedBytes = 0;
+};
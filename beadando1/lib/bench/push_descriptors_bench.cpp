@@ -0,0 +1,321 @@
+/**
+ * Descriptor recording benchmark: per-draw descriptors pushed into the command buffer against bound sets.
+ *
+ * Usage: push_descriptors_bench [<draws per frame>] [<frames>]
+ *
+ * Runs on the first device with a graphics queue, without a window. Each frame records the descriptors of every
+ * draw (a uniform buffer that changes per draw and a storage buffer) into one command buffer, nothing is
+ * submitted. Only the CPU time of the recording is measured:
+ *   - "bind, persistent sets": sets written once up front, each draw only binds its set (the path the lighting
+ *     pass used before push descriptors)
+ *   - "bind, per-frame sets":  the PushDescriptors fallback, a set is allocated, written and bound for each draw
+ *   - "push":                  vkCmdPushDescriptorSetKHR through PushDescriptors, when the device has the extension
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "buffer.h"
+#include "descriptor_allocator.h"
+#include "descriptors.h"
+#include "memory_allocator.h"
+#include "object_cache.h"
+#include "push_descriptors.h"
+#include "sampler_cache.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t UNIFORM_BUFFER_COUNT = 16;
+constexpr uint32_t FRAMES_IN_FLIGHT     = 2;
+
+struct Device {
+    VkInstance       instance        = VK_NULL_HANDLE;
+    VkPhysicalDevice phyDevice       = VK_NULL_HANDLE;
+    VkDevice         device          = VK_NULL_HANDLE;
+    uint32_t         queueFamilyIdx  = 0;
+    bool             pushDescriptors = false;
+};
+
+bool IsExtensionSupported(const VkPhysicalDevice phyDevice, const char* extensionName)
+{
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(phyDevice, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(phyDevice, nullptr, &count, extensions.data());
+
+    for (const VkExtensionProperties& extension : extensions) {
+        if (std::strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CreateHeadlessDevice(Device* outDevice)
+{
+    const VkApplicationInfo appInfo = {
+        .sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pNext              = nullptr,
+        .pApplicationName   = "push_descriptors_bench",
+        .applicationVersion = 1,
+        .pEngineName        = "vkcourse",
+        .engineVersion      = 1,
+        .apiVersion         = VK_API_VERSION_1_3,
+    };
+    const VkInstanceCreateInfo instanceInfo = {
+        .sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pNext                   = nullptr,
+        .flags                   = 0,
+        .pApplicationInfo        = &appInfo,
+        .enabledLayerCount       = 0,
+        .ppEnabledLayerNames     = nullptr,
+        .enabledExtensionCount   = 0,
+        .ppEnabledExtensionNames = nullptr,
+    };
+    if (vkCreateInstance(&instanceInfo, nullptr, &outDevice->instance) != VK_SUCCESS) {
+        printf("[ERROR] Failed to create the Vulkan instance\n");
+        return false;
+    }
+
+    uint32_t phyDeviceCount = 0;
+    vkEnumeratePhysicalDevices(outDevice->instance, &phyDeviceCount, nullptr);
+    std::vector<VkPhysicalDevice> phyDevices(phyDeviceCount);
+    vkEnumeratePhysicalDevices(outDevice->instance, &phyDeviceCount, phyDevices.data());
+
+    for (const VkPhysicalDevice phyDevice : phyDevices) {
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(phyDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(phyDevice, &familyCount, families.data());
+
+        for (uint32_t familyIdx = 0; familyIdx < familyCount; familyIdx++) {
+            if (outDevice->phyDevice == VK_NULL_HANDLE && (families[familyIdx].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                outDevice->phyDevice      = phyDevice;
+                outDevice->queueFamilyIdx = familyIdx;
+            }
+        }
+    }
+    if (outDevice->phyDevice == VK_NULL_HANDLE) {
+        printf("[ERROR] No device with a graphics queue\n");
+        return false;
+    }
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(outDevice->phyDevice, &properties);
+    printf("Device: %s\n", properties.deviceName);
+
+    std::vector<const char*> extensions;
+    outDevice->pushDescriptors = IsExtensionSupported(outDevice->phyDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    if (outDevice->pushDescriptors) {
+        extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    const float                   queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo     = {
+        .sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .pNext            = nullptr,
+        .flags            = 0,
+        .queueFamilyIndex = outDevice->queueFamilyIdx,
+        .queueCount       = 1,
+        .pQueuePriorities = &queuePriority,
+    };
+    const VkDeviceCreateInfo deviceInfo = {
+        .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext                   = nullptr,
+        .flags                   = 0,
+        .queueCreateInfoCount    = 1,
+        .pQueueCreateInfos       = &queueInfo,
+        .enabledLayerCount       = 0,
+        .ppEnabledLayerNames     = nullptr,
+        .enabledExtensionCount   = (uint32_t)extensions.size(),
+        .ppEnabledExtensionNames = extensions.data(),
+        .pEnabledFeatures        = nullptr,
+    };
+    if (vkCreateDevice(outDevice->phyDevice, &deviceInfo, nullptr, &outDevice->device) != VK_SUCCESS) {
+        printf("[ERROR] Failed to create the device\n");
+        return false;
+    }
+
+    return true;
+}
+
+struct Scene {
+    std::vector<BufferInfo> uniformBuffers;
+    BufferInfo              storageBuffer = {};
+};
+
+// Records 'frameCount' frames of 'drawCount' draws, returns the average recording time of a frame in microseconds
+template <typename RecordDraw, typename BeginFrame>
+double MeasureFrames(const VkDevice        device,
+                     const VkCommandPool   cmdPool,
+                     const VkCommandBuffer cmdBuffer,
+                     uint32_t              frameCount,
+                     uint32_t              drawCount,
+                     BeginFrame            beginFrame,
+                     RecordDraw            recordDraw)
+{
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+
+    double totalSeconds = 0.0;
+    for (uint32_t frameIdx = 0; frameIdx < frameCount + 1; frameIdx++) {
+        vkResetCommandPool(device, cmdPool, 0);
+
+        const Clock::time_point start = Clock::now();
+
+        beginFrame();
+        vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+        for (uint32_t drawIdx = 0; drawIdx < drawCount; drawIdx++) {
+            recordDraw(drawIdx);
+        }
+        vkEndCommandBuffer(cmdBuffer);
+
+        // The first frame creates the pools and warms up the caches
+        if (frameIdx > 0) {
+            totalSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+    }
+
+    return totalSeconds * 1e6 / frameCount;
+}
+
+void PrintResult(const char* label, double frameUs, uint32_t drawCount)
+{
+    printf("  %-24s %9.1f us/frame %8.1f ns/draw\n", label, frameUs, frameUs * 1000.0 / drawCount);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    const uint32_t drawCount  = (argc > 1) ? (uint32_t)std::strtoul(argv[1], nullptr, 10) : 1000;
+    const uint32_t frameCount = (argc > 2) ? (uint32_t)std::strtoul(argv[2], nullptr, 10) : 200;
+
+    Device ctx;
+    if (!CreateHeadlessDevice(&ctx)) {
+        return 1;
+    }
+    const VkDevice device = ctx.device;
+
+    Scene scene;
+    for (uint32_t idx = 0; idx < UNIFORM_BUFFER_COUNT; idx++) {
+        scene.uniformBuffers.push_back(BufferInfo::Create(ctx.phyDevice, device, 256, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT));
+    }
+    scene.storageBuffer = BufferInfo::Create(ctx.phyDevice, device, 4096, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+        {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+    };
+
+    // Without the extension PushDescriptors creates plain layouts, the bind paths use those
+    FrameDescriptorAllocator frameDescriptors;
+    DescriptorTypeCounts     countsPerSet = {};
+    countsPerSet[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER] = 1;
+    countsPerSet[VK_DESCRIPTOR_TYPE_STORAGE_BUFFER] = 1;
+    frameDescriptors.Create(device, FRAMES_IN_FLIGHT, countsPerSet);
+
+    PushDescriptors fallback;
+    fallback.Create(device, false, &frameDescriptors);
+    const VkDescriptorSetLayout setLayout      = fallback.CreateLayout(bindings);
+    const VkPipelineLayout      pipelineLayout = ObjectCache::Get(device).GetPipelineLayout({setLayout});
+
+    const VkCommandPoolCreateInfo poolInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = ctx.queueFamilyIdx,
+    };
+    VkCommandPool cmdPool = VK_NULL_HANDLE;
+    vkCreateCommandPool(device, &poolInfo, nullptr, &cmdPool);
+
+    const VkCommandBufferAllocateInfo cmdBufferInfo = {
+        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext              = nullptr,
+        .commandPool        = cmdPool,
+        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+    vkAllocateCommandBuffers(device, &cmdBufferInfo, &cmdBuffer);
+
+    printf("%u draws per frame, %u frames\n", drawCount, frameCount);
+
+    // Persistent sets: one per draw, written before the measurement
+    DescriptorAllocator persistentSets;
+    persistentSets.Create(device, countsPerSet);
+
+    std::vector<VkDescriptorSet> sets(drawCount);
+    for (uint32_t drawIdx = 0; drawIdx < drawCount; drawIdx++) {
+        DescriptorSetMgmt descriptors(persistentSets.Allocate(setLayout), setLayout);
+        descriptors.SetBuffer(0, scene.uniformBuffers[drawIdx % UNIFORM_BUFFER_COUNT].buffer);
+        descriptors.SetBuffer(1, scene.storageBuffer.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        descriptors.Update(device);
+        sets[drawIdx] = descriptors.Get();
+    }
+
+    const double bindUs = MeasureFrames(device, cmdPool, cmdBuffer, frameCount, drawCount, []() {}, [&](uint32_t drawIdx) {
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &sets[drawIdx], 0,
+                                nullptr);
+    });
+    PrintResult("bind, persistent sets", bindUs, drawCount);
+
+    DescriptorSetMgmt perDraw(VK_NULL_HANDLE, setLayout);
+    perDraw.SetBuffer(1, scene.storageBuffer.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+    const double fallbackUs = MeasureFrames(device, cmdPool, cmdBuffer, frameCount, drawCount,
+        [&]() { frameDescriptors.BeginFrame(); },
+        [&](uint32_t drawIdx) {
+            perDraw.SetBuffer(0, scene.uniformBuffers[drawIdx % UNIFORM_BUFFER_COUNT].buffer);
+            fallback.CmdPushDescriptors(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, perDraw);
+        });
+    PrintResult("bind, per-frame sets", fallbackUs, drawCount);
+
+    if (ctx.pushDescriptors) {
+        PushDescriptors pushDescriptors;
+        pushDescriptors.Create(device, true, nullptr);
+
+        const VkDescriptorSetLayout pushLayout         = pushDescriptors.CreateLayout(bindings);
+        const VkPipelineLayout      pushPipelineLayout = ObjectCache::Get(device).GetPipelineLayout({pushLayout});
+
+        DescriptorSetMgmt pushed(VK_NULL_HANDLE, pushLayout);
+        pushed.SetBuffer(1, scene.storageBuffer.buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+        const double pushUs = MeasureFrames(device, cmdPool, cmdBuffer, frameCount, drawCount, []() {},
+            [&](uint32_t drawIdx) {
+                pushed.SetBuffer(0, scene.uniformBuffers[drawIdx % UNIFORM_BUFFER_COUNT].buffer);
+                pushDescriptors.CmdPushDescriptors(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pushPipelineLayout, 0,
+                                                   pushed);
+            });
+        PrintResult("push", pushUs, drawCount);
+    } else {
+        printf("  push: %s is not supported by the device\n", VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    vkDestroyCommandPool(device, cmdPool, nullptr);
+    persistentSets.Destroy();
+    frameDescriptors.Destroy();
+    for (BufferInfo& buffer : scene.uniformBuffers) {
+        buffer.Destroy(device);
+    }
+    scene.storageBuffer.Destroy(device);
+
+    MemoryAllocator::Destroy(device);
+    ObjectCache::Destroy(device);
+    SamplerCache::Destroy(device);
+
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(ctx.instance, nullptr);
+
+    return 0;
+}
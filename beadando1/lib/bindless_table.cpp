@@ -0,0 +1,304 @@
+#include "bindless_table.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#include "object_cache.h"
+
+bool BindlessTable::EnableFeatures(const VkPhysicalDevice phyDevice, VkPhysicalDeviceVulkan12Features* enable)
+{
+    // Queried structs, the driver fills everything but the chain
+    VkPhysicalDeviceVulkan12Features supported = {};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supported.pNext = nullptr;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &supported;
+
+    vkGetPhysicalDeviceFeatures2(phyDevice, &features);
+
+    const bool available = supported.runtimeDescriptorArray
+                        && supported.descriptorBindingPartiallyBound
+                        && supported.descriptorBindingSampledImageUpdateAfterBind
+                        && supported.descriptorBindingUpdateUnusedWhilePending
+                        && supported.shaderSampledImageArrayNonUniformIndexing;
+    if (!available) {
+        return false;
+    }
+
+    enable->descriptorIndexing                           = VK_TRUE;
+    enable->runtimeDescriptorArray                       = VK_TRUE;
+    enable->descriptorBindingPartiallyBound              = VK_TRUE;
+    enable->descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enable->descriptorBindingUpdateUnusedWhilePending    = VK_TRUE;
+    enable->shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+
+    return true;
+}
+
+VkResult BindlessTable::Create(const VkPhysicalDevice phyDevice,
+                               const VkDevice         device,
+                               uint32_t               maxTextures,
+                               uint32_t               maxMaterials)
+{
+    m_device           = device;
+    m_maxTextures      = maxTextures;
+    m_maxMaterials     = maxMaterials;
+    m_descriptorBuffer = DescriptorBuffer::Find(device);
+
+    const VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding            = TEXTURE_BINDING,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount    = maxTextures,
+            .stageFlags         = VK_SHADER_STAGE_ALL,
+            .pImmutableSamplers = nullptr,
+        },
+        {
+            .binding            = MATERIAL_BINDING,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount    = 1,
+            .stageFlags         = VK_SHADER_STAGE_ALL,
+            .pImmutableSamplers = nullptr,
+        },
+    };
+
+    // Only the texture array is updated while bound, the material buffer is written once below.
+    // Descriptor buffers are written in place, they have no update after bind flags.
+    VkDescriptorBindingFlags         textureFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    VkDescriptorSetLayoutCreateFlags layoutFlags  = DescriptorBuffer::LayoutCreateFlags(device);
+    if (m_descriptorBuffer == nullptr) {
+        textureFlags |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+                      | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+        layoutFlags  |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    }
+
+    const VkDescriptorBindingFlags bindingFlags[] = {
+        textureFlags,
+        0,
+    };
+
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .pNext         = nullptr,
+        .bindingCount  = (uint32_t)std::size(bindingFlags),
+        .pBindingFlags = bindingFlags,
+    };
+
+    const VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext        = &bindingFlagsInfo,
+        .flags        = layoutFlags,
+        .bindingCount = (uint32_t)std::size(bindings),
+        .pBindings    = bindings,
+    };
+
+    // Owned by the object cache, every pipeline layout built on the table shares it
+    m_layout = ObjectCache::Get(device).GetDescriptorSetLayout(layoutInfo);
+    if (m_layout == VK_NULL_HANDLE) {
+        printf("[ERROR] Bindless descriptor set layout creation failed\n");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    m_materials = BufferInfo::Create(phyDevice, device, maxMaterials * sizeof(Material),
+                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryUsage::PerFrame);
+
+    const VkDescriptorBufferInfo materialInfo = {
+        .buffer = m_materials.buffer,
+        .offset = 0,
+        .range  = VK_WHOLE_SIZE,
+    };
+
+    if (m_descriptorBuffer != nullptr) {
+        if (!m_descriptorBuffer->AllocateRange(m_descriptorBuffer->LayoutSize(m_layout), &m_range)) {
+            printf("[ERROR] Bindless descriptor buffer range allocation failed\n");
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+
+        m_set = DescriptorBuffer::SetHandle(m_range.offset);
+        m_descriptorBuffer->Write(m_set, m_layout, MATERIAL_BINDING, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                  {.buffer = materialInfo});
+        return VK_SUCCESS;
+    }
+
+    const VkDescriptorPoolSize poolSizes[] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxTextures},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+    };
+
+    const VkDescriptorPoolCreateInfo poolInfo = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext         = nullptr,
+        .flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets       = 1,
+        .poolSizeCount = (uint32_t)std::size(poolSizes),
+        .pPoolSizes    = poolSizes,
+    };
+
+    VkResult result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_pool);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Bindless descriptor pool creation failed: %d\n", result);
+        return result;
+    }
+
+    const VkDescriptorSetAllocateInfo allocInfo = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext              = nullptr,
+        .descriptorPool     = m_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts        = &m_layout,
+    };
+
+    result = vkAllocateDescriptorSets(device, &allocInfo, &m_set);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Bindless descriptor set allocation failed: %d\n", result);
+        return result;
+    }
+
+    const VkWriteDescriptorSet materialWrite = {
+        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext            = nullptr,
+        .dstSet           = m_set,
+        .dstBinding       = MATERIAL_BINDING,
+        .dstArrayElement  = 0,
+        .descriptorCount  = 1,
+        .descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pImageInfo       = nullptr,
+        .pBufferInfo      = &materialInfo,
+        .pTexelBufferView = nullptr,
+    };
+    vkUpdateDescriptorSets(device, 1, &materialWrite, 0, nullptr);
+
+    return VK_SUCCESS;
+}
+
+void BindlessTable::Destroy()
+{
+    if (m_device == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (m_materials.buffer != VK_NULL_HANDLE) {
+        m_materials.Destroy(m_device);
+    }
+
+    // The set is freed with the pool or its range
+    if (m_descriptorBuffer != nullptr) {
+        if (m_set != VK_NULL_HANDLE) {
+            m_descriptorBuffer->FreeRange(m_range);
+        }
+    } else {
+        vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    }
+
+    m_textureSlots.clear();
+    m_pool             = VK_NULL_HANDLE;
+    m_layout           = VK_NULL_HANDLE;
+    m_set              = VK_NULL_HANDLE;
+    m_descriptorBuffer = nullptr;
+    m_range            = {};
+    m_materials        = {};
+    m_textureCount     = 0;
+    m_materialCount    = 0;
+    m_device           = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessTable::AddTexture(const VkImageView view, const VkSampler sampler)
+{
+    assert(IsValid() && "BindlessTable::Create was not called");
+
+    const auto it = m_textureSlots.find({view, sampler});
+    if (it != m_textureSlots.end()) {
+        return it->second;
+    }
+
+    if (m_textureCount >= m_maxTextures) {
+        printf("[ERROR] Bindless table is full (%u textures)\n", m_maxTextures);
+        return NO_TEXTURE;
+    }
+
+    const uint32_t textureIdx = m_textureCount++;
+    WriteTexture(textureIdx, view, sampler);
+    m_textureSlots.emplace(std::make_pair(view, sampler), textureIdx);
+
+    return textureIdx;
+}
+
+void BindlessTable::SetTexture(uint32_t textureIdx, const VkImageView view, const VkSampler sampler)
+{
+    assert(textureIdx < m_textureCount);
+
+    // The old view is about to be destroyed, a new pair with the same handles must not find this slot
+    for (auto it = m_textureSlots.begin(); it != m_textureSlots.end(); ++it) {
+        if (it->second == textureIdx) {
+            m_textureSlots.erase(it);
+            break;
+        }
+    }
+
+    WriteTexture(textureIdx, view, sampler);
+    m_textureSlots[{view, sampler}] = textureIdx;
+}
+
+uint32_t BindlessTable::AddMaterial(const Material& material)
+{
+    assert(IsValid() && "BindlessTable::Create was not called");
+
+    if (m_materialCount >= m_maxMaterials) {
+        printf("[ERROR] Bindless table is full (%u materials)\n", m_maxMaterials);
+        return UINT32_MAX;
+    }
+
+    const uint32_t materialIdx = m_materialCount++;
+    SetMaterial(materialIdx, material);
+
+    return materialIdx;
+}
+
+void BindlessTable::SetMaterial(uint32_t materialIdx, const Material& material)
+{
+    assert(materialIdx < m_materialCount);
+
+    uint8_t* materials = (uint8_t*)m_materials.Map(m_device);
+    memcpy(materials + materialIdx * sizeof(Material), &material, sizeof(Material));
+    m_materials.Unmap(m_device);
+}
+
+void BindlessTable::Bind(const VkCommandBuffer cmdBuffer, const VkPipelineLayout pipelineLayout, uint32_t setIdx) const
+{
+    CmdBindDescriptorSets(m_descriptorBuffer, cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, setIdx, 1,
+                          &m_set);
+}
+
+void BindlessTable::WriteTexture(uint32_t textureIdx, const VkImageView view, const VkSampler sampler)
+{
+    // Uploaded textures are left in the general layout
+    const VkDescriptorImageInfo imageInfo = {
+        .sampler     = sampler,
+        .imageView   = view,
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+
+    if (m_descriptorBuffer != nullptr) {
+        m_descriptorBuffer->Write(m_set, m_layout, TEXTURE_BINDING, textureIdx,
+                                  VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, {.image = imageInfo});
+        return;
+    }
+
+    const VkWriteDescriptorSet write = {
+        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext            = nullptr,
+        .dstSet           = m_set,
+        .dstBinding       = TEXTURE_BINDING,
+        .dstArrayElement  = textureIdx,
+        .descriptorCount  = 1,
+        .descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo       = &imageInfo,
+        .pBufferInfo      = nullptr,
+        .pTexelBufferView = nullptr,
+    };
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
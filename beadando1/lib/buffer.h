@@ -2,12 +2,30 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include "memory_allocator.h"
+
+class UploadManager;
+
 struct BufferInfo {
-    VkDeviceSize   size;
-    VkBuffer       buffer;
-    VkDeviceMemory memory;
+    VkDeviceSize     size;
+    VkBuffer         buffer;
+    MemoryAllocation allocation;
+
+    // Creates a persistently mapped host visible buffer
+    static BufferInfo Create(const VkPhysicalDevice phyDevice,
+                             const VkDevice         device,
+                             VkDeviceSize           size,
+                             VkBufferUsageFlags     usageFlags,
+                             MemoryUsage            memoryUsage = MemoryUsage::Upload);
 
-    static BufferInfo Create(const VkPhysicalDevice phyDevice, const VkDevice device, VkDeviceSize size, VkBufferUsageFlags usageFlags);
+    // Creates a device local buffer for data that never changes (vertices, indices).
+    // The contents are queued on the upload manager and only valid once the upload completed.
+    static BufferInfo CreateStatic(const VkPhysicalDevice phyDevice,
+                                   const VkDevice         device,
+                                   UploadManager&         uploads,
+                                   const void*            data,
+                                   VkDeviceSize           size,
+                                   VkBufferUsageFlags     usageFlags);
 
     void* Map(const VkDevice device);
     void Unmap(const VkDevice device);
@@ -1,6 +1,13 @@
 #include "context.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "executable_path.h"
+#include "memory_allocator.h"
+#include "object_cache.h"
+#include "sampler_cache.h"
 
 
 VkInstance Context::CreateInstance(const std::vector<const char*>& layers, const std::vector<const char*>& extensions)
@@ -96,9 +103,51 @@ VkDevice Context::CreateDevice(const std::vector<const char*>& extensions)
     std::vector<const char *> finalExtensions = extensions;
     finalExtensions.insert(finalExtensions.end(), swapchainExtensions.begin(), swapchainExtensions.end());
 
+    // Optional: live heap budget/usage for the memory statistics
+    const bool useMemoryBudget = IsDeviceExtensionSupported(m_phyDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (useMemoryBudget) {
+        finalExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    // Value initialized, designated initializers would have to list every feature
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures = {};
+    descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    descriptorBufferFeatures.pNext = nullptr;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext             = nullptr;
+    vulkan12Features.timelineSemaphore = VK_TRUE; // used by the upload manager
+
+    // Optional, when requested: descriptors written straight into a buffer instead of pools and sets
+    const bool useDescriptorBuffer = m_requestedDescriptorBackend == DescriptorBackend::Buffer
+        && IsDeviceExtensionSupported(m_phyDevice, VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME)
+        && DescriptorBuffer::EnableFeatures(m_phyDevice, &descriptorBufferFeatures, &vulkan12Features);
+    if (useDescriptorBuffer) {
+        finalExtensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+        vulkan12Features.pNext = &descriptorBufferFeatures;
+    } else if (m_requestedDescriptorBackend == DescriptorBackend::Buffer) {
+        printf("Descriptor buffers are not supported, using descriptor sets\n");
+    }
+
+    // Optional: per-draw descriptors written into the command buffer, sets are allocated per frame without it.
+    // Next to descriptor buffers only when the device can push without a buffer of their own.
+    const bool usePushDescriptors = IsDeviceExtensionSupported(m_phyDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)
+        && (!useDescriptorBuffer || descriptorBufferFeatures.descriptorBufferPushDescriptors);
+    if (usePushDescriptors) {
+        finalExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    // Descriptor indexing for the bindless texture and material table, optional unless the application requires it
+    const bool useBindless = BindlessTable::EnableFeatures(m_phyDevice, &vulkan12Features);
+    if (!useBindless && m_requireBindless) {
+        printf("[ERROR] Descriptor indexing is not supported, the application requires the bindless table\n");
+        return VK_NULL_HANDLE;
+    }
+
     VkPhysicalDeviceSynchronization2Features syncFeatures = {
         .sType              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
-        .pNext              = nullptr,
+        .pNext              = &vulkan12Features,
         .synchronization2   = VK_TRUE,
     };
 
@@ -108,41 +157,113 @@ VkDevice Context::CreateDevice(const std::vector<const char*>& extensions)
         .dynamicRendering   = VK_TRUE,
     };
 
+    // Optional: anisotropic filtering, the sampler cache clamps the requests when it is not available
+    VkPhysicalDeviceFeatures supportedFeatures = {};
+    vkGetPhysicalDeviceFeatures(m_phyDevice, &supportedFeatures);
+
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    enabledFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+
     const float queuePriority[1] = { 1.0f };
 
-    const VkDeviceQueueCreateInfo queueInfo = {
-        .sType              = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-        .pNext              = nullptr,
-        .flags              = 0,
-        .queueFamilyIndex   = m_queueFamilyIdx,
-        .queueCount         = 1,
-        .pQueuePriorities   = queuePriority,
+    std::vector<VkDeviceQueueCreateInfo> queueInfos = {
+        {
+            .sType              = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext              = nullptr,
+            .flags              = 0,
+            .queueFamilyIndex   = m_queueFamilyIdx,
+            .queueCount         = 1,
+            .pQueuePriorities   = queuePriority,
+        },
     };
 
+    m_transferQueueFamilyIdx = FindTransferQueueFamily(m_phyDevice, m_queueFamilyIdx);
+    if (m_transferQueueFamilyIdx != m_queueFamilyIdx) {
+        queueInfos.push_back({
+            .sType              = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext              = nullptr,
+            .flags              = 0,
+            .queueFamilyIndex   = m_transferQueueFamilyIdx,
+            .queueCount         = 1,
+            .pQueuePriorities   = queuePriority,
+        });
+    }
+
     const VkDeviceCreateInfo createInfo = {
         .sType                      = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
         .pNext                      = &dynamicRendering,
         .flags                      = 0,
-        .queueCreateInfoCount       = 1,
-        .pQueueCreateInfos          = &queueInfo,
+        .queueCreateInfoCount       = (uint32_t)queueInfos.size(),
+        .pQueueCreateInfos          = queueInfos.data(),
         .enabledLayerCount          = 0,        // deprecated
         .ppEnabledLayerNames        = nullptr,  // deprecated
         .enabledExtensionCount      = (uint32_t)finalExtensions.size(),
         .ppEnabledExtensionNames    = finalExtensions.data(),
-        .pEnabledFeatures           = nullptr,
+        .pEnabledFeatures           = &enabledFeatures,
     };
 
     VkResult result = vkCreateDevice(m_phyDevice, &createInfo, nullptr, &m_device);
     assert((result == VK_SUCCESS) && "VkDevice creation failed");
 
     vkGetDeviceQueue(m_device, m_queueFamilyIdx, 0, &m_queue);
+    vkGetDeviceQueue(m_device, m_transferQueueFamilyIdx, 0, &m_transferQueue);
+
+    // The allocator queries the memory properties and builds the memory type policy once for the device
+    MemoryAllocator& allocator = MemoryAllocator::Get(m_phyDevice, m_device);
+    if (useMemoryBudget) {
+        allocator.EnableMemoryBudget();
+    }
+
+    // Before any buffer is created: descriptor buffers address the buffers they reference
+    if (useDescriptorBuffer) {
+        allocator.EnableBufferDeviceAddress();
+
+        m_descriptorBuffer = DescriptorBuffer::Create(m_phyDevice, m_device);
+        assert((m_descriptorBuffer != nullptr) && "DescriptorBuffer creation failed");
+        printf("Using descriptor buffers\n");
+    }
+
+    if (allocator.policy().HasResizableBar()) {
+        printf("Resizable BAR available, per-frame data is placed in device local memory\n");
+    }
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(m_phyDevice, &properties);
+    SamplerCache::Get(m_device).SetDeviceLimits(properties.limits, enabledFeatures.samplerAnisotropy == VK_TRUE);
+
+    result = m_pipelineCache.Create(m_phyDevice, m_device, ExecutableRelativePath(m_appName + ".pipeline_cache"));
+    assert((result == VK_SUCCESS) && "PipelineCache creation failed");
+
+    if (HasDedicatedTransferQueue()) {
+        printf("Using dedicated transfer queue family: %u\n", m_transferQueueFamilyIdx);
+    }
 
+    result = m_uploads.Create(m_phyDevice, m_device, m_queue, m_queueFamilyIdx, m_transferQueue,
+                              m_transferQueueFamilyIdx);
+    assert((result == VK_SUCCESS) && "UploadManager creation failed");
+
+    m_textureLoader.Create(m_phyDevice, m_device, m_uploads);
+    m_textureCache.Create(m_device, m_textureLoader);
+    m_textureStreamer.Create(m_phyDevice, m_device, m_uploads, m_textureLoader);
+
+    m_pushDescriptors.Create(m_device, usePushDescriptors, &m_frameDescriptors);
+
+    if (useBindless) {
+        result = m_bindless.Create(m_phyDevice, m_device);
+        assert((result == VK_SUCCESS) && "BindlessTable creation failed");
+    } else {
+        printf("Descriptor indexing is not supported, the bindless table is not available\n");
+    }
+
+    // Only sizes the first pool, the pool grows with the sets allocated from it
+    const uint32_t firstPoolSets = DescriptorAllocator::DEFAULT_SETS_PER_POOL;
     CreateDescriptorPool(
         {
-            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100},
-            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, firstPoolSets},
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, firstPoolSets},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, firstPoolSets},
         },
-        100);
+        firstPoolSets);
 
     return m_device;
 }
@@ -155,6 +276,20 @@ DescriptorPool Context::CreateDescriptorPool(const std::unordered_map<VkDescript
     return m_descriptorPool;
 }
 
+FrameDescriptorAllocator& Context::CreateFrameDescriptors(uint32_t frameCount)
+{
+    // A guess for the first pools only, later pools follow the layouts actually allocated
+    DescriptorTypeCounts countsPerSet                       = {};
+    countsPerSet[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER]         = 1;
+    countsPerSet[VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC] = 1;
+    countsPerSet[VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER] = 1;
+
+    const VkResult result = m_frameDescriptors.Create(m_device, frameCount, countsPerSet);
+    assert((result == VK_SUCCESS) && "FrameDescriptorAllocator creation failed");
+
+    return m_frameDescriptors;
+}
+
 VkCommandPool Context::CreateCommandPool()
 {
     const VkCommandPoolCreateInfo createInfo = {
@@ -170,9 +305,36 @@ VkCommandPool Context::CreateCommandPool()
     return m_commandPool;
 }
 
+VkResult Context::FlushUploads()
+{
+    const VkResult result = m_uploads.WaitIdle();
+    assert((result == VK_SUCCESS) && "Waiting for uploads failed");
+
+    return result;
+}
+
 void Context::Destroy()
 {
+    m_textureCache.Destroy();
+    m_textureStreamer.Destroy();
+    m_bindless.Destroy();
+    m_textureLoader.Destroy();
+    m_uploads.Destroy();
     m_descriptorPool.Destroy();
+    m_frameDescriptors.Destroy();
+
+    DescriptorBuffer::Destroy(m_device);
+    m_descriptorBuffer = nullptr;
+
+    // Pipelines compiled during this run are kept for the next one
+    m_pipelineCache.Save();
+    m_pipelineCache.Destroy();
+
+    MemoryAllocator::Destroy(m_device);
+    // The layouts may reference immutable samplers, destroy them first
+    ObjectCache::Destroy(m_device);
+    SamplerCache::Destroy(m_device);
+
     vkDestroyDevice(m_device, nullptr);
     vkDestroyInstance(m_instance, nullptr);
 }
@@ -203,3 +365,54 @@ bool Context::FindQueueFamily(const VkPhysicalDevice phyDevice, const VkSurfaceK
 
     return false;
 }
+
+const MemoryTypePolicy& Context::memoryPolicy() const
+{
+    return MemoryAllocator::Get(m_phyDevice, m_device).policy();
+}
+
+bool Context::IsDeviceExtensionSupported(const VkPhysicalDevice phyDevice, const char* extensionName)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(phyDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(phyDevice, nullptr, &extensionCount, extensions.data());
+
+    for (const VkExtensionProperties& extension : extensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t Context::FindTransferQueueFamily(const VkPhysicalDevice phyDevice, uint32_t graphicsQueueFamilyIdx)
+{
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(phyDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(phyDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Prefer a transfer only family (usually backed by a DMA engine), then any non graphics family
+    // which can do transfers. Fall back to the graphics family if there is no such family.
+    uint32_t candidate = graphicsQueueFamilyIdx;
+    for (uint32_t idx = 0; idx < queueFamilyCount; idx++) {
+        const VkQueueFlags flags = queueFamilies[idx].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0) {
+            continue;
+        }
+
+        if ((flags & VK_QUEUE_COMPUTE_BIT) == 0) {
+            return idx;
+        }
+
+        if (candidate == graphicsQueueFamilyIdx) {
+            candidate = idx;
+        }
+    }
+
+    return candidate;
+}
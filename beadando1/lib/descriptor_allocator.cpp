@@ -0,0 +1,282 @@
+#include "descriptor_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+VkResult DescriptorAllocator::Create(const VkDevice              device,
+                                     const DescriptorTypeCounts& countsPerSet,
+                                     uint32_t                    setsPerPool,
+                                     VkDescriptorPoolCreateFlags flags)
+{
+    m_device         = device;
+    m_flags          = flags;
+    m_expectedCounts = countsPerSet;
+    m_nextPoolSets   = std::clamp(setsPerPool, 1u, MAX_SETS_PER_POOL);
+    m_usedCounts     = {};
+    m_usedBytes      = 0;
+    m_usedSets       = 0;
+    m_currentPool    = 0;
+    m_stats          = {};
+
+    m_descriptorBuffer = DescriptorBuffer::Find(device);
+    if (m_descriptorBuffer != nullptr) {
+        return CreateChunk(0);
+    }
+
+    return CreatePool(countsPerSet);
+}
+
+void DescriptorAllocator::Destroy()
+{
+    // The sets are freed with their pools
+    for (VkDescriptorPool pool : m_pools) {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+    for (const Chunk& chunk : m_chunks) {
+        m_descriptorBuffer->FreeRange(chunk.range);
+    }
+
+    m_pools.clear();
+    m_chunks.clear();
+    m_currentPool = 0;
+}
+
+VkResult DescriptorAllocator::CreatePool(const DescriptorTypeCounts& required)
+{
+    const uint32_t maxSets = m_nextPoolSets;
+
+    // Until the first allocation the expected counts are all there is to go on
+    VkDescriptorPoolSize poolSizes[CORE_DESCRIPTOR_TYPE_COUNT];
+    uint32_t             poolSizeCount = 0;
+    for (uint32_t type = 0; type < CORE_DESCRIPTOR_TYPE_COUNT; type++) {
+        uint64_t count = (uint64_t)m_expectedCounts[type] * maxSets;
+        if (m_usedSets > 0) {
+            count = (m_usedCounts[type] * maxSets + m_usedSets - 1) / m_usedSets;
+        }
+        count = std::max<uint64_t>(count, required[type]);
+
+        if (count > 0) {
+            poolSizes[poolSizeCount++] = {(VkDescriptorType)type, (uint32_t)std::min<uint64_t>(count, UINT32_MAX)};
+        }
+    }
+
+    // A pool needs at least one pool size
+    if (poolSizeCount == 0) {
+        poolSizes[poolSizeCount++] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1};
+    }
+
+    const VkDescriptorPoolCreateInfo createInfo = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext         = nullptr,
+        .flags         = m_flags,
+        .maxSets       = maxSets,
+        .poolSizeCount = poolSizeCount,
+        .pPoolSizes    = poolSizes,
+    };
+
+    VkDescriptorPool pool   = VK_NULL_HANDLE;
+    const VkResult   result = vkCreateDescriptorPool(m_device, &createInfo, nullptr, &pool);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Descriptor pool creation failed (%u sets): %d\n", maxSets, result);
+        return result;
+    }
+
+    m_pools.push_back(pool);
+    m_nextPoolSets = std::min(maxSets * 2, MAX_SETS_PER_POOL);
+    m_stats.poolCount++;
+
+    return VK_SUCCESS;
+}
+
+VkResult DescriptorAllocator::CreateChunk(VkDeviceSize requiredBytes)
+{
+    const uint32_t maxSets = m_nextPoolSets;
+
+    // Sized like the pools: from the expected set until the first allocation, from the average set after it
+    VkDeviceSize setBytes = m_descriptorBuffer->EstimateSetSize(m_expectedCounts);
+    if (m_usedSets > 0) {
+        setBytes = (m_usedBytes + m_usedSets - 1) / m_usedSets;
+    }
+
+    DescriptorBuffer::Range range;
+    if (!m_descriptorBuffer->AllocateRange(std::max(setBytes * maxSets, requiredBytes), &range)) {
+        return VK_ERROR_OUT_OF_POOL_MEMORY;
+    }
+
+    m_chunks.push_back({range, 0});
+    m_nextPoolSets = std::min(maxSets * 2, MAX_SETS_PER_POOL);
+    m_stats.poolCount++;
+
+    return VK_SUCCESS;
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateFromBuffer(const VkDescriptorSetLayout layout)
+{
+    const VkDeviceSize setBytes = m_descriptorBuffer->LayoutSize(layout);
+    if (setBytes == 0) {
+        printf("[ERROR] Descriptor set layout is not known to the descriptor buffer\n");
+        m_stats.failedAllocations++;
+        return VK_NULL_HANDLE;
+    }
+
+    m_usedBytes += setBytes;
+    m_usedSets++;
+
+    // Move on to the next chunk while the current one is full, a new chunk always fits the set
+    while (m_chunks[m_currentPool].used + setBytes > m_chunks[m_currentPool].range.size) {
+        if (m_currentPool + 1 == m_chunks.size()) {
+            if (CreateChunk(setBytes) != VK_SUCCESS) {
+                m_stats.failedAllocations++;
+                return VK_NULL_HANDLE;
+            }
+
+            m_stats.growthEvents++;
+        }
+
+        m_currentPool++;
+    }
+
+    Chunk&             chunk  = m_chunks[m_currentPool];
+    const VkDeviceSize offset = chunk.range.offset + chunk.used;
+    chunk.used += setBytes;
+
+    m_stats.setsAllocated++;
+    m_stats.setsSinceReset++;
+
+    return DescriptorBuffer::SetHandle(offset);
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(const VkDescriptorSetLayout layout)
+{
+    assert(IsValid() && "DescriptorAllocator::Create must be called first");
+
+    if (m_descriptorBuffer != nullptr) {
+        return AllocateFromBuffer(layout);
+    }
+
+    // Record what the set holds, new pools are sized from it
+    DescriptorTypeCounts counts = m_expectedCounts;
+    if (const ObjectCache* objects = ObjectCache::Find(m_device)) {
+        objects->GetDescriptorCounts(layout, &counts);
+    }
+
+    for (uint32_t type = 0; type < CORE_DESCRIPTOR_TYPE_COUNT; type++) {
+        m_usedCounts[type] += counts[type];
+    }
+    m_usedSets++;
+
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext              = nullptr,
+        .descriptorPool     = m_pools[m_currentPool],
+        .descriptorSetCount = 1,
+        .pSetLayouts        = &layout,
+    };
+
+    VkDescriptorSet set    = VK_NULL_HANDLE;
+    VkResult        result = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+
+    // Move on to the next pool while the current one is full, a new pool is the last try
+    bool newPool = false;
+    while ((result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) && !newPool) {
+        if (m_currentPool + 1 == m_pools.size()) {
+            if (CreatePool(counts) != VK_SUCCESS) {
+                break;
+            }
+
+            m_stats.growthEvents++;
+            newPool = true;
+        }
+
+        m_currentPool++;
+        allocInfo.descriptorPool = m_pools[m_currentPool];
+        result                   = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+    }
+
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Descriptor set allocation failed: %d\n", result);
+        m_stats.failedAllocations++;
+        return VK_NULL_HANDLE;
+    }
+
+    m_stats.setsAllocated++;
+    m_stats.setsSinceReset++;
+
+    return set;
+}
+
+void DescriptorAllocator::Reset()
+{
+    // Pools after the current one have not been used since the last reset
+    for (uint32_t idx = 0; idx <= m_currentPool && idx < m_pools.size(); idx++) {
+        vkResetDescriptorPool(m_device, m_pools[idx], 0);
+    }
+    for (uint32_t idx = 0; idx <= m_currentPool && idx < m_chunks.size(); idx++) {
+        m_chunks[idx].used = 0;
+    }
+
+    m_currentPool          = 0;
+    m_stats.setsSinceReset = 0;
+}
+
+VkResult FrameDescriptorAllocator::Create(const VkDevice              device,
+                                          uint32_t                    frameCount,
+                                          const DescriptorTypeCounts& countsPerSet,
+                                          uint32_t                    setsPerPool)
+{
+    assert(frameCount > 0);
+
+    m_frames.resize(frameCount);
+    for (DescriptorAllocator& frame : m_frames) {
+        const VkResult result = frame.Create(device, countsPerSet, setsPerPool);
+        if (result != VK_SUCCESS) {
+            Destroy();
+            return result;
+        }
+    }
+
+    // Start on the last frame so the first BeginFrame() selects frame zero
+    m_frameIdx      = frameCount - 1;
+    m_lastFrameSets = 0;
+    m_highWaterMark = 0;
+
+    return VK_SUCCESS;
+}
+
+void FrameDescriptorAllocator::Destroy()
+{
+    for (DescriptorAllocator& frame : m_frames) {
+        frame.Destroy();
+    }
+
+    m_frames.clear();
+    m_frameIdx = 0;
+}
+
+void FrameDescriptorAllocator::BeginFrame()
+{
+    m_lastFrameSets = SetsThisFrame();
+    m_highWaterMark = std::max(m_highWaterMark, m_lastFrameSets);
+
+    m_frameIdx = (m_frameIdx + 1) % (uint32_t)m_frames.size();
+    m_frames[m_frameIdx].Reset();
+}
+
+uint32_t FrameDescriptorAllocator::PoolCount() const
+{
+    uint32_t count = 0;
+    for (const DescriptorAllocator& frame : m_frames) {
+        count += frame.GetStats().poolCount;
+    }
+    return count;
+}
+
+uint32_t FrameDescriptorAllocator::GrowthEvents() const
+{
+    uint32_t count = 0;
+    for (const DescriptorAllocator& frame : m_frames) {
+        count += frame.GetStats().growthEvents;
+    }
+    return count;
+}
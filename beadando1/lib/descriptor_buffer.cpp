@@ -0,0 +1,478 @@
+#include "descriptor_buffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+std::mutex                                                      g_descriptorBuffersMutex;
+std::unordered_map<VkDevice, std::unique_ptr<DescriptorBuffer>> g_descriptorBuffers;
+
+constexpr VkBufferUsageFlags DESCRIPTOR_BUFFER_USAGE =
+    VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+
+// Largest descriptor of any implementation is well below this
+constexpr size_t MAX_DESCRIPTOR_SIZE = 256;
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+T LoadDeviceFunction(const VkDevice device, const char* name)
+{
+    return (T)vkGetDeviceProcAddr(device, name);
+}
+
+} // anonymous namespace
+
+bool DescriptorBuffer::EnableFeatures(const VkPhysicalDevice                      phyDevice,
+                                      VkPhysicalDeviceDescriptorBufferFeaturesEXT* enable,
+                                      VkPhysicalDeviceVulkan12Features*            enable12)
+{
+    // Queried structs, the driver fills everything but the chain
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT supported = {};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    supported.pNext = nullptr;
+
+    VkPhysicalDeviceVulkan12Features supported12 = {};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supported12.pNext = &supported;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &supported12;
+
+    vkGetPhysicalDeviceFeatures2(phyDevice, &features);
+
+    if (!supported.descriptorBuffer || !supported12.bufferDeviceAddress) {
+        return false;
+    }
+
+    // Pushed sets are only used when they need no buffer of their own
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties = {};
+    descriptorBufferProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+    descriptorBufferProperties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &descriptorBufferProperties;
+
+    vkGetPhysicalDeviceProperties2(phyDevice, &properties);
+
+    enable->descriptorBuffer                = VK_TRUE;
+    enable->descriptorBufferPushDescriptors = supported.descriptorBufferPushDescriptors
+                                           && descriptorBufferProperties.bufferlessPushDescriptors;
+    enable12->bufferDeviceAddress           = VK_TRUE;
+
+    return true;
+}
+
+DescriptorBuffer* DescriptorBuffer::Create(const VkPhysicalDevice phyDevice, const VkDevice device, VkDeviceSize size)
+{
+    std::unique_ptr<DescriptorBuffer> descriptorBuffer = std::make_unique<DescriptorBuffer>(phyDevice, device);
+    if (!descriptorBuffer->Init(size)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(g_descriptorBuffersMutex);
+
+    std::unique_ptr<DescriptorBuffer>& entry = g_descriptorBuffers[device];
+    assert(!entry && "The device already has a descriptor buffer");
+    entry = std::move(descriptorBuffer);
+
+    return entry.get();
+}
+
+DescriptorBuffer* DescriptorBuffer::Find(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_descriptorBuffersMutex);
+
+    const auto it = g_descriptorBuffers.find(device);
+    return (it != g_descriptorBuffers.end()) ? it->second.get() : nullptr;
+}
+
+void DescriptorBuffer::Destroy(const VkDevice device)
+{
+    std::unique_ptr<DescriptorBuffer> descriptorBuffer;
+    {
+        std::lock_guard<std::mutex> lock(g_descriptorBuffersMutex);
+
+        const auto it = g_descriptorBuffers.find(device);
+        if (it == g_descriptorBuffers.end()) {
+            return;
+        }
+
+        descriptorBuffer = std::move(it->second);
+        g_descriptorBuffers.erase(it);
+    }
+
+    // Destroyed here, outside of the lock: freeing the buffer looks up the device again
+}
+
+VkDescriptorSetLayoutCreateFlags DescriptorBuffer::LayoutCreateFlags(const VkDevice device)
+{
+    return (Find(device) != nullptr) ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+}
+
+VkPipelineCreateFlags DescriptorBuffer::PipelineCreateFlags(const VkDevice device)
+{
+    return (Find(device) != nullptr) ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+}
+
+DescriptorBuffer::DescriptorBuffer(const VkPhysicalDevice phyDevice, const VkDevice device)
+    : m_phyDevice(phyDevice)
+    , m_device(device)
+{
+}
+
+DescriptorBuffer::~DescriptorBuffer()
+{
+    assert(m_ranges.IsEmpty() && "Descriptor buffer ranges are still in use");
+
+    if (m_buffer.buffer != VK_NULL_HANDLE) {
+        m_buffer.Destroy(m_device);
+    }
+}
+
+bool DescriptorBuffer::Init(VkDeviceSize size)
+{
+    m_properties       = {};
+    m_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+    m_properties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &m_properties;
+
+    vkGetPhysicalDeviceProperties2(m_phyDevice, &properties);
+    m_properties.pNext = nullptr;
+
+    m_getLayoutSize =
+        LoadDeviceFunction<PFN_vkGetDescriptorSetLayoutSizeEXT>(m_device, "vkGetDescriptorSetLayoutSizeEXT");
+    m_getBindingOffset = LoadDeviceFunction<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(
+        m_device, "vkGetDescriptorSetLayoutBindingOffsetEXT");
+    m_getDescriptor  = LoadDeviceFunction<PFN_vkGetDescriptorEXT>(m_device, "vkGetDescriptorEXT");
+    m_cmdBindBuffers = LoadDeviceFunction<PFN_vkCmdBindDescriptorBuffersEXT>(m_device, "vkCmdBindDescriptorBuffersEXT");
+    m_cmdSetBufferOffsets =
+        LoadDeviceFunction<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(m_device, "vkCmdSetDescriptorBufferOffsetsEXT");
+
+    if (m_getLayoutSize == nullptr || m_getBindingOffset == nullptr || m_getDescriptor == nullptr
+        || m_cmdBindBuffers == nullptr || m_cmdSetBufferOffsets == nullptr) {
+        printf("[ERROR] VK_EXT_descriptor_buffer functions are not available\n");
+        return false;
+    }
+
+    // Every set is addressed from the start of the single bound buffer, through both the sampler and the
+    // resource binding
+    size = std::min({size, m_properties.maxSamplerDescriptorBufferRange,
+                     m_properties.maxResourceDescriptorBufferRange});
+
+    // Written by the CPU, read by every draw: the same placement as per-frame data
+    m_buffer = BufferInfo::Create(m_phyDevice, m_device, size,
+                                  DESCRIPTOR_BUFFER_USAGE | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                                  MemoryUsage::PerFrame);
+    m_mapped = (uint8_t*)m_buffer.Map(m_device);
+
+    const VkBufferDeviceAddressInfo addressInfo = {
+        .sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .pNext  = nullptr,
+        .buffer = m_buffer.buffer,
+    };
+    m_address = vkGetBufferDeviceAddress(m_device, &addressInfo);
+    assert(m_address % m_properties.descriptorBufferOffsetAlignment == 0);
+
+    m_ranges.Reset(size);
+
+    return true;
+}
+
+bool DescriptorBuffer::AllocateRange(VkDeviceSize size, Range* outRange)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    TLSFAllocator::Allocation allocation;
+    if (!m_ranges.Allocate(size, m_properties.descriptorBufferOffsetAlignment, &allocation)) {
+        printf("[ERROR] Descriptor buffer is full (%llu of %llu bytes used, %llu requested)\n",
+               (unsigned long long)m_ranges.UsedBytes(), (unsigned long long)m_ranges.Size(),
+               (unsigned long long)size);
+        return false;
+    }
+
+    *outRange = {
+        .offset = allocation.offset,
+        .size   = allocation.size,
+        .node   = allocation.node,
+    };
+    return true;
+}
+
+void DescriptorBuffer::FreeRange(const Range& range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ranges.Free(range.node);
+}
+
+const DescriptorBuffer::LayoutInfo* DescriptorBuffer::FindLayout(const VkDescriptorSetLayout layout)
+{
+    const auto it = m_layouts.find(layout);
+    if (it != m_layouts.end()) {
+        return &it->second;
+    }
+
+    // The binding types and counts are not available from Vulkan, only the cache knows them
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    const ObjectCache*                        objects = ObjectCache::Find(m_device);
+    if (objects == nullptr || !objects->GetBindings(layout, &bindings)) {
+        return nullptr;
+    }
+
+    LayoutInfo info;
+    m_getLayoutSize(m_device, layout, &info.size);
+    info.size = AlignUp(std::max<VkDeviceSize>(info.size, 1), m_properties.descriptorBufferOffsetAlignment);
+
+    for (const VkDescriptorSetLayoutBinding& binding : bindings) {
+        if (binding.descriptorCount == 0) {
+            continue;
+        }
+
+        BindingInfo bindingInfo = {binding.binding, binding.descriptorType, binding.descriptorCount, 0};
+        m_getBindingOffset(m_device, layout, binding.binding, &bindingInfo.offset);
+        info.bindings.push_back(bindingInfo);
+    }
+
+    std::sort(info.bindings.begin(), info.bindings.end(),
+              [](const BindingInfo& lhs, const BindingInfo& rhs) { return lhs.binding < rhs.binding; });
+
+    return &m_layouts.emplace(layout, std::move(info)).first->second;
+}
+
+VkDeviceSize DescriptorBuffer::LayoutSize(const VkDescriptorSetLayout layout)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const LayoutInfo* info = FindLayout(layout);
+    return (info != nullptr) ? info->size : 0;
+}
+
+VkDeviceSize DescriptorBuffer::EstimateSetSize(const DescriptorTypeCounts& counts) const
+{
+    VkDeviceSize size = 0;
+    for (uint32_t type = 0; type < CORE_DESCRIPTOR_TYPE_COUNT; type++) {
+        size += counts[type] * DescriptorSize((VkDescriptorType)type);
+    }
+
+    return AlignUp(std::max<VkDeviceSize>(size, 1), m_properties.descriptorBufferOffsetAlignment);
+}
+
+VkDeviceSize DescriptorBuffer::DescriptorSize(VkDescriptorType type) const
+{
+    switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        return m_properties.samplerDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        return m_properties.combinedImageSamplerDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        return m_properties.sampledImageDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        return m_properties.storageImageDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        return m_properties.uniformTexelBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return m_properties.storageTexelBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        return m_properties.uniformBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        return m_properties.storageBufferDescriptorSize;
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        return m_properties.inputAttachmentDescriptorSize;
+    default:
+        // Dynamic buffers do not exist with descriptor buffers
+        return 0;
+    }
+}
+
+void DescriptorBuffer::Write(const VkDescriptorSet       set,
+                             const VkDescriptorSetLayout layout,
+                             uint32_t                    binding,
+                             uint32_t                    arrayElement,
+                             VkDescriptorType            type,
+                             const DescriptorInfo&       info)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const LayoutInfo* layoutInfo = FindLayout(layout);
+    if (layoutInfo == nullptr) {
+        printf("[ERROR] Descriptor set layout is not known to the descriptor buffer\n");
+        return;
+    }
+
+    const auto bindingIt =
+        std::lower_bound(layoutInfo->bindings.begin(), layoutInfo->bindings.end(), binding,
+                         [](const BindingInfo& entry, uint32_t value) { return entry.binding < value; });
+    if (bindingIt == layoutInfo->bindings.end() || bindingIt->binding != binding || arrayElement >= bindingIt->count) {
+        printf("[ERROR] Descriptor binding %u[%u] is not in the layout\n", binding, arrayElement);
+        return;
+    }
+    assert(bindingIt->type == type && "Descriptor type does not match the layout");
+
+    VkDescriptorGetInfoEXT getInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+        .pNext = nullptr,
+        .type  = type,
+        .data  = {},
+    };
+    VkDescriptorAddressInfoEXT addressInfo = {
+        .sType   = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT,
+        .pNext   = nullptr,
+        .address = 0,
+        .range   = 0,
+        .format  = VK_FORMAT_UNDEFINED,
+    };
+
+    switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+        getInfo.data.pSampler = &info.image.sampler;
+        break;
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        getInfo.data.pCombinedImageSampler = &info.image;
+        break;
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        getInfo.data.pSampledImage = &info.image;
+        break;
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        getInfo.data.pStorageImage = &info.image;
+        break;
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        getInfo.data.pInputAttachmentImage = &info.image;
+        break;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: {
+        const auto bufferIt = m_bufferAddresses.find(info.buffer.buffer);
+        if (bufferIt == m_bufferAddresses.end()) {
+            printf("[ERROR] Buffer of descriptor binding %u is not registered\n", binding);
+            return;
+        }
+
+        const BufferAddress& buffer = bufferIt->second;
+        addressInfo.address         = buffer.address + info.buffer.offset;
+        addressInfo.range = (info.buffer.range == VK_WHOLE_SIZE) ? buffer.size - info.buffer.offset : info.buffer.range;
+
+        if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+            getInfo.data.pUniformBuffer = &addressInfo;
+        } else {
+            getInfo.data.pStorageBuffer = &addressInfo;
+        }
+        break;
+    }
+    default:
+        printf("[ERROR] Descriptor type %d is not supported by the descriptor buffer\n", type);
+        return;
+    }
+
+    const size_t descriptorSize = DescriptorSize(type);
+    uint8_t*     bindingData    = m_mapped + SetOffset(set) + bindingIt->offset;
+
+    VkDeviceSize writtenOffset = 0;
+    VkDeviceSize writtenSize   = 0;
+
+    if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && !m_properties.combinedImageSamplerDescriptorSingleArray) {
+        // The binding holds every image descriptor first, then every sampler descriptor
+        const size_t imageSize   = m_properties.sampledImageDescriptorSize;
+        const size_t samplerSize = m_properties.samplerDescriptorSize;
+        assert(descriptorSize <= MAX_DESCRIPTOR_SIZE && imageSize + samplerSize <= descriptorSize);
+
+        uint8_t combined[MAX_DESCRIPTOR_SIZE];
+        m_getDescriptor(m_device, &getInfo, descriptorSize, combined);
+
+        uint8_t* samplers = bindingData + bindingIt->count * imageSize;
+        memcpy(bindingData + arrayElement * imageSize, combined, imageSize);
+        memcpy(samplers + arrayElement * samplerSize, combined + imageSize, samplerSize);
+
+        writtenOffset = (bindingData - m_mapped) + arrayElement * imageSize;
+        writtenSize   = (samplers - m_mapped) + (arrayElement + 1) * samplerSize - writtenOffset;
+    } else {
+        uint8_t* descriptor = bindingData + arrayElement * descriptorSize;
+        m_getDescriptor(m_device, &getInfo, descriptorSize, descriptor);
+
+        writtenOffset = descriptor - m_mapped;
+        writtenSize   = descriptorSize;
+    }
+
+    m_descriptorWrites++;
+
+    // No-op unless the buffer landed in non coherent memory
+    MemoryAllocator::Find(m_device)->Flush(m_buffer.allocation, writtenOffset, writtenSize);
+}
+
+void DescriptorBuffer::RegisterBuffer(const VkBuffer buffer, VkDeviceSize size)
+{
+    const VkBufferDeviceAddressInfo addressInfo = {
+        .sType  = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+        .pNext  = nullptr,
+        .buffer = buffer,
+    };
+    const VkDeviceAddress address = vkGetBufferDeviceAddress(m_device, &addressInfo);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bufferAddresses[buffer] = {address, size};
+}
+
+void DescriptorBuffer::UnregisterBuffer(const VkBuffer buffer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bufferAddresses.erase(buffer);
+}
+
+void DescriptorBuffer::CmdBindSets(const VkCommandBuffer     cmdBuffer,
+                                   const VkPipelineBindPoint bindPoint,
+                                   const VkPipelineLayout    pipelineLayout,
+                                   uint32_t                  firstSet,
+                                   uint32_t                  setCount,
+                                   const VkDescriptorSet*    sets)
+{
+    assert(setCount <= MAX_BOUND_SETS);
+
+    // The bound buffer is command buffer state: it is bound again with the sets, so users do not have to track
+    // where their command buffers begin. Binding the same buffer again does not disturb the sets bound from it.
+    const VkDescriptorBufferBindingInfoEXT bindingInfo = {
+        .sType   = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+        .pNext   = nullptr,
+        .address = m_address,
+        .usage   = DESCRIPTOR_BUFFER_USAGE,
+    };
+    m_cmdBindBuffers(cmdBuffer, 1, &bindingInfo);
+
+    const uint32_t bufferIndices[MAX_BOUND_SETS] = {};
+    VkDeviceSize   offsets[MAX_BOUND_SETS];
+    for (uint32_t idx = 0; idx < setCount; idx++) {
+        offsets[idx] = SetOffset(sets[idx]);
+    }
+
+    m_cmdSetBufferOffsets(cmdBuffer, bindPoint, pipelineLayout, firstSet, setCount, bufferIndices, offsets);
+}
+
+DescriptorBuffer::Stats DescriptorBuffer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return {
+        .size             = m_ranges.Size(),
+        .usedBytes        = m_ranges.UsedBytes(),
+        .rangeCount       = m_ranges.AllocationCount(),
+        .descriptorWrites = m_descriptorWrites,
+    };
+}
+
+void DescriptorBuffer::PrintStats() const
+{
+    const Stats stats = GetStats();
+
+    printf("Descriptor buffer: %llu of %llu bytes in %u ranges, %llu descriptor writes\n",
+           (unsigned long long)stats.usedBytes, (unsigned long long)stats.size, stats.rangeCount,
+           (unsigned long long)stats.descriptorWrites);
+}
@@ -5,18 +5,25 @@
 #include <unordered_map>
 #include <utility>
 
-size_t descriptorSetLayoutBindingVectorHash(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
-// TODO: avoid number -> string -> number conversion
+#include "descriptor_buffer.h"
+#include "object_cache.h"
+
+namespace {
+
+// Pool totals for 'setCount' sets -> descriptors of a single set
+DescriptorTypeCounts CountsPerSet(const std::unordered_map<VkDescriptorType, uint32_t>& countPerType, uint32_t setCount)
 {
-    std::string bindingsString = "";
-    for (const auto binding : bindings) {
-        bindingsString += std::to_string(binding.binding) + "," + std::to_string(binding.descriptorCount) + "," +
-                          std::to_string(binding.descriptorType) + "," +
-                          std::to_string(reinterpret_cast<uint64_t>(binding.pImmutableSamplers)) + ",";
+    DescriptorTypeCounts counts = {};
+    for (const std::pair<const VkDescriptorType, uint32_t>& entry : countPerType) {
+        if (entry.first < CORE_DESCRIPTOR_TYPE_COUNT) {
+            counts[entry.first] = (entry.second + setCount - 1) / setCount;
+        }
     }
-    return std::hash<std::string>()(bindingsString);
+    return counts;
 }
 
+} // anonymous namespace
+
 DescriptorMgmt::DescriptorMgmt()
 {
 }
@@ -44,23 +51,8 @@ void DescriptorMgmt::AddDescType(VkDescriptorType type, uint32_t count)
 
 void DescriptorMgmt::CreatePool(const VkDevice device)
 {
-    std::vector<VkDescriptorPoolSize> poolSizes;
-    poolSizes.reserve(m_descTypes.size());
-
-    for (const std::pair<const VkDescriptorType, uint32_t>& entry : m_descTypes) {
-        poolSizes.push_back({entry.first, entry.second});
-    }
-
-    VkDescriptorPoolCreateInfo createInfo = {
-        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .pNext         = nullptr,
-        .flags         = 0,
-        .maxSets       = 4,
-        .poolSizeCount = (uint32_t)poolSizes.size(),
-        .pPoolSizes    = poolSizes.data(),
-    };
-
-    VkResult result = vkCreateDescriptorPool(device, &createInfo, nullptr, &m_pool);
+    // m_descTypes holds the descriptors of one set, the allocator adds pools when more sets are created
+    VkResult result = m_allocator.Create(device, CountsPerSet(m_descTypes, 1), FIRST_POOL_SETS);
     if (result != VK_SUCCESS) {
         // TODO: ....
     }
@@ -93,89 +85,170 @@ VkDescriptorSetLayout DescriptorMgmt::CreateLayout(const VkDevice device)
 
 void DescriptorMgmt::CreateDescriptorSets(const VkDevice device, uint32_t count)
 {
-    assert(m_pool != VK_NULL_HANDLE);
+    assert(m_allocator.IsValid());
     assert(m_layout != VK_NULL_HANDLE);
 
-    std::vector<VkDescriptorSetLayout> layouts(count, m_layout);
+    m_sets.reserve(m_sets.size() + count);
+    for (uint32_t idx = 0; idx < count; idx++) {
+        const VkDescriptorSet set = m_allocator.Allocate(m_layout);
+        if (set == VK_NULL_HANDLE) {
+            // TODO: ....
+        }
 
-    VkDescriptorSetAllocateInfo createInfo = {
-        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .pNext              = nullptr,
-        .descriptorPool     = m_pool,
-        .descriptorSetCount = count,
-        .pSetLayouts        = layouts.data(),
-    };
+        m_sets.push_back(DescriptorSetMgmt(set, m_layout));
+    }
+}
 
-    std::vector<VkDescriptorSet> sets(count, VK_NULL_HANDLE);
+void DescriptorMgmt::Destroy(const VkDevice device)
+{
+    m_allocator.Destroy();
 
-    VkResult result = vkAllocateDescriptorSets(device, &createInfo, sets.data());
-    if (result != VK_SUCCESS) {
-        // TODO: ....
+    vkDestroyDescriptorSetLayout(device, m_layout, nullptr);
+}
+
+DescriptorSetMgmt::Write& DescriptorSetMgmt::FindOrInsert(uint32_t binding, uint32_t arrayElement)
+{
+    uint32_t pos = 0;
+    while (pos < m_writeCount
+           && (m_writes[pos].binding < binding
+               || (m_writes[pos].binding == binding && m_writes[pos].arrayElement < arrayElement))) {
+        pos++;
     }
 
-    for (const VkDescriptorSet& set : sets) {
-        m_sets.push_back(DescriptorSetMgmt(set));
+    if (pos < m_writeCount && m_writes[pos].binding == binding && m_writes[pos].arrayElement == arrayElement) {
+        return m_writes[pos];
     }
+
+    assert(m_writeCount < MAX_WRITES && "Too many descriptors in DescriptorSetMgmt");
+    for (uint32_t idx = m_writeCount; idx > pos; idx--) {
+        m_writes[idx] = m_writes[idx - 1];
+    }
+    m_writeCount++;
+
+    m_writes[pos]              = {};
+    m_writes[pos].binding      = binding;
+    m_writes[pos].arrayElement = arrayElement;
+    return m_writes[pos];
 }
 
-void DescriptorMgmt::Destroy(const VkDevice device)
+void DescriptorSetMgmt::SetBuffer(uint32_t         idx,
+                                  VkBuffer         buffer,
+                                  VkDescriptorType type,
+                                  VkDeviceSize     range,
+                                  uint32_t         arrayElement)
 {
-    vkDestroyDescriptorPool(device, m_pool, nullptr);
+    // Dynamic buffers need an explicit range, the dynamic offset is added on top of it at bind time
+    assert(range != VK_WHOLE_SIZE || type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 
-    vkDestroyDescriptorSetLayout(device, m_layout, nullptr);
+    Write& write      = FindOrInsert(idx, arrayElement);
+    write.type        = type;
+    write.info.buffer = {buffer, 0, range};
 }
 
-void DescriptorSetMgmt::SetBuffer(uint32_t idx, VkBuffer buffer)
+void DescriptorSetMgmt::SetImage(uint32_t      idx,
+                                 VkImageView   view,
+                                 VkSampler     sampler,
+                                 VkImageLayout layout,
+                                 uint32_t      arrayElement)
 {
-    m_bufferInfos[idx] = {buffer, 0, VK_WHOLE_SIZE};
+    Write& write     = FindOrInsert(idx, arrayElement);
+    write.type       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.info.image = {sampler, view, layout};
 }
 
-void DescriptorSetMgmt::SetImage(uint32_t idx, VkImageView view, VkSampler sampler, VkImageLayout layout)
+void DescriptorSetMgmt::Resolve(const VkDevice device)
 {
-    m_imageInfos[idx] = {sampler, view, layout};
+    if (m_resolved) {
+        return;
+    }
+    m_resolved = true;
+
+    m_descriptorBuffer = DescriptorBuffer::Find(device);
+
+    ObjectCache* objects = (m_layout != VK_NULL_HANDLE) ? ObjectCache::Find(device) : nullptr;
+    if (objects != nullptr) {
+        m_template = objects->GetUpdateTemplate(m_layout);
+    }
 }
 
-void DescriptorSetMgmt::Update(const VkDevice device)
+bool DescriptorSetMgmt::UpdateWithTemplate(const VkDevice device)
 {
-    VkWriteDescriptorSet baseInfo = {
-        .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext            = nullptr,
-        .dstSet           = m_set,
-        .dstBinding       = 0, // set later
-        .dstArrayElement  = 0,
-        .descriptorCount  = 1,                   // set later
-        .descriptorType   = (VkDescriptorType)0, // set later
-        .pImageInfo       = nullptr,
-        .pBufferInfo      = nullptr,
-        .pTexelBufferView = nullptr,
-    };
+    // A template writes every descriptor of the layout, partial updates use plain writes
+    if (m_template == nullptr || m_template->descriptorCount != m_writeCount) {
+        return false;
+    }
 
-    const uint32_t                    infoCount = (uint32_t)(m_bufferInfos.size() + m_imageInfos.size());
-    std::vector<VkWriteDescriptorSet> writeInfos(infoCount, baseInfo);
+    // Both the writes and the template bindings are in binding order
+    DescriptorInfo data[MAX_WRITES];
+    uint32_t       bindingIdx = 0;
+    for (uint32_t idx = 0; idx < m_writeCount; idx++) {
+        const Write& write = m_writes[idx];
 
-    for (const std::pair<const uint32_t, VkDescriptorBufferInfo>& entry : m_bufferInfos) {
-        const uint32_t                idx  = entry.first;
-        const VkDescriptorBufferInfo& info = entry.second;
+        while (bindingIdx < m_template->bindings.size() && m_template->bindings[bindingIdx].binding < write.binding) {
+            bindingIdx++;
+        }
+        if (bindingIdx == m_template->bindings.size()) {
+            return false;
+        }
 
-        VkWriteDescriptorSet& writeInfo = writeInfos[idx];
+        const DescriptorUpdateTemplate::Binding& binding = m_template->bindings[bindingIdx];
+        if (binding.binding != write.binding || write.arrayElement >= binding.count) {
+            return false;
+        }
+        assert(binding.type == write.type && "Descriptor type does not match the layout");
 
-        writeInfo.dstBinding     = idx;
-        writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        writeInfo.pBufferInfo    = &info;
+        data[binding.first + write.arrayElement] = write.info;
     }
 
-    for (const std::pair<const uint32_t, VkDescriptorImageInfo>& entry : m_imageInfos) {
-        const uint32_t               idx  = entry.first;
-        const VkDescriptorImageInfo& info = entry.second;
+    vkUpdateDescriptorSetWithTemplate(device, m_set, m_template->handle, data);
+    return true;
+}
 
-        VkWriteDescriptorSet& writeInfo = writeInfos[idx];
+uint32_t DescriptorSetMgmt::FillWrites(const VkDescriptorSet dstSet, VkWriteDescriptorSet (&outWrites)[MAX_WRITES]) const
+{
+    for (uint32_t idx = 0; idx < m_writeCount; idx++) {
+        const Write& write   = m_writes[idx];
+        const bool   isImage = write.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+        outWrites[idx] = {
+            .sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext            = nullptr,
+            .dstSet           = dstSet,
+            .dstBinding       = write.binding,
+            .dstArrayElement  = write.arrayElement,
+            .descriptorCount  = 1,
+            .descriptorType   = write.type,
+            .pImageInfo       = isImage ? &write.info.image : nullptr,
+            .pBufferInfo      = isImage ? nullptr : &write.info.buffer,
+            .pTexelBufferView = nullptr,
+        };
+    }
 
-        writeInfo.dstBinding     = idx;
-        writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        writeInfo.pImageInfo     = &info;
+    return m_writeCount;
+}
+
+void DescriptorSetMgmt::Update(const VkDevice device)
+{
+    Resolve(device);
+
+    if (m_descriptorBuffer != nullptr) {
+        assert(m_layout != VK_NULL_HANDLE && "Descriptor buffer sets are written through their layout");
+
+        for (uint32_t idx = 0; idx < m_writeCount; idx++) {
+            const Write& write = m_writes[idx];
+            m_descriptorBuffer->Write(m_set, m_layout, write.binding, write.arrayElement, write.type, write.info);
+        }
+        return;
+    }
+
+    if (UpdateWithTemplate(device)) {
+        return;
     }
 
-    vkUpdateDescriptorSets(device, infoCount, writeInfos.data(), 0, nullptr);
+    VkWriteDescriptorSet writeInfos[MAX_WRITES];
+    const uint32_t       writeCount = FillWrites(m_set, writeInfos);
+
+    vkUpdateDescriptorSets(device, writeCount, writeInfos, 0, nullptr);
 }
 
 DescriptorPool::DescriptorPool()
@@ -188,67 +261,25 @@ VkResult DescriptorPool::Create(VkDevice
 {
     m_device = device;
 
-    std::vector<VkDescriptorPoolSize> poolSizes;
-    poolSizes.resize(countPerType.size());
-    {
-        size_t idx = 0;
-        for (const auto& entry : countPerType) {
-            const VkDescriptorPoolSize poolSize = {.type = entry.first, .descriptorCount = entry.second};
-            poolSizes[idx]                      = poolSize;
-            idx++;
-        }
-    }
-
-    const VkDescriptorPoolCreateInfo poolCreateInfo{
-        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .pNext         = nullptr,
-        .flags         = 0,
-        .maxSets       = maxSetCount,
-        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-        .pPoolSizes    = poolSizes.data(),
-    };
-
-    return vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &m_descriptorPool);
+    return m_allocator.Create(device, CountsPerSet(countPerType, maxSetCount), maxSetCount);
 }
 
 VkDescriptorSetLayout DescriptorPool::createLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
 {
-    const size_t bindingsHash = descriptorSetLayoutBindingVectorHash(bindings);
-
-    const auto foundLayout = m_layouts.find(bindingsHash);
-    if (foundLayout != m_layouts.end()) {
-        return foundLayout->second;
-    }
-
-    const VkDescriptorSetLayoutCreateInfo layoutInfo{
-        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .pNext        = nullptr,
-        .flags        = 0,
-        .bindingCount = static_cast<uint32_t>(bindings.size()),
-        .pBindings    = bindings.data(),
-    };
-
-    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
-    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout)) {
+    // Shared with every other user of the same bindings, owned by the object cache of the device
+    const VkDescriptorSetLayout layout
+        = ObjectCache::Get(m_device).GetDescriptorSetLayout(bindings, DescriptorBuffer::LayoutCreateFlags(m_device));
+    if (layout == VK_NULL_HANDLE) {
         throw std::runtime_error("Failed to create descriptor set layout!");
     }
 
-    const auto it = m_layouts.insert({bindingsHash, layout}).first;
-    return it->second;
+    return layout;
 }
 
 VkDescriptorSet DescriptorPool::createSet(VkDescriptorSetLayout layout)
 {
-    const VkDescriptorSetAllocateInfo allocInfo{
-        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .pNext              = nullptr,
-        .descriptorPool     = m_descriptorPool,
-        .descriptorSetCount = 1,
-        .pSetLayouts        = &layout,
-    };
-
-    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-    if (vkAllocateDescriptorSets(m_device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+    const VkDescriptorSet descriptorSet = m_allocator.Allocate(layout);
+    if (descriptorSet == VK_NULL_HANDLE) {
         throw std::runtime_error("Failed to create descriptor set!");
     }
 
@@ -258,9 +289,5 @@ VkDescriptorSet DescriptorPool::createSet(VkDescriptorSetLayout layout)
 void DescriptorPool::Destroy()
 {
     // TODO: destroy sets beforehand
-    for (const auto& it : m_layouts) {
-        vkDestroyDescriptorSetLayout(m_device, it.second, nullptr);
-    }
-
-    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    m_allocator.Destroy();
 }
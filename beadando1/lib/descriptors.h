@@ -1,14 +1,20 @@
 #pragma once
 
+#include <array>
 #include <unordered_map>
 #include <vector>
 
 #include <vulkan/vulkan_core.h>
 
+#include "descriptor_allocator.h"
+
 class DescriptorSetMgmt;
 
 class DescriptorMgmt {
 public:
+    // Sets of the first pool, later pools grow from there
+    static constexpr uint32_t FIRST_POOL_SETS = 4;
+
     DescriptorMgmt();
 
     void SetDescriptor(uint32_t binding, VkDescriptorType type, uint32_t count = 1);
@@ -30,43 +36,94 @@ private:
 
     std::unordered_map<VkDescriptorType, uint32_t> m_descTypes;
     VkDescriptorSetLayout                          m_layout = VK_NULL_HANDLE;
-    VkDescriptorPool                               m_pool   = VK_NULL_HANDLE;
+    DescriptorAllocator                            m_allocator;
     std::vector<DescriptorSetMgmt>                 m_sets;
 };
 
+/**
+ * Writes of a descriptor set, kept in binding order in fixed storage: nothing is allocated on the heap.
+ *
+ * With the layout of the set known and created by the ObjectCache, Update() packs the writes for the layout's
+ * update template and writes the whole set with a single vkUpdateDescriptorSetWithTemplate. Without a template,
+ * or while not every descriptor of the layout has been set, the writes go through vkUpdateDescriptorSets.
+ * The writes are kept after Update, so a set can be rewritten every frame by changing only what moved.
+ *
+ * Without a set the writes describe the bindings of a push descriptor layout, see PushDescriptors.
+ *
+ * On a device with a DescriptorBuffer the set is a range of it: Update() writes each descriptor there and the
+ * layout must be given.
+ */
 class DescriptorSetMgmt {
 public:
-    DescriptorSetMgmt(const VkDescriptorSet set)
+    static constexpr uint32_t MAX_WRITES = 16;
+
+    DescriptorSetMgmt(const VkDescriptorSet set = VK_NULL_HANDLE, const VkDescriptorSetLayout layout = VK_NULL_HANDLE)
         : m_set(set)
+        , m_layout(layout)
     {
     }
 
-    VkDescriptorSet& Get() { return m_set; }
+    VkDescriptorSet&      Get() { return m_set; }
+    VkDescriptorSetLayout Layout() const { return m_layout; }
 
-    void SetBuffer(uint32_t idx, VkBuffer buffer);
-    void SetImage(uint32_t idx, VkImageView view, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL);
+    void SetBuffer(uint32_t         idx,
+                   VkBuffer         buffer,
+                   VkDescriptorType type         = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                   VkDeviceSize     range        = VK_WHOLE_SIZE,
+                   uint32_t         arrayElement = 0);
+    void SetImage(uint32_t      idx,
+                  VkImageView   view,
+                  VkSampler     sampler,
+                  VkImageLayout layout       = VK_IMAGE_LAYOUT_GENERAL,
+                  uint32_t      arrayElement = 0);
 
     void Update(const VkDevice device);
 
+    // Fills one VkWriteDescriptorSet per descriptor, pointing into this object. Returns the write count.
+    uint32_t FillWrites(const VkDescriptorSet dstSet, VkWriteDescriptorSet (&outWrites)[MAX_WRITES]) const;
+
 private:
-    VkDescriptorSet                                      m_set;
-    std::unordered_map<uint32_t, VkDescriptorBufferInfo> m_bufferInfos;
-    std::unordered_map<uint32_t, VkDescriptorImageInfo>  m_imageInfos;
+    struct Write {
+        uint32_t         binding;
+        uint32_t         arrayElement;
+        VkDescriptorType type;
+        DescriptorInfo   info;
+    };
+
+    // Returns the write of the descriptor, inserted at its place in binding order when new
+    Write& FindOrInsert(uint32_t binding, uint32_t arrayElement);
+    // Looks up the template and the descriptor buffer once
+    void   Resolve(const VkDevice device);
+    bool   UpdateWithTemplate(const VkDevice device);
+
+    VkDescriptorSet       m_set;
+    VkDescriptorSetLayout m_layout;
+
+    const DescriptorUpdateTemplate* m_template         = nullptr;
+    DescriptorBuffer*               m_descriptorBuffer = nullptr;
+    bool                            m_resolved         = false;
+
+    std::array<Write, MAX_WRITES> m_writes;
+    uint32_t                      m_writeCount = 0;
 };
 
+// Sets that live as long as their user, on a DescriptorAllocator that grows as needed
 class DescriptorPool {
 public:
     DescriptorPool();
 
+    // The counts and the set count size the first pool, the allocator grows past them
     VkResult
     Create(VkDevice device, const std::unordered_map<VkDescriptorType, uint32_t>& countPerType, uint32_t maxSetCount);
 
+    // The layout comes from the ObjectCache of the device, it must not be destroyed
     VkDescriptorSetLayout createLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
     VkDescriptorSet       createSet(VkDescriptorSetLayout layout);
     void                  Destroy();
 
+    const DescriptorAllocator::Stats& GetStats() const { return m_allocator.GetStats(); }
+
 private:
-    VkDevice                                          m_device;
-    VkDescriptorPool                                  m_descriptorPool;
-    std::unordered_map<size_t, VkDescriptorSetLayout> m_layouts;
+    VkDevice            m_device = VK_NULL_HANDLE;
+    DescriptorAllocator m_allocator;
 };
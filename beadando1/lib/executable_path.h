@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Path of 'name' in the directory of the running executable, so caches written at runtime end up next to the
+// binary whatever the working directory is. Falls back to 'name' itself (the working directory) when the
+// executable can not be located.
+std::string ExecutableRelativePath(const std::string& name);
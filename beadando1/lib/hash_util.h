@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// FNV-1a helpers for hashing create info structures field by field, nothing is allocated
+static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+static constexpr uint64_t FNV_PRIME        = 0x100000001b3ull;
+
+// Hashes the raw bytes of a single field, padding bytes of the surrounding struct are never read
+template <typename T>
+inline void HashField(uint64_t* hash, const T& value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+
+    for (uint8_t byte : bytes) {
+        *hash ^= byte;
+        *hash *= FNV_PRIME;
+    }
+}
+
+// Hashes 'count' values of an array without padding (handles, flags, enums)
+template <typename T>
+inline void HashArray(uint64_t* hash, const T* values, uint32_t count)
+{
+    HashField(hash, count);
+    for (uint32_t idx = 0; idx < count; idx++) {
+        HashField(hash, values[idx]);
+    }
+}
+
+// 64 bit FNV-1a of a whole buffer, the checksum of the files written by the caches
+inline uint64_t HashBytes(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t idx = 0; idx < size; idx++) {
+        hash = (hash ^ bytes[idx]) * FNV_PRIME;
+    }
+
+    return hash;
+}
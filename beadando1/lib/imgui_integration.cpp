@@ -1,9 +1,14 @@
 #include "imgui_integration.h"
 
+#include <cstdio>
+#include <string>
+
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <imgui.h>
 
+#include "memory_allocator.h"
+
 static VkDescriptorPool CreateSimpleDescriptorPool(const VkDevice device) {
 
     const VkDescriptorPoolSize poolSizes[] = {
@@ -52,7 +57,7 @@ bool IMGUIIntegration::CreateContext(const Context& context, const Swapchain& sw
         .MinImageCount       = 2,
         .ImageCount          = 2,
         .MSAASamples         = VK_SAMPLE_COUNT_1_BIT,
-        .PipelineCache       = VK_NULL_HANDLE,
+        .PipelineCache       = context.pipelineCache().handle(),
         .Subpass             = 0,
         .UseDynamicRendering = true,
         .PipelineRenderingCreateInfo =
@@ -87,6 +92,67 @@ void IMGUIIntegration::Draw(const VkCommandBuffer cmdBuffer)
     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer);
 }
 
+void IMGUIIntegration::MemoryWindow(const Context& context)
+{
+    const MemoryAllocator* allocator = MemoryAllocator::Find(context.device());
+    if (allocator == nullptr) {
+        return;
+    }
+
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    ImGui::Begin("Memory");
+
+    ImGui::Text("VkDeviceMemory objects: %u", allocator->DeviceMemoryCount());
+    if (!allocator->HasMemoryBudget()) {
+        ImGui::TextDisabled("VK_EXT_memory_budget not available");
+    }
+
+    const std::vector<MemoryAllocator::HeapStats> heaps = allocator->GetHeapStats();
+    for (uint32_t heapIdx = 0; heapIdx < heaps.size(); heapIdx++) {
+        const MemoryAllocator::HeapStats& heap = heaps[heapIdx];
+
+        ImGui::SeparatorText(("Heap " + std::to_string(heapIdx)).c_str());
+        ImGui::Text("Size %.1f MiB, %u allocation(s), %u block(s), fragmentation %.2f", heap.heapSize / MiB,
+                    heap.allocationCount, heap.blockCount, heap.fragmentation);
+        ImGui::Text("Used %.2f MiB of %.2f MiB reserved", heap.usedBytes / MiB, heap.reservedBytes / MiB);
+
+        if (heap.budgetBytes > 0) {
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", heap.budgetUsage / MiB, heap.budgetBytes / MiB);
+            ImGui::ProgressBar((float)((double)heap.budgetUsage / (double)heap.budgetBytes), ImVec2(-1.0f, 0.0f),
+                               overlay);
+        }
+
+        for (uint32_t categoryIdx = 0; categoryIdx < MEMORY_CATEGORY_COUNT; categoryIdx++) {
+            if (heap.categoryBytes[categoryIdx] > 0) {
+                ImGui::BulletText("%s: %.2f MiB", MemoryCategoryName((MemoryCategory)categoryIdx),
+                                  heap.categoryBytes[categoryIdx] / MiB);
+            }
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Categories", ImGuiTreeNodeFlags_DefaultOpen)) {
+        for (uint32_t categoryIdx = 0; categoryIdx < MEMORY_CATEGORY_COUNT; categoryIdx++) {
+            const MemoryAllocator::UsageStats usage = allocator->GetCategoryStats((MemoryCategory)categoryIdx);
+            ImGui::Text("%-10s %4u allocation(s) %8.2f MiB (peak %.2f MiB)",
+                        MemoryCategoryName((MemoryCategory)categoryIdx), usage.allocationCount, usage.bytes / MiB,
+                        usage.peakBytes / MiB);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Memory types")) {
+        const std::vector<MemoryAllocator::TypeStats> types = allocator->GetTypeStats();
+        for (uint32_t typeIdx = 0; typeIdx < types.size(); typeIdx++) {
+            const MemoryAllocator::TypeStats& type = types[typeIdx];
+            ImGui::Text("Type %2u (heap %u, flags 0x%02x): %u allocation(s) %.2f MiB", typeIdx, type.heapIdx,
+                        type.propertyFlags, type.allocationCount, type.usedBytes / MiB);
+        }
+    }
+
+    ImGui::End();
+}
+
 void IMGUIIntegration::Destroy(const Context& context)
 {
     ImGui_ImplVulkan_Shutdown();
@@ -0,0 +1,346 @@
+#include "ktx2.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+struct Ktx2Header {
+    uint8_t  identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must be tightly packed");
+
+struct Ktx2LevelIndex {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Khronos data format descriptor values (khr_df.h)
+enum : uint8_t {
+    KHR_DF_MODEL_BC1A = 128,
+    KHR_DF_MODEL_BC3  = 130,
+    KHR_DF_MODEL_BC5  = 132,
+    KHR_DF_MODEL_BC7  = 134,
+
+    KHR_DF_PRIMARIES_BT709 = 1,
+    KHR_DF_TRANSFER_LINEAR = 1,
+    KHR_DF_TRANSFER_SRGB   = 2,
+
+    KHR_DF_CHANNEL_COLOR      = 0,
+    KHR_DF_CHANNEL_BC5_GREEN  = 1,
+    KHR_DF_CHANNEL_BC1A_ALPHA = 1,
+    KHR_DF_CHANNEL_BC3_ALPHA  = 15,
+};
+
+struct DfdSample {
+    uint16_t bitOffset;
+    uint8_t  bitLength;   // minus one
+    uint8_t  channelType; // channel id, the linear/exponent/signed/float flags are not used
+};
+
+bool IsSrgb(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Builds the basic data format descriptor block of the format, empty when the format is not supported
+std::vector<uint32_t> BuildDfd(VkFormat format)
+{
+    uint8_t                colorModel = 0;
+    std::vector<DfdSample> samples;
+
+    switch (format) {
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        colorModel = KHR_DF_MODEL_BC1A;
+        samples    = {{0, 63, KHR_DF_CHANNEL_BC1A_ALPHA}};
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        colorModel = KHR_DF_MODEL_BC3;
+        samples    = {{0, 63, KHR_DF_CHANNEL_BC3_ALPHA}, {64, 63, KHR_DF_CHANNEL_COLOR}};
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        colorModel = KHR_DF_MODEL_BC5;
+        samples    = {{0, 63, KHR_DF_CHANNEL_COLOR}, {64, 63, KHR_DF_CHANNEL_BC5_GREEN}};
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        colorModel = KHR_DF_MODEL_BC7;
+        samples    = {{0, 127, KHR_DF_CHANNEL_COLOR}};
+        break;
+    default:
+        return {};
+    }
+
+    const uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+    const uint8_t  transfer  = IsSrgb(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+    std::vector<uint32_t> dfd;
+    dfd.push_back(4 + blockSize);                                         // dfdTotalSize
+    dfd.push_back(0);                                                     // vendorId | descriptorType
+    dfd.push_back(2 | (blockSize << 16));                                 // versionNumber | descriptorBlockSize
+    dfd.push_back(colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16)); // model | primaries | transfer
+    dfd.push_back(3 | (3 << 8));                                          // 4x4x1x1 texel block
+    dfd.push_back(BlockCompressedSize(format));                           // bytesPlane0..3
+    dfd.push_back(0);                                                     // bytesPlane4..7
+
+    for (const DfdSample& sample : samples) {
+        dfd.push_back(sample.bitOffset | (sample.bitLength << 16) | (sample.channelType << 24));
+        dfd.push_back(0);          // sample position
+        dfd.push_back(0);          // sampleLower
+        dfd.push_back(UINT32_MAX); // sampleUpper
+    }
+
+    return dfd;
+}
+
+} // namespace
+
+uint32_t BlockCompressedSize(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+VkFormat SrgbBlockFormat(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        return VK_FORMAT_BC3_SRGB_BLOCK;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        return VK_FORMAT_BC7_SRGB_BLOCK;
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        return VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK;
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        return VK_FORMAT_ASTC_4x4_SRGB_BLOCK;
+    default:
+        return format;
+    }
+}
+
+bool ParseKtx2(const uint8_t* data, uint64_t size, Ktx2Image* outImage, const char* name)
+{
+    Ktx2Header header = {};
+    if (size < sizeof(header)) {
+        printf("[ERROR] KTX2: '%s' is too small\n", name);
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        printf("[ERROR] KTX2: '%s' is not a KTX2 file\n", name);
+        return false;
+    }
+
+    if (header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+        printf("[ERROR] KTX2: '%s' only uncompressed single 2D images are supported\n", name);
+        return false;
+    }
+
+    // A level count of zero asks the loader to generate the mips, only the base level is stored
+    const uint32_t levelCount = std::max(header.levelCount, 1u);
+
+    if (size < sizeof(header) + levelCount * sizeof(Ktx2LevelIndex)) {
+        printf("[ERROR] KTX2: '%s' level index is truncated\n", name);
+        return false;
+    }
+
+    Ktx2Image image = {
+        .format = (VkFormat)header.vkFormat,
+        .width  = header.pixelWidth,
+        .height = header.pixelHeight,
+        .mips   = {},
+    };
+
+    for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++) {
+        Ktx2LevelIndex level = {};
+        std::memcpy(&level, data + sizeof(header) + levelIdx * sizeof(Ktx2LevelIndex), sizeof(level));
+
+        if (level.byteOffset > size || level.byteLength > size - level.byteOffset) {
+            printf("[ERROR] KTX2: '%s' level data is out of the file\n", name);
+            return false;
+        }
+
+        image.mips.levels.push_back({
+            .width  = std::max(image.width >> levelIdx, 1u),
+            .height = std::max(image.height >> levelIdx, 1u),
+            .offset = level.byteOffset,
+            .size   = level.byteLength,
+        });
+    }
+
+    *outImage = std::move(image);
+
+    return true;
+}
+
+bool LoadKtx2(const std::string& path, Ktx2Image* outImage)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<uint8_t> contents((size_t)file.tellg());
+    file.seekg(0);
+    if (!file.read((char*)contents.data(), (std::streamsize)contents.size())) {
+        printf("[ERROR] KTX2: failed to read '%s'\n", path.c_str());
+        return false;
+    }
+
+    Ktx2Image image;
+    if (!ParseKtx2(contents.data(), contents.size(), &image, path.c_str())) {
+        return false;
+    }
+
+    // The levels are stored from the smallest, pack them from the largest without the file padding
+    uint64_t totalSize = 0;
+    for (const MipLevel& level : image.mips.levels) {
+        totalSize += level.size;
+    }
+    image.mips.data.resize(totalSize);
+
+    uint64_t offset = 0;
+    for (MipLevel& level : image.mips.levels) {
+        std::memcpy(image.mips.data.data() + offset, contents.data() + level.offset, level.size);
+        level.offset = offset;
+        offset += level.size;
+    }
+
+    *outImage = std::move(image);
+
+    return true;
+}
+
+bool EncodeKtx2(const Ktx2Image& image, std::vector<uint8_t>* outData)
+{
+    const std::vector<uint32_t> dfd = BuildDfd(image.format);
+    if (dfd.empty()) {
+        printf("[ERROR] KTX2: format %d can not be written\n", image.format);
+        return false;
+    }
+
+    const uint32_t levelCount = (uint32_t)image.mips.levels.size();
+    const uint32_t dfdOffset  = sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex);
+    const uint32_t dfdSize    = (uint32_t)(dfd.size() * sizeof(uint32_t));
+
+    // Levels are stored from the smallest to the largest, each aligned to the block size
+    const uint64_t alignment = BlockCompressedSize(image.format);
+
+    std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+    uint64_t                    fileOffset = dfdOffset + dfdSize;
+    for (uint32_t levelIdx = levelCount; levelIdx-- > 0;) {
+        fileOffset = (fileOffset + alignment - 1) / alignment * alignment;
+
+        levelIndex[levelIdx] = {
+            .byteOffset             = fileOffset,
+            .byteLength             = image.mips.levels[levelIdx].size,
+            .uncompressedByteLength = image.mips.levels[levelIdx].size,
+        };
+        fileOffset += image.mips.levels[levelIdx].size;
+    }
+
+    Ktx2Header header = {
+        .identifier             = {},
+        .vkFormat               = (uint32_t)image.format,
+        .typeSize               = 1,
+        .pixelWidth             = image.width,
+        .pixelHeight            = image.height,
+        .pixelDepth             = 0,
+        .layerCount             = 0,
+        .faceCount              = 1,
+        .levelCount             = levelCount,
+        .supercompressionScheme = 0,
+        .dfdByteOffset          = dfdOffset,
+        .dfdByteLength          = dfdSize,
+        .kvdByteOffset          = 0,
+        .kvdByteLength          = 0,
+        .sgdByteOffset          = 0,
+        .sgdByteLength          = 0,
+    };
+    std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+    std::vector<uint8_t>& data = *outData;
+    data.assign(fileOffset, 0);
+
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), levelIndex.data(), levelCount * sizeof(Ktx2LevelIndex));
+    std::memcpy(data.data() + dfdOffset, dfd.data(), dfdSize);
+
+    // The padding between the levels stays zero
+    for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++) {
+        const MipLevel& level = image.mips.levels[levelIdx];
+        std::memcpy(data.data() + levelIndex[levelIdx].byteOffset, image.mips.data.data() + level.offset, level.size);
+    }
+
+    return true;
+}
+
+bool WriteKtx2(const std::string& path, const Ktx2Image& image)
+{
+    std::vector<uint8_t> data;
+    if (!EncodeKtx2(image, &data)) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        printf("[ERROR] KTX2: can not create '%s'\n", path.c_str());
+        return false;
+    }
+
+    file.write((const char*)data.data(), (std::streamsize)data.size());
+
+    return (bool)file;
+}
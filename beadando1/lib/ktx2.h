@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "mip_generator.h"
+
+// A 2D texture stored in a KTX2 container, the level data is exactly what the GPU consumes
+struct Ktx2Image {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    MipChain mips;
+};
+
+/**
+ * Minimal KTX2 reader/writer.
+ *
+ * Only single layer, single face 2D textures without supercompression are handled, which is
+ * what the texture bake tool produces. The level data is read as is, uploading it is a copy.
+ *
+ * The writer supports the block compressed formats with a known data format descriptor:
+ * BC1 (RGBA), BC3, BC5 and BC7, both UNORM and SRGB.
+ */
+bool LoadKtx2(const std::string& path, Ktx2Image* outImage);
+bool WriteKtx2(const std::string& path, const Ktx2Image& image);
+
+// Reads the header and level index of KTX2 data in memory without copying the texels:
+// the level offsets of 'outImage' point into 'data' and 'outImage->mips.data' stays empty.
+// 'name' is only used in the error messages.
+bool ParseKtx2(const uint8_t* data, uint64_t size, Ktx2Image* outImage, const char* name);
+// Serializes the image into the bytes WriteKtx2 would write
+bool EncodeKtx2(const Ktx2Image& image, std::vector<uint8_t>* outData);
+
+// Bytes per 4x4 block of a supported block compressed format, 0 for anything else
+uint32_t BlockCompressedSize(VkFormat format);
+
+// The sRGB variant of a block compressed format, or the format itself when there is none
+VkFormat SrgbBlockFormat(VkFormat format);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+// How the CPU and GPU access the memory, selects the memory type request
+enum class MemoryUsage : uint32_t {
+    GpuOnly  = 0, // written by transfers/rendering, never mapped (static geometry, textures, attachments)
+    Upload   = 1, // written once by the CPU, read by transfers (staging buffers)
+    PerFrame = 2, // written by the CPU every frame, read directly by shaders (light and material buffers)
+    Readback = 3, // written by the GPU, read by the CPU
+
+    TransientAttachment = 4, // attachments which never leave the tile, lazily allocated where available
+};
+
+struct MemoryTypeRequest {
+    VkMemoryPropertyFlags required  = 0; // the type must have all of these
+    VkMemoryPropertyFlags preferred = 0; // each present flag raises the score
+    VkMemoryPropertyFlags avoided   = 0; // each present flag lowers the score
+};
+
+/**
+ * Memory type selection shared by every allocation of a device.
+ *
+ * The memory properties are queried once. Candidate types must have all required flags and
+ * a heap large enough for the allocation, the rest are scored by the preferred/avoided flags.
+ * Ties go to the lower index, as the driver lists the better types first.
+ *
+ * Resizable BAR (a large DEVICE_LOCAL | HOST_VISIBLE heap on a discrete GPU) and unified memory
+ * (every heap is device local: integrated GPUs, software rasterizers) are detected at creation:
+ * there per-frame CPU written data is placed into device local memory.
+ */
+class MemoryTypePolicy {
+public:
+    static constexpr uint32_t     INVALID_TYPE   = UINT32_MAX;
+    // Without resizable BAR the host visible device local heap is a 256 MiB window
+    static constexpr VkDeviceSize SMALL_BAR_SIZE = 256ull * 1024 * 1024;
+
+    MemoryTypePolicy() = default;
+    explicit MemoryTypePolicy(const VkPhysicalDeviceMemoryProperties& properties);
+
+    MemoryTypeRequest RequestFor(MemoryUsage usage) const;
+
+    // Returns the best type from memoryTypeBits or INVALID_TYPE. A size of zero skips the heap size check.
+    uint32_t FindMemoryType(uint32_t memoryTypeBits, const MemoryTypeRequest& request, VkDeviceSize size = 0) const;
+    uint32_t FindMemoryType(uint32_t memoryTypeBits, MemoryUsage usage, VkDeviceSize size = 0) const
+    {
+        return FindMemoryType(memoryTypeBits, RequestFor(usage), size);
+    }
+
+    bool HasResizableBar() const { return m_hasResizableBar; }
+    bool IsUnifiedMemory() const { return m_isUnifiedMemory; }
+    bool HasLazilyAllocatedMemory() const { return m_hasLazilyAllocated; }
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties() const { return m_properties; }
+
+private:
+    VkPhysicalDeviceMemoryProperties m_properties         = {};
+    bool                             m_hasResizableBar    = false;
+    bool                             m_isUnifiedMemory    = false;
+    bool                             m_hasLazilyAllocated = false;
+};
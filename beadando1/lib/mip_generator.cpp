@@ -0,0 +1,159 @@
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+#include "pixel_convert.h"
+
+namespace {
+
+// Below this many destination texels per thread the thread start costs more than the filtering
+constexpr uint32_t MIN_TEXELS_PER_THREAD = 64 * 1024;
+
+using DownsampleFn = void (*)(const uint8_t*, uint32_t, uint32_t, uint8_t*, uint32_t, uint32_t, uint32_t);
+
+template <uint32_t PixelSize>
+void DownsampleRows(const uint8_t* src,
+                    uint32_t       srcWidth,
+                    uint32_t       srcHeight,
+                    uint8_t*       dst,
+                    uint32_t       dstWidth,
+                    uint32_t       rowBegin,
+                    uint32_t       rowEnd)
+{
+    const uint32_t srcStride = srcWidth * PixelSize;
+
+    for (uint32_t y = rowBegin; y < rowEnd; y++) {
+        const uint8_t* row0 = src + (uint64_t)std::min(y * 2, srcHeight - 1) * srcStride;
+        const uint8_t* row1 = src + (uint64_t)std::min(y * 2 + 1, srcHeight - 1) * srcStride;
+        uint8_t*       out  = dst + (uint64_t)y * dstWidth * PixelSize;
+
+        // Plain integer loop over the channels, the compiler vectorizes it
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            const uint32_t x0 = std::min(x * 2, srcWidth - 1) * PixelSize;
+            const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * PixelSize;
+
+            for (uint32_t c = 0; c < PixelSize; c++) {
+                const uint32_t sum     = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                out[x * PixelSize + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// sRGB RGBA8: averaging the encoded values darkens the levels, the texels are filtered in linear space
+void DownsampleRowsSrgb(const uint8_t* src,
+                        uint32_t       srcWidth,
+                        uint32_t       srcHeight,
+                        uint8_t*       dst,
+                        uint32_t       dstWidth,
+                        uint32_t       rowBegin,
+                        uint32_t       rowEnd)
+{
+    std::vector<float> linear0(srcWidth * 4);
+    std::vector<float> linear1(srcWidth * 4);
+    std::vector<float> linearOut(dstWidth * 4);
+
+    for (uint32_t y = rowBegin; y < rowEnd; y++) {
+        SrgbToLinearRGBA(src + (uint64_t)std::min(y * 2, srcHeight - 1) * srcWidth * 4, linear0.data(), srcWidth);
+        SrgbToLinearRGBA(src + (uint64_t)std::min(y * 2 + 1, srcHeight - 1) * srcWidth * 4, linear1.data(), srcWidth);
+
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            const uint32_t x0 = std::min(x * 2, srcWidth - 1) * 4;
+            const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1) * 4;
+
+            for (uint32_t c = 0; c < 4; c++) {
+                linearOut[x * 4 + c] = (linear0[x0 + c] + linear0[x1 + c] + linear1[x0 + c] + linear1[x1 + c]) * 0.25f;
+            }
+        }
+
+        LinearToSrgbRGBA(linearOut.data(), dst + (uint64_t)y * dstWidth * 4, dstWidth);
+    }
+}
+
+DownsampleFn SelectDownsample(uint32_t pixelSize, bool srgb)
+{
+    switch (pixelSize) {
+    case 1: return DownsampleRows<1>;
+    case 2: return DownsampleRows<2>;
+    case 3: return DownsampleRows<3>;
+    default: return srgb ? DownsampleRowsSrgb : DownsampleRows<4>;
+    }
+}
+
+} // namespace
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height)
+{
+    const uint32_t largest = std::max(std::max(width, height), 1u);
+
+    return std::bit_width(largest);
+}
+
+MipChain BuildMipChainRGBA8(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t levelCount)
+{
+    return BuildMipChain(pixels, width, height, levelCount, 4, false);
+}
+
+MipChain BuildMipChain(const uint8_t* pixels,
+                       uint32_t       width,
+                       uint32_t       height,
+                       uint32_t       levelCount,
+                       uint32_t       pixelSize,
+                       bool           srgb)
+{
+    assert(pixelSize >= 1 && pixelSize <= 4);
+
+    const DownsampleFn downsample = SelectDownsample(pixelSize, srgb);
+
+    MipChain chain;
+    levelCount = std::clamp(levelCount, 1u, MipLevelCount(width, height));
+
+    uint64_t totalSize = 0;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        const uint32_t levelWidth  = std::max(width >> level, 1u);
+        const uint32_t levelHeight = std::max(height >> level, 1u);
+        const uint64_t levelSize   = (uint64_t)levelWidth * levelHeight * pixelSize;
+
+        chain.levels.push_back({levelWidth, levelHeight, totalSize, levelSize});
+        totalSize += levelSize;
+    }
+
+    chain.data.resize(totalSize);
+    std::memcpy(chain.data.data(), pixels, chain.levels[0].size);
+
+    const uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (uint32_t level = 1; level < levelCount; level++) {
+        const MipLevel& src = chain.levels[level - 1];
+        const MipLevel& dst = chain.levels[level];
+
+        const uint8_t* srcData = chain.data.data() + src.offset;
+        uint8_t*       dstData = chain.data.data() + dst.offset;
+
+        const uint64_t texels      = (uint64_t)dst.width * dst.height;
+        const uint32_t threadCount = (uint32_t)std::clamp<uint64_t>(texels / MIN_TEXELS_PER_THREAD, 1, maxThreads);
+
+        if (threadCount == 1) {
+            downsample(srcData, src.width, src.height, dstData, dst.width, 0, dst.height);
+            continue;
+        }
+
+        const uint32_t rowsPerThread = (dst.height + threadCount - 1) / threadCount;
+
+        std::vector<std::thread> workers;
+        for (uint32_t rowBegin = 0; rowBegin < dst.height; rowBegin += rowsPerThread) {
+            const uint32_t rowEnd = std::min(rowBegin + rowsPerThread, dst.height);
+            workers.emplace_back(downsample, srcData, src.width, src.height, dstData, dst.width, rowBegin, rowEnd);
+        }
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    return chain;
+}
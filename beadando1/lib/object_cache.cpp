@@ -0,0 +1,491 @@
+#include "object_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "hash_util.h"
+#include "sampler_cache.h"
+
+namespace {
+
+std::mutex                                                 g_objectCachesMutex;
+std::unordered_map<VkDevice, std::unique_ptr<ObjectCache>> g_objectCaches;
+
+// The immutable samplers of a binding, the specification ignores them for other descriptor types
+const VkSampler* ImmutableSamplers(const VkDescriptorSetLayoutBinding& binding)
+{
+    const bool samplerType = binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER
+                          || binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    return samplerType ? binding.pImmutableSamplers : nullptr;
+}
+
+} // anonymous namespace
+
+int32_t DescriptorUpdateTemplate::Find(uint32_t binding) const
+{
+    const auto it = std::lower_bound(bindings.begin(), bindings.end(), binding,
+                                     [](const Binding& entry, uint32_t value) { return entry.binding < value; });
+
+    return (it != bindings.end() && it->binding == binding) ? (int32_t)(it - bindings.begin()) : -1;
+}
+
+ObjectCache& ObjectCache::Get(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_objectCachesMutex);
+
+    std::unique_ptr<ObjectCache>& cache = g_objectCaches[device];
+    if (!cache) {
+        cache = std::make_unique<ObjectCache>(device);
+    }
+
+    return *cache;
+}
+
+ObjectCache* ObjectCache::Find(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_objectCachesMutex);
+
+    const auto it = g_objectCaches.find(device);
+    return (it != g_objectCaches.end()) ? it->second.get() : nullptr;
+}
+
+void ObjectCache::Destroy(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_objectCachesMutex);
+    g_objectCaches.erase(device);
+}
+
+ObjectCache::ObjectCache(const VkDevice device)
+    : m_device(device)
+{
+}
+
+ObjectCache::~ObjectCache()
+{
+    for (const auto& [key, entry] : m_setLayouts) {
+        if (entry->updateTemplate) {
+            vkDestroyDescriptorUpdateTemplate(m_device, entry->updateTemplate->handle, nullptr);
+        }
+    }
+
+    for (const auto& [key, entry] : m_pipelineLayouts) {
+        vkDestroyPipelineLayout(m_device, entry->layout, nullptr);
+    }
+
+    for (const auto& [key, entry] : m_setLayouts) {
+        vkDestroyDescriptorSetLayout(m_device, entry->layout, nullptr);
+    }
+}
+
+VkDescriptorSetLayout ObjectCache::GetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& createInfo)
+{
+    SetLayoutKey key = {
+        .flags        = createInfo.flags,
+        .bindingCount = createInfo.bindingCount,
+        .bindings     = createInfo.pBindings,
+    };
+
+    const VkBaseInStructure* next = (const VkBaseInStructure*)createInfo.pNext;
+    for (; next != nullptr; next = next->pNext) {
+        if (next->sType != VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO) {
+            assert(false && "Only binding flags can be chained to a cached descriptor set layout");
+            printf("[ERROR] Descriptor set layout with unsupported pNext structure: %d\n", next->sType);
+            return VK_NULL_HANDLE;
+        }
+
+        const VkDescriptorSetLayoutBindingFlagsCreateInfo* flagsInfo =
+            (const VkDescriptorSetLayoutBindingFlagsCreateInfo*)next;
+
+        key.bindingFlagCount = flagsInfo->bindingCount;
+        key.bindingFlags     = flagsInfo->pBindingFlags;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_setLayouts.find(key);
+    if (it != m_setLayouts.end()) {
+        m_setLayoutCounters.hits++;
+        return it->second->layout;
+    }
+    m_setLayoutCounters.misses++;
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    const VkResult        result = vkCreateDescriptorSetLayout(m_device, &createInfo, nullptr, &layout);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Descriptor set layout creation failed: %d\n", result);
+        return VK_NULL_HANDLE;
+    }
+
+    // Copy the arrays, the immutable samplers are reserved up front so the binding pointers stay valid
+    std::unique_ptr<SetLayoutEntry> entry = std::make_unique<SetLayoutEntry>();
+    entry->layout                         = layout;
+    entry->flags                          = createInfo.flags;
+    entry->bindings.assign(key.bindings, key.bindings + key.bindingCount);
+    entry->bindingFlags.assign(key.bindingFlags, key.bindingFlags + key.bindingFlagCount);
+
+    size_t samplerCount = 0;
+    for (const VkDescriptorSetLayoutBinding& binding : entry->bindings) {
+        samplerCount += (ImmutableSamplers(binding) != nullptr) ? binding.descriptorCount : 0;
+    }
+    entry->immutableSamplers.reserve(samplerCount);
+
+    for (VkDescriptorSetLayoutBinding& binding : entry->bindings) {
+        if (binding.descriptorType < CORE_DESCRIPTOR_TYPE_COUNT) {
+            entry->descriptorCounts[binding.descriptorType] += binding.descriptorCount;
+        }
+
+        const VkSampler* samplers = ImmutableSamplers(binding);
+        binding.pImmutableSamplers = nullptr;
+
+        if (samplers != nullptr) {
+            binding.pImmutableSamplers = entry->immutableSamplers.data() + entry->immutableSamplers.size();
+            entry->immutableSamplers.insert(entry->immutableSamplers.end(), samplers,
+                                            samplers + binding.descriptorCount);
+        }
+    }
+
+    key.bindings     = entry->bindings.data();
+    key.bindingFlags = entry->bindingFlags.data();
+
+    m_setLayoutsByHandle[layout] = entry.get();
+    m_setLayouts.emplace(key, std::move(entry));
+    return layout;
+}
+
+VkDescriptorSetLayout ObjectCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                                          VkDescriptorSetLayoutCreateFlags                 flags)
+{
+    const VkDescriptorSetLayoutCreateInfo createInfo = {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext        = nullptr,
+        .flags        = flags,
+        .bindingCount = (uint32_t)bindings.size(),
+        .pBindings    = bindings.data(),
+    };
+
+    return GetDescriptorSetLayout(createInfo);
+}
+
+bool ObjectCache::GetDescriptorCounts(const VkDescriptorSetLayout layout, DescriptorTypeCounts* outCounts) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_setLayoutsByHandle.find(layout);
+    if (it == m_setLayoutsByHandle.end()) {
+        return false;
+    }
+
+    *outCounts = it->second->descriptorCounts;
+    return true;
+}
+
+bool ObjectCache::GetBindings(const VkDescriptorSetLayout                   layout,
+                              std::vector<VkDescriptorSetLayoutBinding>* outBindings) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_setLayoutsByHandle.find(layout);
+    if (it == m_setLayoutsByHandle.end()) {
+        return false;
+    }
+
+    *outBindings = it->second->bindings;
+    return true;
+}
+
+const DescriptorUpdateTemplate* ObjectCache::GetUpdateTemplate(const VkDescriptorSetLayout layout)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_setLayoutsByHandle.find(layout);
+    if (it == m_setLayoutsByHandle.end()) {
+        return nullptr;
+    }
+
+    SetLayoutEntry& entry = *it->second;
+    if (entry.templateBuilt) {
+        m_templateCounters.hits++;
+        return entry.updateTemplate.get();
+    }
+    m_templateCounters.misses++;
+    entry.templateBuilt = true;
+
+    // Push descriptor layouts are updated with vkCmdPushDescriptorSetKHR only, descriptor buffer layouts have no sets
+    const VkDescriptorSetLayoutCreateFlags noSetFlags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR
+                                                      | VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+    if (entry.flags & noSetFlags) {
+        return nullptr;
+    }
+
+    for (const VkDescriptorBindingFlags flags : entry.bindingFlags) {
+        if (flags & VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT) {
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<DescriptorUpdateTemplate> updateTemplate = std::make_unique<DescriptorUpdateTemplate>();
+    for (const VkDescriptorSetLayoutBinding& binding : entry.bindings) {
+        if (binding.descriptorType >= CORE_DESCRIPTOR_TYPE_COUNT) {
+            return nullptr;
+        }
+        if (binding.descriptorCount > 0) {
+            updateTemplate->bindings.push_back({binding.binding, binding.descriptorType, 0, binding.descriptorCount});
+        }
+    }
+
+    std::sort(updateTemplate->bindings.begin(), updateTemplate->bindings.end(),
+              [](const DescriptorUpdateTemplate::Binding& lhs, const DescriptorUpdateTemplate::Binding& rhs) {
+                  return lhs.binding < rhs.binding;
+              });
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(updateTemplate->bindings.size());
+    for (DescriptorUpdateTemplate::Binding& binding : updateTemplate->bindings) {
+        binding.first = updateTemplate->descriptorCount;
+        updateTemplate->descriptorCount += binding.count;
+
+        entries.push_back({
+            .dstBinding      = binding.binding,
+            .dstArrayElement = 0,
+            .descriptorCount = binding.count,
+            .descriptorType  = binding.type,
+            .offset          = binding.first * sizeof(DescriptorInfo),
+            .stride          = sizeof(DescriptorInfo),
+        });
+    }
+
+    if (entries.empty()) {
+        return nullptr;
+    }
+
+    const VkDescriptorUpdateTemplateCreateInfo createInfo = {
+        .sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+        .pNext                      = nullptr,
+        .flags                      = 0,
+        .descriptorUpdateEntryCount = (uint32_t)entries.size(),
+        .pDescriptorUpdateEntries   = entries.data(),
+        .templateType               = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+        .descriptorSetLayout        = layout,
+        .pipelineBindPoint          = VK_PIPELINE_BIND_POINT_GRAPHICS, // only used by push descriptor templates
+        .pipelineLayout             = VK_NULL_HANDLE,
+        .set                        = 0,
+    };
+
+    const VkResult result = vkCreateDescriptorUpdateTemplate(m_device, &createInfo, nullptr, &updateTemplate->handle);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Descriptor update template creation failed: %d\n", result);
+        return nullptr;
+    }
+
+    entry.updateTemplate = std::move(updateTemplate);
+    return entry.updateTemplate.get();
+}
+
+VkPipelineLayout ObjectCache::GetPipelineLayout(const VkPipelineLayoutCreateInfo& createInfo)
+{
+    assert(createInfo.pNext == nullptr && "Pipeline layout create info chains are not cached");
+
+    PipelineLayoutKey key = {
+        .flags          = createInfo.flags,
+        .setLayoutCount = createInfo.setLayoutCount,
+        .setLayouts     = createInfo.pSetLayouts,
+        .rangeCount     = createInfo.pushConstantRangeCount,
+        .ranges         = createInfo.pPushConstantRanges,
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_pipelineLayouts.find(key);
+    if (it != m_pipelineLayouts.end()) {
+        m_pipelineLayoutCounters.hits++;
+        return it->second->layout;
+    }
+    m_pipelineLayoutCounters.misses++;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    const VkResult   result = vkCreatePipelineLayout(m_device, &createInfo, nullptr, &layout);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Pipeline layout creation failed: %d\n", result);
+        return VK_NULL_HANDLE;
+    }
+
+    std::unique_ptr<PipelineLayoutEntry> entry = std::make_unique<PipelineLayoutEntry>();
+    entry->layout                              = layout;
+    entry->setLayouts.assign(key.setLayouts, key.setLayouts + key.setLayoutCount);
+    entry->ranges.assign(key.ranges, key.ranges + key.rangeCount);
+
+    key.setLayouts = entry->setLayouts.data();
+    key.ranges     = entry->ranges.data();
+
+    m_pipelineLayouts.emplace(key, std::move(entry));
+    return layout;
+}
+
+VkPipelineLayout ObjectCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& layouts,
+                                                uint32_t                                  pushConstantSize)
+{
+    const VkPushConstantRange pushConstantRange = {
+        .stageFlags = VK_SHADER_STAGE_ALL,
+        .offset     = 0,
+        .size       = pushConstantSize,
+    };
+
+    const VkPipelineLayoutCreateInfo createInfo = {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext                  = nullptr,
+        .flags                  = 0,
+        .setLayoutCount         = (uint32_t)layouts.size(),
+        .pSetLayouts            = layouts.data(),
+        .pushConstantRangeCount = (pushConstantSize > 0) ? 1u : 0u,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    return GetPipelineLayout(createInfo);
+}
+
+VkSampler ObjectCache::GetSampler(const VkSamplerCreateInfo& createInfo)
+{
+    return SamplerCache::Get(m_device).GetSampler(createInfo);
+}
+
+ObjectCache::Stats ObjectCache::GetStats() const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        stats.descriptorSetLayouts       = m_setLayoutCounters;
+        stats.descriptorSetLayouts.count = (uint32_t)m_setLayouts.size();
+        stats.pipelineLayouts            = m_pipelineLayoutCounters;
+        stats.pipelineLayouts.count      = (uint32_t)m_pipelineLayouts.size();
+        stats.updateTemplates            = m_templateCounters;
+        stats.updateTemplates.count      = (uint32_t)m_templateCounters.misses;
+    }
+
+    if (const SamplerCache* samplers = SamplerCache::Find(m_device)) {
+        stats.samplers = {
+            .hits   = samplers->Hits(),
+            .misses = samplers->Misses(),
+            .count  = samplers->SamplerCount(),
+        };
+    }
+
+    return stats;
+}
+
+void ObjectCache::PrintStats() const
+{
+    const Stats stats = GetStats();
+
+    const auto print = [](const char* name, const Counters& counters) {
+        printf("Object cache: %u %s, %llu hits, %llu misses\n", counters.count, name,
+               (unsigned long long)counters.hits, (unsigned long long)counters.misses);
+    };
+
+    print("descriptor set layouts", stats.descriptorSetLayouts);
+    print("pipeline layouts", stats.pipelineLayouts);
+    print("samplers", stats.samplers);
+    print("update templates", stats.updateTemplates);
+}
+
+size_t ObjectCache::KeyHash::operator()(const SetLayoutKey& key) const
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    HashField(&hash, key.flags);
+    HashField(&hash, key.bindingCount);
+    for (uint32_t idx = 0; idx < key.bindingCount; idx++) {
+        const VkDescriptorSetLayoutBinding& binding = key.bindings[idx];
+
+        HashField(&hash, binding.binding);
+        HashField(&hash, binding.descriptorType);
+        HashField(&hash, binding.descriptorCount);
+        HashField(&hash, binding.stageFlags);
+
+        // The sampler handles, not the address of the caller's array
+        const VkSampler* samplers = ImmutableSamplers(binding);
+        HashArray(&hash, samplers, (samplers != nullptr) ? binding.descriptorCount : 0);
+    }
+    HashArray(&hash, key.bindingFlags, key.bindingFlagCount);
+
+    return (size_t)hash;
+}
+
+size_t ObjectCache::KeyHash::operator()(const PipelineLayoutKey& key) const
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    HashField(&hash, key.flags);
+    HashArray(&hash, key.setLayouts, key.setLayoutCount);
+    HashField(&hash, key.rangeCount);
+    for (uint32_t idx = 0; idx < key.rangeCount; idx++) {
+        HashField(&hash, key.ranges[idx].stageFlags);
+        HashField(&hash, key.ranges[idx].offset);
+        HashField(&hash, key.ranges[idx].size);
+    }
+
+    return (size_t)hash;
+}
+
+bool ObjectCache::KeyEqual::operator()(const SetLayoutKey& lhs, const SetLayoutKey& rhs) const
+{
+    if (lhs.flags != rhs.flags || lhs.bindingCount != rhs.bindingCount
+        || lhs.bindingFlagCount != rhs.bindingFlagCount) {
+        return false;
+    }
+
+    for (uint32_t idx = 0; idx < lhs.bindingCount; idx++) {
+        const VkDescriptorSetLayoutBinding& a = lhs.bindings[idx];
+        const VkDescriptorSetLayoutBinding& b = rhs.bindings[idx];
+
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount
+            || a.stageFlags != b.stageFlags) {
+            return false;
+        }
+
+        const VkSampler* samplersA = ImmutableSamplers(a);
+        const VkSampler* samplersB = ImmutableSamplers(b);
+        if ((samplersA == nullptr) != (samplersB == nullptr)) {
+            return false;
+        }
+        for (uint32_t samplerIdx = 0; samplersA != nullptr && samplerIdx < a.descriptorCount; samplerIdx++) {
+            if (samplersA[samplerIdx] != samplersB[samplerIdx]) {
+                return false;
+            }
+        }
+    }
+
+    for (uint32_t idx = 0; idx < lhs.bindingFlagCount; idx++) {
+        if (lhs.bindingFlags[idx] != rhs.bindingFlags[idx]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ObjectCache::KeyEqual::operator()(const PipelineLayoutKey& lhs, const PipelineLayoutKey& rhs) const
+{
+    if (lhs.flags != rhs.flags || lhs.setLayoutCount != rhs.setLayoutCount || lhs.rangeCount != rhs.rangeCount) {
+        return false;
+    }
+
+    for (uint32_t idx = 0; idx < lhs.setLayoutCount; idx++) {
+        if (lhs.setLayouts[idx] != rhs.setLayouts[idx]) {
+            return false;
+        }
+    }
+
+    for (uint32_t idx = 0; idx < lhs.rangeCount; idx++) {
+        const VkPushConstantRange& a = lhs.ranges[idx];
+        const VkPushConstantRange& b = rhs.ranges[idx];
+
+        if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size) {
+            return false;
+        }
+    }
+
+    return true;
+}
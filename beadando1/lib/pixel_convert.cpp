@@ -0,0 +1,481 @@
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PIXEL_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(PIXEL_CONVERT_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles every intrinsic without target flags
+#define TARGET_SSE41
+#define TARGET_AVX2
+#elif defined(PIXEL_CONVERT_X86)
+// Only these functions use the instructions, the rest of the library stays buildable for any x86 CPU
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+SimdLevel DetectSimdLevel()
+{
+#if defined(PIXEL_CONVERT_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 1);
+    const bool sse41   = (info[2] & (1 << 19)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    // AVX registers must also be saved by the OS
+    bool avx2 = false;
+    if (osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    return avx2 ? SimdLevel::AVX2 : (sse41 ? SimdLevel::SSE41 : SimdLevel::Scalar);
+#elif defined(PIXEL_CONVERT_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    return __builtin_cpu_supports("sse4.1") ? SimdLevel::SSE41 : SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+std::atomic<SimdLevel>& ActiveSimdLevel()
+{
+    static std::atomic<SimdLevel> level(DetectSimdLevel());
+    return level;
+}
+
+// x * a / 255 rounded, exact for every 8 bit x and a
+inline uint8_t MulDiv255(uint32_t x, uint32_t a)
+{
+    const uint32_t t = x * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+// Index of the linear -> sRGB table: 12 bits keep every dark sRGB step distinguishable
+constexpr uint32_t LINEAR_TABLE_SIZE = 4096;
+
+const std::array<float, 256>& SrgbToLinearTable()
+{
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> result = {};
+        for (uint32_t idx = 0; idx < 256; idx++) {
+            const float srgb = idx / 255.0f;
+            result[idx] = (srgb <= 0.04045f) ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+
+    return table;
+}
+
+const std::array<uint8_t, LINEAR_TABLE_SIZE>& LinearToSrgbTable()
+{
+    static const std::array<uint8_t, LINEAR_TABLE_SIZE> table = [] {
+        std::array<uint8_t, LINEAR_TABLE_SIZE> result = {};
+        for (uint32_t idx = 0; idx < LINEAR_TABLE_SIZE; idx++) {
+            const float linear = idx / (float)(LINEAR_TABLE_SIZE - 1);
+            const float srgb   = (linear <= 0.0031308f) ? linear * 12.92f
+                                                        : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            result[idx] = (uint8_t)std::lround(std::clamp(srgb, 0.0f, 1.0f) * 255.0f);
+        }
+        return result;
+    }();
+
+    return table;
+}
+
+// Scalar kernels, also used for the tails of the SIMD ones
+
+void ExpandRGBToRGBAScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    for (size_t idx = 0; idx < pixelCount; idx++) {
+        dst[idx * 4 + 0] = src[idx * 3 + 0];
+        dst[idx * 4 + 1] = src[idx * 3 + 1];
+        dst[idx * 4 + 2] = src[idx * 3 + 2];
+        dst[idx * 4 + 3] = 255;
+    }
+}
+
+void SwizzleRGBAScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint8_t order[4])
+{
+    for (size_t idx = 0; idx < pixelCount; idx++) {
+        const uint8_t pixel[4] = {src[idx * 4 + 0], src[idx * 4 + 1], src[idx * 4 + 2], src[idx * 4 + 3]};
+        for (uint32_t c = 0; c < 4; c++) {
+            dst[idx * 4 + c] = pixel[order[c]];
+        }
+    }
+}
+
+void PackRGScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    for (size_t idx = 0; idx < pixelCount; idx++) {
+        dst[idx * 2 + 0] = src[idx * 4 + 0];
+        dst[idx * 2 + 1] = src[idx * 4 + 1];
+    }
+}
+
+void PremultiplyAlphaScalar(uint8_t* pixels, size_t pixelCount)
+{
+    for (size_t idx = 0; idx < pixelCount; idx++) {
+        uint8_t* pixel = pixels + idx * 4;
+        pixel[0]       = MulDiv255(pixel[0], pixel[3]);
+        pixel[1]       = MulDiv255(pixel[1], pixel[3]);
+        pixel[2]       = MulDiv255(pixel[2], pixel[3]);
+    }
+}
+
+#if defined(PIXEL_CONVERT_X86)
+
+// 4 RGB pixels (12 bytes) -> 4 RGBA pixels, the alpha bytes are zeroed and or-ed in afterwards
+#define RGB_TO_RGBA_SHUFFLE 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+
+TARGET_SSE41 void ExpandRGBToRGBASSE41(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m128i shuffle = _mm_setr_epi8(RGB_TO_RGBA_SHUFFLE);
+    const __m128i alpha   = _mm_set1_epi32((int)0xff000000);
+
+    // Each load reads 16 bytes for 12 used ones, stop while the over-read is still inside the source
+    size_t idx = 0;
+    for (; idx + 6 <= pixelCount; idx += 4) {
+        const __m128i rgb = _mm_loadu_si128((const __m128i*)(src + idx * 3));
+        _mm_storeu_si128((__m128i*)(dst + idx * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+    }
+
+    ExpandRGBToRGBAScalar(src + idx * 3, dst + idx * 4, pixelCount - idx);
+}
+
+TARGET_AVX2 void ExpandRGBToRGBAAVX2(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    // The shuffle works inside the 128 bit lanes: each lane gets 4 pixels of its own load
+    const __m256i shuffle = _mm256_setr_epi8(RGB_TO_RGBA_SHUFFLE, RGB_TO_RGBA_SHUFFLE);
+    const __m256i alpha   = _mm256_set1_epi32((int)0xff000000);
+
+    size_t idx = 0;
+    for (; idx + 10 <= pixelCount; idx += 8) {
+        const __m128i lo  = _mm_loadu_si128((const __m128i*)(src + idx * 3));
+        const __m128i hi  = _mm_loadu_si128((const __m128i*)(src + idx * 3 + 12));
+        const __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256((__m256i*)(dst + idx * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+    }
+
+    ExpandRGBToRGBASSE41(src + idx * 3, dst + idx * 4, pixelCount - idx);
+}
+
+#undef RGB_TO_RGBA_SHUFFLE
+
+// Byte shuffle mask applying 'order' to the 4 pixels of a 128 bit lane
+std::array<int8_t, 16> SwizzleShuffle(const uint8_t order[4])
+{
+    std::array<int8_t, 16> shuffle = {};
+    for (uint32_t idx = 0; idx < 16; idx++) {
+        shuffle[idx] = (int8_t)((idx & ~3u) + (order[idx & 3] & 3));
+    }
+    return shuffle;
+}
+
+TARGET_SSE41 void SwizzleRGBASSE41(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint8_t order[4])
+{
+    const std::array<int8_t, 16> mask    = SwizzleShuffle(order);
+    const __m128i                shuffle = _mm_loadu_si128((const __m128i*)mask.data());
+
+    size_t idx = 0;
+    for (; idx + 4 <= pixelCount; idx += 4) {
+        const __m128i pixels = _mm_loadu_si128((const __m128i*)(src + idx * 4));
+        _mm_storeu_si128((__m128i*)(dst + idx * 4), _mm_shuffle_epi8(pixels, shuffle));
+    }
+
+    SwizzleRGBAScalar(src + idx * 4, dst + idx * 4, pixelCount - idx, order);
+}
+
+TARGET_AVX2 void SwizzleRGBAAVX2(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint8_t order[4])
+{
+    const std::array<int8_t, 16> mask    = SwizzleShuffle(order);
+    const __m256i                shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mask.data()));
+
+    size_t idx = 0;
+    for (; idx + 8 <= pixelCount; idx += 8) {
+        const __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + idx * 4));
+        _mm256_storeu_si256((__m256i*)(dst + idx * 4), _mm256_shuffle_epi8(pixels, shuffle));
+    }
+
+    SwizzleRGBASSE41(src + idx * 4, dst + idx * 4, pixelCount - idx, order);
+}
+
+// 4 RGBA pixels -> 4 RG pixels in the low 8 bytes
+#define RGBA_TO_RG_SHUFFLE 0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1
+
+TARGET_SSE41 void PackRGSSE41(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m128i shuffle = _mm_setr_epi8(RGBA_TO_RG_SHUFFLE);
+
+    size_t idx = 0;
+    for (; idx + 4 <= pixelCount; idx += 4) {
+        const __m128i pixels = _mm_loadu_si128((const __m128i*)(src + idx * 4));
+        _mm_storel_epi64((__m128i*)(dst + idx * 2), _mm_shuffle_epi8(pixels, shuffle));
+    }
+
+    PackRGScalar(src + idx * 4, dst + idx * 2, pixelCount - idx);
+}
+
+TARGET_AVX2 void PackRGAVX2(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+    const __m256i shuffle = _mm256_setr_epi8(RGBA_TO_RG_SHUFFLE, RGBA_TO_RG_SHUFFLE);
+
+    size_t idx = 0;
+    for (; idx + 8 <= pixelCount; idx += 8) {
+        const __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + idx * 4));
+        // Each lane holds its 8 result bytes at the bottom, move the upper lane's next to the lower one's
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(pixels, shuffle), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i*)(dst + idx * 2), _mm256_castsi256_si128(packed));
+    }
+
+    PackRGSSE41(src + idx * 4, dst + idx * 2, pixelCount - idx);
+}
+
+#undef RGBA_TO_RG_SHUFFLE
+
+// Color words times alpha / 255, the alpha word is multiplied by 255 / 255 and stays as it is
+TARGET_SSE41 __m128i PremultiplyWords(__m128i words)
+{
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha         = _mm_blend_epi16(alpha, _mm_set1_epi16(255), 0x88);
+
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(words, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+TARGET_SSE41 void PremultiplyAlphaSSE41(uint8_t* pixels, size_t pixelCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t idx = 0;
+    for (; idx + 4 <= pixelCount; idx += 4) {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)(pixels + idx * 4));
+        const __m128i lo    = PremultiplyWords(_mm_unpacklo_epi8(bytes, zero));
+        const __m128i hi    = PremultiplyWords(_mm_unpackhi_epi8(bytes, zero));
+        _mm_storeu_si128((__m128i*)(pixels + idx * 4), _mm_packus_epi16(lo, hi));
+    }
+
+    PremultiplyAlphaScalar(pixels + idx * 4, pixelCount - idx);
+}
+
+TARGET_AVX2 __m256i PremultiplyWords(__m256i words)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(words, _MM_SHUFFLE(3, 3, 3, 3)),
+                                           _MM_SHUFFLE(3, 3, 3, 3));
+    alpha         = _mm256_blend_epi16(alpha, _mm256_set1_epi16(255), 0x88);
+
+    const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(words, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+TARGET_AVX2 void PremultiplyAlphaAVX2(uint8_t* pixels, size_t pixelCount)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    // Unpack and pack both work inside the lanes, the pixel order is kept
+    size_t idx = 0;
+    for (; idx + 8 <= pixelCount; idx += 8) {
+        const __m256i bytes = _mm256_loadu_si256((const __m256i*)(pixels + idx * 4));
+        const __m256i lo    = PremultiplyWords(_mm256_unpacklo_epi8(bytes, zero));
+        const __m256i hi    = PremultiplyWords(_mm256_unpackhi_epi8(bytes, zero));
+        _mm256_storeu_si256((__m256i*)(pixels + idx * 4), _mm256_packus_epi16(lo, hi));
+    }
+
+    PremultiplyAlphaSSE41(pixels + idx * 4, pixelCount - idx);
+}
+
+#endif // PIXEL_CONVERT_X86
+
+} // anonymous namespace
+
+SimdLevel PixelConvertSimdLevel()
+{
+    return ActiveSimdLevel().load(std::memory_order_relaxed);
+}
+
+SimdLevel SetPixelConvertSimdLevel(SimdLevel level)
+{
+    static const SimdLevel supported = DetectSimdLevel();
+
+    const SimdLevel used = std::min(level, supported);
+    ActiveSimdLevel().store(used, std::memory_order_relaxed);
+    return used;
+}
+
+void ExpandRGBToRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+#if defined(PIXEL_CONVERT_X86)
+    switch (PixelConvertSimdLevel()) {
+    case SimdLevel::AVX2: return ExpandRGBToRGBAAVX2(src, dst, pixelCount);
+    case SimdLevel::SSE41: return ExpandRGBToRGBASSE41(src, dst, pixelCount);
+    case SimdLevel::Scalar: break;
+    }
+#endif
+    ExpandRGBToRGBAScalar(src, dst, pixelCount);
+}
+
+void ExpandToRGBA(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixelCount)
+{
+    switch (channels) {
+    case 4:
+        std::memcpy(dst, src, pixelCount * 4);
+        break;
+    case 3:
+        ExpandRGBToRGBA(src, dst, pixelCount);
+        break;
+    case 2:
+        for (size_t idx = 0; idx < pixelCount; idx++) {
+            std::memset(dst + idx * 4, src[idx * 2], 3);
+            dst[idx * 4 + 3] = src[idx * 2 + 1];
+        }
+        break;
+    default:
+        for (size_t idx = 0; idx < pixelCount; idx++) {
+            std::memset(dst + idx * 4, src[idx], 3);
+            dst[idx * 4 + 3] = 255;
+        }
+        break;
+    }
+}
+
+void SwizzleRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint8_t order[4])
+{
+#if defined(PIXEL_CONVERT_X86)
+    switch (PixelConvertSimdLevel()) {
+    case SimdLevel::AVX2: return SwizzleRGBAAVX2(src, dst, pixelCount, order);
+    case SimdLevel::SSE41: return SwizzleRGBASSE41(src, dst, pixelCount, order);
+    case SimdLevel::Scalar: break;
+    }
+#endif
+    SwizzleRGBAScalar(src, dst, pixelCount, order);
+}
+
+void PackRG(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+{
+#if defined(PIXEL_CONVERT_X86)
+    switch (PixelConvertSimdLevel()) {
+    case SimdLevel::AVX2: return PackRGAVX2(src, dst, pixelCount);
+    case SimdLevel::SSE41: return PackRGSSE41(src, dst, pixelCount);
+    case SimdLevel::Scalar: break;
+    }
+#endif
+    PackRGScalar(src, dst, pixelCount);
+}
+
+void PremultiplyAlpha(uint8_t* pixels, size_t pixelCount)
+{
+#if defined(PIXEL_CONVERT_X86)
+    switch (PixelConvertSimdLevel()) {
+    case SimdLevel::AVX2: return PremultiplyAlphaAVX2(pixels, pixelCount);
+    case SimdLevel::SSE41: return PremultiplyAlphaSSE41(pixels, pixelCount);
+    case SimdLevel::Scalar: break;
+    }
+#endif
+    PremultiplyAlphaScalar(pixels, pixelCount);
+}
+
+void SrgbToLinearRGBA(const uint8_t* src, float* dst, size_t pixelCount)
+{
+    const std::array<float, 256>& table = SrgbToLinearTable();
+
+    for (size_t idx = 0; idx < pixelCount; idx++) {
+        dst[idx * 4 + 0] = table[src[idx * 4 + 0]];
+        dst[idx * 4 + 1] = table[src[idx * 4 + 1]];
+        dst[idx * 4 + 2] = table[src[idx * 4 + 2]];
+        dst[idx * 4 + 3] = src[idx * 4 + 3] * (1.0f / 255.0f);
+    }
+}
+
+void LinearToSrgbRGBA(const float* src, uint8_t* dst, size_t pixelCount)
+{
+    const std::array<uint8_t, LINEAR_TABLE_SIZE>& table = LinearToSrgbTable();
+    constexpr float                               scale = LINEAR_TABLE_SIZE - 1;
+
+    for (size_t idx = 0; idx < pixelCount; idx++) {
+        for (uint32_t c = 0; c < 3; c++) {
+            const float linear = std::clamp(src[idx * 4 + c], 0.0f, 1.0f);
+            dst[idx * 4 + c]   = table[(uint32_t)(linear * scale + 0.5f)];
+        }
+        dst[idx * 4 + 3] = (uint8_t)(std::clamp(src[idx * 4 + 3], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+PixelConversion ChoosePixelConversion(const VkFormat format, bool premultiplyAlpha)
+{
+    PixelConversion conversion = {
+        .format           = format,
+        .pixelSize        = 4,
+        .swizzleBGRA      = false,
+        .packRG           = false,
+        .premultiplyAlpha = premultiplyAlpha,
+        .srgb             = false,
+    };
+
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        conversion.srgb = true;
+        break;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+        conversion.swizzleBGRA = true;
+        break;
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        conversion.swizzleBGRA = true;
+        conversion.srgb        = true;
+        break;
+    case VK_FORMAT_R8G8_UNORM:
+        conversion.pixelSize        = 2;
+        conversion.packRG           = true;
+        conversion.premultiplyAlpha = false; // no alpha left to premultiply with
+        break;
+    default:
+        break;
+    }
+
+    return conversion;
+}
+
+void ConvertPixels(const PixelConversion& conversion,
+                   const uint8_t*         src,
+                   uint32_t               channels,
+                   uint8_t*               dst,
+                   size_t                 pixelCount)
+{
+    if (conversion.packRG) {
+        if (channels == 4) {
+            PackRG(src, dst, pixelCount);
+            return;
+        }
+
+        std::vector<uint8_t> rgba(pixelCount * 4);
+        ExpandToRGBA(src, channels, rgba.data(), pixelCount);
+        PackRG(rgba.data(), dst, pixelCount);
+        return;
+    }
+
+    ExpandToRGBA(src, channels, dst, pixelCount);
+
+    // Premultiplied on the stored values, for sRGB formats that is the encoded color
+    if (conversion.premultiplyAlpha && channels != 3 && channels != 1) {
+        PremultiplyAlpha(dst, pixelCount);
+    }
+
+    if (conversion.swizzleBGRA) {
+        const uint8_t bgra[4] = {2, 1, 0, 3};
+        SwizzleRGBA(dst, dst, pixelCount, bgra);
+    }
+}
@@ -0,0 +1,202 @@
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "ktx2.h"
+#include "pixel_convert.h"
+
+// ImGui compiles its own static copy for the font atlas, this one is private to the atlas builder
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace {
+
+struct BlockInfo {
+    uint32_t dim   = 1; // texels per block side
+    uint32_t bytes = 4;
+};
+
+BlockInfo BlockInfoOf(const VkFormat format)
+{
+    const uint32_t blockBytes = BlockCompressedSize(format);
+    if (blockBytes != 0) {
+        return {4, blockBytes};
+    }
+
+    return {1, ChoosePixelConversion(format).pixelSize};
+}
+
+// Tries to pack the rects into width x height grid cells
+bool PackRects(std::vector<stbrp_rect>& rects, uint32_t width, uint32_t height)
+{
+    std::vector<stbrp_node> nodes(width);
+
+    stbrp_context context;
+    stbrp_init_target(&context, (int)width, (int)height, nodes.data(), (int)nodes.size());
+
+    return stbrp_pack_rects(&context, rects.data(), (int)rects.size()) == 1;
+}
+
+} // anonymous namespace
+
+uint32_t AtlasBuilder::Add(const DecodedImage& image)
+{
+    assert(!image.generateMips && "The atlas needs the complete mip chain of its images");
+
+    m_images.push_back(&image);
+    return (uint32_t)(m_images.size() - 1);
+}
+
+bool AtlasBuilder::Build(TextureAtlas* outAtlas, uint32_t maxSize, uint32_t maxLevels) const
+{
+    if (m_images.empty()) {
+        return false;
+    }
+
+    const VkFormat  format = m_images[0]->format;
+    const BlockInfo block  = BlockInfoOf(format);
+
+    uint32_t levelCount = std::max(maxLevels, 1u);
+    for (const DecodedImage* image : m_images) {
+        if (image->format != format || image->width % block.dim != 0 || image->height % block.dim != 0) {
+            printf("[ERROR] Atlas: '%s' does not match the format or block size of the atlas\n", image->path.c_str());
+            return false;
+        }
+
+        levelCount = std::min(levelCount, (uint32_t)image->mips.levels.size());
+    }
+
+    // Every level of every image has to start and end on a whole block of its atlas level
+    const auto alignedAtLevels = [&](uint32_t levels) {
+        const uint32_t grid = block.dim << (levels - 1);
+        return std::all_of(m_images.begin(), m_images.end(), [grid](const DecodedImage* image) {
+            return image->width % grid == 0 && image->height % grid == 0;
+        });
+    };
+    while (levelCount > 1 && !alignedAtLevels(levelCount)) {
+        levelCount--;
+    }
+
+    // Placement grid in texels of level 0, also the gutter width: one block on the coarsest level
+    const uint32_t grid = block.dim << (levelCount - 1);
+
+    std::vector<stbrp_rect> rects(m_images.size());
+    uint64_t                area = 0;
+    for (uint32_t idx = 0; idx < m_images.size(); idx++) {
+        rects[idx]    = {};
+        rects[idx].id = (int)idx;
+        rects[idx].w  = (stbrp_coord)(m_images[idx]->width / grid + 2);
+        rects[idx].h  = (stbrp_coord)(m_images[idx]->height / grid + 2);
+        area += (uint64_t)rects[idx].w * rects[idx].h;
+    }
+
+    // Smallest power of two size the rects fit into, growing the width and the height in turn
+    uint32_t width  = 1;
+    uint32_t height = 1;
+    while ((uint64_t)width * height < area) {
+        if (width <= height) {
+            width *= 2;
+        } else {
+            height *= 2;
+        }
+    }
+
+    const uint32_t maxCells = std::max(maxSize / grid, 1u);
+    while (width > maxCells || height > maxCells || !PackRects(rects, width, height)) {
+        if (width >= maxCells && height >= maxCells) {
+            printf("[ERROR] Atlas: %zu images do not fit into %ux%u\n", m_images.size(), maxSize, maxSize);
+            return false;
+        }
+        if (width <= height && width < maxCells) {
+            width *= 2;
+        } else {
+            height *= 2;
+        }
+    }
+
+    // The packer fills from the top left, the power of two size is not needed by the device
+    width  = 0;
+    height = 0;
+    for (const stbrp_rect& rect : rects) {
+        width  = std::max(width, (uint32_t)(rect.x + rect.w));
+        height = std::max(height, (uint32_t)(rect.y + rect.h));
+    }
+
+    TextureAtlas atlas;
+    atlas.image.path         = "atlas";
+    atlas.image.format       = format;
+    atlas.image.width        = width * grid;
+    atlas.image.height       = height * grid;
+    atlas.image.mipLevels    = levelCount;
+    atlas.image.generateMips = false;
+
+    uint64_t totalSize = 0;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        const uint32_t levelWidth  = atlas.image.width >> level;
+        const uint32_t levelHeight = atlas.image.height >> level;
+        const uint64_t levelSize   = (uint64_t)(levelWidth / block.dim) * (levelHeight / block.dim) * block.bytes;
+
+        atlas.image.mips.levels.push_back({levelWidth, levelHeight, totalSize, levelSize});
+        totalSize += levelSize;
+    }
+    atlas.image.mips.data.resize(totalSize);
+    atlas.regions.resize(m_images.size());
+
+    for (const stbrp_rect& rect : rects) {
+        const DecodedImage& image = *m_images[rect.id];
+
+        // Top left texel of the image inside its gutter
+        const uint32_t originX = (rect.x + 1) * grid;
+        const uint32_t originY = (rect.y + 1) * grid;
+
+        for (uint32_t level = 0; level < levelCount; level++) {
+            const MipLevel& src = image.mips.levels[level];
+            const MipLevel& dst = atlas.image.mips.levels[level];
+
+            // Everything below is counted in blocks of the level
+            const uint32_t gutter    = (grid >> level) / block.dim;
+            const uint32_t srcWidth  = (image.width >> level) / block.dim;
+            const uint32_t srcHeight = (image.height >> level) / block.dim;
+            const uint32_t dstX      = (originX >> level) / block.dim;
+            const uint32_t dstY      = (originY >> level) / block.dim;
+            const uint64_t srcPitch  = (uint64_t)srcWidth * block.bytes;
+            const uint64_t dstPitch  = (uint64_t)(dst.width / block.dim) * block.bytes;
+
+            if ((uint64_t)srcHeight * srcPitch > src.size) {
+                printf("[ERROR] Atlas: level %u of '%s' is truncated\n", level, image.path.c_str());
+                return false;
+            }
+
+            const uint8_t* srcData = image.Data() + src.offset;
+            uint8_t*       dstData = atlas.image.mips.data.data() + dst.offset;
+
+            for (int32_t row = -(int32_t)gutter; row < (int32_t)(srcHeight + gutter); row++) {
+                const uint8_t* srcRow = srcData + std::clamp<int32_t>(row, 0, srcHeight - 1) * srcPitch;
+                uint8_t*       dstRow = dstData + (dstY + row) * dstPitch + (uint64_t)dstX * block.bytes;
+
+                std::memcpy(dstRow, srcRow, srcPitch);
+                for (uint32_t col = 1; col <= gutter; col++) {
+                    std::memcpy(dstRow - (uint64_t)col * block.bytes, srcRow, block.bytes);
+                    std::memcpy(dstRow + srcPitch + (uint64_t)(col - 1) * block.bytes,
+                                srcRow + srcPitch - block.bytes, block.bytes);
+                }
+            }
+        }
+
+        atlas.regions[rect.id] = {
+            .scale  = glm::vec2((float)image.width / atlas.image.width, (float)image.height / atlas.image.height),
+            .offset = glm::vec2((float)originX / atlas.image.width, (float)originY / atlas.image.height),
+        };
+    }
+
+    printf("Atlas: %zu images in %ux%u, %u levels\n", m_images.size(), atlas.image.width, atlas.image.height,
+           levelCount);
+
+    *outAtlas = std::move(atlas);
+
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "glm_config.h"
+#include "texture.h"
+
+// Where an image ended up in the atlas: atlasUV = uv * scale + offset, for uv in [0, 1]
+struct AtlasRegion {
+    glm::vec2 scale  = glm::vec2(1.0f);
+    glm::vec2 offset = glm::vec2(0.0f);
+
+    glm::vec2 Apply(const glm::vec2& uv) const { return uv * scale + offset; }
+};
+
+struct TextureAtlas {
+    DecodedImage             image;   // complete mip chain of the atlas, see Texture::CreateFromDecoded
+    std::vector<AtlasRegion> regions; // indexed by the return value of AtlasBuilder::Add
+};
+
+/**
+ * Packs small textures into one image with the bundled stb rect packer (imstb_rectpack.h).
+ *
+ * The inputs are decoded mip chains of the same format, uncompressed or block compressed (e.g. embedded KTX2
+ * data, see Texture::DecodeData): every level of an input is copied into the same level of the atlas, nothing
+ * is filtered again. For that the images are placed on a grid fine enough for the coarsest atlas level, and
+ * each image is surrounded by a gutter repeating its edge texels (edge blocks of compressed formats) on every
+ * level, so linear filtering and the coarser levels do not bleed the neighbours in.
+ *
+ * The atlas keeps at most 'maxLevels' levels: each extra level doubles the gutter and the grid alignment.
+ * Meshes using the atlas remap their UVs with the returned regions, wrapping UVs outside of [0, 1] can not
+ * be used with an atlas.
+ */
+class AtlasBuilder {
+public:
+    static constexpr uint32_t DEFAULT_MAX_SIZE   = 4096;
+    static constexpr uint32_t DEFAULT_MAX_LEVELS = 4;
+
+    // The image must hold its complete chain on the CPU (generateMips == false) and stay alive until Build.
+    // Returns the index of its region.
+    uint32_t Add(const DecodedImage& image);
+
+    // False when the inputs have different formats or do not fit into maxSize x maxSize
+    bool Build(TextureAtlas* outAtlas, uint32_t maxSize = DEFAULT_MAX_SIZE, uint32_t maxLevels = DEFAULT_MAX_LEVELS) const;
+
+    uint32_t ImageCount() const { return (uint32_t)m_images.size(); }
+
+private:
+    std::vector<const DecodedImage*> m_images;
+};
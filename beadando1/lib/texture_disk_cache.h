@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan_core.h>
+
+struct DecodedImage;
+
+/**
+ * Persistent cache of decoded, mip-chained texel data ready for upload.
+ *
+ * Blobs are keyed by the hash of the source file content and the target format, so an edited
+ * source simply maps to a new blob. Hits are memory mapped and uploaded straight from the mapping.
+ *
+ * Several processes may share the directory: blobs are written to a unique temporary file and
+ * renamed into place, readers only ever see complete files and validate the header before use.
+ */
+class TextureDiskCache {
+public:
+    // Raised when the stored texels change: 2 converts per format and filters sRGB mips in linear space
+    static constexpr uint32_t VERSION = 2;
+
+    explicit TextureDiskCache(const std::string& directory);
+
+    bool IsEnabled() const { return !m_directory.empty(); }
+
+    // Maps the blob of the source, false on a miss or an invalid blob
+    bool Load(uint64_t sourceHash, const VkFormat format, DecodedImage* outImage) const;
+    // Writes the full mip chain of the image, the image must hold every level
+    bool Store(uint64_t sourceHash, const DecodedImage& image) const;
+
+    uint32_t Hits() const { return m_hits; }
+    uint32_t Misses() const { return m_misses; }
+
+    // 64 bit FNV-1a of the data
+    static uint64_t HashContent(const void* data, size_t size);
+
+private:
+    std::string BlobPath(uint64_t sourceHash, const VkFormat format) const;
+
+    std::string m_directory;
+
+    // Loads run on the texture loader's worker threads
+    mutable std::atomic<uint32_t> m_hits   = 0;
+    mutable std::atomic<uint32_t> m_misses = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+#include <vulkan/vulkan_core.h>
+
+#include "texture.h"
+#include "texture_disk_cache.h"
+#include "thread_pool.h"
+#include "upload_manager.h"
+
+/**
+ * Asynchronous texture loading.
+ *
+ * LoadAsync() returns a handle right away and decodes the file on a worker thread, so the decode
+ * time of several textures overlaps: loading is bound by the slowest decode instead of the sum.
+ * Creating the Vulkan image and queueing its upload happens on the calling thread in Update() or
+ * Wait(), as the upload manager must only be flushed from the thread which submits the frames.
+ *
+ * The returned textures are owned by the caller, same as with Texture::LoadFromFile.
+ */
+class TextureLoader {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+    // A thread count of zero uses one thread per hardware thread
+    void Create(const VkPhysicalDevice phyDevice,
+                const VkDevice         device,
+                UploadManager&         uploads,
+                uint32_t               threadCount = 0);
+    // Waits for the decodes in progress. Created textures belong to the caller and are not destroyed.
+    void Destroy();
+
+    // Decoded mip chains are kept in (and on later runs mapped from) the directory
+    void                    EnableDiskCache(const std::string& directory);
+    const TextureDiskCache* diskCache() const { return m_diskCache.get(); }
+
+    Handle LoadAsync(const std::string& path, const VkFormat format, VkImageUsageFlags usage);
+
+    // Embedded KTX2 data has nothing to decode, the texture is created and its upload queued right away.
+    // See Texture::LoadFromData, nullptr on failure.
+    Texture* LoadFromData(const std::string& name,
+                          const uint8_t*     data,
+                          size_t             size,
+                          const VkFormat     format,
+                          VkImageUsageFlags  usage);
+
+    // Only decodes on a worker thread, without creating a texture. The result always holds the complete
+    // mip chain on the CPU (built there when the decode would leave it to the GPU), see TextureStreamer.
+    std::future<std::unique_ptr<DecodedImage>> DecodeAsync(const std::string& path, const VkFormat format);
+
+    // Creates and queues the upload of every finished decode, returns how many finished in this call
+    uint32_t Update();
+
+    // nullptr until the decode finished and Update()/Wait() created the texture, or when the load failed
+    Texture* Get(Handle handle) const;
+    bool     IsFailed(Handle handle) const;
+
+    // Blocks until the decode finished and creates the texture, nullptr on failure
+    Texture* Wait(Handle handle);
+    void     WaitAll();
+
+    uint32_t PendingCount() const;
+
+private:
+    enum class State {
+        Decoding,
+        Ready,
+        Failed,
+    };
+
+    struct Request {
+        VkImageUsageFlags                          usage   = 0;
+        std::future<std::unique_ptr<DecodedImage>> decode  = {};
+        State                                      state   = State::Decoding;
+        Texture*                                   texture = nullptr;
+    };
+
+    void Finish(Request& request);
+
+    VkPhysicalDevice                  m_phyDevice = VK_NULL_HANDLE;
+    VkDevice                          m_device    = VK_NULL_HANDLE;
+    UploadManager*                    m_uploads   = nullptr;
+    std::unique_ptr<TextureDiskCache> m_diskCache; // declared before the pool, the workers use it until joined
+    std::unique_ptr<ThreadPool>       m_pool;
+
+    // Handles are indices, a deque keeps the requests in place while growing
+    std::deque<Request> m_requests;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "glm_config.h"
+#include "texture.h"
+#include "texture_loader.h"
+#include "upload_manager.h"
+
+/**
+ * Mip level streaming for textures larger than what should stay resident.
+ *
+ * A streamed texture keeps its complete mip chain on the CPU (mapped from the disk cache when it is
+ * enabled) and only the coarse end of the chain on the GPU. Right after the decode the levels up to
+ * INITIAL_RESIDENT_SIZE texels are uploaded, finer levels follow once the texture is drawn large enough.
+ *
+ * Every frame the users report how many pixels the texture covers on screen (RequestScreenSize,
+ * see ProjectedSize). Update() raises the resident levels of the textures missing the most levels first
+ * until the per-frame upload budget is used up. A Vulkan image can not grow, so a new residency creates
+ * a new image from the CPU chain (the coarser levels are uploaded again, at most a third of the new
+ * level) and the old image is destroyed a few frames later.
+ *
+ * The memory cap covers the resident images and the replaced ones not destroyed yet. Before growing a texture,
+ * textures not drawn in the current frame drop their finest level, least recently drawn first. Dropping a level
+ * also creates a new image, so it only frees memory once the replaced image is destroyed: the growth waits for
+ * that, and the copies of the evictions are paid from the frame budget like any other upload.
+ *
+ * The view changes with the residency. Users compare Version() with the version they last bound and
+ * rewrite their descriptor set while it is not used by a pending command buffer.
+ */
+class TextureStreamer {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+    static constexpr VkDeviceSize DEFAULT_FRAME_BUDGET  = 16ull * 1024 * 1024;
+    static constexpr VkDeviceSize DEFAULT_MEMORY_CAP    = 256ull * 1024 * 1024;
+    // Levels up to this size (in texels) are resident as soon as the decode finished
+    static constexpr uint32_t     INITIAL_RESIDENT_SIZE = 64;
+    // More frames than any swapchain keeps in flight
+    static constexpr uint64_t     RELEASE_DELAY_FRAMES  = 4;
+
+    struct Stats {
+        uint32_t     textureCount      = 0;
+        uint32_t     pendingCount      = 0; // still decoding
+        uint32_t     evictions         = 0; // levels dropped to stay under the memory cap
+        VkDeviceSize residentBytes     = 0;
+        VkDeviceSize retiredBytes      = 0; // replaced images waiting for the frames in flight
+        VkDeviceSize fullBytes         = 0; // device bytes if every level of every texture was resident
+        VkDeviceSize uploadedLastFrame = 0;
+        VkDeviceSize frameBudget       = 0;
+        VkDeviceSize memoryCap         = 0;
+    };
+
+    void Create(const VkPhysicalDevice phyDevice,
+                const VkDevice         device,
+                UploadManager&         uploads,
+                TextureLoader&         loader,
+                VkDeviceSize           frameBudget = DEFAULT_FRAME_BUDGET,
+                VkDeviceSize           memoryCap   = DEFAULT_MEMORY_CAP);
+    // Destroys every texture, the GPU must be idle.
+    void Destroy();
+
+    // Starts decoding the file on the loader's worker threads
+    Handle Add(const std::string& path, const VkFormat format);
+
+    // Blocks until the decode finished and the initial levels are queued for upload, false when the load failed
+    bool WaitResident(Handle handle);
+
+    // Records the on screen size of one use of the texture in the current frame, the largest request wins
+    void RequestScreenSize(Handle handle, float pixels);
+
+    // Diameter in pixels of a bounding sphere after projection, 0 when it is behind the camera
+    static float ProjectedSize(const glm::mat4& projection,
+                               const glm::mat4& view,
+                               const glm::vec3& center,
+                               float            radius,
+                               float            viewportHeight);
+
+    // Call once per frame, after the requests of the frame and before its submit
+    void Update();
+
+    // nullptr until the initial levels are created or when the load failed
+    const Texture* Get(Handle handle) const;
+    // Changes every time Get() returns a different texture, 0 while there is none
+    uint32_t       Version(Handle handle) const;
+    // Resident levels of the texture and the level count of its full chain
+    uint32_t       ResidentLevels(Handle handle) const;
+    uint32_t       LevelCount(Handle handle) const;
+
+    void SetFrameBudget(VkDeviceSize frameBudget) { m_frameBudget = frameBudget; }
+    void SetMemoryCap(VkDeviceSize memoryCap) { m_memoryCap = memoryCap; }
+
+    Stats GetStats() const;
+    void  PrintStats() const;
+
+private:
+    struct Entry {
+        std::string                                path;
+        VkFormat                                   format = VK_FORMAT_UNDEFINED;
+        std::future<std::unique_ptr<DecodedImage>> decode;
+        std::unique_ptr<DecodedImage>              image;           // complete chain, set once decoded
+        bool                                       failed        = false;
+        Texture*                                   texture       = nullptr;
+        uint32_t                                   residentBase  = 0; // finest resident level of the chain
+        uint32_t                                   minBase       = 0; // coarsest base, always resident
+        uint32_t                                   version       = 0;
+        float                                      requestPixels = 0.0f; // largest request of the frame
+        uint64_t                                   lastUsedFrame = 0;
+    };
+
+    struct Retired {
+        Texture* texture = nullptr;
+        uint64_t frame   = 0;
+    };
+
+    // Sum of the level sizes from 'base' to the end of the chain
+    static VkDeviceSize ChainBytes(const Entry& entry, uint32_t base);
+    // Finest level worth keeping for the requested on screen size
+    static uint32_t     DesiredBase(const Entry& entry);
+
+    void FinishDecode(Entry& entry);
+    bool SetResidency(Entry& entry, uint32_t base);
+    // Drops levels of idle textures until 'growth' more resident bytes fit under the cap. True when a new image of
+    // 'imageBytes' can be created right away, false while the replaced images still hold the memory.
+    bool MakeRoom(VkDeviceSize growth, VkDeviceSize imageBytes, const Entry* requester);
+    void DestroyRetired(bool all);
+
+    VkPhysicalDevice m_phyDevice   = VK_NULL_HANDLE;
+    VkDevice         m_device      = VK_NULL_HANDLE;
+    UploadManager*   m_uploads     = nullptr;
+    TextureLoader*   m_loader      = nullptr;
+    VkDeviceSize     m_frameBudget = DEFAULT_FRAME_BUDGET;
+    VkDeviceSize     m_memoryCap   = DEFAULT_MEMORY_CAP;
+    uint64_t         m_frame       = 0;
+
+    // Handles are indices, a deque keeps the entries in place while growing
+    std::deque<Entry>    m_entries;
+    std::vector<Retired> m_retired;
+
+    VkDeviceSize m_residentBytes     = 0;
+    VkDeviceSize m_retiredBytes      = 0;
+    VkDeviceSize m_uploadedThisFrame = 0;
+    VkDeviceSize m_uploadedLastFrame = 0;
+    uint32_t     m_evictions         = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads executing queued tasks in submission order.
+ *
+ * Used for CPU heavy work which does not touch Vulkan objects (image decoding, mip generation).
+ * The destructor finishes the already queued tasks before joining the workers.
+ */
+class ThreadPool {
+public:
+    // A thread count of zero uses one thread per hardware thread
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    // Disable copy and move constructors
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&)      = delete;
+
+    template <typename Function>
+    auto Submit(Function&& function) -> std::future<decltype(function())>
+    {
+        using Result = decltype(function());
+
+        // std::function needs a copyable callable, the packaged task is shared instead
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> result = task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push([task]() { (*task)(); });
+        }
+        m_taskAvailable.notify_one();
+
+        return result;
+    }
+
+    uint32_t ThreadCount() const { return (uint32_t)m_workers.size(); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread>          m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_taskAvailable;
+    bool                              m_stopping = false;
+};
@@ -0,0 +1,717 @@
+#include "upload_manager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "memory_allocator.h"
+
+namespace {
+
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+VkResult CreateUploadCommandPool(const VkDevice device, uint32_t queueFamilyIdx, VkCommandPool* outCmdPool)
+{
+    const VkCommandPoolCreateInfo poolInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = queueFamilyIdx,
+    };
+
+    return vkCreateCommandPool(device, &poolInfo, nullptr, outCmdPool);
+}
+
+VkResult CreateTimelineSemaphore(const VkDevice device, VkSemaphore* outSemaphore)
+{
+    const VkSemaphoreTypeCreateInfo typeInfo = {
+        .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext         = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue  = 0,
+    };
+
+    const VkSemaphoreCreateInfo semaphoreInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &typeInfo,
+        .flags = 0,
+    };
+
+    return vkCreateSemaphore(device, &semaphoreInfo, nullptr, outSemaphore);
+}
+
+} // namespace
+
+VkResult UploadManager::Create(const VkPhysicalDevice phyDevice,
+                               const VkDevice         device,
+                               const VkQueue          graphicsQueue,
+                               uint32_t               graphicsQueueFamilyIdx,
+                               const VkQueue          transferQueue,
+                               uint32_t               transferQueueFamilyIdx,
+                               VkDeviceSize           stagingSize)
+{
+    m_phyDevice              = phyDevice;
+    m_device                 = device;
+    m_graphicsQueue          = graphicsQueue;
+    m_graphicsQueueFamilyIdx = graphicsQueueFamilyIdx;
+    m_transferQueue          = transferQueue;
+    m_transferQueueFamilyIdx = transferQueueFamilyIdx;
+    m_stagingSize            = stagingSize;
+
+    VkResult result = CreateUploadCommandPool(device, transferQueueFamilyIdx, &m_cmdPool);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Failed to create upload command pool\n");
+        return result;
+    }
+
+    result = CreateTimelineSemaphore(device, &m_timeline);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Failed to create upload timeline semaphore\n");
+        return result;
+    }
+
+    if (UsesOwnershipTransfer()) {
+        result = CreateUploadCommandPool(device, graphicsQueueFamilyIdx, &m_acquireCmdPool);
+        if (result != VK_SUCCESS) {
+            printf("[ERROR] Failed to create upload acquire command pool\n");
+            return result;
+        }
+
+        result = CreateTimelineSemaphore(device, &m_transferTimeline);
+        if (result != VK_SUCCESS) {
+            printf("[ERROR] Failed to create transfer timeline semaphore\n");
+            return result;
+        }
+    }
+
+    m_staging    = BufferInfo::Create(phyDevice, device, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    m_stagingPtr = (uint8_t*)m_staging.Map(device);
+
+    return VK_SUCCESS;
+}
+
+void UploadManager::Destroy()
+{
+    if (m_device == VK_NULL_HANDLE) {
+        return;
+    }
+
+    WaitIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Reclaim();
+        assert(m_inFlight.empty());
+    }
+
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroySemaphore(m_device, m_transferTimeline, nullptr);
+    vkDestroyCommandPool(m_device, m_cmdPool, nullptr);
+    vkDestroyCommandPool(m_device, m_acquireCmdPool, nullptr);
+    m_staging.Destroy(m_device);
+
+    m_freeCmdBuffers.clear();
+    m_freeAcquireCmdBuffers.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+UploadTicket UploadManager::UploadBuffer(const VkBuffer dstBuffer,
+                                         const void*    data,
+                                         VkDeviceSize   size,
+                                         VkDeviceSize   dstOffset)
+{
+    assert(dstBuffer != VK_NULL_HANDLE);
+    assert(data != nullptr && size > 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    VkDeviceSize   srcOffset = 0;
+    const VkBuffer srcBuffer = Stage(data, size, STAGING_ALIGNMENT, &srcOffset);
+
+    BeginBatch();
+
+    const VkBufferCopy region = {
+        .srcOffset = srcOffset,
+        .dstOffset = dstOffset,
+        .size      = size,
+    };
+    vkCmdCopyBuffer(m_current.cmdBuffer, srcBuffer, dstBuffer, 1, &region);
+
+    // With a single queue family the memory barrier at the end of the batch covers buffers
+    if (UsesOwnershipTransfer()) {
+        const VkBufferMemoryBarrier barrier = {
+            .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .pNext               = nullptr,
+            .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT,
+            .srcQueueFamilyIndex = m_transferQueueFamilyIdx,
+            .dstQueueFamilyIndex = m_graphicsQueueFamilyIdx,
+            .buffer              = dstBuffer,
+            .offset              = dstOffset,
+            .size                = size,
+        };
+        TransferOwnership(&barrier, nullptr, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    }
+
+    m_bytesUploaded += size;
+
+    return m_current.ticket;
+}
+
+UploadTicket UploadManager::UploadImage(const VkImage      dstImage,
+                                        VkExtent3D         extent,
+                                        const void*        data,
+                                        VkDeviceSize       size,
+                                        VkImageLayout      finalLayout,
+                                        VkImageAspectFlags aspect)
+{
+    const std::vector<VkBufferImageCopy> regions = {
+        {
+            .bufferOffset      = 0,
+            .bufferRowLength   = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource  = {aspect, 0, 0, 1},
+            .imageOffset       = {0, 0, 0},
+            .imageExtent       = extent,
+        },
+    };
+
+    return UploadImageRegions(dstImage, data, size, regions, 1, finalLayout, aspect);
+}
+
+UploadTicket UploadManager::UploadImageRegions(const VkImage                         dstImage,
+                                               const void*                           data,
+                                               VkDeviceSize                          size,
+                                               const std::vector<VkBufferImageCopy>& regions,
+                                               uint32_t                              levelCount,
+                                               VkImageLayout                         finalLayout,
+                                               VkImageAspectFlags                    aspect)
+{
+    assert(dstImage != VK_NULL_HANDLE);
+    assert(data != nullptr && size > 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    RecordImageCopy(dstImage, data, size, regions, levelCount, aspect);
+    FinishImage(dstImage, levelCount, finalLayout, aspect);
+
+    return m_current.ticket;
+}
+
+UploadTicket UploadManager::UploadImageGenerateMips(const VkImage dstImage,
+                                                    VkExtent3D    extent,
+                                                    const void*   data,
+                                                    VkDeviceSize  size,
+                                                    uint32_t      mipLevels,
+                                                    VkImageLayout finalLayout)
+{
+    assert(dstImage != VK_NULL_HANDLE);
+    assert(data != nullptr && size > 0);
+
+    const std::vector<VkBufferImageCopy> regions = {
+        {
+            .bufferOffset      = 0,
+            .bufferRowLength   = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+            .imageOffset       = {0, 0, 0},
+            .imageExtent       = extent,
+        },
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    RecordImageCopy(dstImage, data, size, regions, mipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Blits need a graphics queue: with a separate transfer queue the image is handed over first
+    // and the cascade is recorded into the acquire command buffer.
+    VkCommandBuffer blitCmd = m_current.cmdBuffer;
+    if (UsesOwnershipTransfer()) {
+        const VkImageMemoryBarrier barrier = {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .pNext               = nullptr,
+            .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = m_transferQueueFamilyIdx,
+            .dstQueueFamilyIndex = m_graphicsQueueFamilyIdx,
+            .image               = dstImage,
+            .subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1},
+        };
+        TransferOwnership(nullptr, &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        blitCmd = m_current.acquireCmd;
+    }
+
+    RecordMipCascade(blitCmd, dstImage, extent, mipLevels, finalLayout);
+
+    return m_current.ticket;
+}
+
+void UploadManager::RecordImageCopy(const VkImage                         dstImage,
+                                    const void*                           data,
+                                    VkDeviceSize                          size,
+                                    const std::vector<VkBufferImageCopy>& regions,
+                                    uint32_t                              levelCount,
+                                    VkImageAspectFlags                    aspect)
+{
+    VkDeviceSize   srcOffset = 0;
+    const VkBuffer srcBuffer = Stage(data, size, STAGING_ALIGNMENT, &srcOffset);
+
+    BeginBatch();
+
+    const VkImageMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = 0,
+        .dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = dstImage,
+        .subresourceRange    = {aspect, 0, levelCount, 0, 1},
+    };
+    vkCmdPipelineBarrier(m_current.cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    // The region offsets are relative to the caller's data, move them to the staging location
+    std::vector<VkBufferImageCopy> stagedRegions = regions;
+    for (VkBufferImageCopy& region : stagedRegions) {
+        region.bufferOffset += srcOffset;
+    }
+
+    vkCmdCopyBufferToImage(m_current.cmdBuffer, srcBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           (uint32_t)stagedRegions.size(), stagedRegions.data());
+
+    m_bytesUploaded += size;
+}
+
+void UploadManager::FinishImage(const VkImage      dstImage,
+                                uint32_t           levelCount,
+                                VkImageLayout      finalLayout,
+                                VkImageAspectFlags aspect)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout           = finalLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = dstImage,
+        .subresourceRange    = {aspect, 0, levelCount, 0, 1},
+    };
+
+    if (UsesOwnershipTransfer()) {
+        barrier.srcQueueFamilyIndex = m_transferQueueFamilyIdx;
+        barrier.dstQueueFamilyIndex = m_graphicsQueueFamilyIdx;
+        TransferOwnership(nullptr, &barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    } else {
+        vkCmdPipelineBarrier(m_current.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+void UploadManager::RecordMipCascade(const VkCommandBuffer cmdBuffer,
+                                     const VkImage         image,
+                                     VkExtent3D            extent,
+                                     uint32_t              mipLevels,
+                                     VkImageLayout         finalLayout)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext               = nullptr,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = image,
+        .subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+
+    int32_t srcWidth  = (int32_t)extent.width;
+    int32_t srcHeight = (int32_t)extent.height;
+
+    for (uint32_t level = 1; level < mipLevels; level++) {
+        const int32_t dstWidth  = std::max(srcWidth / 2, 1);
+        const int32_t dstHeight = std::max(srcHeight / 2, 1);
+
+        // Previous level: written by the copy/blit, becomes the blit source
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                             0, nullptr, 1, &barrier);
+
+        const VkImageBlit blit = {
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1},
+            .srcOffsets     = {{0, 0, 0}, {srcWidth, srcHeight, 1}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+            .dstOffsets     = {{0, 0, 0}, {dstWidth, dstHeight, 1}},
+        };
+        vkCmdBlitImage(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        // Previous level is done
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout     = finalLayout;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0,
+                             nullptr, 0, nullptr, 1, &barrier);
+
+        srcWidth  = dstWidth;
+        srcHeight = dstHeight;
+    }
+
+    // Last level was only written
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                     = finalLayout;
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+}
+
+UploadTicket UploadManager::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return FlushLocked();
+}
+
+bool UploadManager::IsComplete(UploadTicket ticket) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ticket > m_lastSubmitted) {
+            return false;
+        }
+    }
+
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &value);
+
+    return value >= ticket;
+}
+
+VkResult UploadManager::Wait(UploadTicket ticket)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ticket > m_lastSubmitted) {
+            FlushLocked();
+        }
+    }
+
+    const VkResult result = WaitValue(ticket);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Reclaim();
+
+    return result;
+}
+
+VkResult UploadManager::WaitIdle()
+{
+    return Wait(Flush());
+}
+
+bool UploadManager::HasPending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current.cmdBuffer != VK_NULL_HANDLE;
+}
+
+VkBuffer UploadManager::Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset)
+{
+    if (TryAllocateStaging(size, alignment, outOffset)) {
+        memcpy(m_stagingPtr + *outOffset, data, size);
+        // The Upload usage only prefers coherent memory, the transfer must not read stale bytes
+        MemoryAllocator::Find(m_device)->Flush(m_staging.allocation, *outOffset, size);
+        return m_staging.buffer;
+    }
+
+    // Does not fit into the ring, use a temporary buffer which is destroyed when the batch retires
+    BufferInfo temp = BufferInfo::Create(m_phyDevice, m_device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    temp.Update(m_device, data, size);
+
+    BeginBatch();
+    m_current.tempBuffers.push_back(temp);
+
+    *outOffset = 0;
+    return temp.buffer;
+}
+
+bool UploadManager::TryAllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset)
+{
+    // A single upload should not be able to monopolize the ring
+    if (size > m_stagingSize / 2) {
+        return false;
+    }
+
+    while (true) {
+        Reclaim();
+
+        bool stagingEmpty = !m_current.usesStaging;
+        for (const Batch& batch : m_inFlight) {
+            stagingEmpty = stagingEmpty && !batch.usesStaging;
+        }
+
+        if (stagingEmpty) {
+            m_stagingHead = 0;
+            m_stagingTail = 0;
+        }
+
+        // The live region is [tail, head), possibly wrapped around the end of the ring.
+        // Writing up to the tail is not allowed so that head == tail always means "empty".
+        const VkDeviceSize offset   = AlignUp(m_stagingHead, alignment);
+        VkDeviceSize       position = VK_WHOLE_SIZE;
+        if (stagingEmpty || m_stagingHead >= m_stagingTail) {
+            if (offset + size <= m_stagingSize) {
+                position = offset;
+            } else if (size < m_stagingTail) {
+                position = 0;
+            }
+        } else if (offset + size < m_stagingTail) {
+            position = offset;
+        }
+
+        if (position != VK_WHOLE_SIZE) {
+            BeginBatch();
+
+            m_stagingHead         = position + size;
+            m_current.usesStaging = true;
+            m_current.stagingEnd  = m_stagingHead;
+
+            *outOffset = position;
+            return true;
+        }
+
+        // Out of staging space: submit the recorded uploads and wait for the oldest batch
+        FlushLocked();
+        if (m_inFlight.empty()) {
+            return false;
+        }
+
+        WaitValue(m_inFlight.front().ticket);
+    }
+}
+
+void UploadManager::BeginBatch()
+{
+    if (m_current.cmdBuffer != VK_NULL_HANDLE) {
+        return;
+    }
+
+    m_current.cmdBuffer = BeginCommandBuffer(m_cmdPool, &m_freeCmdBuffers);
+    if (UsesOwnershipTransfer()) {
+        m_current.acquireCmd = BeginCommandBuffer(m_acquireCmdPool, &m_freeAcquireCmdBuffers);
+    }
+
+    m_current.ticket = m_lastSubmitted + 1;
+}
+
+VkCommandBuffer UploadManager::BeginCommandBuffer(const VkCommandPool cmdPool, std::vector<VkCommandBuffer>* freeList)
+{
+    if (freeList->empty()) {
+        const VkCommandBufferAllocateInfo allocInfo = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext              = nullptr,
+            .commandPool        = cmdPool,
+            .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+
+        VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+        const VkResult  result    = vkAllocateCommandBuffers(m_device, &allocInfo, &cmdBuffer);
+        assert((result == VK_SUCCESS) && "Upload command buffer allocation failed");
+
+        freeList->push_back(cmdBuffer);
+    }
+
+    const VkCommandBuffer cmdBuffer = freeList->back();
+    freeList->pop_back();
+
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = nullptr,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = nullptr,
+    };
+    vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+
+    return cmdBuffer;
+}
+
+void UploadManager::TransferOwnership(const VkBufferMemoryBarrier* bufferBarrier,
+                                      const VkImageMemoryBarrier*  imageBarrier,
+                                      VkPipelineStageFlags         dstStageMask)
+{
+    // Release on the transfer queue: the destination access mask is ignored there
+    VkBufferMemoryBarrier bufferRelease = bufferBarrier ? *bufferBarrier : VkBufferMemoryBarrier{};
+    VkImageMemoryBarrier  imageRelease  = imageBarrier ? *imageBarrier : VkImageMemoryBarrier{};
+    bufferRelease.dstAccessMask         = 0;
+    imageRelease.dstAccessMask          = 0;
+
+    vkCmdPipelineBarrier(m_current.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                         nullptr, bufferBarrier ? 1 : 0, &bufferRelease, imageBarrier ? 1 : 0, &imageRelease);
+
+    // Acquire on the graphics queue: the source access mask is ignored there.
+    // The layout transition is part of both halves and is executed once.
+    VkBufferMemoryBarrier bufferAcquire = bufferBarrier ? *bufferBarrier : VkBufferMemoryBarrier{};
+    VkImageMemoryBarrier  imageAcquire  = imageBarrier ? *imageBarrier : VkImageMemoryBarrier{};
+    bufferAcquire.srcAccessMask         = 0;
+    imageAcquire.srcAccessMask          = 0;
+
+    vkCmdPipelineBarrier(m_current.acquireCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, nullptr,
+                         bufferBarrier ? 1 : 0, &bufferAcquire, imageBarrier ? 1 : 0, &imageAcquire);
+}
+
+UploadTicket UploadManager::FlushLocked()
+{
+    if (m_current.cmdBuffer == VK_NULL_HANDLE) {
+        return m_lastSubmitted;
+    }
+
+    if (!UsesOwnershipTransfer()) {
+        // Make the transfer writes visible for any later use (vertex/index fetch, shader reads)
+        const VkMemoryBarrier barrier = {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .pNext         = nullptr,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+        };
+        vkCmdPipelineBarrier(m_current.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    vkEndCommandBuffer(m_current.cmdBuffer);
+
+    // Without ownership transfer the copy submit signals the ticket directly
+    const VkSemaphore transferSignal = UsesOwnershipTransfer() ? m_transferTimeline : m_timeline;
+
+    const VkTimelineSemaphoreSubmitInfo timelineInfo = {
+        .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext                     = nullptr,
+        .waitSemaphoreValueCount   = 0,
+        .pWaitSemaphoreValues      = nullptr,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues    = &m_current.ticket,
+    };
+
+    const VkSubmitInfo submitInfo = {
+        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext                = &timelineInfo,
+        .waitSemaphoreCount   = 0,
+        .pWaitSemaphores      = nullptr,
+        .pWaitDstStageMask    = nullptr,
+        .commandBufferCount   = 1,
+        .pCommandBuffers      = &m_current.cmdBuffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores    = &transferSignal,
+    };
+
+    VkResult result = vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    assert((result == VK_SUCCESS) && "Upload submit failed");
+
+    if (UsesOwnershipTransfer()) {
+        vkEndCommandBuffer(m_current.acquireCmd);
+
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        const VkTimelineSemaphoreSubmitInfo acquireTimelineInfo = {
+            .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext                     = nullptr,
+            .waitSemaphoreValueCount   = 1,
+            .pWaitSemaphoreValues      = &m_current.ticket,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues    = &m_current.ticket,
+        };
+
+        const VkSubmitInfo acquireInfo = {
+            .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext                = &acquireTimelineInfo,
+            .waitSemaphoreCount   = 1,
+            .pWaitSemaphores      = &m_transferTimeline,
+            .pWaitDstStageMask    = &waitStage,
+            .commandBufferCount   = 1,
+            .pCommandBuffers      = &m_current.acquireCmd,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores    = &m_timeline,
+        };
+
+        result = vkQueueSubmit(m_graphicsQueue, 1, &acquireInfo, VK_NULL_HANDLE);
+        assert((result == VK_SUCCESS) && "Upload acquire submit failed");
+    }
+
+    m_lastSubmitted = m_current.ticket;
+    m_submitCount++;
+
+    m_inFlight.push_back(std::move(m_current));
+    m_current = {};
+
+    return m_lastSubmitted;
+}
+
+void UploadManager::Reclaim()
+{
+    if (m_inFlight.empty()) {
+        return;
+    }
+
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(m_device, m_timeline, &completed);
+
+    // Tickets are signaled in submission order, so batches retire in order
+    size_t retired = 0;
+    for (; retired < m_inFlight.size() && m_inFlight[retired].ticket <= completed; retired++) {
+        Batch& batch = m_inFlight[retired];
+
+        vkResetCommandBuffer(batch.cmdBuffer, 0);
+        m_freeCmdBuffers.push_back(batch.cmdBuffer);
+
+        if (batch.acquireCmd != VK_NULL_HANDLE) {
+            vkResetCommandBuffer(batch.acquireCmd, 0);
+            m_freeAcquireCmdBuffers.push_back(batch.acquireCmd);
+        }
+
+        for (BufferInfo& temp : batch.tempBuffers) {
+            temp.Destroy(m_device);
+        }
+
+        if (batch.usesStaging) {
+            m_stagingTail = batch.stagingEnd;
+        }
+    }
+
+    m_inFlight.erase(m_inFlight.begin(), m_inFlight.begin() + retired);
+}
+
+VkResult UploadManager::WaitValue(UploadTicket ticket) const
+{
+    const VkSemaphoreWaitInfo waitInfo = {
+        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext          = nullptr,
+        .flags          = 0,
+        .semaphoreCount = 1,
+        .pSemaphores    = &m_timeline,
+        .pValues        = &ticket,
+    };
+
+    return vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "buffer.h"
+
+// Timeline semaphore value of the submit that carries an upload
+using UploadTicket = uint64_t;
+
+/**
+ * Queues buffer and image uploads from any number of callers and executes them in batches.
+ *
+ * Upload calls copy the source data into a persistently mapped staging ring and record the copy
+ * into the currently open command buffer. Flush() submits everything recorded so far as one batch
+ * which signals a timeline semaphore, each upload returns the value its batch will signal.
+ * Staging space of finished batches is reclaimed lazily, uploads larger than the ring get a
+ * temporary staging buffer.
+ *
+ * When a separate transfer queue is given the copies run there. Ownership of the resources is
+ * released to the graphics queue family and acquired by a small submit on the graphics queue,
+ * which waits for the transfer on the GPU and signals the ticket. Frames submitted after Flush()
+ * are ordered after that acquire, so the CPU never has to wait for an upload to use it.
+ * Because of that submit Flush() must be called from the thread that submits the frames.
+ */
+class UploadManager {
+public:
+    static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32ull * 1024 * 1024;
+
+    VkResult Create(const VkPhysicalDevice phyDevice,
+                    const VkDevice         device,
+                    const VkQueue          graphicsQueue,
+                    uint32_t               graphicsQueueFamilyIdx,
+                    const VkQueue          transferQueue,
+                    uint32_t               transferQueueFamilyIdx,
+                    VkDeviceSize           stagingSize = DEFAULT_STAGING_SIZE);
+    void     Destroy();
+
+    UploadTicket UploadBuffer(const VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+    // Uploads tightly packed texel data into mip 0 of the image and leaves it in 'finalLayout'.
+    UploadTicket UploadImage(const VkImage      dstImage,
+                             VkExtent3D         extent,
+                             const void*        data,
+                             VkDeviceSize       size,
+                             VkImageLayout      finalLayout = VK_IMAGE_LAYOUT_GENERAL,
+                             VkImageAspectFlags aspect      = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Uploads several regions (ex.: mip levels) from one block of data, the region buffer offsets are
+    // relative to 'data'. Levels [0, levelCount) of the image end up in 'finalLayout'.
+    UploadTicket UploadImageRegions(const VkImage                         dstImage,
+                                    const void*                           data,
+                                    VkDeviceSize                          size,
+                                    const std::vector<VkBufferImageCopy>& regions,
+                                    uint32_t                              levelCount,
+                                    VkImageLayout                         finalLayout = VK_IMAGE_LAYOUT_GENERAL,
+                                    VkImageAspectFlags                    aspect      = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // Uploads mip 0 and fills the remaining levels with a linear blit cascade. The image needs
+    // TRANSFER_SRC usage and a format supporting linear blits. The blits run on the graphics queue.
+    UploadTicket UploadImageGenerateMips(const VkImage dstImage,
+                                         VkExtent3D    extent,
+                                         const void*   data,
+                                         VkDeviceSize  size,
+                                         uint32_t      mipLevels,
+                                         VkImageLayout finalLayout = VK_IMAGE_LAYOUT_GENERAL);
+
+    // Submits all recorded uploads, returns the ticket of the last upload.
+    UploadTicket Flush();
+
+    bool IsComplete(UploadTicket ticket) const;
+    // Waits for the upload, flushes first if it was not submitted yet.
+    VkResult Wait(UploadTicket ticket);
+    VkResult WaitIdle();
+
+    bool     HasPending() const;
+    bool     UsesOwnershipTransfer() const { return m_transferQueueFamilyIdx != m_graphicsQueueFamilyIdx; }
+    uint64_t BytesUploaded() const { return m_bytesUploaded; }
+    uint32_t SubmitCount() const { return m_submitCount; }
+
+    VkSemaphore timeline() const { return m_timeline; }
+
+private:
+    struct Batch {
+        UploadTicket            ticket      = 0;
+        VkCommandBuffer         cmdBuffer   = VK_NULL_HANDLE; // transfer queue
+        VkCommandBuffer         acquireCmd  = VK_NULL_HANDLE; // graphics queue, only with ownership transfer
+        bool                    usesStaging = false;
+        VkDeviceSize            stagingEnd  = 0;
+        std::vector<BufferInfo> tempBuffers = {};
+    };
+
+    // Returns the staging buffer and offset for 'size' bytes, the data is already copied there.
+    VkBuffer        Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset);
+    bool            TryAllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset);
+    void            BeginBatch();
+    VkCommandBuffer BeginCommandBuffer(const VkCommandPool cmdPool, std::vector<VkCommandBuffer>* freeList);
+    // Hands the resource over to the graphics queue family, 'barrier' describes the release.
+    void            TransferOwnership(const VkBufferMemoryBarrier* bufferBarrier,
+                                      const VkImageMemoryBarrier*  imageBarrier,
+                                      VkPipelineStageFlags         dstStageMask);
+    // Copies the regions into the image, all levels are left in TRANSFER_DST_OPTIMAL
+    void            RecordImageCopy(const VkImage                         dstImage,
+                                    const void*                           data,
+                                    VkDeviceSize                          size,
+                                    const std::vector<VkBufferImageCopy>& regions,
+                                    uint32_t                              levelCount,
+                                    VkImageAspectFlags                    aspect);
+    // Moves all levels from TRANSFER_DST_OPTIMAL to the final layout on the graphics queue
+    void            FinishImage(const VkImage      dstImage,
+                                uint32_t           levelCount,
+                                VkImageLayout      finalLayout,
+                                VkImageAspectFlags aspect);
+    static void     RecordMipCascade(const VkCommandBuffer cmdBuffer,
+                                     const VkImage         image,
+                                     VkExtent3D            extent,
+                                     uint32_t              mipLevels,
+                                     VkImageLayout         finalLayout);
+    UploadTicket    FlushLocked();
+    void            Reclaim();
+    VkResult        WaitValue(UploadTicket ticket) const;
+
+    VkPhysicalDevice m_phyDevice              = VK_NULL_HANDLE;
+    VkDevice         m_device                 = VK_NULL_HANDLE;
+    VkQueue          m_graphicsQueue          = VK_NULL_HANDLE;
+    uint32_t         m_graphicsQueueFamilyIdx = 0;
+    VkQueue          m_transferQueue          = VK_NULL_HANDLE;
+    uint32_t         m_transferQueueFamilyIdx = 0;
+    VkCommandPool    m_cmdPool                = VK_NULL_HANDLE; // transfer queue family
+    VkCommandPool    m_acquireCmdPool         = VK_NULL_HANDLE; // graphics queue family
+    VkSemaphore      m_timeline               = VK_NULL_HANDLE; // signaled when the upload is usable
+    VkSemaphore      m_transferTimeline       = VK_NULL_HANDLE; // signaled by the transfer queue
+
+    BufferInfo   m_staging     = {};
+    uint8_t*     m_stagingPtr  = nullptr;
+    VkDeviceSize m_stagingSize = 0;
+    VkDeviceSize m_stagingHead = 0;
+    VkDeviceSize m_stagingTail = 0;
+
+    mutable std::mutex           m_mutex;
+    Batch                        m_current;
+    std::vector<Batch>           m_inFlight;
+    std::vector<VkCommandBuffer> m_freeCmdBuffers;
+    std::vector<VkCommandBuffer> m_freeAcquireCmdBuffers;
+    UploadTicket                 m_lastSubmitted = 0;
+
+    uint64_t m_bytesUploaded = 0;
+    uint32_t m_submitCount   = 0;
+};
@@ -0,0 +1,48 @@
+# Embeds textures into an executable, the texture counterpart of add_shader.
+#
+# texbake compresses the image (with its full mip chain) into KTX2 at build time and writes it as a
+# byte array into "<image name>_include.h" in the binary dir. The sources include the header and create the
+# texture with Texture::LoadFromData / TextureCache::AcquireData: no file is read and nothing is decoded at
+# startup, so it does not depend on the working directory either.
+#
+#   add_texture(<target> <image> <variable name> [NORMAL])
+#
+# A relative image path is relative to the current source dir, NORMAL bakes the red/green channels as BC5.
+function(add_texture TEXTURE_TARGET IMAGE_FILE TEXTURE_VAR_NAME)
+    cmake_path(ABSOLUTE_PATH IMAGE_FILE BASE_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR} OUTPUT_VARIABLE TEXTURE_INPUT)
+    cmake_path(GET TEXTURE_INPUT FILENAME TEXTURE_NAME)
+    set(TEXTURE_OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${TEXTURE_NAME}_include.h)
+
+    set(TEXTURE_OPTIONS)
+    if("NORMAL" IN_LIST ARGN)
+        list(APPEND TEXTURE_OPTIONS --normal)
+    endif()
+
+    # Create command which bakes the texture
+    add_custom_command(OUTPUT ${TEXTURE_OUTPUT}
+        DEPENDS texbake ${TEXTURE_INPUT}
+        COMMAND texbake
+                ${TEXTURE_INPUT}
+                ${TEXTURE_OUTPUT}
+                ${TEXTURE_OPTIONS}
+                --variable-name ${TEXTURE_VAR_NAME}
+        COMMENT "Embedding ${TEXTURE_NAME}"
+    )
+    add_custom_target(${TEXTURE_TARGET}-tex-${TEXTURE_NAME} DEPENDS ${TEXTURE_OUTPUT})
+    add_dependencies(${TEXTURE_TARGET} ${TEXTURE_TARGET}-tex-${TEXTURE_NAME})
+    target_include_directories(${TEXTURE_TARGET} PRIVATE ${CMAKE_CURRENT_BINARY_DIR})
+endfunction(add_texture)
+
+function(add_textures TEXTURE_TARGET)
+    list(LENGTH ARGV ARG_COUNT)
+
+    math(EXPR LIST_LENGTH "${ARG_COUNT} - 1")
+    foreach(IDX RANGE 1 ${LIST_LENGTH} 2)
+        list(GET ARGV ${IDX} IMAGE_FILE)
+
+        math(EXPR IDX_NEXT "${IDX} + 1")
+        list(GET ARGV "${IDX_NEXT}" TEXTURE_VAR_NAME)
+
+        add_texture(${TEXTURE_TARGET} ${IMAGE_FILE} ${TEXTURE_VAR_NAME})
+    endforeach()
+endfunction(add_textures)
@@ -0,0 +1,184 @@
+#include "bc_encoder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+uint16_t PackRGB565(const uint8_t* color)
+{
+    return (uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+void UnpackRGB565(uint16_t packed, int32_t* outColor)
+{
+    const int32_t r = (packed >> 11) & 0x1F;
+    const int32_t g = (packed >> 5) & 0x3F;
+    const int32_t b = packed & 0x1F;
+
+    outColor[0] = (r << 3) | (r >> 2);
+    outColor[1] = (g << 2) | (g >> 4);
+    outColor[2] = (b << 3) | (b >> 2);
+}
+
+} // namespace
+
+void EncodeBC1(const RGBABlock& block, uint8_t* out)
+{
+    uint8_t minColor[3] = {255, 255, 255};
+    uint8_t maxColor[3] = {0, 0, 0};
+
+    for (const auto& texel : block.texels) {
+        for (uint32_t c = 0; c < 3; c++) {
+            minColor[c] = std::min(minColor[c], texel[c]);
+            maxColor[c] = std::max(maxColor[c], texel[c]);
+        }
+    }
+
+    // Move the endpoints inwards a little, the extremes are usually outliers
+    for (uint32_t c = 0; c < 3; c++) {
+        const uint8_t inset = (uint8_t)((maxColor[c] - minColor[c]) / 16);
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+
+    uint16_t color0 = PackRGB565(maxColor);
+    uint16_t color1 = PackRGB565(minColor);
+
+    // color0 > color1 selects the opaque four color mode
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int32_t palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (uint32_t c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (uint32_t texelIdx = 0; texelIdx < 16; texelIdx++) {
+            const uint8_t* texel = block.texels[texelIdx];
+
+            uint32_t best     = 0;
+            int32_t  bestDist = INT32_MAX;
+            for (uint32_t entry = 0; entry < 4; entry++) {
+                int32_t dist = 0;
+                for (uint32_t c = 0; c < 3; c++) {
+                    const int32_t diff = texel[c] - palette[entry][c];
+                    dist += diff * diff;
+                }
+
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best     = entry;
+                }
+            }
+
+            indices |= best << (texelIdx * 2);
+        }
+    }
+
+    out[0] = (uint8_t)(color0 & 0xFF);
+    out[1] = (uint8_t)(color0 >> 8);
+    out[2] = (uint8_t)(color1 & 0xFF);
+    out[3] = (uint8_t)(color1 >> 8);
+    std::memcpy(out + 4, &indices, sizeof(indices));
+}
+
+void EncodeBC4(const RGBABlock& block, uint32_t channel, uint8_t* out)
+{
+    uint8_t minValue = 255;
+    uint8_t maxValue = 0;
+    for (const auto& texel : block.texels) {
+        minValue = std::min(minValue, texel[channel]);
+        maxValue = std::max(maxValue, texel[channel]);
+    }
+
+    out[0] = maxValue;
+    out[1] = minValue;
+
+    uint64_t indices = 0;
+    if (maxValue != minValue) {
+        // value0 > value1 selects the eight value mode: 0 = max, 1 = min, 2..7 interpolated
+        int32_t palette[8] = {maxValue, minValue};
+        for (int32_t entry = 1; entry < 7; entry++) {
+            palette[entry + 1] = ((7 - entry) * maxValue + entry * minValue) / 7;
+        }
+
+        for (uint32_t texelIdx = 0; texelIdx < 16; texelIdx++) {
+            const int32_t value = block.texels[texelIdx][channel];
+
+            uint64_t best     = 0;
+            int32_t  bestDist = INT32_MAX;
+            for (uint32_t entry = 0; entry < 8; entry++) {
+                const int32_t dist = std::abs(value - palette[entry]);
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best     = entry;
+                }
+            }
+
+            indices |= best << (texelIdx * 3);
+        }
+    }
+
+    for (uint32_t byteIdx = 0; byteIdx < 6; byteIdx++) {
+        out[2 + byteIdx] = (uint8_t)(indices >> (byteIdx * 8));
+    }
+}
+
+void EncodeBC3(const RGBABlock& block, uint8_t* out)
+{
+    EncodeBC4(block, 3, out);
+    EncodeBC1(block, out + 8);
+}
+
+void EncodeBC5(const RGBABlock& block, uint8_t* out)
+{
+    EncodeBC4(block, 0, out);
+    EncodeBC4(block, 1, out + 8);
+}
+
+std::vector<uint8_t> CompressImage(const uint8_t* pixels, uint32_t width, uint32_t height, BlockFormat format)
+{
+    const uint32_t blocksX   = (width + 3) / 4;
+    const uint32_t blocksY   = (height + 3) / 4;
+    const uint32_t blockSize = (format == BlockFormat::BC1) ? 8 : 16;
+
+    std::vector<uint8_t> result((size_t)blocksX * blocksY * blockSize);
+    uint8_t*             out = result.data();
+
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            RGBABlock block;
+            for (uint32_t y = 0; y < 4; y++) {
+                for (uint32_t x = 0; x < 4; x++) {
+                    const uint32_t px = std::min(bx * 4 + x, width - 1);
+                    const uint32_t py = std::min(by * 4 + y, height - 1);
+                    std::memcpy(block.texels[y * 4 + x], pixels + ((size_t)py * width + px) * 4, 4);
+                }
+            }
+
+            switch (format) {
+            case BlockFormat::BC1:
+                EncodeBC1(block, out);
+                break;
+            case BlockFormat::BC3:
+                EncodeBC3(block, out);
+                break;
+            case BlockFormat::BC5:
+                EncodeBC5(block, out);
+                break;
+            }
+
+            out += blockSize;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Texel block of 4x4 RGBA8 values, row by row
+struct RGBABlock {
+    uint8_t texels[16][4];
+};
+
+/**
+ * Simple block compression encoders for the texture bake tool.
+ *
+ * Endpoints are the (slightly inset) bounding box of the block, each texel picks the closest
+ * palette entry. The quality is below the dedicated encoders but it is fast and has no dependencies.
+ */
+void EncodeBC1(const RGBABlock& block, uint8_t* out);                      // 8 bytes, opaque
+void EncodeBC3(const RGBABlock& block, uint8_t* out);                      // 16 bytes
+void EncodeBC4(const RGBABlock& block, uint32_t channel, uint8_t* out);    // 8 bytes, one channel
+void EncodeBC5(const RGBABlock& block, uint8_t* out);                      // 16 bytes, red and green
+
+enum class BlockFormat {
+    BC1,
+    BC3,
+    BC5,
+};
+
+// Compresses a whole RGBA8 image, the edge blocks repeat the last row/column
+std::vector<uint8_t> CompressImage(const uint8_t* pixels, uint32_t width, uint32_t height, BlockFormat format);
@@ -0,0 +1,118 @@
+/**
+ * Texture bake tool: converts a PNG/JPG image into a block compressed KTX2 file with a full mip chain.
+ *
+ * Usage: texbake <input image> <output.ktx2> [--normal] [--variable-name <name>]
+ *
+ * Opaque images become BC1, images with alpha BC3, "--normal" stores the red/green channels as BC5.
+ * With "--variable-name" the output is a C++ header holding the KTX2 file as a byte array of that name
+ * instead of the file itself (same as glslangValidator does for SPIR-V), see add_texture in texture.cmake.
+ */
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "bc_encoder.h"
+#include "ktx2.h"
+#include "mip_generator.h"
+#include "stb_image.h"
+
+static bool WriteHeader(const char* path, const char* variableName, const char* inputPath,
+                        const std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        printf("[ERROR] Can not create '%s'\n", path);
+        return false;
+    }
+
+    // Aligned like a heap allocation, the level data is copied from here without decoding
+    fprintf(file, "// Generated by texbake from %s, do not edit\n", inputPath);
+    fprintf(file, "#pragma once\n\n#include <cstdint>\n\n");
+    fprintf(file, "alignas(16) const uint8_t %s[%zu] = {", variableName, data.size());
+    for (size_t idx = 0; idx < data.size(); idx++) {
+        fprintf(file, "%s0x%02x,", (idx % 16 == 0) ? "\n    " : " ", data[idx]);
+    }
+    fprintf(file, "\n};\n");
+
+    const bool success = (ferror(file) == 0);
+    fclose(file);
+
+    return success;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        printf("Usage: %s <input image> <output.ktx2> [--normal] [--variable-name <name>]\n", argv[0]);
+        return 1;
+    }
+
+    const char* inputPath    = argv[1];
+    const char* outputPath   = argv[2];
+    bool        isNormal     = false;
+    const char* variableName = nullptr;
+
+    for (int argIdx = 3; argIdx < argc; argIdx++) {
+        if (std::strcmp(argv[argIdx], "--normal") == 0) {
+            isNormal = true;
+        } else if (std::strcmp(argv[argIdx], "--variable-name") == 0 && argIdx + 1 < argc) {
+            variableName = argv[++argIdx];
+        } else {
+            printf("[ERROR] Unknown argument: %s\n", argv[argIdx]);
+            return 1;
+        }
+    }
+
+    int32_t  width    = 0;
+    int32_t  height   = 0;
+    int32_t  channels = 0;
+    uint8_t* pixels   = stbi_load(inputPath, &width, &height, &channels, 4);
+    if (pixels == nullptr) {
+        printf("[ERROR] Failed to load image: %s\n", inputPath);
+        return 1;
+    }
+
+    bool hasAlpha = false;
+    for (size_t idx = 3; idx < (size_t)width * height * 4; idx += 4) {
+        hasAlpha |= pixels[idx] != 255;
+    }
+
+    BlockFormat blockFormat = hasAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+    VkFormat    vkFormat    = hasAlpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    if (isNormal) {
+        blockFormat = BlockFormat::BC5;
+        vkFormat    = VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+
+    const MipChain chain = BuildMipChainRGBA8(pixels, width, height, MipLevelCount(width, height));
+    stbi_image_free(pixels);
+
+    Ktx2Image image = {
+        .format = vkFormat,
+        .width  = (uint32_t)width,
+        .height = (uint32_t)height,
+        .mips   = {},
+    };
+
+    for (const MipLevel& level : chain.levels) {
+        const std::vector<uint8_t> blocks =
+            CompressImage(chain.data.data() + level.offset, level.width, level.height, blockFormat);
+
+        image.mips.levels.push_back({level.width, level.height, image.mips.data.size(), blocks.size()});
+        image.mips.data.insert(image.mips.data.end(), blocks.begin(), blocks.end());
+    }
+
+    if (variableName != nullptr) {
+        std::vector<uint8_t> data;
+        if (!EncodeKtx2(image, &data) || !WriteHeader(outputPath, variableName, inputPath, data)) {
+            return 1;
+        }
+    } else if (!WriteKtx2(outputPath, image)) {
+        return 1;
+    }
+
+    printf("Baked %s -> %s (%ux%u, %zu levels, %zu bytes instead of %zu)\n", inputPath, outputPath, image.width,
+           image.height, image.mips.levels.size(), image.mips.data.size(), chain.data.size());
+
+    return 0;
+}
@@ -26,6 +26,8 @@ namespace {
 #include "buffer.h"
 #include "descriptors.h"
 #include "grid.h"
+#include "object_cache.h"
+#include "sampler_cache.h"
 #include "shader_tooling.h"
 
 #define VK_LOAD_INSTANCE_PFN(instance, name) reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name))
@@ -1387,6 +1389,12 @@ int main(int /*argc*/, char **/*argv*/) {
 
     DestroyImageViews(device, swapchainViews);
     vkDestroySwapchainKHR(device, swapchain, nullptr);
+
+    // BufferInfo allocates from the device's MemoryAllocator, its memory blocks must go before the device
+    MemoryAllocator::Destroy(device);
+    // The descriptor set layouts come from the ObjectCache and may reference cached samplers, both go first
+    ObjectCache::Destroy(device);
+    SamplerCache::Destroy(device);
     vkDestroyDevice(device, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
 
@@ -26,8 +26,11 @@ namespace {
 #include "buffer.h"
 #include "descriptors.h"
 #include "grid.h"
+#include "object_cache.h"
+#include "sampler_cache.h"
 #include "shader_tooling.h"
 #include "texture.h"
+#include "upload_manager.h"
 
 #define VK_LOAD_INSTANCE_PFN(instance, name) reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name))
 
@@ -113,7 +116,7 @@ VkResult CreateVkInstance(const std::vector<const char *> &extraExtensions, bool
         .applicationVersion = 1,
         .pEngineName        = "vkcourse",
         .engineVersion      = 1,
-        .apiVersion         = VK_API_VERSION_1_1,
+        .apiVersion         = VK_API_VERSION_1_2,
     };
 
     /*
@@ -235,9 +238,14 @@ VkResult CreateDevice(
     VkPhysicalDeviceFeatures features = {};
     features.fillModeNonSolid = VK_TRUE;
 
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext             = nullptr;
+    vulkan12Features.timelineSemaphore = VK_TRUE; // used by the upload manager
+
     VkDeviceCreateInfo createInfo = {
         .sType                      = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext                      = nullptr,
+        .pNext                      = &vulkan12Features,
         .flags                      = 0,
         .queueCreateInfoCount       = 1,
         .pQueueCreateInfos          = &queueInfo,
@@ -952,6 +960,12 @@ int main(int /*argc*/, char **/*argv*/) {
     VkQueue queue = VK_NULL_HANDLE;
     vkGetDeviceQueue(device, queueFamilyIdx, 0, &queue);
 
+    // Texture uploads, everything runs on the one graphics queue
+    UploadManager uploads;
+    if (uploads.Create(phyDevice, device, queue, queueFamilyIdx, queue, queueFamilyIdx) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create the upload manager");
+    }
+
     const std::vector<VkFormat> preferredFormats
         = {VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM};
 
@@ -1024,13 +1038,16 @@ int main(int /*argc*/, char **/*argv*/) {
     };
 
     const char *textureName = "./images/checker-map_tho.png";
-    Texture *uvTexture = Texture::LoadFromFile(phyDevice, device, queue, cmdPool, textureName, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    Texture *uvTexture = Texture::LoadFromFile(phyDevice, device, uploads, textureName, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
 
     if (uvTexture == nullptr) {
         printf("[ERROR] Was unable to create texture %s\n", textureName);
         exit(-1);
     }
 
+    // The texture is sampled right away, wait for its upload
+    uploads.WaitIdle();
+
     DescriptorMgmt descriptors;
     descriptors.SetDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1);
     descriptors.CreateLayout(device);
@@ -1344,6 +1361,14 @@ int main(int /*argc*/, char **/*argv*/) {
 
     DestroyImageViews(device, swapchainViews);
     vkDestroySwapchainKHR(device, swapchain, nullptr);
+
+    uploads.Destroy();
+
+    // BufferInfo allocates from the device's MemoryAllocator, its memory blocks must go before the device
+    MemoryAllocator::Destroy(device);
+    // The descriptor set layouts come from the ObjectCache and may reference cached samplers, both go first
+    ObjectCache::Destroy(device);
+    SamplerCache::Destroy(device);
     vkDestroyDevice(device, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
 
@@ -192,6 +192,9 @@ int main(int /*argc*/, char** /*argv*/)
     grid.position(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f)));
     grid.rotation(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
 
+    // Upload the textures in one go
+    context.FlushUploads();
+
     glfwShowWindow(window);
 
     const VkViewport viewport = {
@@ -46,6 +46,7 @@ VkPipelineLayout CreateEmptyPipelineLayout(const VkDevice device, uint32_t pushC
 }
 
 VkPipeline CreateSimplePipeline(const VkDevice         device,
+                                const VkPipelineCache  pipelineCache,
                                 const VkFormat         colorFormat,
                                 const VkPipelineLayout pipelineLayout,
                                 const VkShaderModule   shaderVertex,
@@ -250,7 +251,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
     assert(result == VK_SUCCESS);
 
     return pipeline;
@@ -273,7 +274,8 @@ VkResult SimpleCube::Create(const Context& context, const VkFormat colorFormat,
 
     m_constantOffset = pushConstantStart;
     m_pipelineLayout = CreateEmptyPipelineLayout(device, m_constantOffset + sizeof(ModelPushConstant));
-    m_pipeline       = CreateSimplePipeline(device, colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
+    m_pipeline       = CreateSimplePipeline(device, context.pipelineCache().handle(), colorFormat, m_pipelineLayout,
+                                            shaderVertex, shaderFragment);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
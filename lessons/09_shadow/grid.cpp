@@ -85,6 +85,7 @@ static std::vector<uint32_t> buildIndexList(uint32_t splitCount)
 }
 
 VkPipeline CreateSimplePipeline(const VkDevice         device,
+                                const VkPipelineCache  pipelineCache,
                                 const VkFormat         colorFormat,
                                 const VkPipelineLayout pipelineLayout,
                                 const VkShaderModule   shaderVertex,
@@ -304,7 +305,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
     assert(result == VK_SUCCESS);
 
     return pipeline;
@@ -333,8 +334,8 @@ VkResult Grid::Create(Context& context,
     m_device = device;
 
     const std::string imagePath = "../../images/checker-map_tho.png";
-    m_texture = *Texture::LoadFromFile(context.physicalDevice(), device, context.queue(), context.commandPool(),
-                                       imagePath, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
+    m_texture = *Texture::LoadFromFile(context.physicalDevice(), device, context.uploads(), imagePath,
+                                       VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
 
     const std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {
         VkDescriptorSetLayoutBinding{
@@ -357,7 +358,8 @@ VkResult Grid::Create(Context& context,
 
     m_constantOffset = pushConstantStart;
     m_pipelineLayout = CreatePipelineLayout(device, {m_descSetLayout}, m_constantOffset + sizeof(ModelPushConstant));
-    m_pipeline       = CreateSimplePipeline(device, colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
+    m_pipeline       = CreateSimplePipeline(device, context.pipelineCache().handle(), colorFormat, m_pipelineLayout,
+                                            shaderVertex, shaderFragment);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
@@ -390,7 +392,7 @@ VkResult Grid::Create(Context& context,
 
     m_modelSet = context.descriptorPool().createSet(m_descSetLayout);
 
-    DescriptorSetMgmt setMgmt(m_modelSet);
+    DescriptorSetMgmt setMgmt(m_modelSet, m_descSetLayout);
     setMgmt.SetBuffer(0, m_uniformBuffer.buffer);
     setMgmt.SetImage(1, m_texture.view(), m_texture.sampler());
     setMgmt.Update(device);
@@ -11,6 +11,7 @@ namespace {
 } // namespace
 
 static VkPipeline CreatePipeline(const VkDevice         device,
+                                 const VkPipelineCache  pipelineCache,
                                  const VkPipelineLayout pipelineLayout,
                                  const VkFormat         colorFormat,
                                  const VkFormat         depthFormat,
@@ -225,7 +226,7 @@ static VkPipeline CreatePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
     (void)result;
 
     return pipeline;
@@ -284,7 +285,7 @@ bool LightningPass::Create(Context& context, Texture& shadowMap)
     VkDescriptorSetLayout descSetLayoutLight = context.descriptorPool().createLayout(layoutBindingsLight);
 
     m_pipelineLayout = CreatePipelineLayout(device, {descSetLayoutBase, descSetLayoutLight}, m_pushConstStart + sizeof(glm::mat4));
-    BuildPipeline(device, m_pipelineLayout);
+    BuildPipeline(device, context.pipelineCache().handle(), m_pipelineLayout);
 
     m_colorOutput = Texture::Create2D(phyDevice, device, m_colorFormat, m_extent,
                                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
@@ -301,7 +302,7 @@ bool LightningPass::Create(Context& context, Texture& shadowMap)
 
     m_lightSet = context.descriptorPool().createSet(descSetLayoutLight);
 
-    DescriptorSetMgmt setMgmt(m_lightSet);
+    DescriptorSetMgmt setMgmt(m_lightSet, descSetLayoutLight);
     setMgmt.SetBuffer(0, m_lightBuffer.buffer);
     setMgmt.SetImage(1, shadowMap.view(), shadowMap.sampler());
     setMgmt.Update(device);
@@ -314,7 +315,9 @@ void LightningPass::updateLightInfo(Context& context, DirectionalLight& lightSha
     m_lightBuffer.Update(context.device(), &lightSpaceMatrix, sizeof(lightSpaceMatrix));
 }
 
-void LightningPass::BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout)
+void LightningPass::BuildPipeline(const VkDevice         device,
+                                  const VkPipelineCache  pipelineCache,
+                                  const VkPipelineLayout pipelineLayout)
 {
     // Simple lightning
     {
@@ -324,7 +327,7 @@ void LightningPass::BuildPipeline(const VkDevice device, const VkPipelineLayout
         };
 
         m_simplePipeline =
-            CreatePipeline(device, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0], gridShaders[1]);
+            CreatePipeline(device, pipelineCache, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0], gridShaders[1]);
 
         vkDestroyShaderModule(device, gridShaders[0], nullptr);
         vkDestroyShaderModule(device, gridShaders[1], nullptr);
@@ -338,7 +341,7 @@ void LightningPass::BuildPipeline(const VkDevice device, const VkPipelineLayout
         };
 
         m_shadowMapPipeline =
-            CreatePipeline(device, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0], gridShaders[1]);
+            CreatePipeline(device, pipelineCache, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0], gridShaders[1]);
 
         vkDestroyShaderModule(device, gridShaders[0], nullptr);
         vkDestroyShaderModule(device, gridShaders[1], nullptr);
@@ -22,7 +22,7 @@ public:
     void BeginPass(const VkCommandBuffer cmdBuffer);
     void EndPass(const VkCommandBuffer cmdBuffer);
 
-    void BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout);
+    void BuildPipeline(const VkDevice device, const VkPipelineCache pipelineCache, const VkPipelineLayout pipelineLayout);
 
     void Destroy(const VkDevice device);
 
@@ -10,6 +10,7 @@ namespace {
 
 static VkPipeline CreatePipeline(
     const VkDevice          device,
+    const VkPipelineCache   pipelineCache,
     const VkExtent2D        surfaceExtent,
     const VkRenderPass      renderPass,
     const VkPipelineLayout  pipelineLayout,
@@ -193,7 +194,7 @@ static VkPipeline CreatePipeline(
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
     (void)result;
 
     return pipeline;
@@ -201,6 +202,7 @@ static VkPipeline CreatePipeline(
 
 void PostProcessPass::BuildPipeline(
     const VkDevice          device,
+    const VkPipelineCache   pipelineCache,
     const VkExtent2D        surfaceExtent,
     const VkRenderPass      renderPass) {
 
@@ -229,7 +231,7 @@ void PostProcessPass::BuildPipeline(
         CreateShaderModule(device, SPV_post_process_frag, sizeof(SPV_post_process_frag)),
     };
 
-    m_pipeline = CreatePipeline(device, surfaceExtent, renderPass, m_pipelineLayout, shaders[0], shaders[1]);
+    m_pipeline = CreatePipeline(device, pipelineCache, surfaceExtent, renderPass, m_pipelineLayout, shaders[0], shaders[1]);
 
     vkDestroyShaderModule(device, shaders[0], nullptr);
     vkDestroyShaderModule(device, shaders[1], nullptr);
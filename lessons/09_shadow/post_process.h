@@ -10,6 +10,7 @@ public:
 
     void BuildPipeline(
         const VkDevice          device,
+        const VkPipelineCache   pipelineCache,
         const VkExtent2D        surfaceExtent,
         const VkRenderPass      renderPass);
 
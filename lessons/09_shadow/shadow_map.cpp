@@ -27,12 +27,14 @@ bool ShadowMap::Create(Context& context)
     assert(m_shadowDepth.IsValid());
 
     m_pipelineLayout = CreatePipelineLayout(device, {}, m_pushConstantStart + sizeof(glm::mat4));
-    BuildPipeline(device, m_pipelineLayout);
+    BuildPipeline(device, context.pipelineCache().handle(), m_pipelineLayout);
 
     return true;
 }
 
-bool ShadowMap::BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout)
+bool ShadowMap::BuildPipeline(const VkDevice         device,
+                              const VkPipelineCache  pipelineCache,
+                              const VkPipelineLayout pipelineLayout)
 {
     VkShaderModule shaderVertex   = CreateShaderModule(device, SPV_shadow_map_vert, sizeof(SPV_shadow_map_vert));
     VkShaderModule shaderFragment = CreateShaderModule(device, SPV_shadow_map_frag, sizeof(SPV_shadow_map_frag));
@@ -246,7 +248,7 @@ bool ShadowMap::BuildPipeline(const VkDevice device, const VkPipelineLayout pipe
         .basePipelineIndex   = 0,
     };
 
-    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_pipeline);
+    VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &m_pipeline);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
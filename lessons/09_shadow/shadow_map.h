@@ -21,7 +21,7 @@ public:
     void BeginPass(const VkCommandBuffer cmdBuffer);
     void EndPass(const VkCommandBuffer cmdBuffer);
 
-    bool BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout);
+    bool BuildPipeline(const VkDevice device, const VkPipelineCache pipelineCache, const VkPipelineLayout pipelineLayout);
 
     VkExtent2D Extent() const { return m_extent; }
     uint32_t   Width() const { return m_extent.width; }
@@ -10,10 +10,14 @@
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 
+#include "attachment_pool.h"
 #include "camera.h"
 #include "context.h"
+#include "executable_path.h"
 #include "grid.h"
 #include "imgui_integration.h"
+#include "memory_allocator.h"
+#include "object_cache.h"
 #include "lightning_pass.h"
 #include "post_process.h"
 #include "shadow_map.h"
@@ -131,8 +135,16 @@ int main(int /*argc*/, char** /*argv*/)
         throw std::runtime_error("Failed to create window surface!");
     }
 
+    // Every set of the application is bound through the lib, descriptor buffers can be used when supported
+    context.RequestDescriptorBackend(DescriptorBackend::Buffer);
+    // The grid and the lightning pass only bind their textures and materials through the bindless table
+    context.RequireBindless();
+
     VkPhysicalDevice phyDevice      = context.SelectPhysicalDevice(surface);
     VkDevice         device         = context.CreateDevice({});
+    if (device == VK_NULL_HANDLE) {
+        throw std::runtime_error("Failed to create Vulkan Device");
+    }
     VkQueue          queue          = context.queue();
 
     Swapchain swapchain(instance, phyDevice, device, surface, {windowWidth, windowHeight});
@@ -143,14 +155,15 @@ int main(int /*argc*/, char** /*argv*/)
 
     std::vector<VkCommandBuffer> cmdBuffers = AllocateCommandBuffers(device, cmdPool, swapchain.images().size());
 
+    // Sets of the pushed descriptors when the device can not push them
+    FrameDescriptorAllocator& frameDescriptors = context.CreateFrameDescriptors((uint32_t)swapchain.images().size());
+
     VkFence     imageFence       = CreateFence(device);
     VkSemaphore presentSemaphore = CreateSemaphore(device);
 
     imIntegration.CreateContext(context, swapchain);
 
-    VkFormat depthFormat  = VK_FORMAT_D32_SFLOAT;
-    Texture  depthTexture = Texture::Create2D(context.physicalDevice(), context.device(), depthFormat,
-                                              swapchain.surfaceExtent(), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    const VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
 
     struct LightInfo {
         glm::vec4 position;
@@ -179,6 +192,9 @@ int main(int /*argc*/, char** /*argv*/)
         assert(result == VK_SUCCESS);
     }
 
+    // Decoded textures are kept on disk, later starts map them instead of decoding again
+    context.textureLoader().EnableDiskCache(ExecutableRelativePath("texture_cache"));
+
     SimpleCube cube;
     cube.Create(context, swapchain.format(), commonPushConstantRange.size);
 
@@ -187,6 +203,9 @@ int main(int /*argc*/, char** /*argv*/)
     grid.position(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f)));
     grid.rotation(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
 
+    // Upload all static geometry and textures in one go
+    context.FlushUploads();
+
     glfwShowWindow(window);
 
     const VkViewport viewport = {
@@ -205,7 +224,26 @@ int main(int /*argc*/, char** /*argv*/)
     };
     (void)scissor;
 
-    ShadowMap shadowMap(depthFormat, commonPushConstantRange.size, swapchain.surfaceExtent());
+    // Frame pass order, attachments share memory based on which passes use them
+    enum FramePass : uint32_t {
+        PASS_SHADOW      = 0,
+        PASS_LIGHTING    = 1,
+        PASS_POSTPROCESS = 2, // reads the lighting color
+    };
+
+    ShadowMap     shadowMap(depthFormat, commonPushConstantRange.size, swapchain.surfaceExtent());
+    LightningPass lightningPass(swapchain.format(), depthFormat, commonPushConstantRange.size,
+                                swapchain.surfaceExtent());
+
+    AttachmentPool attachments;
+    shadowMap.DeclareAttachments(attachments, PASS_SHADOW, PASS_LIGHTING);
+    lightningPass.DeclareAttachments(attachments, PASS_LIGHTING, PASS_POSTPROCESS);
+    {
+        VkResult result = attachments.Build(context.physicalDevice(), device);
+        assert((result == VK_SUCCESS) && "Attachment creation failed");
+        attachments.PrintReport();
+    }
+
     shadowMap.Create(context);
 
     DirectionalLight directionalLight = {
@@ -214,8 +252,6 @@ int main(int /*argc*/, char** /*argv*/)
         glm::mat4(1.0f),
     };
 
-    LightningPass lightningPass(swapchain.format(), depthFormat, commonPushConstantRange.size,
-                                swapchain.surfaceExtent());
     lightningPass.Create(context, shadowMap.Depth());
 
     PostProcessPass postProcess(swapchain.format(), swapchain.surfaceExtent());
@@ -227,6 +263,9 @@ int main(int /*argc*/, char** /*argv*/)
 
     postProcess.BindInputImage(context.device(), lightningPass.colorOutput());
 
+    // Every pipeline exists by now: compare with the previous run to see what the cache saved
+    context.pipelineCache().PrintStats();
+
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
         camera.Update();
@@ -258,6 +297,15 @@ int main(int /*argc*/, char** /*argv*/)
             ImGui::InputFloat3("Light Positon", (float*)&directionalLight.position);
 
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            ImGui::Text("Attachments %.2f MiB (%.2f MiB saved by aliasing/lazy allocation)",
+                        attachments.AllocatedBytes() / (1024.0 * 1024.0), attachments.SavedBytes() / (1024.0 * 1024.0));
+            const TextureCache::Stats textureStats = context.textureCache().GetStats();
+            ImGui::Text("Texture cache %u hits, %u misses, %u resident (%.2f MiB)", textureStats.hits,
+                        textureStats.misses, textureStats.residentCount, textureStats.residentBytes / (1024.0 * 1024.0));
+            const TextureStreamer::Stats streamStats = context.textureStreamer().GetStats();
+            ImGui::Text("Streaming %.2f of %.2f MiB resident (cap %.0f MiB), %.2f MiB uploaded last frame",
+                        streamStats.residentBytes / (1024.0 * 1024.0), streamStats.fullBytes / (1024.0 * 1024.0),
+                        streamStats.memoryCap / (1024.0 * 1024.0), streamStats.uploadedLastFrame / (1024.0 * 1024.0));
 
             static int postProcessCurrent = 0;
             const char* postProcessOptions[] = { "Copy", "Laplace", "Blur", "Mexico", "custom" };
@@ -266,6 +314,9 @@ int main(int /*argc*/, char** /*argv*/)
                 postProcess.options.mode = (uint32_t)postProcessCurrent;
             }
             ImGui::End();
+
+            imIntegration.MemoryWindow(context);
+
             ImGui::Render();
 
             // Hacked in rotation
@@ -305,6 +356,13 @@ int main(int /*argc*/, char** /*argv*/)
 
         vkWaitForFences(device, 1, &imageFence, VK_TRUE, UINT64_MAX);
 
+        frameDescriptors.BeginFrame();
+        context.textureCache().BeginFrame();
+
+        // The grid texture follows the camera: report its size on screen, then stream within the frame budget
+        grid.UpdateStreaming(context.textureStreamer(), camera, (float)swapchain.surfaceExtent().height);
+        context.textureStreamer().Update();
+
         // Get command buffer based on swapchain image index
         VkCommandBuffer cmdBuffer = cmdBuffers[swapchainImage.idx];
         {
@@ -448,13 +506,25 @@ int main(int /*argc*/, char** /*argv*/)
         vkDeviceWaitIdle(device);
     }
 
+    // Statistics of the run, the lib only collects them
+    MemoryAllocator::Get(phyDevice, device).PrintStats();
+    context.textureCache().PrintStats();
+    ObjectCache::Get(device).PrintStats();
+    if (const DescriptorBuffer* descriptorBuffer = context.descriptorBuffer()) {
+        descriptorBuffer->PrintStats();
+    }
+    if (const TextureDiskCache* diskCache = context.textureLoader().diskCache()) {
+        printf("Texture disk cache: %u hits, %u misses\n", diskCache->Hits(), diskCache->Misses());
+    }
+    context.textureStreamer().PrintStats();
+
     postProcess.Destroy(context);
     shadowMap.Destroy(context);
     lightningPass.Destroy(device);
+    attachments.Destroy(device);
 
     vkDestroyPipelineLayout(device, commonLayout, nullptr);
 
-    depthTexture.Destroy(context.device());
     imIntegration.Destroy(context);
 
     vkDestroyFence(device, imageFence, nullptr);
@@ -468,6 +538,13 @@ int main(int /*argc*/, char** /*argv*/)
     swapchain.Destroy();
     context.Destroy();
 
+    // Saved by Context::Destroy, the statistics outlive the cache
+    const PipelineCache::Stats& pipelineCacheStats = context.pipelineCache().GetStats();
+    if (pipelineCacheStats.savedBytes > 0) {
+        printf("Pipeline cache: %llu bytes saved (%u merged from other processes)\n",
+               (unsigned long long)pipelineCacheStats.savedBytes, pipelineCacheStats.mergedFiles);
+    }
+
     glfwDestroyWindow(window);
 
     glfwTerminate();
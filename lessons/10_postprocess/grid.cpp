@@ -1,14 +1,17 @@
 #include "grid.h"
 
 #include <GLFW/glfw3.h>
+#include <cassert>
+#include <cmath>
 #include <cstdio>
 
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
 #include "buffer.h"
+#include "camera.h"
 #include "context.h"
-#include "descriptors.h"
+#include "sampler_cache.h"
 #include "texture.h"
 #include "wrappers.h"
 
@@ -85,6 +88,7 @@ static std::vector<uint32_t> buildIndexList(uint32_t splitCount)
 }
 
 VkPipeline CreateSimplePipeline(const VkDevice         device,
+                                PipelineCache&         pipelineCache,
                                 const VkFormat         colorFormat,
                                 const VkPipelineLayout pipelineLayout,
                                 const VkShaderModule   shaderVertex,
@@ -284,7 +288,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     const VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
         .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext               = &renderingInfo,
-        .flags               = 0,
+        .flags               = DescriptorBuffer::PipelineCreateFlags(device),
         .stageCount          = 2,
         .pStages             = shaders,
         .pVertexInputState   = &vertexInputInfo,
@@ -304,7 +308,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &pipeline);
     assert(result == VK_SUCCESS);
 
     return pipeline;
@@ -333,31 +337,16 @@ VkResult Grid::Create(Context& context,
     m_device = device;
 
     const std::string imagePath = "../../images/checker-map_tho.png";
-    m_texture = *Texture::LoadFromFile(context.physicalDevice(), device, context.queue(), context.commandPool(),
-                                       imagePath, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT);
-
-    const std::vector<VkDescriptorSetLayoutBinding> layoutBindings = {
-        VkDescriptorSetLayoutBinding{
-            .binding            = 0,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-        VkDescriptorSetLayoutBinding{
-            .binding            = 1,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-    };
+    m_texture = context.textureStreamer().Add(imagePath, VK_FORMAT_R8G8B8A8_UNORM);
+    m_radius  = 0.5f * std::sqrt(width * width + height * height);
 
-    m_descSetLayout = context.descriptorPool().createLayout(layoutBindings);
+    assert(context.HasBindless() && "Context::RequireBindless must be called before CreateDevice");
+    m_bindless = &context.bindless();
 
     m_constantOffset = pushConstantStart;
-    m_pipelineLayout = CreatePipelineLayout(device, {m_descSetLayout}, m_constantOffset + sizeof(ModelPushConstant));
-    m_pipeline       = CreateSimplePipeline(device, colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
+    m_pipelineLayout = CreatePipelineLayout(device, {m_bindless->layout()}, m_constantOffset + sizeof(ModelPushConstant));
+    m_pipeline       = CreateSimplePipeline(device, context.pipelineCache(), colorFormat, m_pipelineLayout,
+                                            shaderVertex, shaderFragment);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
@@ -365,47 +354,53 @@ VkResult Grid::Create(Context& context,
     {
         const std::vector<Vertex> vertexData     = buildGrid(width, height, count);
         const uint32_t            vertexDataSize = vertexData.size() * sizeof(vertexData[0]);
-        m_vertexBuffer =
-            BufferInfo::Create(context.physicalDevice(), device, vertexDataSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-        m_vertexBuffer.Update(device, vertexData.data(), vertexDataSize);
+        m_vertexBuffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), vertexData.data(),
+                                                  vertexDataSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
     }
 
     {
         const std::vector<uint32_t> indexData     = buildIndexList(count);
         const uint32_t              indexDataSize = indexData.size() * sizeof(indexData[0]);
-        m_indexBuffer =
-            BufferInfo::Create(context.physicalDevice(), device, indexDataSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-        m_indexBuffer.Update(device, indexData.data(), indexDataSize);
+        m_indexBuffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), indexData.data(),
+                                                 indexDataSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
         m_vertexCount = indexData.size();
     }
 
-    m_uniformBuffer =
-        BufferInfo::Create(context.physicalDevice(), device, sizeof(UniformBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    // The grid is mostly seen at grazing angles, anisotropic filtering keeps the far lines sharp
+    const SamplerSettings samplerSettings = { .maxAnisotropy = 16.0f };
+    m_sampler = SamplerCache::Get(device).Get(samplerSettings);
 
-    const UniformBuffer data = {
-        .color = glm::vec4(1.0f, 0.2f, 1.0f, 1.0f),
-        .time  = (float)glfwGetTime(),
-    };
-    m_uniformBuffer.Update(device, &data, sizeof(data));
-
-    m_modelSet = context.descriptorPool().createSet(m_descSetLayout);
+    // Only the coarse levels are waited for, the finer ones are streamed in while drawing
+    TextureStreamer& streamer = context.textureStreamer();
+    if (!streamer.WaitResident(m_texture)) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
 
-    DescriptorSetMgmt setMgmt(m_modelSet);
-    setMgmt.SetBuffer(0, m_uniformBuffer.buffer);
-    setMgmt.SetImage(1, m_texture.view(), m_texture.sampler());
-    setMgmt.Update(device);
+    // The streamed texture keeps its slot in the bindless table, new residencies only rewrite the slot
+    m_textureVersion = streamer.Version(m_texture);
+    m_textureIdx     = m_bindless->AddTexture(streamer.Get(m_texture)->view(), m_sampler);
+    m_materialIdx    = m_bindless->AddMaterial({.textureIdx = m_textureIdx});
 
     return VK_SUCCESS;
 }
 
+void Grid::UpdateStreaming(TextureStreamer& streamer, const Camera& camera, float viewportHeight)
+{
+    if (streamer.Version(m_texture) != m_textureVersion) {
+        m_textureVersion = streamer.Version(m_texture);
+        m_bindless->SetTexture(m_textureIdx, streamer.Get(m_texture)->view(), m_sampler);
+    }
+
+    const glm::vec3 center = glm::vec3(m_position * m_rotation * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    const float     pixels = TextureStreamer::ProjectedSize(camera.projection(), camera.view(), center, m_radius,
+                                                            viewportHeight);
+    streamer.RequestScreenSize(m_texture, pixels);
+}
+
 void Grid::Destroy(Context& context)
 {
     const VkDevice device = context.device();
 
-    //context.descriptorPool().destroySet(m_modelSet);
-
-    m_texture.Destroy(device);
-    m_uniformBuffer.Destroy(device);
     m_vertexBuffer.Destroy(device);
     m_indexBuffer.Destroy(device);
     vkDestroyPipeline(device, m_pipeline, nullptr);
@@ -414,14 +409,9 @@ void Grid::Destroy(Context& context)
 
 void Grid::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
 {
-    const UniformBuffer data = {
-        .color = glm::vec4(1.0f, 0.2f, 1.0f, 1.0f),
-        .time  = (float)glfwGetTime(),
-    };
-    m_uniformBuffer.Update(m_device, &data, sizeof(data));
-
     ModelPushConstant modelData = {
-        .model = glm::mat4(1.0f) * m_position * m_rotation,
+        .model       = glm::mat4(1.0f) * m_position * m_rotation,
+        .materialIdx = m_materialIdx,
     };
 
     if (bindPipeline) {
@@ -430,8 +420,6 @@ void Grid::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
     vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, m_constantOffset,
                        sizeof(ModelPushConstant), &modelData);
 
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_modelSet, 0,
-                            nullptr);
     VkDeviceSize nullOffset = 0u;
     vkCmdBindVertexBuffers(cmdBuffer, 0u, 1u, &m_vertexBuffer.buffer, &nullOffset);
     vkCmdBindIndexBuffer(cmdBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
@@ -5,20 +5,18 @@
 #include <vulkan/vulkan_core.h>
 
 #include "glm_config.h"
+#include "bindless_table.h"
 #include "buffer.h"
-#include "texture.h"
+#include "texture_streamer.h"
 
+class Camera;
 class Context;
 
 class Grid {
 public:
     struct ModelPushConstant {
         glm::mat4 model;
-    };
-
-    struct UniformBuffer {
-        glm::vec4 color;
-        float     time;
+        uint32_t  materialIdx; // into the bindless material table
     };
 
     Grid();
@@ -32,6 +30,10 @@ public:
     void     Destroy(Context& context);
     void     Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline = true);
 
+    // Reports the on screen size of the grid to the streamer and points the bindless texture slot to the finest
+    // resident levels. Call before TextureStreamer::Update, while the slot is not used by a pending command buffer.
+    void UpdateStreaming(TextureStreamer& streamer, const Camera& camera, float viewportHeight);
+
     void position(const glm::mat4& position) { m_position = position; }
     void rotation(const glm::mat4& rotation) { m_rotation = rotation; }
 
@@ -45,11 +47,14 @@ private:
     glm::mat4        m_position       = glm::mat4(1.0f);
     glm::mat4        m_rotation       = glm::mat4(1.0f);
 
-    BufferInfo            m_uniformBuffer = {};
-    VkDescriptorPool      m_pool          = VK_NULL_HANDLE;
-    VkDescriptorSetLayout m_descSetLayout = VK_NULL_HANDLE;
-    VkDescriptorSet       m_modelSet      = VK_NULL_HANDLE;
-    VkDevice              m_device        = VK_NULL_HANDLE;
+    BindlessTable* m_bindless    = nullptr; // owned by the context
+    uint32_t       m_textureIdx  = 0;
+    uint32_t       m_materialIdx = 0;
+    VkDevice       m_device      = VK_NULL_HANDLE;
 
-    Texture m_texture = {};
+    // The checker texture is 4096x4096, only the levels needed for the current view are resident
+    TextureStreamer::Handle m_texture        = TextureStreamer::INVALID_HANDLE;
+    uint32_t                m_textureVersion = 0; // version of the texture written into the bindless slot
+    VkSampler               m_sampler        = VK_NULL_HANDLE;
+    float                   m_radius         = 0.0f; // bounding sphere around the center of the grid
 };
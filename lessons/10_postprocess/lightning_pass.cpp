@@ -1,5 +1,7 @@
 #include "lightning_pass.h"
 
+#include <iterator>
+
 #include "wrappers.h"
 
 namespace {
@@ -11,6 +13,7 @@ namespace {
 } // namespace
 
 static VkPipeline CreatePipeline(const VkDevice         device,
+                                 PipelineCache&         pipelineCache,
                                  const VkPipelineLayout pipelineLayout,
                                  const VkFormat         colorFormat,
                                  const VkFormat         depthFormat,
@@ -205,7 +208,7 @@ static VkPipeline CreatePipeline(const VkDevice         device,
     VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
         .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext               = &renderingInfo,
-        .flags               = 0,
+        .flags               = DescriptorBuffer::PipelineCreateFlags(device),
         .stageCount          = 2,
         .pStages             = shaders,
         .pVertexInputState   = &vertexInputInfo,
@@ -225,7 +228,7 @@ static VkPipeline CreatePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &pipeline);
     (void)result;
 
     return pipeline;
@@ -242,27 +245,22 @@ LightningPass::LightningPass(const VkFormat colorFormat,
 {
 }
 
+void LightningPass::DeclareAttachments(AttachmentPool& attachments, uint32_t passIdx, uint32_t lastColorReaderPassIdx)
+{
+    m_colorOutput = attachments.Add("lighting color", m_colorFormat, m_extent,
+                                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+                                        | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                    passIdx, lastColorReaderPassIdx);
+    // The depth is cleared at the start and discarded at the end of the pass, it never has to leave the tile
+    m_depthOutput = attachments.Add("lighting depth", m_depthFormat, m_extent,
+                                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                                    passIdx, passIdx);
+}
+
 bool LightningPass::Create(Context& context, Texture& shadowMap)
 {
-    VkPhysicalDevice phyDevice = context.physicalDevice();
-    VkDevice         device    = context.device();
+    VkDevice device = context.device();
 
-    const std::vector<VkDescriptorSetLayoutBinding> layoutBindingsBase = {
-        VkDescriptorSetLayoutBinding{
-            .binding            = 0,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-        VkDescriptorSetLayoutBinding{
-            .binding            = 1,
-            .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount    = 1,
-            .stageFlags         = VK_SHADER_STAGE_ALL,
-            .pImmutableSamplers = nullptr,
-        },
-    };
     const std::vector<VkDescriptorSetLayoutBinding> layoutBindingsLight = {
         VkDescriptorSetLayoutBinding{
             .binding            = 0,
@@ -280,31 +278,35 @@ bool LightningPass::Create(Context& context, Texture& shadowMap)
         },
     };
 
-    VkDescriptorSetLayout descSetLayoutBase = context.descriptorPool().createLayout(layoutBindingsBase);
-    VkDescriptorSetLayout descSetLayoutLight = context.descriptorPool().createLayout(layoutBindingsLight);
+    // Written into the command buffer at the start of the pass, no set has to be allocated for it
+    m_pushDescriptors = &context.pushDescriptors();
+
+    VkDescriptorSetLayout descSetLayoutLight = m_pushDescriptors->CreateLayout(layoutBindingsLight);
+    if (descSetLayoutLight == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    // Set 0 is the bindless table with the textures and materials of every object
+    assert(context.HasBindless() && "Context::RequireBindless must be called before CreateDevice");
+    m_bindless = &context.bindless();
 
-    m_pipelineLayout = CreatePipelineLayout(device, {descSetLayoutBase, descSetLayoutLight}, m_pushConstStart + sizeof(glm::mat4));
-    BuildPipeline(device, m_pipelineLayout);
+    // Per draw: model matrix and material index
+    m_pipelineLayout = CreatePipelineLayout(device, {m_bindless->layout(), descSetLayoutLight},
+                                            m_pushConstStart + sizeof(glm::mat4) + sizeof(uint32_t));
+    BuildPipeline(device, context.pipelineCache(), m_pipelineLayout);
 
-    m_colorOutput = Texture::Create2D(phyDevice, device, m_colorFormat, m_extent,
-                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
-                                          VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
-    m_depthOutput = Texture::Create2D(phyDevice, device, m_depthFormat, m_extent,
-                                      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    assert(m_depthOutput.IsValid());
+    assert(m_colorOutput != nullptr && m_depthOutput != nullptr && m_depthOutput->IsValid()
+           && "AttachmentPool must be built before Create");
 
-    m_lightBuffer =
-        BufferInfo::Create(context.physicalDevice(), device, sizeof(glm::mat4), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+    m_lightBuffer = BufferInfo::Create(context.physicalDevice(), device, sizeof(glm::mat4),
+                                       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MemoryUsage::PerFrame);
 
     const glm::mat4 lightMatrix = glm::mat4(1.0f);
     m_lightBuffer.Update(device, &lightMatrix, sizeof(lightMatrix));
 
-    m_lightSet = context.descriptorPool().createSet(descSetLayoutLight);
-
-    DescriptorSetMgmt setMgmt(m_lightSet);
-    setMgmt.SetBuffer(0, m_lightBuffer.buffer);
-    setMgmt.SetImage(1, shadowMap.view(), shadowMap.sampler());
-    setMgmt.Update(device);
+    m_lightDescriptors = DescriptorSetMgmt(VK_NULL_HANDLE, descSetLayoutLight);
+    m_lightDescriptors.SetBuffer(0, m_lightBuffer.buffer);
+    m_lightDescriptors.SetImage(1, shadowMap.view(), shadowMap.sampler());
 
     return true;
 }
@@ -314,7 +316,9 @@ void LightningPass::updateLightInfo(Context& context, DirectionalLight& lightSha
     m_lightBuffer.Update(context.device(), &lightSpaceMatrix, sizeof(lightSpaceMatrix));
 }
 
-void LightningPass::BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout)
+void LightningPass::BuildPipeline(const VkDevice         device,
+                                  PipelineCache&         pipelineCache,
+                                  const VkPipelineLayout pipelineLayout)
 {
     // Simple lightning
     {
@@ -324,7 +328,8 @@ void LightningPass::BuildPipeline(const VkDevice device, const VkPipelineLayout
         };
 
         m_simplePipeline =
-            CreatePipeline(device, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0], gridShaders[1]);
+            CreatePipeline(device, pipelineCache, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0],
+                           gridShaders[1]);
 
         vkDestroyShaderModule(device, gridShaders[0], nullptr);
         vkDestroyShaderModule(device, gridShaders[1], nullptr);
@@ -338,7 +343,8 @@ void LightningPass::BuildPipeline(const VkDevice device, const VkPipelineLayout
         };
 
         m_shadowMapPipeline =
-            CreatePipeline(device, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0], gridShaders[1]);
+            CreatePipeline(device, pipelineCache, pipelineLayout, m_colorFormat, m_depthFormat, gridShaders[0],
+                           gridShaders[1]);
 
         vkDestroyShaderModule(device, gridShaders[0], nullptr);
         vkDestroyShaderModule(device, gridShaders[1], nullptr);
@@ -352,8 +358,6 @@ void LightningPass::Destroy(const VkDevice device)
     vkDestroyPipeline(device, m_shadowMapPipeline, nullptr);
 
     vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
-    m_colorOutput.Destroy(device);
-    m_depthOutput.Destroy(device);
 }
 
 void LightningPass::BeginPass(const VkCommandBuffer cmdBuffer)
@@ -363,7 +367,7 @@ void LightningPass::BeginPass(const VkCommandBuffer cmdBuffer)
     const VkRenderingAttachmentInfoKHR colorAttachment = {
         .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
         .pNext              = nullptr,
-        .imageView          = m_colorOutput.view(),
+        .imageView          = m_colorOutput->view(),
         .imageLayout        = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
         .resolveMode        = VK_RESOLVE_MODE_NONE,
         .resolveImageView   = VK_NULL_HANDLE,
@@ -376,13 +380,13 @@ void LightningPass::BeginPass(const VkCommandBuffer cmdBuffer)
     const VkRenderingAttachmentInfoKHR depthAttachment = {
         .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
         .pNext              = nullptr,
-        .imageView          = m_depthOutput.view(),
+        .imageView          = m_depthOutput->view(),
         .imageLayout        = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
         .resolveMode        = VK_RESOLVE_MODE_NONE,
         .resolveImageView   = VK_NULL_HANDLE,
         .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
         .loadOp             = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp            = VK_ATTACHMENT_STORE_OP_STORE,
+        .storeOp            = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .clearValue         = {.depthStencil = depthClear},
     };
     const VkRenderingInfoKHR renderInfo = {
@@ -416,8 +420,10 @@ void LightningPass::BeginPass(const VkCommandBuffer cmdBuffer)
     vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
     vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_shadowMapPipeline);
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1, 1, &m_lightSet, 0,
-                            nullptr);
+    // Bound once for the whole pass, the draws only push their material index
+    m_bindless->Bind(cmdBuffer, m_pipelineLayout, 0);
+    m_pushDescriptors->CmdPushDescriptors(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1,
+                                          m_lightDescriptors);
 }
 
 void LightningPass::EndPass(const VkCommandBuffer cmdBuffer)
@@ -429,26 +435,49 @@ void LightningPass::EndPass(const VkCommandBuffer cmdBuffer)
 
 void LightningPass::TransitionForRender(const VkCommandBuffer cmdBuffer)
 {
-    const VkImageMemoryBarrier2 renderStartBarrier = {
-        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-        .pNext               = nullptr,
-        .srcStageMask        = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-        .srcAccessMask       = VK_ACCESS_2_NONE,
-        .dstStageMask        = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR,
-        .dstAccessMask       = VK_ACCESS_2_NONE,
-        .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
-        .newLayout           = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image               = m_colorOutput.image(),
-        .subresourceRange =
-            {
-                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-                .baseMipLevel   = 0,
-                .levelCount     = 1,
-                .baseArrayLayer = 0,
-                .layerCount     = 1,
-            },
+    const VkImageMemoryBarrier2 renderStartBarriers[] = {
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .pNext               = nullptr,
+            .srcStageMask        = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+            .srcAccessMask       = VK_ACCESS_2_NONE,
+            .dstStageMask        = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT_KHR,
+            .dstAccessMask       = VK_ACCESS_2_NONE,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = m_colorOutput->image(),
+            .subresourceRange =
+                {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel   = 0,
+                    .levelCount     = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1,
+                },
+        },
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .pNext               = nullptr,
+            .srcStageMask        = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+            .srcAccessMask       = VK_ACCESS_2_NONE,
+            .dstStageMask        = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
+            .dstAccessMask       = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = m_depthOutput->image(),
+            .subresourceRange =
+                {
+                    .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
+                    .baseMipLevel   = 0,
+                    .levelCount     = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount     = 1,
+                },
+        },
     };
     const VkDependencyInfo startDependency = {
         .sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
@@ -458,8 +487,8 @@ void LightningPass::TransitionForRender(const VkCommandBuffer cmdBuffer)
         .pMemoryBarriers          = nullptr,
         .bufferMemoryBarrierCount = 0,
         .pBufferMemoryBarriers    = nullptr,
-        .imageMemoryBarrierCount  = 1,
-        .pImageMemoryBarriers     = &renderStartBarrier,
+        .imageMemoryBarrierCount  = (uint32_t)std::size(renderStartBarriers),
+        .pImageMemoryBarriers     = renderStartBarriers,
     };
     vkCmdPipelineBarrier2(cmdBuffer, &startDependency);
 }
@@ -477,7 +506,7 @@ void LightningPass::TransitionForRead(const VkCommandBuffer cmdBuffer)
         .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image               = m_colorOutput.image(),
+        .image               = m_colorOutput->image(),
         .subresourceRange =
             {
                 .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
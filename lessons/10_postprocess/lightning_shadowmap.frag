@@ -1,5 +1,7 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : require
+
 const bool PCF = false;
 
 layout(location = 0) in vec2 in_uv;
@@ -9,7 +11,19 @@ layout(location = 3) in vec4 in_fragPosLightSpace;
 
 layout(location = 0) out vec4 out_color;
 
-layout(set = 0, binding = 1) uniform sampler2D modelTexture;
+struct Material {
+    vec4 baseColor;
+    uint textureIdx; // NO_TEXTURE: base color only
+};
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+// Bindless table, see BindlessTable
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+layout(std430, set = 0, binding = 1) readonly buffer Materials {
+    Material materials[];
+};
+
 layout(set = 1, binding = 1) uniform sampler2D shadowMap;
 
 layout(push_constant) uniform PushConstants {
@@ -20,7 +34,19 @@ layout(push_constant) uniform PushConstants {
     vec4 lightPosition;
     // model spec
     mat4 model;
+    uint materialIdx;
 } constants;
+
+vec4 MaterialColor(uint materialIdx, vec2 uv)
+{
+    Material material = materials[materialIdx];
+    if (material.textureIdx == NO_TEXTURE) {
+        return material.baseColor;
+    }
+
+    return material.baseColor * texture(textures[nonuniformEXT(material.textureIdx)], uv);
+}
+
 vec3 lightColor = vec3(1.0f, 1.0f, 1.0f);
 
 struct {
@@ -91,7 +117,7 @@ float PCFShadow(vec4 fragPosLightSpace)
 }
 
 void main() {
-    vec4 pixel = texture(modelTexture, in_uv);
+    vec4 pixel = MaterialColor(constants.materialIdx, in_uv);
 
     // distance based attenuation
     float distance = length(constants.lightPosition.xyz - in_fragPos);
@@ -16,6 +16,7 @@ layout(push_constant) uniform PushConstants {
     vec4 lightPosition;
     // model spec
     mat4 model;
+    uint materialIdx;
 } constants;
 
 layout(location = 0) out vec2 out_uv;
@@ -1,5 +1,7 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : require
+
 layout(location = 0) in vec2 in_uv;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec3 in_fragPos;
@@ -7,7 +9,18 @@ layout(location = 3) in vec3 in_color;
 
 layout(location = 0) out vec4 out_color;
 
-layout(set = 0, binding = 1) uniform sampler2D modelTexture;
+struct Material {
+    vec4 baseColor;
+    uint textureIdx; // NO_TEXTURE: base color only
+};
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+// Bindless table, see BindlessTable
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+layout(std430, set = 0, binding = 1) readonly buffer Materials {
+    Material materials[];
+};
 
 layout(push_constant) uniform PushConstants {
     // common
@@ -17,12 +30,23 @@ layout(push_constant) uniform PushConstants {
     vec4 lightPosition;
     // model spec
     mat4 model;
+    uint materialIdx;
 } constants;
 
+vec4 MaterialColor(uint materialIdx, vec2 uv)
+{
+    Material material = materials[materialIdx];
+    if (material.textureIdx == NO_TEXTURE) {
+        return material.baseColor;
+    }
+
+    return material.baseColor * texture(textures[nonuniformEXT(material.textureIdx)], uv);
+}
+
 vec3 lightColor = vec3(1.0f, 1.0f, 1.0f);
 
 void main() {
-    vec4 pixel = texture(modelTexture, in_uv);
+    vec4 pixel = MaterialColor(constants.materialIdx, in_uv);
 
     // ambient
     float ambientStrength = 0.1;
@@ -8,6 +8,7 @@ namespace {
 }
 
 static VkPipeline CreatePipeline(const VkDevice         device,
+                                 PipelineCache&         pipelineCache,
                                  const VkPipelineLayout pipelineLayout,
                                  const VkFormat         colorFormat,
                                  const VkShaderModule   shaderVertex,
@@ -168,7 +169,7 @@ static VkPipeline CreatePipeline(const VkDevice         device,
     VkGraphicsPipelineCreateInfo pipelineCreateInfo = {
         .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext               = &renderingInfo,
-        .flags               = 0,
+        .flags               = DescriptorBuffer::PipelineCreateFlags(device),
         .stageCount          = 2,
         .pStages             = shaders,
         .pVertexInputState   = &vertexInputInfo,
@@ -188,7 +189,7 @@ static VkPipeline CreatePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &pipeline);
     (void)result;
 
     return pipeline;
@@ -212,23 +213,25 @@ bool PostProcessPass::Create(Context& context) {
         },
     };
 
-    VkDescriptorSetLayout descSetLayout = context.descriptorPool().createLayout(layoutBindingsBase);
+    m_descSetLayout = context.descriptorPool().createLayout(layoutBindingsBase);
 
-    m_pipelineLayout = CreatePipelineLayout(device, {descSetLayout}, sizeof(PostProcessOptions));
+    m_pipelineLayout = CreatePipelineLayout(device, {m_descSetLayout}, sizeof(PostProcessOptions));
     {
         VkShaderModule shaders[] = {
             CreateShaderModule(device, SPV_post_process_vert, sizeof(SPV_post_process_vert)),
             CreateShaderModule(device, SPV_post_process_frag, sizeof(SPV_post_process_frag)),
         };
 
-        m_pipeline = CreatePipeline(device, m_pipelineLayout, m_colorFormat, shaders[0], shaders[1]);
+        m_pipeline =
+            CreatePipeline(device, context.pipelineCache(), m_pipelineLayout, m_colorFormat, shaders[0], shaders[1]);
 
         vkDestroyShaderModule(device, shaders[0], nullptr);
         vkDestroyShaderModule(device, shaders[1], nullptr);
 
     }
 
-    m_descSet = context.descriptorPool().createSet(descSetLayout);
+    m_descSet          = context.descriptorPool().createSet(m_descSetLayout);
+    m_descriptorBuffer = context.descriptorBuffer();
 
     return VK_SUCCESS;
 }
@@ -283,8 +286,8 @@ void PostProcessPass::BeginPass(const VkCommandBuffer cmdBuffer, VkImageView col
     vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
     vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descSet, 0,
-                            nullptr);
+    CmdBindDescriptorSets(m_descriptorBuffer, cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                          &m_descSet);
     vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(PostProcessOptions), &options);
 }
 
@@ -297,7 +300,7 @@ void PostProcessPass::EndPass(const VkCommandBuffer cmdBuffer) {
 }
 
 void PostProcessPass::BindInputImage(const VkDevice device, const Texture& texture) {
-    DescriptorSetMgmt descSetMgmt(m_descSet);
+    DescriptorSetMgmt descSetMgmt(m_descSet, m_descSetLayout);
     descSetMgmt.SetImage(0, texture.view(), texture.sampler());
     descSetMgmt.Update(device);
 }
@@ -30,7 +30,9 @@ private:
     VkFormat            m_colorFormat       = {};
     VkExtent2D          m_extent            = {};
 
+    VkDescriptorSetLayout m_descSetLayout   = VK_NULL_HANDLE;
     VkDescriptorSet     m_descSet           = VK_NULL_HANDLE;
+    DescriptorBuffer*   m_descriptorBuffer  = nullptr; // owned by the context, nullptr with descriptor sets
     VkPipelineLayout    m_pipelineLayout    = VK_NULL_HANDLE;
     VkPipeline          m_pipeline          = VK_NULL_HANDLE;
 };
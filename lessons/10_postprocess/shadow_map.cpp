@@ -17,22 +17,29 @@ ShadowMap::ShadowMap(const VkFormat depthFormat, const uint32_t pushConstantStar
 {
 }
 
+void ShadowMap::DeclareAttachments(AttachmentPool& attachments, uint32_t passIdx, uint32_t lastReaderPassIdx)
+{
+    m_shadowDepth = attachments.Add("shadow depth", m_depthFormat, m_extent,
+                                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, passIdx,
+                                    lastReaderPassIdx);
+}
+
 bool ShadowMap::Create(Context& context)
 {
-    VkPhysicalDevice phyDevice = context.physicalDevice();
-    VkDevice         device    = context.device();
+    VkDevice device = context.device();
 
-    m_shadowDepth = Texture::Create2D(phyDevice, device, m_depthFormat, m_extent,
-                                      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    assert(m_shadowDepth.IsValid());
+    assert(m_shadowDepth != nullptr && m_shadowDepth->IsValid() && "AttachmentPool must be built before Create");
 
-    m_pipelineLayout = CreatePipelineLayout(device, {}, m_pushConstantStart + sizeof(glm::mat4));
-    BuildPipeline(device, m_pipelineLayout);
+    // Same push constant range as the object layouts (model matrix and material index), so their pushes stay valid
+    m_pipelineLayout = CreatePipelineLayout(device, {}, m_pushConstantStart + sizeof(glm::mat4) + sizeof(uint32_t));
+    BuildPipeline(device, context.pipelineCache(), m_pipelineLayout);
 
     return true;
 }
 
-bool ShadowMap::BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout)
+bool ShadowMap::BuildPipeline(const VkDevice         device,
+                              PipelineCache&         pipelineCache,
+                              const VkPipelineLayout pipelineLayout)
 {
     VkShaderModule shaderVertex   = CreateShaderModule(device, SPV_shadow_map_vert, sizeof(SPV_shadow_map_vert));
     VkShaderModule shaderFragment = CreateShaderModule(device, SPV_shadow_map_frag, sizeof(SPV_shadow_map_frag));
@@ -246,7 +253,7 @@ bool ShadowMap::BuildPipeline(const VkDevice device, const VkPipelineLayout pipe
         .basePipelineIndex   = 0,
     };
 
-    VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_pipeline);
+    VkResult result = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &m_pipeline);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
@@ -257,7 +264,6 @@ bool ShadowMap::BuildPipeline(const VkDevice device, const VkPipelineLayout pipe
 void ShadowMap::Destroy(Context& context)
 {
     VkDevice device = context.device();
-    m_shadowDepth.Destroy(device);
     vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
     vkDestroyPipeline(device, m_pipeline, nullptr);
 }
@@ -275,7 +281,7 @@ void ShadowMap::TransitionForRender(const VkCommandBuffer cmdBuffer)
         .newLayout           = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image               = m_shadowDepth.image(),
+        .image               = m_shadowDepth->image(),
         .subresourceRange =
             {
                 .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
@@ -312,7 +318,7 @@ void ShadowMap::TransitionForRead(const VkCommandBuffer cmdBuffer)
         .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image               = m_shadowDepth.image(),
+        .image               = m_shadowDepth->image(),
         .subresourceRange =
             {
                 .aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT,
@@ -345,7 +351,7 @@ void ShadowMap::BeginPass(const VkCommandBuffer cmdBuffer)
     const VkRenderingAttachmentInfoKHR depthAttachment = {
         .sType              = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
         .pNext              = nullptr,
-        .imageView          = m_shadowDepth.view(),
+        .imageView          = m_shadowDepth->view(),
         .imageLayout        = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
         .resolveMode        = VK_RESOLVE_MODE_NONE,
         .resolveImageView   = VK_NULL_HANDLE,
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan_core.h>
 
 #include "glm_config.h"
+#include "attachment_pool.h"
 #include "context.h"
 #include "texture.h"
 
@@ -16,19 +17,22 @@ class ShadowMap {
 public:
     ShadowMap(const VkFormat depthFormat, const uint32_t pushConstantStart, VkExtent2D extent);
 
+    // Declares the shadow depth used from passIdx up to lastReaderPassIdx, call before Create
+    void DeclareAttachments(AttachmentPool& attachments, uint32_t passIdx, uint32_t lastReaderPassIdx);
+
     bool Create(Context& context);
     void Destroy(Context& context);
     void BeginPass(const VkCommandBuffer cmdBuffer);
     void EndPass(const VkCommandBuffer cmdBuffer);
 
-    bool BuildPipeline(const VkDevice device, const VkPipelineLayout pipelineLayout);
+    bool BuildPipeline(const VkDevice device, PipelineCache& pipelineCache, const VkPipelineLayout pipelineLayout);
 
     VkExtent2D Extent() const { return m_extent; }
     uint32_t   Width() const { return m_extent.width; }
     uint32_t   Height() const { return m_extent.height; }
 
     VkPipeline Pipeline() const { return m_pipeline; }
-    Texture&   Depth() { return m_shadowDepth; }
+    Texture&   Depth() { return *m_shadowDepth; }
 
     void updateLightInfo(const VkCommandBuffer cmdBuffer, DirectionalLight& lightInfo);
 
@@ -42,5 +46,5 @@ private:
     VkPipelineLayout m_pipelineLayout    = VK_NULL_HANDLE;
     VkPipeline       m_pipeline          = VK_NULL_HANDLE;
     uint32_t         m_pushConstantStart = 0;
-    Texture          m_shadowDepth;
+    Texture*         m_shadowDepth       = nullptr; // owned by the AttachmentPool
 };
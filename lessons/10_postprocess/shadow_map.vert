@@ -28,6 +28,7 @@ layout(push_constant) uniform PushConstants {
     vec4 lightPosition; // ignored
     // model spec
     mat4 model;
+    uint materialIdx;
 } constants;
 
 void main() {
@@ -45,7 +45,7 @@ VkPipelineLayout CreateEmptyPipelineLayout(const VkDevice device, uint32_t pushC
     return layout;
 }
 
-VkPipeline CreateSimplePipeline(const VkDevice         device,
+VkPipeline CreateSimplePipeline(PipelineCache&         pipelineCache,
                                 const VkFormat         colorFormat,
                                 const VkPipelineLayout pipelineLayout,
                                 const VkShaderModule   shaderVertex,
@@ -250,7 +250,7 @@ VkPipeline CreateSimplePipeline(const VkDevice         device,
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    VkResult   result   = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+    VkResult   result   = pipelineCache.CreateGraphicsPipeline(pipelineCreateInfo, &pipeline);
     assert(result == VK_SUCCESS);
 
     return pipeline;
@@ -264,7 +264,7 @@ SimpleCube::SimpleCube()
 {
 }
 
-VkResult SimpleCube::Create(const Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart)
+VkResult SimpleCube::Create(Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart)
 {
     const VkDevice       device       = context.device();
     const VkShaderModule shaderVertex = CreateShaderModule(device, SPV_triangle_in_vert, sizeof(SPV_triangle_in_vert));
@@ -273,16 +273,21 @@ VkResult SimpleCube::Create(const Context& context, const VkFormat colorFormat,
 
     m_constantOffset = pushConstantStart;
     m_pipelineLayout = CreateEmptyPipelineLayout(device, m_constantOffset + sizeof(ModelPushConstant));
-    m_pipeline       = CreateSimplePipeline(device, colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
+    m_pipeline = CreateSimplePipeline(context.pipelineCache(), colorFormat, m_pipelineLayout, shaderVertex, shaderFragment);
 
     vkDestroyShaderModule(device, shaderVertex, nullptr);
     vkDestroyShaderModule(device, shaderFragment, nullptr);
 
-    m_buffer = BufferInfo::Create(context.physicalDevice(), device, sizeof(g_cubeVertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-    m_buffer.Update(device, g_cubeVertices, sizeof(g_cubeVertices));
+    m_buffer = BufferInfo::CreateStatic(context.physicalDevice(), device, context.uploads(), g_cubeVertices,
+                                        sizeof(g_cubeVertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
     m_vertexCount = g_cubeVertexCount;
 
+    // Untextured: the lighting pass shades the cube with the base color of its material
+    if (context.HasBindless()) {
+        m_materialIdx = context.bindless().AddMaterial({.baseColor = glm::vec4(1.0f)});
+    }
+
     return VK_SUCCESS;
 }
 
@@ -296,7 +301,8 @@ void SimpleCube::Destroy(const VkDevice device)
 void SimpleCube::Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline)
 {
     ModelPushConstant modelData = {
-        .model = glm::mat4(1.0f) * m_position * m_rotation,
+        .model       = glm::mat4(1.0f) * m_position * m_rotation,
+        .materialIdx = m_materialIdx,
     };
 
     if (bindPipeline) {
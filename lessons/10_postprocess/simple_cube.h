@@ -12,11 +12,12 @@ class SimpleCube {
 public:
     struct ModelPushConstant {
         glm::mat4 model;
+        uint32_t  materialIdx; // into the bindless material table
     };
 
     SimpleCube();
 
-    VkResult Create(const Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart);
+    VkResult Create(Context& context, const VkFormat colorFormat, const uint32_t pushConstantStart);
     void     Destroy(const VkDevice device);
     void     Draw(const VkCommandBuffer cmdBuffer, bool bindPipeline = true);
 
@@ -31,4 +32,5 @@ private:
     uint32_t         m_vertexCount    = 0;
     glm::mat4        m_position       = glm::mat4(1.0f);
     glm::mat4        m_rotation       = glm::mat4(1.0f);
+    uint32_t         m_materialIdx    = 0;
 };
@@ -16,6 +16,7 @@ layout(push_constant) uniform PushConstants {
     mat4 view;
     vec4 lightPosition;
     mat4 model;
+    uint materialIdx;
 } constants;
 
 void main() {
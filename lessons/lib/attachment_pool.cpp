@@ -0,0 +1,195 @@
+#include "attachment_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+namespace {
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // anonymous namespace
+
+Texture* AttachmentPool::Add(const std::string& name,
+                             const VkFormat     format,
+                             VkExtent2D         extent,
+                             VkImageUsageFlags  usage,
+                             uint32_t           firstPass,
+                             uint32_t           lastPass)
+{
+    assert(firstPass <= lastPass);
+
+    Entry entry;
+    entry.name      = name;
+    entry.texture   = std::make_unique<Texture>();
+    entry.format    = format;
+    entry.extent    = extent;
+    entry.usage     = usage;
+    entry.firstPass = firstPass;
+    entry.lastPass  = lastPass;
+
+    m_entries.push_back(std::move(entry));
+
+    return m_entries.back().texture.get();
+}
+
+bool AttachmentPool::Overlaps(const Entry& lhs, const Entry& rhs)
+{
+    return lhs.firstPass <= rhs.lastPass && rhs.firstPass <= lhs.lastPass;
+}
+
+VkDeviceSize AttachmentPool::PlaceAliased(std::vector<Entry*>& placed, Entry& entry) const
+{
+    // 'placed' is sorted by offset: take the first gap between the attachments that are alive
+    // at the same time which is large enough.
+    VkDeviceSize offset = 0;
+    for (const Entry* other : placed) {
+        if (!Overlaps(*other, entry)) {
+            continue;
+        }
+
+        if (AlignUp(offset, entry.requirements.alignment) + entry.requirements.size <= other->offset) {
+            break;
+        }
+
+        offset = std::max(offset, other->offset + other->requirements.size);
+    }
+
+    entry.offset = AlignUp(offset, entry.requirements.alignment);
+
+    const auto it = std::upper_bound(placed.begin(), placed.end(), &entry,
+                                     [](const Entry* lhs, const Entry* rhs) { return lhs->offset < rhs->offset; });
+    placed.insert(it, &entry);
+
+    return entry.offset + entry.requirements.size;
+}
+
+VkResult AttachmentPool::Build(const VkPhysicalDevice phyDevice, const VkDevice device)
+{
+    MemoryAllocator& allocator = MemoryAllocator::Get(phyDevice, device);
+    const bool       useLazy   = allocator.policy().HasLazilyAllocatedMemory();
+
+    std::vector<Entry*> aliasable;
+    uint32_t            memoryTypeBits = UINT32_MAX;
+    VkDeviceSize        alignment      = 1;
+
+    for (Entry& entry : m_entries) {
+        // Lazily allocated memory is only committed when the tile contents have to be spilled
+        if (useLazy && (entry.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)) {
+            *entry.texture = Texture::Create2D(phyDevice, device, entry.format, entry.extent, entry.usage);
+            if (!entry.texture->IsValid()) {
+                printf("[ERROR] AttachmentPool: failed to create '%s'\n", entry.name.c_str());
+                return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+            }
+
+            entry.requirements = entry.texture->MemoryRequirements(device);
+            entry.lazy         = true;
+            m_requiredBytes += entry.requirements.size;
+            continue;
+        }
+
+        *entry.texture = Texture::Create2DUnbound(device, entry.format, entry.extent, entry.usage);
+        if (!entry.texture->IsValid()) {
+            printf("[ERROR] AttachmentPool: failed to create '%s'\n", entry.name.c_str());
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        entry.requirements = entry.texture->MemoryRequirements(device);
+        memoryTypeBits &= entry.requirements.memoryTypeBits;
+        alignment = std::max(alignment, entry.requirements.alignment);
+        m_requiredBytes += entry.requirements.size;
+
+        aliasable.push_back(&entry);
+    }
+
+    if (aliasable.empty()) {
+        return VK_SUCCESS;
+    }
+
+    if (memoryTypeBits == 0) {
+        printf("[ERROR] AttachmentPool: the attachments have no common memory type\n");
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+
+    // Placing the big attachments first leaves the gaps for the small ones
+    std::sort(aliasable.begin(), aliasable.end(),
+              [](const Entry* lhs, const Entry* rhs) { return lhs->requirements.size > rhs->requirements.size; });
+
+    std::vector<Entry*> placed;
+    VkDeviceSize        totalSize = 0;
+    for (Entry* entry : aliasable) {
+        totalSize = std::max(totalSize, PlaceAliased(placed, *entry));
+    }
+
+    for (Entry* entry : aliasable) {
+        for (const Entry* other : aliasable) {
+            if (other != entry && entry->offset < other->offset + other->requirements.size
+                && other->offset < entry->offset + entry->requirements.size) {
+                entry->aliased = true;
+            }
+        }
+    }
+
+    const VkMemoryRequirements requirements = {
+        .size           = totalSize,
+        .alignment      = alignment,
+        .memoryTypeBits = memoryTypeBits,
+    };
+
+    VkResult result = allocator.AllocateMemory(requirements, MemoryUsage::GpuOnly, &m_memory, MemoryCategory::Attachment);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] AttachmentPool: failed to allocate %llu bytes\n", (unsigned long long)totalSize);
+        return result;
+    }
+
+    for (Entry* entry : aliasable) {
+        result = entry->texture->BindMemory(device, m_memory.memory, m_memory.offset + entry->offset);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+
+    m_allocatedBytes = totalSize;
+
+    return VK_SUCCESS;
+}
+
+void AttachmentPool::Destroy(const VkDevice device)
+{
+    for (Entry& entry : m_entries) {
+        if (entry.texture->IsValid()) {
+            entry.texture->Destroy(device);
+        }
+    }
+
+    if (MemoryAllocator* allocator = MemoryAllocator::Find(device)) {
+        allocator->Free(m_memory);
+    }
+
+    m_entries.clear();
+    m_memory         = {};
+    m_requiredBytes  = 0;
+    m_allocatedBytes = 0;
+}
+
+void AttachmentPool::PrintReport() const
+{
+    constexpr double MiB = 1024.0 * 1024.0;
+
+    printf("Attachments: %.2f MiB with separate allocations, %.2f MiB allocated, %.2f MiB saved per frame\n",
+           m_requiredBytes / MiB, m_allocatedBytes / MiB, SavedBytes() / MiB);
+
+    for (const Entry& entry : m_entries) {
+        printf("-> %s (%ux%u, %.2f MiB) passes %u-%u: ", entry.name.c_str(), entry.extent.width, entry.extent.height,
+               entry.requirements.size / MiB, entry.firstPass, entry.lastPass);
+
+        if (entry.lazy) {
+            printf("lazily allocated\n");
+        } else {
+            printf("offset %llu%s\n", (unsigned long long)entry.offset, entry.aliased ? ", aliased" : "");
+        }
+    }
+}
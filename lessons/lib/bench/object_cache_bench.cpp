@@ -0,0 +1,168 @@
+/**
+ * Descriptor set layout lookup benchmark: the ObjectCache keys against the string hash DescriptorPool used before.
+ *
+ * Usage: object_cache_bench [<lookup count>]
+ *
+ * Only the CPU side of a cache hit is measured, no device is created: building the key from the bindings,
+ * hashing it and finding the stored layout. The old lookup turned every binding into text and hashed the string,
+ * the new one hashes the create info in place and compares it field by field with the stored copy.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "object_cache.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t LAYOUT_COUNT = 64;
+
+// The previous DescriptorPool key, kept here as it was for the comparison
+size_t descriptorSetLayoutBindingVectorHash(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    std::string bindingsString = "";
+    for (const auto binding : bindings) {
+        bindingsString += std::to_string(binding.binding) + "," + std::to_string(binding.descriptorCount) + "," +
+                          std::to_string(binding.descriptorType) + "," +
+                          std::to_string(reinterpret_cast<uint64_t>(binding.pImmutableSamplers)) + ",";
+    }
+    return std::hash<std::string>()(bindingsString);
+}
+
+// Layouts shaped like the ones of the apps: uniform buffers, textures with and without immutable samplers,
+// storage buffers, 1 to 6 bindings
+std::vector<std::vector<VkDescriptorSetLayoutBinding>> MakeLayouts(const std::vector<VkSampler>& samplers)
+{
+    const VkDescriptorType types[] = {
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+    };
+    const VkShaderStageFlags stages[] = {
+        VK_SHADER_STAGE_VERTEX_BIT,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    std::mt19937                                           random(1);
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> layouts;
+    while (layouts.size() < LAYOUT_COUNT) {
+        std::vector<VkDescriptorSetLayoutBinding> bindings(1 + random() % 6);
+        for (uint32_t idx = 0; idx < bindings.size(); idx++) {
+            const VkDescriptorType type = types[random() % std::size(types)];
+
+            bindings[idx] = {
+                .binding            = idx,
+                .descriptorType     = type,
+                .descriptorCount    = 1,
+                .stageFlags         = stages[random() % std::size(stages)],
+                .pImmutableSamplers = nullptr,
+            };
+            if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && random() % 2 == 0) {
+                bindings[idx].pImmutableSamplers = &samplers[random() % samplers.size()];
+            }
+        }
+
+        // The old key can not tell layouts apart that only differ in the stages, keep the comparison fair
+        bool duplicate = false;
+        for (const auto& layout : layouts) {
+            duplicate |= descriptorSetLayoutBindingVectorHash(layout) == descriptorSetLayoutBindingVectorHash(bindings);
+        }
+        if (!duplicate) {
+            layouts.push_back(std::move(bindings));
+        }
+    }
+
+    return layouts;
+}
+
+template <typename Lookup>
+double MeasureNs(const std::vector<uint32_t>& sequence, Lookup lookup, uint64_t* outChecksum)
+{
+    uint64_t checksum = 0;
+
+    const Clock::time_point start = Clock::now();
+    for (uint32_t layoutIdx : sequence) {
+        checksum += lookup(layoutIdx);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    *outChecksum = checksum;
+    return seconds * 1e9 / sequence.size();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    const uint32_t lookupCount = (argc > 1) ? (uint32_t)std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+    // Only the handle values are hashed and compared, they never reach a driver
+    std::vector<VkSampler> samplers;
+    for (uintptr_t idx = 1; idx <= 8; idx++) {
+        samplers.push_back((VkSampler)(idx * 0x1000));
+    }
+
+    const std::vector<std::vector<VkDescriptorSetLayoutBinding>> layouts = MakeLayouts(samplers);
+
+    using SetLayoutKey = ObjectCache::SetLayoutKey;
+    std::unordered_map<SetLayoutKey, uint32_t, ObjectCache::KeyHash, ObjectCache::KeyEqual> keyed;
+    std::unordered_map<size_t, uint32_t>                                                    hashed;
+    for (uint32_t idx = 0; idx < layouts.size(); idx++) {
+        const SetLayoutKey key = {
+            .flags        = 0,
+            .bindingCount = (uint32_t)layouts[idx].size(),
+            .bindings     = layouts[idx].data(),
+        };
+        keyed.emplace(key, idx);
+        hashed.emplace(descriptorSetLayoutBindingVectorHash(layouts[idx]), idx);
+    }
+
+    // Lookups with copies of the bindings, like callers building them per draw or per material
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> requests = layouts;
+
+    std::mt19937          random(2);
+    std::vector<uint32_t> sequence(lookupCount);
+    for (uint32_t& layoutIdx : sequence) {
+        layoutIdx = random() % LAYOUT_COUNT;
+    }
+
+    uint64_t expected = 0;
+    for (uint32_t layoutIdx : sequence) {
+        expected += layoutIdx;
+    }
+
+    uint64_t     stringChecksum = 0;
+    const double stringNs       = MeasureNs(sequence, [&](uint32_t layoutIdx) {
+        return hashed.find(descriptorSetLayoutBindingVectorHash(requests[layoutIdx]))->second;
+    }, &stringChecksum);
+
+    uint64_t     keyChecksum = 0;
+    const double keyNs       = MeasureNs(sequence, [&](uint32_t layoutIdx) {
+        const SetLayoutKey key = {
+            .flags        = 0,
+            .bindingCount = (uint32_t)requests[layoutIdx].size(),
+            .bindings     = requests[layoutIdx].data(),
+        };
+        return keyed.find(key)->second;
+    }, &keyChecksum);
+
+    if (stringChecksum != expected || keyChecksum != expected) {
+        printf("[ERROR] Lookups returned the wrong layouts\n");
+        return 1;
+    }
+
+    printf("%u lookups over %u layouts\n", lookupCount, LAYOUT_COUNT);
+    printf("  string hash (old)   %8.1f ns/lookup\n", stringNs);
+    printf("  KeyHash/KeyEqual    %8.1f ns/lookup (%.1fx)\n", keyNs, stringNs / keyNs);
+
+    return 0;
+}
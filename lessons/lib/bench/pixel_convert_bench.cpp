@@ -0,0 +1,163 @@
+/**
+ * Texture ingestion benchmark: decoding and converting images into texels, stb_image against the pixel_convert kernels.
+ *
+ * Usage: pixel_convert_bench <image> [<image> ...]
+ *
+ * "stb RGBA" is the old path: stb_image expands every pixel to RGBA while decoding and the texels are copied out.
+ * "native + convert" decodes with the channels of the file and builds the texels of the format with the kernels,
+ * once for each SIMD level the CPU has. The conversion is also measured on its own, without the decode.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "pixel_convert.h"
+#include "stb_image.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double MIN_SECONDS = 0.5;
+
+struct FormatCase {
+    const char* name;
+    VkFormat    format;
+};
+
+const FormatCase g_formats[] = {
+    {"R8G8B8A8_UNORM", VK_FORMAT_R8G8B8A8_UNORM},
+    {"B8G8R8A8_SRGB", VK_FORMAT_B8G8R8A8_SRGB},
+    {"R8G8_UNORM", VK_FORMAT_R8G8_UNORM},
+};
+
+const char* LevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::SSE41: return "SSE4.1";
+    case SimdLevel::Scalar: break;
+    }
+    return "scalar";
+}
+
+bool ReadFile(const char* path, std::vector<uint8_t>* outData)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    outData->resize((size_t)file.tellg());
+    file.seekg(0);
+
+    return (bool)file.read((char*)outData->data(), (std::streamsize)outData->size());
+}
+
+// Runs 'work' until MIN_SECONDS passed, returns the average milliseconds of one run
+double Measure(const std::function<void()>& work)
+{
+    work(); // warm up the caches and the allocator
+
+    const Clock::time_point start   = Clock::now();
+    uint32_t                runs    = 0;
+    double                  elapsed = 0.0;
+    do {
+        work();
+        runs++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < MIN_SECONDS);
+
+    return elapsed * 1000.0 / runs;
+}
+
+void PrintResult(const char* label, double ms, size_t pixelCount)
+{
+    printf("  %-32s %9.3f ms %9.1f Mpixel/s\n", label, ms, pixelCount / (ms * 1000.0));
+}
+
+void BenchImage(const char* path, const std::vector<SimdLevel>& levels)
+{
+    std::vector<uint8_t> source;
+    if (!ReadFile(path, &source)) {
+        printf("[ERROR] Failed to load image: %s\n", path);
+        return;
+    }
+
+    int32_t  width    = 0;
+    int32_t  height   = 0;
+    int32_t  channels = 0;
+    uint8_t* decoded  = stbi_load_from_memory(source.data(), (int)source.size(), &width, &height, &channels, 0);
+    if (decoded == nullptr) {
+        printf("[ERROR] Failed to decode image: %s\n", path);
+        return;
+    }
+
+    const size_t pixelCount = (size_t)width * height;
+    printf("%s (%dx%d, %d channels)\n", path, width, height, channels);
+
+    std::vector<uint8_t> texels(pixelCount * 4);
+
+    const double stbMs = Measure([&]() {
+        int32_t  w = 0, h = 0, c = 0;
+        uint8_t* rgba = stbi_load_from_memory(source.data(), (int)source.size(), &w, &h, &c, 4);
+        std::copy(rgba, rgba + pixelCount * 4, texels.data());
+        stbi_image_free(rgba);
+    });
+    PrintResult("stb RGBA", stbMs, pixelCount);
+
+    for (const FormatCase& format : g_formats) {
+        const PixelConversion conversion = ChoosePixelConversion(format.format);
+        printf(" %s\n", format.name);
+
+        for (SimdLevel level : levels) {
+            SetPixelConvertSimdLevel(level);
+
+            char label[64];
+            snprintf(label, sizeof(label), "native + convert (%s)", LevelName(level));
+            const double decodeMs = Measure([&]() {
+                int32_t  w = 0, h = 0, c = 0;
+                uint8_t* pixels = stbi_load_from_memory(source.data(), (int)source.size(), &w, &h, &c, 0);
+                ConvertPixels(conversion, pixels, (uint32_t)c, texels.data(), pixelCount);
+                stbi_image_free(pixels);
+            });
+            PrintResult(label, decodeMs, pixelCount);
+
+            snprintf(label, sizeof(label), "convert only (%s)", LevelName(level));
+            const double convertMs = Measure([&]() {
+                ConvertPixels(conversion, decoded, (uint32_t)channels, texels.data(), pixelCount);
+            });
+            PrintResult(label, convertMs, pixelCount);
+        }
+    }
+
+    stbi_image_free(decoded);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("Usage: %s <image> [<image> ...]\n", argv[0]);
+        return 1;
+    }
+
+    const SimdLevel supported = SetPixelConvertSimdLevel(SimdLevel::AVX2);
+
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2}) {
+        if (level <= supported) {
+            levels.push_back(level);
+        }
+    }
+
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        BenchImage(argv[argIdx], levels);
+    }
+
+    return 0;
+}
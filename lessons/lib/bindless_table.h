@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+
+#include <vulkan/vulkan_core.h>
+
+#include "glm_config.h"
+#include "buffer.h"
+#include "descriptor_buffer.h"
+
+/**
+ * Bindless descriptor table: every texture and material of the device in a single descriptor set.
+ *
+ * Binding 0 is a large array of combined image samplers (VK_EXT_descriptor_indexing, core in 1.2),
+ * binding 1 a storage buffer with one Material per entry. Draws select their material with an index
+ * passed in the push constants, shaders look up the texture of the material:
+ *
+ *     layout(set = 0, binding = 0) uniform sampler2D textures[];
+ *     layout(set = 0, binding = 1) readonly buffer Materials { Material materials[]; };
+ *     ... texture(textures[nonuniformEXT(materials[idx].textureIdx)], uv)
+ *
+ * The set is bound once per pass instead of once per draw, and as every draw uses the same set
+ * draws of different objects can be merged or issued indirectly.
+ *
+ * The texture array is partially bound and update after bind: slots not used by a pending
+ * command buffer can be added or replaced at any time, the set never has to be rebound.
+ * Materials live in host visible memory, change them only while no frame using them is in flight.
+ *
+ * With the DescriptorBuffer backend the set is a range of the descriptor buffer, written in place: the
+ * update after bind rules do not apply there, a slot may be written as long as no pending draw reads it.
+ */
+class BindlessTable {
+public:
+    static constexpr uint32_t TEXTURE_BINDING  = 0;
+    static constexpr uint32_t MATERIAL_BINDING = 1;
+
+    static constexpr uint32_t DEFAULT_MAX_TEXTURES  = 1024;
+    static constexpr uint32_t DEFAULT_MAX_MATERIALS = 256;
+
+    // Material without a texture, the shaders use the base color alone
+    static constexpr uint32_t NO_TEXTURE = UINT32_MAX;
+
+    // Same layout as the std430 Material struct in the shaders
+    struct Material {
+        glm::vec4 baseColor  = glm::vec4(1.0f);
+        uint32_t  textureIdx = NO_TEXTURE;
+        uint32_t  padding[3] = {};
+    };
+
+    // Checks the descriptor indexing features of the device and sets the ones the table needs in 'enable'.
+    // Returns false (and leaves 'enable' unchanged) when one of them is missing.
+    static bool EnableFeatures(const VkPhysicalDevice phyDevice, VkPhysicalDeviceVulkan12Features* enable);
+
+    VkResult Create(const VkPhysicalDevice phyDevice,
+                    const VkDevice         device,
+                    uint32_t               maxTextures  = DEFAULT_MAX_TEXTURES,
+                    uint32_t               maxMaterials = DEFAULT_MAX_MATERIALS);
+    void     Destroy();
+
+    bool IsValid() const { return m_set != VK_NULL_HANDLE; }
+
+    // Returns the slot of the view/sampler pair, pairs already in the table share their slot.
+    // NO_TEXTURE when the table is full.
+    uint32_t AddTexture(const VkImageView view, const VkSampler sampler);
+    // Points an existing slot to a new view (e.g. after the streamer changed the resident levels),
+    // every material using the slot sees the new view
+    void     SetTexture(uint32_t textureIdx, const VkImageView view, const VkSampler sampler);
+
+    // Returns the index of the new material, UINT32_MAX when the table is full
+    uint32_t AddMaterial(const Material& material);
+    void     SetMaterial(uint32_t materialIdx, const Material& material);
+
+    // Binds the table as set 'setIdx'. Pipeline layouts with the table layout at the same index keep it bound.
+    void Bind(const VkCommandBuffer cmdBuffer, const VkPipelineLayout pipelineLayout, uint32_t setIdx = 0) const;
+
+    VkDescriptorSetLayout layout() const { return m_layout; }
+    VkDescriptorSet       set() const { return m_set; }
+    uint32_t              TextureCount() const { return m_textureCount; }
+    uint32_t              MaterialCount() const { return m_materialCount; }
+
+private:
+    void WriteTexture(uint32_t textureIdx, const VkImageView view, const VkSampler sampler);
+
+    VkDevice              m_device = VK_NULL_HANDLE;
+    VkDescriptorPool      m_pool   = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorSet       m_set    = VK_NULL_HANDLE;
+
+    DescriptorBuffer*       m_descriptorBuffer = nullptr; // the set lives in 'm_range' of it when not nullptr
+    DescriptorBuffer::Range m_range;
+
+    uint32_t   m_maxTextures   = 0;
+    uint32_t   m_textureCount  = 0;
+    uint32_t   m_maxMaterials  = 0;
+    uint32_t   m_materialCount = 0;
+    BufferInfo m_materials     = {};
+
+    std::map<std::pair<VkImageView, VkSampler>, uint32_t> m_textureSlots;
+};
@@ -3,29 +3,34 @@
 #include <cassert>
 #include <cstring>
 
-static uint32_t FindMemoryTypeIndex(const VkPhysicalDevice phyDevice, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags) {
-    VkPhysicalDeviceMemoryProperties memoryProperties = {};
-    vkGetPhysicalDeviceMemoryProperties(phyDevice, &memoryProperties);
-
-    for (uint32_t idx = 0; idx < memoryProperties.memoryTypeCount; idx++) {
-        if (requirements.memoryTypeBits & (1 << idx)) {
-            const VkMemoryType& memoryType = memoryProperties.memoryTypes[idx];
-            // TODO: add size check?
-
-            if (memoryType.propertyFlags & flags) {
-                return idx;
-            }
-        }
-    }
+#include "descriptor_buffer.h"
+#include "upload_manager.h"
+
+namespace {
+
+// Buffers read through descriptors, the descriptor buffer backend needs their device address
+constexpr VkBufferUsageFlags DESCRIPTOR_USAGE = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
 
-    return (uint32_t)-1;
+DescriptorBuffer* FindDescriptorBuffer(const VkDevice device, VkBufferUsageFlags usageFlags)
+{
+    return (usageFlags & DESCRIPTOR_USAGE) ? DescriptorBuffer::Find(device) : nullptr;
 }
 
+} // anonymous namespace
+
 BufferInfo BufferInfo::Create(
     const VkPhysicalDevice  phyDevice,
     const VkDevice          device,
     VkDeviceSize            size,
-    VkBufferUsageFlags      usageFlags) {
+    VkBufferUsageFlags      usageFlags,
+    MemoryUsage             memoryUsage) {
+
+    assert(memoryUsage != MemoryUsage::GpuOnly && "Use CreateStatic for device only buffers");
+
+    DescriptorBuffer* descriptorBuffer = FindDescriptorBuffer(device, usageFlags);
+    if (descriptorBuffer != nullptr) {
+        usageFlags |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    }
 
     VkBufferCreateInfo createInfo = {
         .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -43,36 +48,74 @@ BufferInfo BufferInfo::Create(
     vkCreateBuffer(device, &createInfo, nullptr, &result.buffer);
     // TODO: error check
 
-    VkMemoryRequirements requirements = {};
-    vkGetBufferMemoryRequirements(device, result.buffer, &requirements);
+    VkResult allocateResult = MemoryAllocator::Get(phyDevice, device)
+                                  .AllocateForBuffer(result.buffer, memoryUsage, &result.allocation,
+                                                     MemoryCategoryFromBufferUsage(usageFlags));
+    assert(allocateResult == VK_SUCCESS);
+
+    result.size = size;
 
-    const uint32_t memoryTypeIdx = FindMemoryTypeIndex(phyDevice, requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    // TODO: check for error
+    if (descriptorBuffer != nullptr) {
+        descriptorBuffer->RegisterBuffer(result.buffer, size);
+    }
+
+    return result;
+}
+
+BufferInfo BufferInfo::CreateStatic(
+    const VkPhysicalDevice  phyDevice,
+    const VkDevice          device,
+    UploadManager&          uploads,
+    const void*             data,
+    VkDeviceSize            size,
+    VkBufferUsageFlags      usageFlags) {
 
-    VkMemoryAllocateInfo allocInfo = {
-        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext           = 0,
-        .allocationSize  = requirements.size,
-        .memoryTypeIndex = memoryTypeIdx,
+    DescriptorBuffer* descriptorBuffer = FindDescriptorBuffer(device, usageFlags);
+    if (descriptorBuffer != nullptr) {
+        usageFlags |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    }
+
+    VkBufferCreateInfo createInfo = {
+        .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext                 = nullptr,
+        .flags                 = 0,
+        .size                  = size,
+        .usage                 = usageFlags | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = nullptr,
     };
 
-    VkResult allocateResult = vkAllocateMemory(device, &allocInfo, nullptr, &result.memory);
+    BufferInfo result = { };
+
+    VkResult createResult = vkCreateBuffer(device, &createInfo, nullptr, &result.buffer);
+    assert(createResult == VK_SUCCESS);
+
+    VkResult allocateResult = MemoryAllocator::Get(phyDevice, device)
+                                  .AllocateForBuffer(result.buffer, MemoryUsage::GpuOnly, &result.allocation,
+                                                     MemoryCategoryFromBufferUsage(usageFlags));
     assert(allocateResult == VK_SUCCESS);
 
-    vkBindBufferMemory(device, result.buffer, result.memory, 0);
+    result.size = size;
+
+    if (descriptorBuffer != nullptr) {
+        descriptorBuffer->RegisterBuffer(result.buffer, size);
+    }
+
+    uploads.UploadBuffer(result.buffer, data, size);
 
     return result;
 }
 
 void* BufferInfo::Map(const VkDevice device) {
-    void* GPUPtr = nullptr;
-    vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &GPUPtr);
+    // Host visible memory is persistently mapped by the allocator
+    assert(allocation.mapped != nullptr);
 
-    return GPUPtr;
+    return allocation.mapped;
 }
 
 void BufferInfo::Unmap(const VkDevice device) {
-    vkUnmapMemory(device, memory);
+    MemoryAllocator::Find(device)->Flush(allocation);
 }
 
 void BufferInfo::Update(const VkDevice device, const void* inputPtr, size_t size) {
@@ -84,6 +127,10 @@ void BufferInfo::Update(const VkDevice device, const void* inputPtr, size_t size
 }
 
 void BufferInfo::Destroy(const VkDevice device) {
+    if (DescriptorBuffer* descriptorBuffer = DescriptorBuffer::Find(device)) {
+        descriptorBuffer->UnregisterBuffer(buffer);
+    }
+
     vkDestroyBuffer(device, buffer, nullptr);
-    vkFreeMemory(device, memory, nullptr);
+    MemoryAllocator::Find(device)->Free(allocation);
 }
@@ -6,7 +6,22 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include "bindless_table.h"
+#include "descriptor_allocator.h"
+#include "descriptor_buffer.h"
 #include "descriptors.h"
+#include "memory_type_policy.h"
+#include "pipeline_cache.h"
+#include "push_descriptors.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
+#include "texture_streamer.h"
+#include "upload_manager.h"
+
+enum class DescriptorBackend {
+    Sets,   // descriptor pools and sets
+    Buffer, // VK_EXT_descriptor_buffer, see DescriptorBuffer
+};
 
 class Context {
 public:
@@ -20,11 +35,25 @@ public:
     Context(const Context& otherCtx) = delete;
     Context(Context&& otherCtx)      = delete;
 
+    // The descriptor buffer backend is used when requested before CreateDevice and supported by the device.
+    // Every set of the application must then go through the lib (DescriptorPool, DescriptorAllocator,
+    // PushDescriptors, BindlessTable) and be bound with CmdBindDescriptorSets.
+    void             RequestDescriptorBackend(DescriptorBackend backend) { m_requestedDescriptorBackend = backend; }
+    // Called before CreateDevice by applications drawing only through the bindless table: CreateDevice then fails
+    // on devices without descriptor indexing instead of creating the device without the table.
+    void             RequireBindless() { m_requireBindless = true; }
+
     VkInstance       CreateInstance(const std::vector<const char*>& layers, const std::vector<const char*>& extensions);
     VkPhysicalDevice SelectPhysicalDevice(const VkSurfaceKHR surface);
+    // VK_NULL_HANDLE when a required feature is not supported
     VkDevice         CreateDevice(const std::vector<const char*>& extensions);
     VkCommandPool    CreateCommandPool();
     DescriptorPool   CreateDescriptorPool(const std::unordered_map<VkDescriptorType, uint32_t>& countPerType, uint32_t maxSets);
+    // Per frame descriptor sets, reset by FrameDescriptorAllocator::BeginFrame
+    FrameDescriptorAllocator& CreateFrameDescriptors(uint32_t frameCount);
+
+    // Submits all uploads queued on uploads() and waits for them to finish
+    VkResult         FlushUploads();
 
     void             Destroy();
 
@@ -33,11 +62,39 @@ public:
     VkDevice         device() const { return m_device; }
     uint32_t         queueFamilyIdx() const { return m_queueFamilyIdx; }
     VkQueue          queue() const { return m_queue; }
+    // Transfer queue, same as queue() when the device has no separate transfer capable family
+    uint32_t         transferQueueFamilyIdx() const { return m_transferQueueFamilyIdx; }
+    VkQueue          transferQueue() const { return m_transferQueue; }
+    bool             HasDedicatedTransferQueue() const { return m_transferQueueFamilyIdx != m_queueFamilyIdx; }
     VkCommandPool    commandPool() const { return m_commandPool; }
     DescriptorPool&  descriptorPool() { return m_descriptorPool; }
+    FrameDescriptorAllocator& frameDescriptors() { return m_frameDescriptors; }
+    // Pushed sets, allocated from frameDescriptors() when VK_KHR_push_descriptor is not supported
+    PushDescriptors& pushDescriptors() { return m_pushDescriptors; }
+    // Backend selected by CreateDevice, descriptorBuffer() is nullptr with descriptor sets
+    DescriptorBackend descriptorBackend() const
+    {
+        return (m_descriptorBuffer != nullptr) ? DescriptorBackend::Buffer : DescriptorBackend::Sets;
+    }
+    DescriptorBuffer* descriptorBuffer() const { return m_descriptorBuffer; }
+    // Shared by every pipeline of the application, loaded from and saved to '<app name>.pipeline_cache' next to
+    // the executable
+    PipelineCache&   pipelineCache() { return m_pipelineCache; }
+    const PipelineCache& pipelineCache() const { return m_pipelineCache; }
+    UploadManager&   uploads() { return m_uploads; }
+    TextureLoader&   textureLoader() { return m_textureLoader; }
+    TextureCache&    textureCache() { return m_textureCache; }
+    TextureStreamer& textureStreamer() { return m_textureStreamer; }
+    // Bindless texture and material table, only valid when the device supports descriptor indexing
+    bool             HasBindless() const { return m_bindless.IsValid(); }
+    BindlessTable&   bindless() { return m_bindless; }
+    // Memory type selection of the device, valid after CreateDevice
+    const MemoryTypePolicy& memoryPolicy() const;
 
 protected:
-    bool FindQueueFamily(const VkPhysicalDevice phyDevice, const VkSurfaceKHR surface, uint32_t* outQueueFamilyIdx);
+    bool     FindQueueFamily(const VkPhysicalDevice phyDevice, const VkSurfaceKHR surface, uint32_t* outQueueFamilyIdx);
+    uint32_t FindTransferQueueFamily(const VkPhysicalDevice phyDevice, uint32_t graphicsQueueFamilyIdx);
+    bool     IsDeviceExtensionSupported(const VkPhysicalDevice phyDevice, const char* extensionName);
 
     const std::string m_appName;
     const bool        m_useValidation;
@@ -48,6 +105,21 @@ protected:
     uint32_t         m_queueFamilyIdx = -1;
     VkQueue          m_queue          = VK_NULL_HANDLE;
 
+    uint32_t         m_transferQueueFamilyIdx = -1;
+    VkQueue          m_transferQueue          = VK_NULL_HANDLE;
+
+    DescriptorBackend m_requestedDescriptorBackend = DescriptorBackend::Sets;
+    bool              m_requireBindless            = false;
+    DescriptorBuffer* m_descriptorBuffer           = nullptr; // owned by DescriptorBuffer, per device
+
     VkCommandPool    m_commandPool    = VK_NULL_HANDLE;
     DescriptorPool   m_descriptorPool = {};
+    FrameDescriptorAllocator m_frameDescriptors;
+    PushDescriptors  m_pushDescriptors;
+    PipelineCache    m_pipelineCache;
+    UploadManager    m_uploads;
+    TextureLoader    m_textureLoader;
+    TextureCache     m_textureCache;
+    TextureStreamer  m_textureStreamer;
+    BindlessTable    m_bindless;
 };
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "descriptor_buffer.h"
+#include "object_cache.h"
+
+/**
+ * Descriptor set allocator on a growing chain of descriptor pools.
+ *
+ * Sets come from the current pool until it reports VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL,
+ * then the allocation is retried from the next pool, which is created when there is none left. The first pool
+ * is sized from the expected descriptors per set given to Create, later pools from the usage seen so far: the
+ * layouts of the ObjectCache report what their sets hold, other layouts are assumed to match the expectation.
+ * Every new pool holds twice the sets of the previous one, up to MAX_SETS_PER_POOL.
+ *
+ * Sets are not freed one by one: Reset() returns every set to the pools with vkResetDescriptorPool, the pools
+ * are kept and reused in order.
+ *
+ * When the device uses the descriptor buffer backend the pools are ranges of the DescriptorBuffer instead,
+ * sized in bytes the same way, and a set is the next layout sized piece of the current range.
+ */
+class DescriptorAllocator {
+public:
+    static constexpr uint32_t DEFAULT_SETS_PER_POOL = 64;
+    static constexpr uint32_t MAX_SETS_PER_POOL     = 4096;
+
+    struct Stats {
+        uint64_t setsAllocated     = 0; // since Create
+        uint32_t setsSinceReset    = 0;
+        uint32_t poolCount         = 0;
+        uint32_t growthEvents      = 0; // pools created because the previous ones were full
+        uint32_t failedAllocations = 0;
+    };
+
+    VkResult Create(const VkDevice              device,
+                    const DescriptorTypeCounts& countsPerSet,
+                    uint32_t                    setsPerPool = DEFAULT_SETS_PER_POOL,
+                    VkDescriptorPoolCreateFlags flags       = 0);
+    void     Destroy();
+
+    // VK_NULL_HANDLE when not even a new pool can hold the set
+    VkDescriptorSet Allocate(const VkDescriptorSetLayout layout);
+
+    // Returns every set to the pools, the device must be done with them
+    void Reset();
+
+    bool         IsValid() const { return !m_pools.empty() || !m_chunks.empty(); }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    // Range of the descriptor buffer standing in for a pool
+    struct Chunk {
+        DescriptorBuffer::Range range;
+        VkDeviceSize            used = 0;
+    };
+
+    VkResult        CreatePool(const DescriptorTypeCounts& required);
+    VkResult        CreateChunk(VkDeviceSize requiredBytes);
+    VkDescriptorSet AllocateFromBuffer(const VkDescriptorSetLayout layout);
+
+    VkDevice                    m_device         = VK_NULL_HANDLE;
+    VkDescriptorPoolCreateFlags m_flags          = 0;
+    DescriptorTypeCounts        m_expectedCounts = {};
+    uint32_t                    m_nextPoolSets   = DEFAULT_SETS_PER_POOL;
+
+    // Descriptors of each type and sets requested so far, the base of the next pool's size
+    std::array<uint64_t, CORE_DESCRIPTOR_TYPE_COUNT> m_usedCounts = {};
+    uint64_t                                         m_usedBytes  = 0; // descriptor buffer only
+    uint64_t                                         m_usedSets   = 0;
+
+    DescriptorBuffer*             m_descriptorBuffer = nullptr; // owned by the device, nullptr with pools
+    std::vector<VkDescriptorPool> m_pools;
+    std::vector<Chunk>            m_chunks;
+    uint32_t                      m_currentPool = 0; // pools before this one are full until the next Reset
+
+    Stats m_stats;
+};
+
+/**
+ * Descriptor sets written and used within a single frame: one DescriptorAllocator per frame in flight.
+ *
+ * BeginFrame() moves to the next frame and resets its pools, so the caller must make sure the fence of the
+ * frame that used them last has signaled.
+ */
+class FrameDescriptorAllocator {
+public:
+    VkResult Create(const VkDevice              device,
+                    uint32_t                    frameCount,
+                    const DescriptorTypeCounts& countsPerSet,
+                    uint32_t                    setsPerPool = DescriptorAllocator::DEFAULT_SETS_PER_POOL);
+    void     Destroy();
+
+    void BeginFrame();
+
+    VkDescriptorSet Allocate(const VkDescriptorSetLayout layout) { return m_frames[m_frameIdx].Allocate(layout); }
+
+    bool     IsValid() const { return !m_frames.empty(); }
+    uint32_t frameCount() const { return (uint32_t)m_frames.size(); }
+
+    uint32_t SetsThisFrame() const { return m_frames[m_frameIdx].GetStats().setsSinceReset; }
+    uint32_t SetsLastFrame() const { return m_lastFrameSets; }
+    uint32_t HighWaterMark() const { return m_highWaterMark; }
+    // Summed over the frames
+    uint32_t PoolCount() const;
+    uint32_t GrowthEvents() const;
+
+private:
+    std::vector<DescriptorAllocator> m_frames;
+    uint32_t                         m_frameIdx      = 0;
+    uint32_t                         m_lastFrameSets = 0;
+    uint32_t                         m_highWaterMark = 0;
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "buffer.h"
+#include "object_cache.h"
+#include "tlsf.h"
+
+/**
+ * Descriptor backend on VK_EXT_descriptor_buffer: descriptors are written with vkGetDescriptorEXT straight into
+ * a host visible buffer and sets are bound by their offset in it. There are no pools and no set objects.
+ *
+ * A "set" of this backend is a range of the buffer holding one set of its layout. To keep the DescriptorPool,
+ * DescriptorAllocator and DescriptorSetMgmt interfaces unchanged the range is handed out as a VkDescriptorSet
+ * encoding its offset (see SetHandle). These handles are only understood by this class: they must be bound
+ * with CmdBindDescriptorSets below and written through DescriptorSetMgmt, never passed to Vulkan.
+ *
+ * Set layouts need LayoutCreateFlags() and must come from the ObjectCache (the binding types and counts are
+ * looked up there), pipelines using them need PipelineCreateFlags(). Buffers referenced by uniform or storage
+ * buffer descriptors are registered by BufferInfo, the descriptors carry their device address.
+ *
+ * Like the ObjectCache there is one per device, created by the Context when the backend is selected.
+ */
+class DescriptorBuffer {
+public:
+    static constexpr VkDeviceSize DEFAULT_SIZE   = 4ull * 1024 * 1024;
+    static constexpr uint32_t     MAX_BOUND_SETS = 8; // sets per CmdBindSets call
+
+    struct Range {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size   = 0;
+        uint32_t     node   = TLSFAllocator::INVALID_NODE;
+    };
+
+    struct Stats {
+        VkDeviceSize size             = 0;
+        VkDeviceSize usedBytes        = 0; // bytes handed out as ranges
+        uint32_t     rangeCount       = 0;
+        uint64_t     descriptorWrites = 0;
+    };
+
+    // Checks the descriptor buffer features of the device (with buffer device addresses) and sets the ones the
+    // backend needs in 'enable' and 'enable12'. Push descriptors are enabled along when the device supports them
+    // with descriptor buffers. Returns false (and leaves both unchanged) when one of them is missing.
+    static bool EnableFeatures(const VkPhysicalDevice                      phyDevice,
+                               VkPhysicalDeviceDescriptorBufferFeaturesEXT* enable,
+                               VkPhysicalDeviceVulkan12Features*            enable12);
+
+    // Creates the descriptor buffer of the device, nullptr on failure
+    static DescriptorBuffer* Create(const VkPhysicalDevice phyDevice,
+                                    const VkDevice         device,
+                                    VkDeviceSize           size = DEFAULT_SIZE);
+    // Returns the descriptor buffer of the device or nullptr when the device uses descriptor sets.
+    static DescriptorBuffer* Find(const VkDevice device);
+    // Frees the buffer, every range must have been returned. Must be called before the memory allocator is
+    // destroyed.
+    static void Destroy(const VkDevice device);
+
+    // Flags for the set layouts and pipelines of the device: the descriptor buffer bits with this backend,
+    // 0 with descriptor sets
+    static VkDescriptorSetLayoutCreateFlags LayoutCreateFlags(const VkDevice device);
+    static VkPipelineCreateFlags            PipelineCreateFlags(const VkDevice device);
+
+    // Set handle of the range starting at 'offset' and back, VK_NULL_HANDLE is never a valid set
+    static VkDescriptorSet SetHandle(VkDeviceSize offset) { return (VkDescriptorSet)(uintptr_t)(offset + 1); }
+    static VkDeviceSize    SetOffset(const VkDescriptorSet set) { return (VkDeviceSize)(uintptr_t)set - 1; }
+
+    DescriptorBuffer(const VkPhysicalDevice phyDevice, const VkDevice device);
+    ~DescriptorBuffer();
+
+    // Disable copy and move constructors
+    DescriptorBuffer(const DescriptorBuffer&) = delete;
+    DescriptorBuffer(DescriptorBuffer&&)      = delete;
+
+    // Aligned for set offsets. false when the buffer is full.
+    bool AllocateRange(VkDeviceSize size, Range* outRange);
+    void FreeRange(const Range& range);
+
+    // Bytes of one set of the layout, aligned for set offsets. 0 when the layout is unknown to the ObjectCache.
+    VkDeviceSize LayoutSize(const VkDescriptorSetLayout layout);
+    // Bytes of a set holding the given descriptors, for sizing ranges before the layouts are known
+    VkDeviceSize EstimateSetSize(const DescriptorTypeCounts& counts) const;
+    VkDeviceSize DescriptorSize(VkDescriptorType type) const;
+
+    // Writes one descriptor of a set, buffers must have been registered
+    void Write(const VkDescriptorSet       set,
+               const VkDescriptorSetLayout layout,
+               uint32_t                    binding,
+               uint32_t                    arrayElement,
+               VkDescriptorType            type,
+               const DescriptorInfo&       info);
+
+    void RegisterBuffer(const VkBuffer buffer, VkDeviceSize size);
+    void UnregisterBuffer(const VkBuffer buffer);
+
+    // Binds the descriptor buffer and points the sets at their offsets
+    void CmdBindSets(const VkCommandBuffer     cmdBuffer,
+                     const VkPipelineBindPoint bindPoint,
+                     const VkPipelineLayout    pipelineLayout,
+                     uint32_t                  firstSet,
+                     uint32_t                  setCount,
+                     const VkDescriptorSet*    sets);
+
+    Stats GetStats() const;
+    void  PrintStats() const;
+
+private:
+    struct BindingInfo {
+        uint32_t         binding;
+        VkDescriptorType type;
+        uint32_t         count;
+        VkDeviceSize     offset; // from the start of the set
+    };
+
+    struct LayoutInfo {
+        VkDeviceSize             size = 0;
+        std::vector<BindingInfo> bindings;
+    };
+
+    struct BufferAddress {
+        VkDeviceAddress address;
+        VkDeviceSize    size;
+    };
+
+    bool Init(VkDeviceSize size);
+
+    // Must be called with m_mutex held. nullptr when the layout is unknown to the ObjectCache.
+    const LayoutInfo* FindLayout(const VkDescriptorSetLayout layout);
+
+    const VkPhysicalDevice m_phyDevice;
+    const VkDevice         m_device;
+
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT m_properties = {};
+
+    PFN_vkGetDescriptorSetLayoutSizeEXT          m_getLayoutSize       = nullptr;
+    PFN_vkGetDescriptorSetLayoutBindingOffsetEXT m_getBindingOffset    = nullptr;
+    PFN_vkGetDescriptorEXT                       m_getDescriptor       = nullptr;
+    PFN_vkCmdBindDescriptorBuffersEXT            m_cmdBindBuffers      = nullptr;
+    PFN_vkCmdSetDescriptorBufferOffsetsEXT       m_cmdSetBufferOffsets = nullptr;
+
+    BufferInfo      m_buffer  = {};
+    uint8_t*        m_mapped  = nullptr;
+    VkDeviceAddress m_address = 0;
+
+    mutable std::mutex m_mutex;
+    TLSFAllocator      m_ranges;
+
+    std::unordered_map<VkDescriptorSetLayout, LayoutInfo> m_layouts;
+    std::unordered_map<VkBuffer, BufferAddress>           m_bufferAddresses;
+
+    uint64_t m_descriptorWrites = 0;
+};
+
+// vkCmdBindDescriptorSets for either descriptor backend, 'descriptorBuffer' is nullptr when the device uses sets
+inline void CmdBindDescriptorSets(DescriptorBuffer*         descriptorBuffer,
+                                  const VkCommandBuffer     cmdBuffer,
+                                  const VkPipelineBindPoint bindPoint,
+                                  const VkPipelineLayout    pipelineLayout,
+                                  uint32_t                  firstSet,
+                                  uint32_t                  setCount,
+                                  const VkDescriptorSet*    sets)
+{
+    if (descriptorBuffer != nullptr) {
+        descriptorBuffer->CmdBindSets(cmdBuffer, bindPoint, pipelineLayout, firstSet, setCount, sets);
+    } else {
+        vkCmdBindDescriptorSets(cmdBuffer, bindPoint, pipelineLayout, firstSet, setCount, sets, 0, nullptr);
+    }
+}
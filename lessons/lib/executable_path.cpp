@@ -0,0 +1,35 @@
+#include "executable_path.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+static std::filesystem::path ExecutablePath()
+{
+#ifdef _WIN32
+    wchar_t     path[MAX_PATH] = {};
+    const DWORD length         = GetModuleFileNameW(nullptr, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) {
+        return {};
+    }
+
+    return std::filesystem::path(path);
+#else
+    std::error_code error;
+    return std::filesystem::read_symlink("/proc/self/exe", error);
+#endif
+}
+
+std::string ExecutableRelativePath(const std::string& name)
+{
+    const std::filesystem::path executable = ExecutablePath();
+    if (executable.empty()) {
+        return name;
+    }
+
+    return (executable.parent_path() / name).string();
+}
@@ -18,6 +18,9 @@ public:
     void NewFrame();
     void Draw(const VkCommandBuffer cmdBuffer);
 
+    // Per heap/category GPU memory usage window, call between ImGui::NewFrame and ImGui::Render
+    void MemoryWindow(const Context& context);
+
     void Destroy(const Context& context);
 
 protected:
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * The pages are loaded on first access by the OS, so reading a file through the mapping
+ * avoids the extra copy of a read() into a heap buffer.
+ */
+class MappedFile {
+public:
+    // Returns nullptr when the file can not be opened or is empty
+    static std::shared_ptr<MappedFile> Open(const std::string& path);
+
+    ~MappedFile();
+
+    // Disable copy and move constructors
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&)      = delete;
+
+    const uint8_t* data() const { return m_data; }
+    size_t         size() const { return m_size; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* m_data = nullptr;
+    size_t         m_size = 0;
+#ifdef _WIN32
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,659 @@
+#include "memory_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <unordered_map>
+
+namespace {
+
+std::mutex                                                      g_allocatorsMutex;
+std::unordered_map<VkDevice, std::unique_ptr<MemoryAllocator>> g_allocators;
+
+} // anonymous namespace
+
+const char* MemoryCategoryName(MemoryCategory category)
+{
+    switch (category) {
+    case MemoryCategory::Vertex:     return "Vertex";
+    case MemoryCategory::Index:      return "Index";
+    case MemoryCategory::Uniform:    return "Uniform";
+    case MemoryCategory::Staging:    return "Staging";
+    case MemoryCategory::Texture:    return "Texture";
+    case MemoryCategory::Attachment: return "Attachment";
+    default:                         return "Other";
+    }
+}
+
+MemoryCategory MemoryCategoryFromBufferUsage(VkBufferUsageFlags usage)
+{
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        return MemoryCategory::Vertex;
+    }
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        return MemoryCategory::Index;
+    }
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        return MemoryCategory::Uniform;
+    }
+    if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+        return MemoryCategory::Staging;
+    }
+
+    return MemoryCategory::Other;
+}
+
+MemoryCategory MemoryCategoryFromImageUsage(VkImageUsageFlags usage)
+{
+    const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                                            | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                                            | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+    return (usage & attachmentUsage) ? MemoryCategory::Attachment : MemoryCategory::Texture;
+}
+
+MemoryAllocator& MemoryAllocator::Get(const VkPhysicalDevice phyDevice, const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_allocatorsMutex);
+
+    std::unique_ptr<MemoryAllocator>& allocator = g_allocators[device];
+    if (!allocator) {
+        allocator = std::make_unique<MemoryAllocator>(phyDevice, device);
+    }
+
+    return *allocator;
+}
+
+MemoryAllocator* MemoryAllocator::Find(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_allocatorsMutex);
+
+    const auto it = g_allocators.find(device);
+    return (it != g_allocators.end()) ? it->second.get() : nullptr;
+}
+
+void MemoryAllocator::Destroy(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_allocatorsMutex);
+
+    const auto it = g_allocators.find(device);
+    if (it == g_allocators.end()) {
+        return;
+    }
+
+    it->second->ReleaseMemory();
+    g_allocators.erase(it);
+}
+
+MemoryAllocator::MemoryAllocator(const VkPhysicalDevice phyDevice, const VkDevice device, VkDeviceSize blockSize)
+    : m_phyDevice(phyDevice)
+    , m_device(device)
+    , m_blockSize(blockSize)
+{
+    vkGetPhysicalDeviceMemoryProperties(m_phyDevice, &m_memoryProperties);
+    m_policy = MemoryTypePolicy(m_memoryProperties);
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(m_phyDevice, &properties);
+    m_granularity     = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+    m_nonCoherentAtom = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    // Two pools per memory type: one for linear and one for non-linear resources
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+    for (uint32_t idx = 0; idx < m_pools.size(); idx++) {
+        m_pools[idx].memoryTypeIdx = idx / 2;
+    }
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    // Allocators still registered at exit would free their memory on an already destroyed device
+    assert(m_pools.empty() && "MemoryAllocator::Destroy must be called before the device is destroyed");
+}
+
+void MemoryAllocator::ReleaseMemory()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t leakedCount = 0;
+
+    for (Pool& pool : m_pools) {
+        for (std::unique_ptr<Block>& block : pool.blocks) {
+            if (!block) {
+                continue;
+            }
+
+            leakedCount += block->suballocator.AllocationCount();
+            vkFreeMemory(m_device, block->memory, nullptr);
+        }
+    }
+
+    for (const VkDeviceMemory memory : m_dedicatedMemory) {
+        leakedCount++;
+        vkFreeMemory(m_device, memory, nullptr);
+    }
+
+    if (leakedCount > 0) {
+        printf("[WARNING] MemoryAllocator: %u allocation(s) were not freed\n", leakedCount);
+    }
+
+    m_pools.clear();
+    m_dedicatedMemory.clear();
+}
+
+uint32_t MemoryAllocator::PoolIndex(uint32_t memoryTypeIdx, ResourceKind kind) const
+{
+    // With a granularity of one linear and non-linear resources can safely share a block
+    if (m_granularity <= 1) {
+        return memoryTypeIdx * 2;
+    }
+
+    return memoryTypeIdx * 2 + (uint32_t)kind;
+}
+
+VkDeviceSize MemoryAllocator::PreferredBlockSize(uint32_t memoryTypeIdx) const
+{
+    const uint32_t     heapIdx  = m_memoryProperties.memoryTypes[memoryTypeIdx].heapIndex;
+    const VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[heapIdx].size;
+
+    // Small heaps (ex.: the 256MiB BAR heap) should not be eaten up by a few blocks
+    return std::min(m_blockSize, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+}
+
+void* MemoryAllocator::MapMemory(const VkDeviceMemory memory, uint32_t memoryTypeIdx)
+{
+    if ((m_memoryProperties.memoryTypes[memoryTypeIdx].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) {
+        return nullptr;
+    }
+
+    void*    mapped = nullptr;
+    VkResult result = vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    assert(result == VK_SUCCESS);
+    (void)result;
+
+    return mapped;
+}
+
+void MemoryAllocator::RecordAllocation(const MemoryAllocation& allocation)
+{
+    UsageStats& typeUsage     = m_typeUsage[allocation.memoryTypeIdx][(uint32_t)allocation.category];
+    UsageStats& categoryUsage = m_categoryUsage[(uint32_t)allocation.category];
+
+    for (UsageStats* usage : {&typeUsage, &categoryUsage}) {
+        usage->allocationCount++;
+        usage->bytes     += allocation.size;
+        usage->peakBytes = std::max(usage->peakBytes, usage->bytes);
+    }
+}
+
+void MemoryAllocator::RecordFree(const MemoryAllocation& allocation)
+{
+    UsageStats& typeUsage     = m_typeUsage[allocation.memoryTypeIdx][(uint32_t)allocation.category];
+    UsageStats& categoryUsage = m_categoryUsage[(uint32_t)allocation.category];
+
+    for (UsageStats* usage : {&typeUsage, &categoryUsage}) {
+        assert(usage->allocationCount > 0 && usage->bytes >= allocation.size);
+        usage->allocationCount--;
+        usage->bytes -= allocation.size;
+    }
+}
+
+VkResult MemoryAllocator::CreateBlock(uint32_t poolIdx, VkDeviceSize size)
+{
+    Pool& pool = m_pools[poolIdx];
+
+    const VkMemoryAllocateFlagsInfo flagsInfo = {
+        .sType      = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+        .pNext      = nullptr,
+        .flags      = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+        .deviceMask = 0,
+    };
+
+    const VkMemoryAllocateInfo allocInfo = {
+        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext           = m_hasBufferDeviceAddress ? &flagsInfo : nullptr,
+        .allocationSize  = size,
+        .memoryTypeIndex = pool.memoryTypeIdx,
+    };
+
+    std::unique_ptr<Block> block = std::make_unique<Block>();
+
+    VkResult result = vkAllocateMemory(m_device, &allocInfo, nullptr, &block->memory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    block->mapped = MapMemory(block->memory, pool.memoryTypeIdx);
+    block->suballocator.Reset(size);
+
+    // Reuse a released slot so the block indices stored in allocations stay stable
+    const auto freeSlot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+    if (freeSlot != pool.blocks.end()) {
+        *freeSlot = std::move(block);
+    } else {
+        pool.blocks.push_back(std::move(block));
+    }
+
+    return VK_SUCCESS;
+}
+
+bool MemoryAllocator::AllocateFromPool(uint32_t                    poolIdx,
+                                       const VkMemoryRequirements& requirements,
+                                       MemoryAllocation*           outAllocation)
+{
+    Pool& pool = m_pools[poolIdx];
+
+    for (uint32_t blockIdx = 0; blockIdx < pool.blocks.size(); blockIdx++) {
+        Block* block = pool.blocks[blockIdx].get();
+        if (block == nullptr) {
+            continue;
+        }
+
+        TLSFAllocator::Allocation range;
+        if (!block->suballocator.Allocate(requirements.size, requirements.alignment, &range)) {
+            continue;
+        }
+
+        outAllocation->memory        = block->memory;
+        outAllocation->offset        = range.offset;
+        outAllocation->size          = range.size;
+        outAllocation->mapped        = block->mapped ? (uint8_t*)block->mapped + range.offset : nullptr;
+        outAllocation->memoryTypeIdx = pool.memoryTypeIdx;
+        outAllocation->poolIdx       = poolIdx;
+        outAllocation->blockIdx      = blockIdx;
+        outAllocation->node          = range.node;
+        return true;
+    }
+
+    return false;
+}
+
+VkResult MemoryAllocator::AllocateDedicated(const VkMemoryRequirements& requirements,
+                                            uint32_t                    memoryTypeIdx,
+                                            const VkBuffer              buffer,
+                                            const VkImage               image,
+                                            MemoryAllocation*           outAllocation)
+{
+    const VkMemoryAllocateFlagsInfo flagsInfo = {
+        .sType      = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+        .pNext      = nullptr,
+        .flags      = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+        .deviceMask = 0,
+    };
+    const void* flagsNext = m_hasBufferDeviceAddress ? &flagsInfo : nullptr;
+
+    const VkMemoryDedicatedAllocateInfo dedicatedInfo = {
+        .sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+        .pNext  = flagsNext,
+        .image  = image,
+        .buffer = buffer,
+    };
+
+    const VkMemoryAllocateInfo allocInfo = {
+        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext           = (buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE) ? &dedicatedInfo : flagsNext,
+        .allocationSize  = requirements.size,
+        .memoryTypeIndex = memoryTypeIdx,
+    };
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkResult       result = vkAllocateMemory(m_device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    outAllocation->memory        = memory;
+    outAllocation->offset        = 0;
+    outAllocation->size          = requirements.size;
+    outAllocation->mapped        = MapMemory(memory, memoryTypeIdx);
+    outAllocation->memoryTypeIdx = memoryTypeIdx;
+    outAllocation->poolIdx       = MemoryAllocation::DEDICATED;
+    outAllocation->blockIdx      = MemoryAllocation::DEDICATED;
+    outAllocation->node          = TLSFAllocator::INVALID_NODE;
+
+    m_dedicatedCount[memoryTypeIdx]++;
+    m_dedicatedBytes[memoryTypeIdx] += requirements.size;
+    m_dedicatedMemory.insert(memory);
+
+    return VK_SUCCESS;
+}
+
+VkResult MemoryAllocator::Allocate(const VkMemoryRequirements& requirements,
+                                   MemoryUsage                 usage,
+                                   ResourceKind                kind,
+                                   const VkBuffer              dedicatedBuffer,
+                                   const VkImage               dedicatedImage,
+                                   MemoryAllocation*           outAllocation)
+{
+    const uint32_t memoryTypeIdx = m_policy.FindMemoryType(requirements.memoryTypeBits, usage, requirements.size);
+    if (memoryTypeIdx == MemoryTypePolicy::INVALID_TYPE) {
+        printf("[ERROR] MemoryAllocator: no memory type found for usage %u (type bits 0x%x)\n", (uint32_t)usage,
+               requirements.memoryTypeBits);
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const VkDeviceSize blockSize = PreferredBlockSize(memoryTypeIdx);
+
+    // Big resources would only fragment the blocks, give them their own memory
+    if (requirements.size >= blockSize / 2) {
+        return AllocateDedicated(requirements, memoryTypeIdx, dedicatedBuffer, dedicatedImage, outAllocation);
+    }
+
+    const uint32_t poolIdx = PoolIndex(memoryTypeIdx, kind);
+    if (AllocateFromPool(poolIdx, requirements, outAllocation)) {
+        return VK_SUCCESS;
+    }
+
+    // No space in the existing blocks, try a new one. On failure retry with smaller blocks.
+    for (VkDeviceSize newBlockSize = blockSize; newBlockSize >= requirements.size * 2; newBlockSize /= 2) {
+        if (CreateBlock(poolIdx, newBlockSize) == VK_SUCCESS) {
+            const bool allocated = AllocateFromPool(poolIdx, requirements, outAllocation);
+            assert(allocated);
+            (void)allocated;
+            return VK_SUCCESS;
+        }
+    }
+
+    return AllocateDedicated(requirements, memoryTypeIdx, dedicatedBuffer, dedicatedImage, outAllocation);
+}
+
+VkResult MemoryAllocator::AllocateForBuffer(const VkBuffer        buffer,
+                                            MemoryUsage           usage,
+                                            MemoryAllocation*     outAllocation,
+                                            MemoryCategory        category)
+{
+    VkMemoryRequirements requirements = {};
+    vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+
+    VkResult result = Allocate(requirements, usage, ResourceKind::Linear, buffer, VK_NULL_HANDLE, outAllocation);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    outAllocation->category = category;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        RecordAllocation(*outAllocation);
+    }
+
+    result = vkBindBufferMemory(m_device, buffer, outAllocation->memory, outAllocation->offset);
+    if (result != VK_SUCCESS) {
+        Free(*outAllocation);
+        *outAllocation = {};
+    }
+
+    return result;
+}
+
+VkResult MemoryAllocator::AllocateForImage(const VkImage         image,
+                                           MemoryUsage           usage,
+                                           MemoryAllocation*     outAllocation,
+                                           MemoryCategory        category)
+{
+    VkMemoryRequirements requirements = {};
+    vkGetImageMemoryRequirements(m_device, image, &requirements);
+
+    VkResult result = Allocate(requirements, usage, ResourceKind::NonLinear, VK_NULL_HANDLE, image, outAllocation);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    outAllocation->category = category;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        RecordAllocation(*outAllocation);
+    }
+
+    result = vkBindImageMemory(m_device, image, outAllocation->memory, outAllocation->offset);
+    if (result != VK_SUCCESS) {
+        Free(*outAllocation);
+        *outAllocation = {};
+    }
+
+    return result;
+}
+
+VkResult MemoryAllocator::AllocateMemory(const VkMemoryRequirements& requirements,
+                                         MemoryUsage                 usage,
+                                         MemoryAllocation*           outAllocation,
+                                         MemoryCategory              category)
+{
+    VkResult result =
+        Allocate(requirements, usage, ResourceKind::NonLinear, VK_NULL_HANDLE, VK_NULL_HANDLE, outAllocation);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    outAllocation->category = category;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RecordAllocation(*outAllocation);
+
+    return VK_SUCCESS;
+}
+
+void MemoryAllocator::Free(const MemoryAllocation& allocation)
+{
+    if (!allocation.IsValid()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    RecordFree(allocation);
+
+    if (allocation.IsDedicated()) {
+        vkFreeMemory(m_device, allocation.memory, nullptr);
+        m_dedicatedCount[allocation.memoryTypeIdx]--;
+        m_dedicatedBytes[allocation.memoryTypeIdx] -= allocation.size;
+        m_dedicatedMemory.erase(allocation.memory);
+        return;
+    }
+
+    Pool&                   pool  = m_pools[allocation.poolIdx];
+    std::unique_ptr<Block>& block = pool.blocks[allocation.blockIdx];
+    assert(block && block->memory == allocation.memory);
+
+    block->suballocator.Free(allocation.node);
+
+    if (!block->suballocator.IsEmpty()) {
+        return;
+    }
+
+    // Keep one empty block around to avoid allocate/free churn, release the rest
+    const size_t emptyCount = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+                                            [](const std::unique_ptr<Block>& it) { return it && it->suballocator.IsEmpty(); });
+    if (emptyCount > 1) {
+        vkFreeMemory(m_device, block->memory, nullptr);
+        block.reset();
+    }
+}
+
+void MemoryAllocator::Flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    const VkMemoryPropertyFlags flags = m_memoryProperties.memoryTypes[allocation.memoryTypeIdx].propertyFlags;
+    if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+        return;
+    }
+
+    if (size == VK_WHOLE_SIZE) {
+        size = allocation.size - offset;
+    }
+
+    // A dedicated allocation is the whole memory object
+    VkDeviceSize memorySize = allocation.size;
+    if (!allocation.IsDedicated()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        memorySize = m_pools[allocation.poolIdx].blocks[allocation.blockIdx]->suballocator.Size();
+    }
+
+    // The flushed range must be aligned to nonCoherentAtomSize
+    const VkDeviceSize start = (allocation.offset + offset) / m_nonCoherentAtom * m_nonCoherentAtom;
+    const VkDeviceSize end   = (allocation.offset + offset + size + m_nonCoherentAtom - 1) / m_nonCoherentAtom
+                           * m_nonCoherentAtom;
+
+    // Rounded up the range can run past the end of the memory, VK_WHOLE_SIZE stops exactly there
+    const VkMappedMemoryRange range = {
+        .sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .pNext  = nullptr,
+        .memory = allocation.memory,
+        .offset = start,
+        .size   = (end >= memorySize) ? VK_WHOLE_SIZE : end - start,
+    };
+
+    vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+std::vector<MemoryAllocator::HeapStats> MemoryAllocator::GetHeapStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<HeapStats> stats(m_memoryProperties.memoryHeapCount);
+    std::vector<uint64_t>  freeBytes(stats.size(), 0);
+    std::vector<uint64_t>  largestFree(stats.size(), 0);
+
+    for (uint32_t heapIdx = 0; heapIdx < stats.size(); heapIdx++) {
+        stats[heapIdx].heapSize = m_memoryProperties.memoryHeaps[heapIdx].size;
+    }
+
+    for (const Pool& pool : m_pools) {
+        const uint32_t heapIdx = m_memoryProperties.memoryTypes[pool.memoryTypeIdx].heapIndex;
+        HeapStats&     heap    = stats[heapIdx];
+
+        for (const std::unique_ptr<Block>& block : pool.blocks) {
+            if (!block) {
+                continue;
+            }
+
+            heap.blockCount++;
+            heap.allocationCount += block->suballocator.AllocationCount();
+            heap.reservedBytes += block->suballocator.Size();
+            heap.usedBytes += block->suballocator.UsedBytes();
+
+            freeBytes[heapIdx] += block->suballocator.FreeBytes();
+            largestFree[heapIdx] = std::max(largestFree[heapIdx], block->suballocator.LargestFreeRegion());
+        }
+    }
+
+    for (uint32_t typeIdx = 0; typeIdx < m_memoryProperties.memoryTypeCount; typeIdx++) {
+        HeapStats& heap = stats[m_memoryProperties.memoryTypes[typeIdx].heapIndex];
+
+        heap.dedicatedCount += m_dedicatedCount[typeIdx];
+        heap.allocationCount += m_dedicatedCount[typeIdx];
+        heap.reservedBytes += m_dedicatedBytes[typeIdx];
+        heap.usedBytes += m_dedicatedBytes[typeIdx];
+    }
+
+    for (uint32_t typeIdx = 0; typeIdx < m_memoryProperties.memoryTypeCount; typeIdx++) {
+        HeapStats& heap = stats[m_memoryProperties.memoryTypes[typeIdx].heapIndex];
+
+        for (uint32_t categoryIdx = 0; categoryIdx < MEMORY_CATEGORY_COUNT; categoryIdx++) {
+            heap.categoryBytes[categoryIdx] += m_typeUsage[typeIdx][categoryIdx].bytes;
+        }
+    }
+
+    for (uint32_t heapIdx = 0; heapIdx < stats.size(); heapIdx++) {
+        if (freeBytes[heapIdx] > 0) {
+            stats[heapIdx].fragmentation = 1.0f - (float)largestFree[heapIdx] / (float)freeBytes[heapIdx];
+        }
+    }
+
+    if (m_hasMemoryBudget) {
+        // Output structs: only the chain is set, the driver fills the rest
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+        budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        budget.pNext = nullptr;
+
+        VkPhysicalDeviceMemoryProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budget;
+
+        // The budget changes over time (other applications, driver allocations), query it every time
+        vkGetPhysicalDeviceMemoryProperties2(m_phyDevice, &properties);
+
+        for (uint32_t heapIdx = 0; heapIdx < stats.size(); heapIdx++) {
+            stats[heapIdx].budgetBytes = budget.heapBudget[heapIdx];
+            stats[heapIdx].budgetUsage = budget.heapUsage[heapIdx];
+        }
+    }
+
+    return stats;
+}
+
+std::vector<MemoryAllocator::TypeStats> MemoryAllocator::GetTypeStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<TypeStats> stats(m_memoryProperties.memoryTypeCount);
+    for (uint32_t typeIdx = 0; typeIdx < stats.size(); typeIdx++) {
+        TypeStats& type    = stats[typeIdx];
+        type.propertyFlags = m_memoryProperties.memoryTypes[typeIdx].propertyFlags;
+        type.heapIdx       = m_memoryProperties.memoryTypes[typeIdx].heapIndex;
+
+        for (uint32_t categoryIdx = 0; categoryIdx < MEMORY_CATEGORY_COUNT; categoryIdx++) {
+            const UsageStats& usage = m_typeUsage[typeIdx][categoryIdx];
+
+            type.allocationCount += usage.allocationCount;
+            type.usedBytes += usage.bytes;
+            type.categoryBytes[categoryIdx] = usage.bytes;
+        }
+    }
+
+    return stats;
+}
+
+MemoryAllocator::UsageStats MemoryAllocator::GetCategoryStats(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_categoryUsage[(uint32_t)category];
+}
+
+uint32_t MemoryAllocator::DeviceMemoryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t count = 0;
+    for (const Pool& pool : m_pools) {
+        count += (uint32_t)std::count_if(pool.blocks.begin(), pool.blocks.end(),
+                                         [](const std::unique_ptr<Block>& it) { return it != nullptr; });
+    }
+
+    for (uint32_t idx = 0; idx < VK_MAX_MEMORY_TYPES; idx++) {
+        count += m_dedicatedCount[idx];
+    }
+
+    return count;
+}
+
+void MemoryAllocator::PrintStats() const
+{
+    const std::vector<HeapStats> stats = GetHeapStats();
+
+    printf("Memory allocator: %u VkDeviceMemory object(s)\n", DeviceMemoryCount());
+    for (uint32_t heapIdx = 0; heapIdx < stats.size(); heapIdx++) {
+        const HeapStats& heap = stats[heapIdx];
+        printf("-> Heap %u (%.1f MiB): %u allocation(s) in %u block(s) + %u dedicated, "
+               "%.2f / %.2f MiB used, fragmentation %.2f\n",
+               heapIdx, heap.heapSize / (1024.0 * 1024.0), heap.allocationCount - heap.dedicatedCount, heap.blockCount,
+               heap.dedicatedCount, heap.usedBytes / (1024.0 * 1024.0), heap.reservedBytes / (1024.0 * 1024.0),
+               heap.fragmentation);
+
+        if (m_hasMemoryBudget) {
+            printf("   budget: %.2f / %.2f MiB\n", heap.budgetUsage / (1024.0 * 1024.0),
+                   heap.budgetBytes / (1024.0 * 1024.0));
+        }
+    }
+
+    for (uint32_t categoryIdx = 0; categoryIdx < MEMORY_CATEGORY_COUNT; categoryIdx++) {
+        const UsageStats usage = GetCategoryStats((MemoryCategory)categoryIdx);
+        if (usage.peakBytes == 0) {
+            continue;
+        }
+
+        printf("-> %s: %u allocation(s), %.2f MiB (peak %.2f MiB)\n", MemoryCategoryName((MemoryCategory)categoryIdx),
+               usage.allocationCount, usage.bytes / (1024.0 * 1024.0), usage.peakBytes / (1024.0 * 1024.0));
+    }
+}
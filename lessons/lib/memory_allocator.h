@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "memory_type_policy.h"
+#include "tlsf.h"
+
+// What the memory is used for, only used for the statistics
+enum class MemoryCategory : uint32_t {
+    Vertex = 0,
+    Index,
+    Uniform,
+    Staging,
+    Texture,
+    Attachment,
+    Other,
+
+    Count,
+};
+
+constexpr uint32_t MEMORY_CATEGORY_COUNT = (uint32_t)MemoryCategory::Count;
+
+const char*    MemoryCategoryName(MemoryCategory category);
+MemoryCategory MemoryCategoryFromBufferUsage(VkBufferUsageFlags usage);
+MemoryCategory MemoryCategoryFromImageUsage(VkImageUsageFlags usage);
+
+struct MemoryAllocation {
+    static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+    VkDeviceMemory memory        = VK_NULL_HANDLE;
+    VkDeviceSize   offset        = 0;
+    VkDeviceSize   size          = 0;
+    void*          mapped        = nullptr;
+    uint32_t       memoryTypeIdx = UINT32_MAX;
+    uint32_t       poolIdx       = DEDICATED;
+    uint32_t       blockIdx      = DEDICATED;
+    uint32_t       node          = TLSFAllocator::INVALID_NODE;
+    MemoryCategory category      = MemoryCategory::Other;
+
+    bool IsValid() const { return memory != VK_NULL_HANDLE; }
+    bool IsDedicated() const { return poolIdx == DEDICATED; }
+};
+
+/**
+ * Block based device memory allocator.
+ *
+ * Memory is requested from the driver in large blocks per memory type and buffers/images
+ * are placed into these blocks via a TLSF sub-allocator. Large resources (at least half a block)
+ * get a dedicated VkDeviceMemory instead.
+ *
+ * Buffers and optimal tiling images are kept in separate blocks when the device reports
+ * a bufferImageGranularity larger than one, so neighbouring linear and non-linear resources
+ * can never share a granularity "page".
+ *
+ * Memory types are picked by the MemoryTypePolicy from the MemoryUsage of the resource.
+ *
+ * Host visible blocks are mapped once at creation, allocations get a pointer into that mapping.
+ *
+ * Every allocation is counted per memory type and category. When VK_EXT_memory_budget is
+ * enabled on the device the heap statistics also report the driver's live budget and usage,
+ * which include memory not allocated through this allocator (swapchain, driver internals).
+ */
+class MemoryAllocator {
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    enum class ResourceKind : uint32_t {
+        Linear    = 0, // buffers
+        NonLinear = 1, // optimal tiling images
+    };
+
+    struct HeapStats {
+        VkDeviceSize heapSize        = 0;
+        uint32_t     blockCount      = 0;
+        uint32_t     dedicatedCount  = 0;
+        uint32_t     allocationCount = 0;
+        VkDeviceSize reservedBytes   = 0; // bytes requested from the driver
+        VkDeviceSize usedBytes       = 0; // bytes handed out to resources
+        float        fragmentation   = 0.0f;
+        VkDeviceSize budgetBytes     = 0; // VK_EXT_memory_budget, 0 when not available
+        VkDeviceSize budgetUsage     = 0; // VK_EXT_memory_budget, 0 when not available
+        VkDeviceSize categoryBytes[MEMORY_CATEGORY_COUNT] = {};
+    };
+
+    struct TypeStats {
+        VkMemoryPropertyFlags propertyFlags   = 0;
+        uint32_t              heapIdx         = 0;
+        uint32_t              allocationCount = 0;
+        VkDeviceSize          usedBytes       = 0;
+        VkDeviceSize          categoryBytes[MEMORY_CATEGORY_COUNT] = {};
+    };
+
+    struct UsageStats {
+        uint32_t     allocationCount = 0;
+        VkDeviceSize bytes           = 0;
+        VkDeviceSize peakBytes       = 0;
+    };
+
+    // Returns the allocator for the device, creates it on first use.
+    static MemoryAllocator& Get(const VkPhysicalDevice phyDevice, const VkDevice device);
+    // Returns the already created allocator for the device or nullptr.
+    static MemoryAllocator* Find(const VkDevice device);
+    // Frees all memory blocks of the device's allocator. Must be called before the device is destroyed, even
+    // without a Context: allocators left at exit are not freed.
+    static void Destroy(const VkDevice device);
+
+    MemoryAllocator(const VkPhysicalDevice phyDevice,
+                    const VkDevice         device,
+                    VkDeviceSize           blockSize = DEFAULT_BLOCK_SIZE);
+    ~MemoryAllocator();
+
+    // Disable copy and move constructors
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator(MemoryAllocator&&)      = delete;
+
+    // Allocates memory for the resource and binds it.
+    VkResult AllocateForBuffer(const VkBuffer        buffer,
+                               MemoryUsage           usage,
+                               MemoryAllocation*     outAllocation,
+                               MemoryCategory        category = MemoryCategory::Other);
+    VkResult AllocateForImage(const VkImage         image,
+                              MemoryUsage           usage,
+                              MemoryAllocation*     outAllocation,
+                              MemoryCategory        category = MemoryCategory::Other);
+
+    // Allocates memory without binding it, for memory shared by several images (aliased attachments).
+    VkResult AllocateMemory(const VkMemoryRequirements& requirements,
+                            MemoryUsage                 usage,
+                            MemoryAllocation*           outAllocation,
+                            MemoryCategory              category = MemoryCategory::Other);
+
+    void Free(const MemoryAllocation& allocation);
+
+    // Makes host writes visible for non-coherent memory types, no-op for coherent ones.
+    void Flush(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    // Only call it when VK_EXT_memory_budget is enabled on the device.
+    void EnableMemoryBudget() { m_hasMemoryBudget = true; }
+    bool HasMemoryBudget() const { return m_hasMemoryBudget; }
+
+    // Only call it when the bufferDeviceAddress feature is enabled, before the first allocation: every
+    // VkDeviceMemory is then allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, so any buffer can be
+    // created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+    void EnableBufferDeviceAddress() { m_hasBufferDeviceAddress = true; }
+
+    std::vector<HeapStats> GetHeapStats() const;
+    std::vector<TypeStats> GetTypeStats() const;
+    UsageStats             GetCategoryStats(MemoryCategory category) const;
+    uint32_t               DeviceMemoryCount() const;
+    void                   PrintStats() const;
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties() const { return m_memoryProperties; }
+    const MemoryTypePolicy&                 policy() const { return m_policy; }
+
+private:
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void*          mapped = nullptr;
+        TLSFAllocator  suballocator;
+    };
+
+    struct Pool {
+        uint32_t                            memoryTypeIdx = 0;
+        std::vector<std::unique_ptr<Block>> blocks;
+    };
+
+    VkResult Allocate(const VkMemoryRequirements& requirements,
+                      MemoryUsage                 usage,
+                      ResourceKind                kind,
+                      const VkBuffer              dedicatedBuffer,
+                      const VkImage               dedicatedImage,
+                      MemoryAllocation*           outAllocation);
+
+    VkResult AllocateDedicated(const VkMemoryRequirements& requirements,
+                               uint32_t                    memoryTypeIdx,
+                               const VkBuffer              buffer,
+                               const VkImage               image,
+                               MemoryAllocation*           outAllocation);
+
+    bool     AllocateFromPool(uint32_t poolIdx, const VkMemoryRequirements& requirements, MemoryAllocation* outAllocation);
+    VkResult CreateBlock(uint32_t poolIdx, VkDeviceSize size);
+
+    // Frees every block and dedicated allocation, called by Destroy() while the device is still alive
+    void ReleaseMemory();
+
+    uint32_t     PoolIndex(uint32_t memoryTypeIdx, ResourceKind kind) const;
+    VkDeviceSize PreferredBlockSize(uint32_t memoryTypeIdx) const;
+    void*        MapMemory(const VkDeviceMemory memory, uint32_t memoryTypeIdx);
+
+    // Must be called with m_mutex held
+    void RecordAllocation(const MemoryAllocation& allocation);
+    void RecordFree(const MemoryAllocation& allocation);
+
+    const VkPhysicalDevice m_phyDevice;
+    const VkDevice         m_device;
+    const VkDeviceSize     m_blockSize;
+
+    VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+    MemoryTypePolicy                 m_policy;
+    VkDeviceSize                     m_granularity      = 1;
+    VkDeviceSize                     m_nonCoherentAtom  = 1;
+
+    mutable std::mutex m_mutex;
+    std::vector<Pool>  m_pools;
+
+    uint32_t     m_dedicatedCount[VK_MAX_MEMORY_TYPES] = {};
+    VkDeviceSize m_dedicatedBytes[VK_MAX_MEMORY_TYPES] = {};
+
+    // Every live dedicated allocation, so leaked ones can still be freed by ReleaseMemory
+    std::unordered_set<VkDeviceMemory> m_dedicatedMemory;
+
+    bool       m_hasMemoryBudget        = false;
+    bool       m_hasBufferDeviceAddress = false;
+    UsageStats m_typeUsage[VK_MAX_MEMORY_TYPES][MEMORY_CATEGORY_COUNT] = {};
+    UsageStats m_categoryUsage[MEMORY_CATEGORY_COUNT]                  = {};
+};
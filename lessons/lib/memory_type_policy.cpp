@@ -0,0 +1,118 @@
+#include "memory_type_policy.h"
+
+#include <bit>
+#include <climits>
+
+MemoryTypePolicy::MemoryTypePolicy(const VkPhysicalDeviceMemoryProperties& properties)
+    : m_properties(properties)
+{
+    m_isUnifiedMemory = true;
+    for (uint32_t heapIdx = 0; heapIdx < m_properties.memoryHeapCount; heapIdx++) {
+        if ((m_properties.memoryHeaps[heapIdx].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) {
+            m_isUnifiedMemory = false;
+        }
+    }
+
+    const VkMemoryPropertyFlags barFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    for (uint32_t typeIdx = 0; typeIdx < m_properties.memoryTypeCount; typeIdx++) {
+        const VkMemoryType& memoryType = m_properties.memoryTypes[typeIdx];
+        if (memoryType.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            m_hasLazilyAllocated = true;
+        }
+
+        if ((memoryType.propertyFlags & barFlags) != barFlags) {
+            continue;
+        }
+
+        if (!m_isUnifiedMemory && m_properties.memoryHeaps[memoryType.heapIndex].size > SMALL_BAR_SIZE) {
+            m_hasResizableBar = true;
+        }
+    }
+}
+
+MemoryTypeRequest MemoryTypePolicy::RequestFor(MemoryUsage usage) const
+{
+    switch (usage) {
+    case MemoryUsage::GpuOnly:
+        // Keep the host visible device local types free for data the CPU actually writes
+        return {
+            .required  = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .preferred = 0,
+            .avoided   = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        };
+    case MemoryUsage::Upload:
+        // Sequential CPU writes: uncached (write-combined) system memory is the best fit
+        return {
+            .required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            .preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            .avoided   = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        };
+    case MemoryUsage::PerFrame:
+        // With a full size BAR the shaders can read the data from VRAM, without it the 256 MiB
+        // window is left to the driver and the data stays in system memory.
+        if (m_hasResizableBar || m_isUnifiedMemory) {
+            return {
+                .required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                .preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                .avoided   = VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+            };
+        }
+
+        return {
+            .required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            .preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            .avoided   = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        };
+    case MemoryUsage::Readback:
+        return {
+            .required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            .preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            .avoided   = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        };
+    case MemoryUsage::TransientAttachment:
+        return {
+            .required  = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .preferred = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+            .avoided   = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        };
+    }
+
+    return {};
+}
+
+uint32_t MemoryTypePolicy::FindMemoryType(uint32_t                 memoryTypeBits,
+                                          const MemoryTypeRequest& request,
+                                          VkDeviceSize             size) const
+{
+    // Special purpose types are never picked unless explicitly asked for
+    const VkMemoryPropertyFlags excluded = (VK_MEMORY_PROPERTY_PROTECTED_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+                                         & ~(request.required | request.preferred);
+
+    uint32_t bestIdx   = INVALID_TYPE;
+    int32_t  bestScore = INT_MIN;
+
+    for (uint32_t typeIdx = 0; typeIdx < m_properties.memoryTypeCount; typeIdx++) {
+        if ((memoryTypeBits & (1u << typeIdx)) == 0) {
+            continue;
+        }
+
+        const VkMemoryType&         memoryType = m_properties.memoryTypes[typeIdx];
+        const VkMemoryPropertyFlags flags      = memoryType.propertyFlags;
+
+        if ((flags & request.required) != request.required || (flags & excluded) != 0) {
+            continue;
+        }
+
+        if (size > m_properties.memoryHeaps[memoryType.heapIndex].size) {
+            continue;
+        }
+
+        const int32_t score = std::popcount(flags & request.preferred) - std::popcount(flags & request.avoided);
+        if (score > bestScore) {
+            bestScore = score;
+            bestIdx   = typeIdx;
+        }
+    }
+
+    return bestIdx;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct MipLevel {
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    uint64_t offset = 0; // byte offset inside MipChain::data
+    uint64_t size   = 0;
+};
+
+// All levels of an image, tightly packed after each other
+struct MipChain {
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t>  data;
+};
+
+// floor(log2(max(width, height))) + 1
+uint32_t MipLevelCount(uint32_t width, uint32_t height);
+
+/**
+ * Builds the full mip chain of an RGBA8 image on the CPU with a 2x2 box filter.
+ *
+ * Used when the texture format can not be blitted with linear filtering on the device.
+ * Each level is computed from the previous one, the rows of a level are split across
+ * worker threads. Odd sizes clamp the last row/column, so every source texel is used.
+ */
+MipChain BuildMipChainRGBA8(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t levelCount);
+
+// Same for 8 bit images with 1 to 4 channels ('pixelSize' bytes per pixel).
+// 'srgb' RGBA images are filtered in linear space, see PixelConversion::srgb.
+MipChain BuildMipChain(const uint8_t* pixels,
+                       uint32_t       width,
+                       uint32_t       height,
+                       uint32_t       levelCount,
+                       uint32_t       pixelSize,
+                       bool           srgb);
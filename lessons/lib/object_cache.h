@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+// Descriptors of the Vulkan 1.0 descriptor types (SAMPLER .. INPUT_ATTACHMENT), indexed by VkDescriptorType
+static constexpr uint32_t CORE_DESCRIPTOR_TYPE_COUNT = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+using DescriptorTypeCounts                           = std::array<uint32_t, CORE_DESCRIPTOR_TYPE_COUNT>;
+
+// One descriptor of the update data of a DescriptorUpdateTemplate
+union DescriptorInfo {
+    VkDescriptorImageInfo  image;
+    VkDescriptorBufferInfo buffer;
+    VkBufferView           texelBuffer;
+};
+
+/**
+ * Update template of a descriptor set layout: one entry per binding, in binding order. The update data is a packed
+ * array of DescriptorInfo, the descriptors of each binding start at its 'first' element.
+ */
+struct DescriptorUpdateTemplate {
+    struct Binding {
+        uint32_t         binding;
+        VkDescriptorType type;
+        uint32_t         first;
+        uint32_t         count;
+    };
+
+    VkDescriptorUpdateTemplate handle          = VK_NULL_HANDLE;
+    uint32_t                   descriptorCount = 0; // DescriptorInfo elements of the update data
+    std::vector<Binding>       bindings;            // sorted by binding number
+
+    // Index into 'bindings' or -1
+    int32_t Find(uint32_t binding) const;
+};
+
+/**
+ * Device wide cache of descriptor set layouts and pipeline layouts, samplers are served by the SamplerCache.
+ *
+ * Objects are looked up by the full contents of their create info: the flags, every binding with its type,
+ * count, stage flags and immutable samplers, the binding flags of a chained
+ * VkDescriptorSetLayoutBindingFlagsCreateInfo, and for pipeline layouts the set layouts and push constant
+ * ranges. A lookup hashes the create info in place and compares it field by field with the stored copy,
+ * only the creation of a new object allocates. Two create infos share an object only if they are equal.
+ *
+ * Cached descriptor set layouts also provide a descriptor update template, generated on first use.
+ *
+ * Like the samplers, the cached objects live until the cache of the device is destroyed,
+ * users must not destroy them.
+ */
+class ObjectCache {
+public:
+    struct Counters {
+        uint64_t hits   = 0;
+        uint64_t misses = 0; // lookups that created an object
+        uint32_t count  = 0; // objects alive
+    };
+
+    struct Stats {
+        Counters descriptorSetLayouts;
+        Counters pipelineLayouts;
+        Counters samplers;
+        Counters updateTemplates;
+    };
+
+    // Lookup keys: create info contents without ownership, both the lookups and the stored keys use them.
+    // Public only so bench/object_cache_bench.cpp can measure the lookups without a device.
+    struct SetLayoutKey {
+        VkDescriptorSetLayoutCreateFlags    flags            = 0;
+        uint32_t                            bindingCount     = 0;
+        const VkDescriptorSetLayoutBinding* bindings         = nullptr;
+        uint32_t                            bindingFlagCount = 0;
+        const VkDescriptorBindingFlags*     bindingFlags     = nullptr;
+    };
+
+    struct PipelineLayoutKey {
+        VkPipelineLayoutCreateFlags  flags          = 0;
+        uint32_t                     setLayoutCount = 0;
+        const VkDescriptorSetLayout* setLayouts     = nullptr;
+        uint32_t                     rangeCount     = 0;
+        const VkPushConstantRange*   ranges         = nullptr;
+    };
+
+    struct KeyHash {
+        size_t operator()(const SetLayoutKey& key) const;
+        size_t operator()(const PipelineLayoutKey& key) const;
+    };
+
+    struct KeyEqual {
+        bool operator()(const SetLayoutKey& lhs, const SetLayoutKey& rhs) const;
+        bool operator()(const PipelineLayoutKey& lhs, const PipelineLayoutKey& rhs) const;
+    };
+
+    // Returns the cache for the device, creates it on first use.
+    static ObjectCache& Get(const VkDevice device);
+    // Returns the already created cache for the device or nullptr.
+    static ObjectCache* Find(const VkDevice device);
+    // Destroys every object of the device's cache. Must be called before the device is destroyed.
+    static void Destroy(const VkDevice device);
+
+    explicit ObjectCache(const VkDevice device);
+    ~ObjectCache();
+
+    // Disable copy and move constructors
+    ObjectCache(const ObjectCache&) = delete;
+    ObjectCache(ObjectCache&&)      = delete;
+
+    // Only a VkDescriptorSetLayoutBindingFlagsCreateInfo may be chained. VK_NULL_HANDLE on failure.
+    VkDescriptorSetLayout GetDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& createInfo);
+    VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                                 VkDescriptorSetLayoutCreateFlags                 flags = 0);
+
+    // Descriptors per type a set of the layout holds, false when the layout was not created by the cache
+    bool GetDescriptorCounts(const VkDescriptorSetLayout layout, DescriptorTypeCounts* outCounts) const;
+    // Bindings of the layout as created, false when the layout was not created by the cache
+    bool GetBindings(const VkDescriptorSetLayout layout, std::vector<VkDescriptorSetLayoutBinding>* outBindings) const;
+
+    // Template writing every binding of the layout, stays valid with the cache. nullptr when the layout was not
+    // created by the cache, is a push descriptor or descriptor buffer layout or has bindings a template can not
+    // describe (variable counts, inline uniform blocks).
+    const DescriptorUpdateTemplate* GetUpdateTemplate(const VkDescriptorSetLayout layout);
+
+    // pNext chains are not supported. VK_NULL_HANDLE on failure.
+    VkPipelineLayout GetPipelineLayout(const VkPipelineLayoutCreateInfo& createInfo);
+    // Same layout as CreatePipelineLayout (wrappers.h) builds: one push constant range for every stage
+    VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& layouts, uint32_t pushConstantSize = 0);
+
+    // Forwards to the SamplerCache of the device
+    VkSampler GetSampler(const VkSamplerCreateInfo& createInfo);
+
+    Stats GetStats() const;
+    void  PrintStats() const;
+
+private:
+    // Owned copies of the create info arrays, the stored keys point into these
+    struct SetLayoutEntry {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        std::vector<VkSampler>                    immutableSamplers;
+        std::vector<VkDescriptorBindingFlags>     bindingFlags;
+        DescriptorTypeCounts                      descriptorCounts = {};
+        VkDescriptorSetLayoutCreateFlags          flags            = 0;
+        VkDescriptorSetLayout                     layout           = VK_NULL_HANDLE;
+        bool                                      templateBuilt    = false; // also when it could not be built
+        std::unique_ptr<DescriptorUpdateTemplate> updateTemplate;
+    };
+
+    struct PipelineLayoutEntry {
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        std::vector<VkPushConstantRange>   ranges;
+        VkPipelineLayout                   layout = VK_NULL_HANDLE;
+    };
+
+    const VkDevice m_device;
+
+    mutable std::mutex m_mutex;
+
+    std::unordered_map<SetLayoutKey, std::unique_ptr<SetLayoutEntry>, KeyHash, KeyEqual>           m_setLayouts;
+    std::unordered_map<PipelineLayoutKey, std::unique_ptr<PipelineLayoutEntry>, KeyHash, KeyEqual> m_pipelineLayouts;
+    std::unordered_map<VkDescriptorSetLayout, SetLayoutEntry*>                                      m_setLayoutsByHandle;
+
+    Counters m_setLayoutCounters;
+    Counters m_pipelineLayoutCounters;
+    Counters m_templateCounters;
+};
@@ -0,0 +1,235 @@
+#include "pipeline_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "hash_util.h"
+#include "mapped_file.h"
+
+namespace {
+
+constexpr uint32_t FILE_MAGIC = 0x43504B56; // "VKPC"
+
+} // anonymous namespace
+
+VkResult PipelineCache::Create(const VkPhysicalDevice phyDevice, const VkDevice device, const std::string& path)
+{
+    m_device   = device;
+    m_path     = path;
+    m_diskHash = 0;
+    m_stats    = {};
+    vkGetPhysicalDeviceProperties(phyDevice, &m_properties);
+
+    const std::shared_ptr<MappedFile> file = MappedFile::Open(path);
+    if (file) {
+        size_t         size = 0;
+        const uint8_t* data = ValidData(file->data(), file->size(), &size, &m_diskHash);
+        if (data != nullptr) {
+            m_cache = CreateCache(data, size);
+        }
+
+        if (m_cache != VK_NULL_HANDLE) {
+            m_stats.warm        = true;
+            m_stats.loadedBytes = size;
+        } else {
+            printf("[WARNING] Pipeline cache '%s' is not valid for this device or driver, starting cold\n",
+                   path.c_str());
+        }
+    }
+
+    if (m_cache == VK_NULL_HANDLE) {
+        m_cache = CreateCache(nullptr, 0);
+    }
+    if (m_cache == VK_NULL_HANDLE) {
+        printf("[ERROR] Pipeline cache creation failed\n");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    return VK_SUCCESS;
+}
+
+void PipelineCache::Destroy()
+{
+    if (m_cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    }
+
+    m_cache  = VK_NULL_HANDLE;
+    m_device = VK_NULL_HANDLE;
+}
+
+const uint8_t*
+PipelineCache::ValidData(const uint8_t* file, size_t fileSize, size_t* outSize, uint64_t* outHash) const
+{
+    if (fileSize < sizeof(FileHeader)) {
+        return nullptr;
+    }
+
+    FileHeader header;
+    memcpy(&header, file, sizeof(header));
+
+    const bool sameDevice = header.magic == FILE_MAGIC
+                         && header.version == VERSION
+                         && header.vendorID == m_properties.vendorID
+                         && header.deviceID == m_properties.deviceID
+                         && header.driverVersion == m_properties.driverVersion
+                         && memcmp(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    if (!sameDevice || header.dataSize != fileSize - sizeof(FileHeader)) {
+        return nullptr;
+    }
+
+    const uint8_t* data = file + sizeof(FileHeader);
+    if (HashBytes(data, header.dataSize) != header.dataHash) {
+        return nullptr;
+    }
+
+    // The driver checks its own header too, but a mismatch there would silently give an empty cache
+    VkPipelineCacheHeaderVersionOne cacheHeader;
+    if (header.dataSize < sizeof(cacheHeader)) {
+        return nullptr;
+    }
+    memcpy(&cacheHeader, data, sizeof(cacheHeader));
+
+    if (cacheHeader.headerSize < sizeof(cacheHeader)
+        || cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        || cacheHeader.vendorID != m_properties.vendorID
+        || cacheHeader.deviceID != m_properties.deviceID
+        || memcmp(cacheHeader.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return nullptr;
+    }
+
+    *outSize = header.dataSize;
+    *outHash = header.dataHash;
+    return data;
+}
+
+VkPipelineCache PipelineCache::CreateCache(const void* data, size_t size) const
+{
+    const VkPipelineCacheCreateInfo createInfo = {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext           = nullptr,
+        .flags           = 0,
+        .initialDataSize = size,
+        .pInitialData    = data,
+    };
+
+    VkPipelineCache cache  = VK_NULL_HANDLE;
+    const VkResult  result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &cache);
+    return (result == VK_SUCCESS) ? cache : VK_NULL_HANDLE;
+}
+
+bool PipelineCache::Save()
+{
+    if (m_cache == VK_NULL_HANDLE) {
+        return false;
+    }
+
+    // Other processes may have saved since the load, their pipelines are merged in so no run loses work.
+    // The file is unmapped before it is replaced.
+    {
+        const std::shared_ptr<MappedFile> file = MappedFile::Open(m_path);
+
+        size_t         size = 0;
+        uint64_t       hash = 0;
+        const uint8_t* data = file ? ValidData(file->data(), file->size(), &size, &hash) : nullptr;
+        if (data != nullptr && hash != m_diskHash) {
+            VkPipelineCache diskCache = CreateCache(data, size);
+            if (diskCache != VK_NULL_HANDLE) {
+                if (vkMergePipelineCaches(m_device, m_cache, 1, &diskCache) == VK_SUCCESS) {
+                    m_stats.mergedFiles++;
+                }
+                vkDestroyPipelineCache(m_device, diskCache, nullptr);
+            }
+        }
+    }
+
+    size_t   size   = 0;
+    VkResult result = vkGetPipelineCacheData(m_device, m_cache, &size, nullptr);
+    if (result != VK_SUCCESS || size == 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> data(size);
+    result = vkGetPipelineCacheData(m_device, m_cache, &size, data.data());
+    if (result != VK_SUCCESS) {
+        return false;
+    }
+
+    FileHeader header    = {};
+    header.magic         = FILE_MAGIC;
+    header.version       = VERSION;
+    header.vendorID      = m_properties.vendorID;
+    header.deviceID      = m_properties.deviceID;
+    header.driverVersion = m_properties.driverVersion;
+    header.dataSize      = size;
+    header.dataHash      = HashBytes(data.data(), size);
+    memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    // Unique per process and thread, the final name only appears once the file is complete
+    const uint64_t    unique   = std::hash<std::thread::id>{}(std::this_thread::get_id())
+                           ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()
+                           ^ std::random_device{}();
+    const std::string tempPath = m_path + "." + std::to_string(unique) + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)data.data(), (std::streamsize)size);
+
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tempPath);
+            return false;
+        }
+    }
+
+    // Atomic replace on POSIX, Windows refuses to replace an existing file: remove it first there
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_path, error);
+    if (error) {
+        std::filesystem::remove(m_path, error);
+        std::filesystem::rename(tempPath, m_path, error);
+    }
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    m_diskHash         = header.dataHash;
+    m_stats.savedBytes = size;
+    return true;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline* outPipeline)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const VkResult result = vkCreateGraphicsPipelines(m_device, m_cache, 1, &createInfo, nullptr, outPipeline);
+
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    m_stats.createMs += elapsed.count();
+    m_stats.pipelineCount++;
+
+    return result;
+}
+
+void PipelineCache::PrintStats() const
+{
+    if (m_stats.warm) {
+        printf("Pipeline cache: warm (%llu bytes loaded), %u pipelines created in %.2f ms\n",
+               (unsigned long long)m_stats.loadedBytes, m_stats.pipelineCount, m_stats.createMs);
+    } else {
+        printf("Pipeline cache: cold, %u pipelines created in %.2f ms\n", m_stats.pipelineCount, m_stats.createMs);
+    }
+}
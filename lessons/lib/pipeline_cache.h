@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan_core.h>
+
+/**
+ * VkPipelineCache of the device, kept on disk between runs.
+ *
+ * Create() loads the file when it was written for the same GPU and driver: the vendor and device IDs, the
+ * driver version and the pipeline cache UUID must all match, along with a checksum of the data. Anything
+ * else (missing, truncated, other driver) starts an empty cache.
+ *
+ * Save() merges what other processes saved to the same file since it was loaded, so parallel runs add up
+ * instead of overwriting each other, and replaces the file the same way the TextureDiskCache stores its
+ * blobs: written to a unique temporary file and renamed into place.
+ *
+ * Pipelines created through CreateGraphicsPipeline are timed, comparing a cold and a warm start shows
+ * what the cache saves. Other users (ImGui) get the handle only.
+ */
+class PipelineCache {
+public:
+    // Raised when the file layout changes
+    static constexpr uint32_t VERSION = 1;
+
+    struct Stats {
+        bool     warm          = false; // started from valid data on disk
+        uint64_t loadedBytes   = 0;
+        uint64_t savedBytes    = 0;
+        uint32_t mergedFiles   = 0; // saves that merged pipelines of other processes
+        uint32_t pipelineCount = 0; // created through CreateGraphicsPipeline
+        double   createMs      = 0.0;
+    };
+
+    VkResult Create(const VkPhysicalDevice phyDevice, const VkDevice device, const std::string& path);
+    void     Destroy();
+
+    // Merges the file on disk into the cache and writes the result back, false when nothing was written
+    bool Save();
+
+    VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline* outPipeline);
+
+    VkPipelineCache handle() const { return m_cache; }
+    bool            IsValid() const { return m_cache != VK_NULL_HANDLE; }
+
+    const Stats& GetStats() const { return m_stats; }
+    void         PrintStats() const;
+
+private:
+    // Header of the file, followed by the data of vkGetPipelineCacheData
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint32_t reserved; // keeps the 64 bit fields aligned, no padding is written
+        uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    // Cache data of the file when it belongs to this device, nullptr otherwise. 'outHash' is the data checksum.
+    const uint8_t* ValidData(const uint8_t* file, size_t fileSize, size_t* outSize, uint64_t* outHash) const;
+    // Creates a cache from the data, VK_NULL_HANDLE on failure
+    VkPipelineCache CreateCache(const void* data, size_t size) const;
+
+    VkDevice                   m_device     = VK_NULL_HANDLE;
+    VkPipelineCache            m_cache      = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_properties = {};
+    std::string                m_path;
+    uint64_t                   m_diskHash   = 0; // checksum of the file contents already in the cache
+
+    Stats m_stats;
+};
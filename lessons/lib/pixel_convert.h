@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan_core.h>
+
+/**
+ * Pixel format conversion kernels for texture ingestion.
+ *
+ * Images are decoded with their own channel count (stb_image without forcing 4 channels) and turned into
+ * the texels of the requested format here instead of by stb. The kernels have SSE4.1 and AVX2 versions
+ * next to the scalar one, the best the CPU supports is picked once at runtime. Non x86 builds only have
+ * the scalar kernels.
+ *
+ * The sRGB conversions are table lookups, those stay scalar: 8 bit lookups do not vectorize.
+ */
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,
+};
+
+// Instruction set used by the kernels on this CPU
+SimdLevel PixelConvertSimdLevel();
+// Limits the kernels to 'level' (tests and benchmarks compare the versions), never above what the CPU supports.
+// Returns the level used from now on. Not meant to be called while images are converted on other threads.
+SimdLevel SetPixelConvertSimdLevel(SimdLevel level);
+
+// RGB -> RGBA with opaque alpha, 'src' has 3 bytes per pixel
+void ExpandRGBToRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+// 1 (gray), 2 (gray, alpha), 3 or 4 channel pixels -> RGBA
+void ExpandToRGBA(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixelCount);
+
+// dst[c] = src[order[c]] for every RGBA pixel, e.g. {2, 1, 0, 3} turns RGBA into BGRA. 'dst' may be 'src'.
+void SwizzleRGBA(const uint8_t* src, uint8_t* dst, size_t pixelCount, const uint8_t order[4]);
+
+// Keeps the red and green channels of RGBA pixels, 2 bytes per pixel (normal and specular/roughness maps)
+void PackRG(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+
+// Multiplies the color channels of RGBA pixels by their alpha, in place
+void PremultiplyAlpha(uint8_t* pixels, size_t pixelCount);
+
+// sRGB encoded RGBA8 <-> linear float RGBA, alpha is linear in both and only scaled
+void SrgbToLinearRGBA(const uint8_t* src, float* dst, size_t pixelCount);
+void LinearToSrgbRGBA(const float* src, uint8_t* dst, size_t pixelCount);
+
+// How decoded 8 bit pixels become the texels of a texture format, see ChoosePixelConversion
+struct PixelConversion {
+    VkFormat format           = VK_FORMAT_R8G8B8A8_UNORM;
+    uint32_t pixelSize        = 4; // bytes per texel after the conversion
+    bool     swizzleBGRA      = false;
+    bool     packRG           = false;
+    bool     premultiplyAlpha = false;
+    bool     srgb             = false; // mip levels are filtered in linear space
+};
+
+// Picks the kernels for the requested format: R8G8B8A8 and B8G8R8A8 (UNORM and SRGB) and R8G8_UNORM.
+// Other formats get RGBA8 texels, as they always did.
+PixelConversion ChoosePixelConversion(const VkFormat format, bool premultiplyAlpha = false);
+
+// Converts pixels with 'channels' channels (1-4, as decoded) into 'dst', which holds pixelSize bytes per pixel
+void ConvertPixels(const PixelConversion& conversion,
+                   const uint8_t*         src,
+                   uint32_t               channels,
+                   uint8_t*               dst,
+                   size_t                 pixelCount);
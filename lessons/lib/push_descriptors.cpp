@@ -0,0 +1,69 @@
+#include "push_descriptors.h"
+
+#include <cassert>
+#include <cstdio>
+
+#include "descriptor_allocator.h"
+#include "descriptor_buffer.h"
+#include "object_cache.h"
+
+void PushDescriptors::Create(const VkDevice device, bool extensionEnabled, FrameDescriptorAllocator* fallback)
+{
+    m_device               = device;
+    m_fallback             = fallback;
+    m_descriptorBuffer     = DescriptorBuffer::Find(device);
+    m_cmdPushDescriptorSet = nullptr;
+    m_stats                = {};
+
+    if (extensionEnabled) {
+        m_cmdPushDescriptorSet =
+            (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR");
+    }
+
+    if (m_cmdPushDescriptorSet == nullptr) {
+        printf("Push descriptors are not supported, pushed sets are allocated per frame\n");
+    }
+}
+
+VkDescriptorSetLayout PushDescriptors::CreateLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    // Every set layout of a pipeline layout has the descriptor buffer flag or none of them, pushed sets included
+    const VkDescriptorSetLayoutCreateFlags flags =
+        (IsSupported() ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0)
+        | DescriptorBuffer::LayoutCreateFlags(m_device);
+
+    return ObjectCache::Get(m_device).GetDescriptorSetLayout(bindings, flags);
+}
+
+void PushDescriptors::CmdPushDescriptors(const VkCommandBuffer     cmdBuffer,
+                                         const VkPipelineBindPoint bindPoint,
+                                         const VkPipelineLayout    pipelineLayout,
+                                         uint32_t                  setIdx,
+                                         DescriptorSetMgmt&        descriptors)
+{
+    m_stats.pushes++;
+
+    if (IsSupported()) {
+        // The writes are copied into the command buffer, the stack array can go right after the call
+        VkWriteDescriptorSet writes[DescriptorSetMgmt::MAX_WRITES];
+        const uint32_t       writeCount = descriptors.FillWrites(VK_NULL_HANDLE, writes);
+
+        m_cmdPushDescriptorSet(cmdBuffer, bindPoint, pipelineLayout, setIdx, writeCount, writes);
+        return;
+    }
+
+    assert(m_fallback != nullptr && m_fallback->IsValid() && "Push descriptor fallback needs frame descriptors");
+
+    const VkDescriptorSet set = m_fallback->Allocate(descriptors.Layout());
+    if (set == VK_NULL_HANDLE) {
+        printf("[ERROR] Push descriptor fallback set allocation failed\n");
+        return;
+    }
+    m_stats.fallbackSets++;
+
+    // A fresh set every time, written through the update template of the layout when there is one
+    descriptors.Get() = set;
+    descriptors.Update(m_device);
+
+    CmdBindDescriptorSets(m_descriptorBuffer, cmdBuffer, bindPoint, pipelineLayout, setIdx, 1, &set);
+}
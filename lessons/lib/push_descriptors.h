@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include "descriptors.h"
+
+class DescriptorBuffer;
+class FrameDescriptorAllocator;
+
+/**
+ * Per-draw and per-pass descriptors recorded directly into the command buffer (VK_KHR_push_descriptor).
+ *
+ * The descriptors of a set are described with a DescriptorSetMgmt without a set and written by
+ * CmdPushDescriptors each time the set is needed: no set is allocated and nothing has to be kept alive
+ * until the frame is done, the data lands in the command buffer.
+ *
+ * When the device does not support the extension the same calls allocate a set from the frame descriptor
+ * allocator, write it and bind it. Layouts for pushed sets must come from CreateLayout, which only sets the
+ * push descriptor flag when the extension is enabled, so pipelines do not need to know which path is used.
+ * With the DescriptorBuffer backend the fallback sets are ranges of the descriptor buffer.
+ *
+ * A pushed set may hold at most DescriptorSetMgmt::MAX_WRITES descriptors, below the 32 every
+ * implementation of the extension supports (maxPushDescriptors).
+ */
+class PushDescriptors {
+public:
+    struct Stats {
+        uint64_t pushes       = 0; // CmdPushDescriptors calls since Create
+        uint64_t fallbackSets = 0; // sets allocated and bound instead of pushed
+    };
+
+    // 'fallback' is used without the extension only, it must be created before the first push
+    void Create(const VkDevice device, bool extensionEnabled, FrameDescriptorAllocator* fallback);
+
+    bool IsSupported() const { return m_cmdPushDescriptorSet != nullptr; }
+
+    // Set layout for pushed sets, owned by the ObjectCache. VK_NULL_HANDLE on failure.
+    VkDescriptorSetLayout CreateLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+    // Writes the descriptors as set 'setIdx' of the pipeline layout, 'descriptors' must carry the set layout
+    void CmdPushDescriptors(const VkCommandBuffer     cmdBuffer,
+                            const VkPipelineBindPoint bindPoint,
+                            const VkPipelineLayout    pipelineLayout,
+                            uint32_t                  setIdx,
+                            DescriptorSetMgmt&        descriptors);
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    VkDevice                      m_device               = VK_NULL_HANDLE;
+    PFN_vkCmdPushDescriptorSetKHR m_cmdPushDescriptorSet = nullptr;
+    FrameDescriptorAllocator*     m_fallback             = nullptr;
+    DescriptorBuffer*             m_descriptorBuffer     = nullptr;
+
+    Stats m_stats;
+};
@@ -0,0 +1,197 @@
+#include "sampler_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <memory>
+
+#include "hash_util.h"
+
+namespace {
+
+std::mutex                                                    g_samplerCachesMutex;
+std::unordered_map<VkDevice, std::unique_ptr<SamplerCache>> g_samplerCaches;
+
+} // anonymous namespace
+
+SamplerCache& SamplerCache::Get(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_samplerCachesMutex);
+
+    std::unique_ptr<SamplerCache>& cache = g_samplerCaches[device];
+    if (!cache) {
+        cache = std::make_unique<SamplerCache>(device);
+    }
+
+    return *cache;
+}
+
+SamplerCache* SamplerCache::Find(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_samplerCachesMutex);
+
+    const auto it = g_samplerCaches.find(device);
+    return (it != g_samplerCaches.end()) ? it->second.get() : nullptr;
+}
+
+void SamplerCache::Destroy(const VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(g_samplerCachesMutex);
+
+    const auto it = g_samplerCaches.find(device);
+    if (it == g_samplerCaches.end()) {
+        return;
+    }
+
+    it->second->DestroySamplers();
+    g_samplerCaches.erase(it);
+}
+
+SamplerCache::SamplerCache(const VkDevice device)
+    : m_device(device)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+    // A cache left in the registry at exit would destroy its samplers after the device
+    assert(m_samplers.empty() && "SamplerCache::Destroy must be called before the device is destroyed");
+}
+
+void SamplerCache::DestroySamplers()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& [createInfo, sampler] : m_samplers) {
+        vkDestroySampler(m_device, sampler, nullptr);
+    }
+    m_samplers.clear();
+}
+
+void SamplerCache::SetDeviceLimits(const VkPhysicalDeviceLimits& limits, bool anisotropyEnabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_anisotropyEnabled = anisotropyEnabled && (limits.maxSamplerAnisotropy > 1.0f);
+    m_maxAnisotropy     = m_anisotropyEnabled ? limits.maxSamplerAnisotropy : 1.0f;
+    m_maxLodBias        = limits.maxSamplerLodBias;
+}
+
+VkSamplerCreateInfo SamplerCache::CreateInfoFor(const SamplerSettings& settings) const
+{
+    const float anisotropy = std::clamp(settings.maxAnisotropy, 1.0f, m_maxAnisotropy);
+    const bool  useAniso   = m_anisotropyEnabled && (anisotropy > 1.0f);
+
+    return VkSamplerCreateInfo{
+        .sType              = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext              = nullptr,
+        .flags              = 0,
+        .magFilter          = settings.filter,
+        .minFilter          = settings.filter,
+        .mipmapMode         = settings.mipmapMode,
+        .addressModeU       = settings.addressMode,
+        .addressModeV       = settings.addressMode,
+        .addressModeW       = settings.addressMode,
+        .mipLodBias         = std::clamp(settings.lodBias, -m_maxLodBias, m_maxLodBias),
+        .anisotropyEnable   = useAniso ? VK_TRUE : VK_FALSE,
+        .maxAnisotropy      = useAniso ? anisotropy : 1.0f,
+        .compareEnable      = settings.compareEnable ? VK_TRUE : VK_FALSE,
+        .compareOp          = settings.compareEnable ? settings.compareOp : VK_COMPARE_OP_NEVER,
+        .minLod             = 0.0f,
+        .maxLod             = VK_LOD_CLAMP_NONE,
+        .borderColor        = settings.borderColor,
+        .unnormalizedCoordinates = VK_FALSE,
+    };
+}
+
+VkSampler SamplerCache::Get(const SamplerSettings& settings)
+{
+    return GetSampler(CreateInfoFor(settings));
+}
+
+VkSampler SamplerCache::GetSampler(const VkSamplerCreateInfo& createInfo)
+{
+    assert(createInfo.pNext == nullptr && "Sampler create info chains are not cached");
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it = m_samplers.find(createInfo);
+    if (it != m_samplers.end()) {
+        m_hits++;
+        return it->second;
+    }
+    m_misses++;
+
+    VkSampler      sampler = VK_NULL_HANDLE;
+    const VkResult result  = vkCreateSampler(m_device, &createInfo, nullptr, &sampler);
+    if (result != VK_SUCCESS) {
+        printf("[ERROR] Sampler creation failed: %d\n", result);
+        return VK_NULL_HANDLE;
+    }
+
+    m_samplers.emplace(createInfo, sampler);
+    return sampler;
+}
+
+uint32_t SamplerCache::SamplerCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (uint32_t)m_samplers.size();
+}
+
+uint64_t SamplerCache::Hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+uint64_t SamplerCache::Misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
+
+size_t SamplerCache::CreateInfoHash::operator()(const VkSamplerCreateInfo& info) const
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    HashField(&hash, info.flags);
+    HashField(&hash, info.magFilter);
+    HashField(&hash, info.minFilter);
+    HashField(&hash, info.mipmapMode);
+    HashField(&hash, info.addressModeU);
+    HashField(&hash, info.addressModeV);
+    HashField(&hash, info.addressModeW);
+    // Adding zero turns -0.0 into 0.0, the two compare equal so they must hash equal too
+    HashField(&hash, info.mipLodBias + 0.0f);
+    HashField(&hash, info.anisotropyEnable);
+    HashField(&hash, info.maxAnisotropy + 0.0f);
+    HashField(&hash, info.compareEnable);
+    HashField(&hash, info.compareOp);
+    HashField(&hash, info.minLod + 0.0f);
+    HashField(&hash, info.maxLod + 0.0f);
+    HashField(&hash, info.borderColor);
+    HashField(&hash, info.unnormalizedCoordinates);
+
+    return (size_t)hash;
+}
+
+bool SamplerCache::CreateInfoEqual::operator()(const VkSamplerCreateInfo& lhs, const VkSamplerCreateInfo& rhs) const
+{
+    return lhs.flags == rhs.flags
+        && lhs.magFilter == rhs.magFilter
+        && lhs.minFilter == rhs.minFilter
+        && lhs.mipmapMode == rhs.mipmapMode
+        && lhs.addressModeU == rhs.addressModeU
+        && lhs.addressModeV == rhs.addressModeV
+        && lhs.addressModeW == rhs.addressModeW
+        && lhs.mipLodBias == rhs.mipLodBias
+        && lhs.anisotropyEnable == rhs.anisotropyEnable
+        && lhs.maxAnisotropy == rhs.maxAnisotropy
+        && lhs.compareEnable == rhs.compareEnable
+        && lhs.compareOp == rhs.compareOp
+        && lhs.minLod == rhs.minLod
+        && lhs.maxLod == rhs.maxLod
+        && lhs.borderColor == rhs.borderColor
+        && lhs.unnormalizedCoordinates == rhs.unnormalizedCoordinates;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+// Per material sampling parameters, translated into a VkSamplerCreateInfo by the SamplerCache
+struct SamplerSettings {
+    VkFilter             filter        = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode  mipmapMode    = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressMode   = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    float                maxAnisotropy = 1.0f;  // 1 disables anisotropic filtering
+    float                lodBias       = 0.0f;
+    bool                 compareEnable = false; // depth comparison (sampler2DShadow)
+    VkCompareOp          compareOp     = VK_COMPARE_OP_LESS_OR_EQUAL;
+    VkBorderColor        borderColor   = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+};
+
+/**
+ * Device wide cache of immutable samplers.
+ *
+ * Samplers are looked up by every field of their VkSamplerCreateInfo, identical requests share
+ * one VkSampler. Samplers are never destroyed individually: they live until the cache of the
+ * device is destroyed, so they can be handed out freely and stay valid in descriptor sets.
+ *
+ * The LOD range is left open (0 .. VK_LOD_CLAMP_NONE), the image view limits the mip levels,
+ * so textures with different mip counts can use the same sampler.
+ *
+ * Anisotropy is only used after EnableAnisotropy was called (the samplerAnisotropy feature
+ * is enabled on the device), requested values are clamped to the device limits.
+ */
+class SamplerCache {
+public:
+    // Returns the cache for the device, creates it on first use.
+    static SamplerCache& Get(const VkDevice device);
+    // Returns the already created cache for the device or nullptr.
+    static SamplerCache* Find(const VkDevice device);
+    // Destroys every sampler of the device's cache. Must be called before the device is destroyed, also by
+    // code without a Context that used Texture or ObjectCache samplers.
+    static void Destroy(const VkDevice device);
+
+    explicit SamplerCache(const VkDevice device);
+    ~SamplerCache();
+
+    // Disable copy and move constructors
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache(SamplerCache&&)      = delete;
+
+    // Records the sampler limits of the device, anisotropy is only enabled when the device feature is.
+    void SetDeviceLimits(const VkPhysicalDeviceLimits& limits, bool anisotropyEnabled);
+
+    // Returns a shared sampler for the create info, pNext chains are not supported. VK_NULL_HANDLE on failure.
+    VkSampler GetSampler(const VkSamplerCreateInfo& createInfo);
+    VkSampler Get(const SamplerSettings& settings);
+
+    // Fills the create info the settings are translated to (after clamping to the device limits)
+    VkSamplerCreateInfo CreateInfoFor(const SamplerSettings& settings) const;
+
+    bool     IsAnisotropyEnabled() const { return m_anisotropyEnabled; }
+    float    MaxAnisotropy() const { return m_maxAnisotropy; }
+    uint32_t SamplerCount() const;
+    // Lookups answered from the cache / lookups that created a sampler
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+
+private:
+    // Destroys every sampler, called by Destroy() while the device is still alive
+    void DestroySamplers();
+
+    struct CreateInfoHash {
+        size_t operator()(const VkSamplerCreateInfo& info) const;
+    };
+
+    struct CreateInfoEqual {
+        bool operator()(const VkSamplerCreateInfo& lhs, const VkSamplerCreateInfo& rhs) const;
+    };
+
+    const VkDevice m_device;
+
+    bool  m_anisotropyEnabled = false;
+    float m_maxAnisotropy     = 1.0f;
+    float m_maxLodBias        = 2.0f; // smallest maxSamplerLodBias allowed by the specification
+
+    uint64_t m_hits   = 0;
+    uint64_t m_misses = 0;
+
+    mutable std::mutex                                                                 m_mutex;
+    std::unordered_map<VkSamplerCreateInfo, VkSampler, CreateInfoHash, CreateInfoEqual> m_samplers;
+};
@@ -0,0 +1,208 @@
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+
+#include "memory_type_policy.h"
+#include "test_util.h"
+
+namespace {
+
+constexpr VkDeviceSize MiB = 1024ull * 1024;
+constexpr VkDeviceSize GiB = 1024 * MiB;
+
+constexpr VkMemoryPropertyFlags DL     = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+constexpr VkMemoryPropertyFlags HV     = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+constexpr VkMemoryPropertyFlags HC     = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+constexpr VkMemoryPropertyFlags CACHED = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+constexpr VkMemoryPropertyFlags LAZY   = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+constexpr VkMemoryHeapFlags HEAP_DL = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+constexpr uint32_t ALL_TYPES = ~0u;
+constexpr uint32_t NONE      = MemoryTypePolicy::INVALID_TYPE;
+
+VkPhysicalDeviceMemoryProperties MakeProperties(std::initializer_list<VkMemoryHeap> heaps,
+                                                std::initializer_list<VkMemoryType> types)
+{
+    VkPhysicalDeviceMemoryProperties properties = {};
+
+    for (const VkMemoryHeap& heap : heaps) {
+        properties.memoryHeaps[properties.memoryHeapCount++] = heap;
+    }
+    for (const VkMemoryType& type : types) {
+        properties.memoryTypes[properties.memoryTypeCount++] = type;
+    }
+
+    return properties;
+}
+
+// Memory layouts as reported by the drivers, with the type each usage must end up in
+struct LayoutCase {
+    const char*                      name;
+    VkPhysicalDeviceMemoryProperties properties;
+    bool                             resizableBar;
+    bool                             unifiedMemory;
+    bool                             lazilyAllocated;
+    uint32_t                         gpuOnly;
+    uint32_t                         upload;
+    uint32_t                         perFrame;
+    uint32_t                         readback;
+    uint32_t                         transientAttachment;
+};
+
+// Lookups with restricted type bits or sizes close to the heap sizes
+struct LookupCase {
+    const char*  name;
+    uint32_t     layoutIdx;
+    uint32_t     memoryTypeBits;
+    MemoryUsage  usage;
+    VkDeviceSize size;
+    uint32_t     expected;
+};
+
+const LayoutCase g_layouts[] = {
+    {
+        // Discrete GPU without resizable BAR: only a 256 MiB window of VRAM is host visible
+        .name       = "discrete, small BAR",
+        .properties = MakeProperties(
+            {{8 * GiB, HEAP_DL}, {16 * GiB, 0}, {256 * MiB, HEAP_DL}},
+            {{DL, 0}, {HV | HC, 1}, {HV | HC | CACHED, 1}, {DL | HV | HC, 2}}),
+        .resizableBar        = false,
+        .unifiedMemory       = false,
+        .lazilyAllocated     = false,
+        .gpuOnly             = 0,
+        .upload              = 1,
+        .perFrame            = 1, // the BAR window is left to the driver
+        .readback            = 2,
+        .transientAttachment = 0,
+    },
+    {
+        // Discrete GPU with resizable BAR: the whole VRAM heap is host visible
+        .name       = "discrete, resizable BAR",
+        .properties = MakeProperties(
+            {{16 * GiB, HEAP_DL}, {32 * GiB, 0}},
+            {{DL, 0}, {HV | HC, 1}, {HV | HC | CACHED, 1}, {DL | HV | HC, 0}}),
+        .resizableBar        = true,
+        .unifiedMemory       = false,
+        .lazilyAllocated     = false,
+        .gpuOnly             = 0, // host visible VRAM is kept for CPU written data
+        .upload              = 1,
+        .perFrame            = 3,
+        .readback            = 2,
+        .transientAttachment = 0,
+    },
+    {
+        // Integrated GPU: a single device local heap in system memory
+        .name       = "integrated",
+        .properties = MakeProperties(
+            {{12 * GiB, HEAP_DL}},
+            {{DL, 0}, {DL | HV | HC, 0}, {DL | HV | HC | CACHED, 0}}),
+        .resizableBar        = false,
+        .unifiedMemory       = true,
+        .lazilyAllocated     = false,
+        .gpuOnly             = 0,
+        .upload              = 1,
+        .perFrame            = 1,
+        .readback            = 2,
+        .transientAttachment = 0,
+    },
+    {
+        // lavapipe: one type that has every host flag
+        .name       = "lavapipe",
+        .properties = MakeProperties(
+            {{2 * GiB, HEAP_DL}},
+            {{DL | HV | HC | CACHED, 0}}),
+        .resizableBar        = false,
+        .unifiedMemory       = true,
+        .lazilyAllocated     = false,
+        .gpuOnly             = 0,
+        .upload              = 0,
+        .perFrame            = 0,
+        .readback            = 0,
+        .transientAttachment = 0,
+    },
+    {
+        // Tile based GPU: transient attachments can stay in tile memory
+        .name       = "tiler",
+        .properties = MakeProperties(
+            {{4 * GiB, HEAP_DL}},
+            {{DL | LAZY, 0}, {DL, 0}, {DL | HV | HC, 0}, {DL | HV | HC | CACHED, 0}}),
+        .resizableBar        = false,
+        .unifiedMemory       = true,
+        .lazilyAllocated     = true,
+        .gpuOnly             = 1, // lazily allocated memory only when asked for
+        .upload              = 2,
+        .perFrame            = 2,
+        .readback            = 3,
+        .transientAttachment = 0,
+    },
+};
+
+const LookupCase g_lookups[] = {
+    // Small BAR: the window is still used when the resource allows nothing else
+    {"small BAR, BAR type only", 0, 1u << 3, MemoryUsage::PerFrame, 16 * MiB, 3},
+    // ... but not for a resource larger than the window
+    {"small BAR, larger than the window", 0, 1u << 3, MemoryUsage::PerFrame, 300 * MiB, NONE},
+    {"small BAR, larger than the window, any type", 0, ALL_TYPES, MemoryUsage::PerFrame, 300 * MiB, 1},
+    // GPU only data falls back to host visible VRAM when the resource requires it
+    {"small BAR, GPU only on the BAR", 0, (1u << 1) | (1u << 3), MemoryUsage::GpuOnly, 0, 3},
+    {"small BAR, GPU only without device local", 0, (1u << 1) | (1u << 2), MemoryUsage::GpuOnly, 0, NONE},
+    // Resizable BAR: large per-frame buffers still fit into VRAM
+    {"resizable BAR, 1 GiB per-frame", 1, ALL_TYPES, MemoryUsage::PerFrame, 1 * GiB, 3},
+    {"resizable BAR, upload without system memory", 1, (1u << 0) | (1u << 3), MemoryUsage::Upload, 0, 3},
+    // A size of zero skips the heap check
+    {"integrated, no size", 2, ALL_TYPES, MemoryUsage::GpuOnly, 0, 0},
+    {"integrated, larger than the heap", 2, ALL_TYPES, MemoryUsage::GpuOnly, 16 * GiB, NONE},
+    {"lavapipe, no matching bits", 3, 0, MemoryUsage::GpuOnly, 0, NONE},
+    // Without a plain device local type the tiler's lazily allocated type is still never used for GPU only data
+    {"tiler, lazy type only", 4, 1u << 0, MemoryUsage::GpuOnly, 0, NONE},
+};
+
+// Reports the case by name, the table rows are not on separate source lines
+void CheckEqual(const char* caseName, const char* what, uint32_t actual, uint32_t expected)
+{
+    if (actual != expected) {
+        printf("[FAIL] %s: %s is %d, expected %d\n", caseName, what, (int32_t)actual, (int32_t)expected);
+        g_checkFailures++;
+    }
+}
+
+void TestLayouts()
+{
+    for (const LayoutCase& layout : g_layouts) {
+        const MemoryTypePolicy policy(layout.properties);
+
+        CheckEqual(layout.name, "resizable BAR", policy.HasResizableBar(), layout.resizableBar);
+        CheckEqual(layout.name, "unified memory", policy.IsUnifiedMemory(), layout.unifiedMemory);
+        CheckEqual(layout.name, "lazily allocated", policy.HasLazilyAllocatedMemory(), layout.lazilyAllocated);
+
+        CheckEqual(layout.name, "GpuOnly type", policy.FindMemoryType(ALL_TYPES, MemoryUsage::GpuOnly), layout.gpuOnly);
+        CheckEqual(layout.name, "Upload type", policy.FindMemoryType(ALL_TYPES, MemoryUsage::Upload), layout.upload);
+        CheckEqual(layout.name, "PerFrame type", policy.FindMemoryType(ALL_TYPES, MemoryUsage::PerFrame),
+                   layout.perFrame);
+        CheckEqual(layout.name, "Readback type", policy.FindMemoryType(ALL_TYPES, MemoryUsage::Readback),
+                   layout.readback);
+        CheckEqual(layout.name, "TransientAttachment type",
+                   policy.FindMemoryType(ALL_TYPES, MemoryUsage::TransientAttachment), layout.transientAttachment);
+    }
+}
+
+void TestLookups()
+{
+    for (const LookupCase& lookup : g_lookups) {
+        const MemoryTypePolicy policy(g_layouts[lookup.layoutIdx].properties);
+
+        CheckEqual(lookup.name, "type", policy.FindMemoryType(lookup.memoryTypeBits, lookup.usage, lookup.size),
+                   lookup.expected);
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    TestLayouts();
+    TestLookups();
+
+    return TestResult("memory_type_policy_test");
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "pixel_convert.h"
+#include "test_util.h"
+
+namespace {
+
+// Every pixel count up to a few AVX2 iterations, so each tail length is hit on every level:
+// the RGB expansion stops up to 2 pixels early for the over-reading loads, the others run on blocks of 4 or 8.
+constexpr size_t MAX_PIXEL_COUNT = 70;
+
+const char* LevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::SSE41: return "SSE4.1";
+    case SimdLevel::Scalar: break;
+    }
+    return "scalar";
+}
+
+std::vector<uint8_t> RandomBytes(std::mt19937& random, size_t size)
+{
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes) {
+        byte = (uint8_t)random();
+    }
+    return bytes;
+}
+
+// The buffers are sized exactly, a kernel reading or writing past the pixels is caught by the sanitizers.
+// Each kernel runs on the scalar level first, its output is what the SIMD levels must produce.
+struct KernelCase {
+    const char* name;
+    size_t      srcPixelSize;
+    size_t      dstPixelSize;
+    void (*run)(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+};
+
+const uint8_t BGRA_ORDER[4]    = {2, 1, 0, 3};
+const uint8_t REVERSE_ORDER[4] = {3, 2, 1, 0};
+const uint8_t BROADCAST[4]     = {1, 1, 1, 0};
+
+const KernelCase g_kernels[] = {
+    {"ExpandRGBToRGBA", 3, 4,
+     [](const uint8_t* src, uint8_t* dst, size_t count) { ExpandRGBToRGBA(src, dst, count); }},
+    {"SwizzleRGBA BGRA", 4, 4,
+     [](const uint8_t* src, uint8_t* dst, size_t count) { SwizzleRGBA(src, dst, count, BGRA_ORDER); }},
+    {"SwizzleRGBA reverse", 4, 4,
+     [](const uint8_t* src, uint8_t* dst, size_t count) { SwizzleRGBA(src, dst, count, REVERSE_ORDER); }},
+    {"SwizzleRGBA broadcast", 4, 4,
+     [](const uint8_t* src, uint8_t* dst, size_t count) { SwizzleRGBA(src, dst, count, BROADCAST); }},
+    {"PackRG", 4, 2, [](const uint8_t* src, uint8_t* dst, size_t count) { PackRG(src, dst, count); }},
+    {"PremultiplyAlpha", 4, 4,
+     [](const uint8_t* src, uint8_t* dst, size_t count) {
+         std::copy(src, src + count * 4, dst);
+         PremultiplyAlpha(dst, count);
+     }},
+};
+
+std::vector<uint8_t> RunKernel(const KernelCase& kernel, SimdLevel level, const std::vector<uint8_t>& src,
+                               size_t pixelCount)
+{
+    SetPixelConvertSimdLevel(level);
+
+    std::vector<uint8_t> dst(pixelCount * kernel.dstPixelSize);
+    kernel.run(src.data(), dst.data(), pixelCount);
+    return dst;
+}
+
+void TestKernelsMatchScalar(SimdLevel level)
+{
+    std::mt19937 random(42);
+
+    for (const KernelCase& kernel : g_kernels) {
+        for (size_t pixelCount = 0; pixelCount <= MAX_PIXEL_COUNT; pixelCount++) {
+            const std::vector<uint8_t> src = RandomBytes(random, pixelCount * kernel.srcPixelSize);
+
+            const std::vector<uint8_t> expected = RunKernel(kernel, SimdLevel::Scalar, src, pixelCount);
+            const std::vector<uint8_t> actual   = RunKernel(kernel, level, src, pixelCount);
+
+            if (actual != expected) {
+                printf("[FAIL] %s: %s differs from the scalar kernel for %zu pixels\n", LevelName(level), kernel.name,
+                       pixelCount);
+                g_checkFailures++;
+                break;
+            }
+        }
+    }
+}
+
+// The lanes of the RG pack are put together by a permute, a lane mixup only shows with distinct pixels
+void TestPackRGOrder(SimdLevel level)
+{
+    SetPixelConvertSimdLevel(level);
+
+    constexpr size_t     PIXEL_COUNT = 16;
+    std::vector<uint8_t> src(PIXEL_COUNT * 4);
+    for (size_t idx = 0; idx < PIXEL_COUNT; idx++) {
+        src[idx * 4 + 0] = (uint8_t)(idx * 2);
+        src[idx * 4 + 1] = (uint8_t)(idx * 2 + 1);
+        src[idx * 4 + 2] = 0xee;
+        src[idx * 4 + 3] = 0xff;
+    }
+
+    std::vector<uint8_t> dst(PIXEL_COUNT * 2);
+    PackRG(src.data(), dst.data(), PIXEL_COUNT);
+
+    for (size_t idx = 0; idx < dst.size(); idx++) {
+        CHECK(dst[idx] == idx);
+    }
+}
+
+// Every color and alpha pair against the exact rounded result
+void TestPremultiplyExact(SimdLevel level)
+{
+    SetPixelConvertSimdLevel(level);
+
+    std::vector<uint8_t> pixels(256 * 256 * 4);
+    for (uint32_t alpha = 0; alpha < 256; alpha++) {
+        for (uint32_t color = 0; color < 256; color++) {
+            uint8_t* pixel = pixels.data() + (alpha * 256 + color) * 4;
+            pixel[0]       = (uint8_t)color;
+            pixel[1]       = (uint8_t)(255 - color);
+            pixel[2]       = (uint8_t)color;
+            pixel[3]       = (uint8_t)alpha;
+        }
+    }
+
+    PremultiplyAlpha(pixels.data(), 256 * 256);
+
+    uint32_t mismatches = 0;
+    for (uint32_t alpha = 0; alpha < 256; alpha++) {
+        for (uint32_t color = 0; color < 256; color++) {
+            const uint8_t* pixel = pixels.data() + (alpha * 256 + color) * 4;
+            mismatches += pixel[0] != (color * alpha + 127) / 255;
+            mismatches += pixel[1] != ((255 - color) * alpha + 127) / 255;
+            mismatches += pixel[3] != alpha;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+// In place swizzle, the conversion of the BGRA formats runs it on its own output
+void TestSwizzleInPlace(SimdLevel level)
+{
+    SetPixelConvertSimdLevel(level);
+
+    std::mt19937               random(7);
+    const std::vector<uint8_t> src = RandomBytes(random, 37 * 4);
+
+    std::vector<uint8_t> pixels = src;
+    SwizzleRGBA(pixels.data(), pixels.data(), 37, BGRA_ORDER);
+
+    for (size_t idx = 0; idx < 37; idx++) {
+        CHECK(pixels[idx * 4 + 0] == src[idx * 4 + 2]);
+        CHECK(pixels[idx * 4 + 2] == src[idx * 4 + 0]);
+        CHECK(pixels[idx * 4 + 1] == src[idx * 4 + 1]);
+        CHECK(pixels[idx * 4 + 3] == src[idx * 4 + 3]);
+    }
+}
+
+} // anonymous namespace
+
+int main()
+{
+    const SimdLevel supported = SetPixelConvertSimdLevel(SimdLevel::AVX2);
+    printf("pixel_convert_test: CPU supports %s\n", LevelName(supported));
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2}) {
+        if (level > supported) {
+            printf("pixel_convert_test: %s is not available, skipped\n", LevelName(level));
+            continue;
+        }
+
+        TestKernelsMatchScalar(level);
+        TestPackRGOrder(level);
+        TestPremultiplyExact(level);
+        TestSwizzleInPlace(level);
+    }
+
+    return TestResult("pixel_convert_test");
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks for the CPU-only tests of the lib. A failed check is reported and the test goes on,
+// TestResult() turns the failures into the exit code ctest looks at.
+
+inline int g_checkFailures = 0;
+
+#define CHECK(expr)                                                             \
+    do {                                                                        \
+        if (!(expr)) {                                                          \
+            printf("[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #expr);            \
+            g_checkFailures++;                                                  \
+        }                                                                       \
+    } while (0)
+
+inline int TestResult(const char* name)
+{
+    if (g_checkFailures > 0) {
+        printf("%s: %d check(s) failed\n", name, g_checkFailures);
+        return 1;
+    }
+
+    printf("%s: passed\n", name);
+    return 0;
+}
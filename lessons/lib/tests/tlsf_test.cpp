@@ -0,0 +1,275 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "test_util.h"
+#include "tlsf.h"
+
+namespace {
+
+constexpr uint64_t KiB = 1024;
+constexpr uint64_t MiB = 1024 * KiB;
+
+// Allocations tracked next to the allocator, checked for overlaps and against its byte counts
+struct Reference {
+    std::map<uint64_t, TLSFAllocator::Allocation> byOffset;
+    uint64_t                                      usedBytes = 0;
+
+    bool Add(const TLSFAllocator::Allocation& allocation, uint64_t blockSize)
+    {
+        if (allocation.offset + allocation.size > blockSize) {
+            return false;
+        }
+
+        const auto next = byOffset.lower_bound(allocation.offset);
+        if (next != byOffset.end() && next->first < allocation.offset + allocation.size) {
+            return false;
+        }
+        if (next != byOffset.begin()) {
+            const auto prev = std::prev(next);
+            if (prev->first + prev->second.size > allocation.offset) {
+                return false;
+            }
+        }
+
+        byOffset.emplace(allocation.offset, allocation);
+        usedBytes += allocation.size;
+        return true;
+    }
+
+    void Remove(uint64_t offset)
+    {
+        usedBytes -= byOffset.at(offset).size;
+        byOffset.erase(offset);
+    }
+};
+
+void TestAlignment()
+{
+    TLSFAllocator allocator(4 * MiB);
+    Reference     reference;
+
+    const uint64_t alignments[] = {1, 4, 16, 256, 4 * KiB, 64 * KiB};
+    const uint64_t sizes[]      = {1, 3, 100, 255, 256, 1000, 4097, 70000};
+
+    for (uint64_t alignment : alignments) {
+        for (uint64_t size : sizes) {
+            TLSFAllocator::Allocation allocation;
+            CHECK(allocator.Allocate(size, alignment, &allocation));
+            CHECK(allocation.offset % alignment == 0);
+            CHECK(allocation.size == size);
+            CHECK(reference.Add(allocation, allocator.Size()));
+        }
+    }
+
+    CHECK(allocator.UsedBytes() == reference.usedBytes);
+    CHECK(allocator.AllocationCount() == reference.byOffset.size());
+
+    // An alignment of 0 is treated as 1
+    TLSFAllocator::Allocation unaligned;
+    CHECK(allocator.Allocate(7, 0, &unaligned));
+    CHECK(reference.Add(unaligned, allocator.Size()));
+
+    for (const auto& [offset, allocation] : reference.byOffset) {
+        allocator.Free(allocation.node);
+    }
+
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.UsedBytes() == 0);
+    CHECK(allocator.FreeRegionCount() == 1);
+    CHECK(allocator.LargestFreeRegion() == allocator.Size());
+}
+
+void TestSplitMerge()
+{
+    TLSFAllocator allocator(1 * MiB);
+
+    TLSFAllocator::Allocation a;
+    TLSFAllocator::Allocation b;
+    TLSFAllocator::Allocation c;
+    CHECK(allocator.Allocate(4 * KiB, 1, &a));
+    CHECK(allocator.Allocate(4 * KiB, 1, &b));
+    CHECK(allocator.Allocate(4 * KiB, 1, &c));
+
+    // Each allocation is split from the front of the remaining region
+    CHECK(a.offset == 0);
+    CHECK(b.offset == 4 * KiB);
+    CHECK(c.offset == 8 * KiB);
+    CHECK(allocator.FreeRegionCount() == 1);
+    CHECK(allocator.LargestFreeRegion() == 1 * MiB - 12 * KiB);
+
+    // A hole between two allocations stays a region of its own
+    allocator.Free(b.node);
+    CHECK(allocator.FreeRegionCount() == 2);
+
+    // Freeing the left neighbour merges it with the hole
+    allocator.Free(a.node);
+    CHECK(allocator.FreeRegionCount() == 2);
+
+    TLSFAllocator::Allocation merged;
+    CHECK(allocator.Allocate(8 * KiB, 1, &merged));
+    CHECK(merged.offset == 0);
+    CHECK(allocator.FreeRegionCount() == 1);
+
+    // Freeing the allocation between two free regions merges all three
+    allocator.Free(merged.node);
+    allocator.Free(c.node);
+    CHECK(allocator.FreeRegionCount() == 1);
+    CHECK(allocator.LargestFreeRegion() == 1 * MiB);
+    CHECK(allocator.IsEmpty());
+
+    // Alignment padding is kept as a free region and merged back on free
+    TLSFAllocator::Allocation small;
+    TLSFAllocator::Allocation aligned;
+    CHECK(allocator.Allocate(100, 1, &small));
+    CHECK(allocator.Allocate(256, 256, &aligned));
+    CHECK(aligned.offset == 256);
+    CHECK(allocator.FreeRegionCount() == 2);
+    CHECK(allocator.UsedBytes() == 356);
+
+    allocator.Free(small.node);
+    allocator.Free(aligned.node);
+    CHECK(allocator.FreeRegionCount() == 1);
+    CHECK(allocator.LargestFreeRegion() == 1 * MiB);
+}
+
+void TestFragmentation()
+{
+    constexpr uint64_t SLOT_SIZE  = 16 * KiB;
+    constexpr uint32_t SLOT_COUNT = 64;
+
+    TLSFAllocator allocator(SLOT_SIZE * SLOT_COUNT);
+    CHECK(allocator.Fragmentation() == 0.0f);
+
+    std::vector<TLSFAllocator::Allocation> slots(SLOT_COUNT);
+    for (TLSFAllocator::Allocation& slot : slots) {
+        CHECK(allocator.Allocate(SLOT_SIZE, 1, &slot));
+    }
+    CHECK(allocator.FreeBytes() == 0);
+    CHECK(allocator.Fragmentation() == 0.0f);
+
+    // Every other slot free: half of the block is free but no region is larger than one slot
+    for (uint32_t idx = 0; idx < SLOT_COUNT; idx += 2) {
+        allocator.Free(slots[idx].node);
+    }
+    CHECK(allocator.FreeBytes() == SLOT_SIZE * SLOT_COUNT / 2);
+    CHECK(allocator.FreeRegionCount() == SLOT_COUNT / 2);
+    CHECK(allocator.LargestFreeRegion() == SLOT_SIZE);
+    CHECK(allocator.Fragmentation() > 0.9f);
+
+    TLSFAllocator::Allocation tooLarge;
+    CHECK(!allocator.Allocate(2 * SLOT_SIZE, 1, &tooLarge));
+
+    // The holes are still usable for allocations that fit
+    TLSFAllocator::Allocation fits;
+    CHECK(allocator.Allocate(SLOT_SIZE, 1, &fits));
+    CHECK(fits.offset % (2 * SLOT_SIZE) == 0);
+    allocator.Free(fits.node);
+
+    for (uint32_t idx = 1; idx < SLOT_COUNT; idx += 2) {
+        allocator.Free(slots[idx].node);
+    }
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.FreeRegionCount() == 1);
+    CHECK(allocator.Fragmentation() == 0.0f);
+}
+
+void TestExhaustion()
+{
+    constexpr uint64_t BLOCK_SIZE = 1 * MiB;
+
+    TLSFAllocator allocator(BLOCK_SIZE);
+
+    TLSFAllocator::Allocation allocation;
+    CHECK(!allocator.Allocate(BLOCK_SIZE + 1, 1, &allocation));
+    // The worst case alignment padding must fit as well
+    CHECK(!allocator.Allocate(BLOCK_SIZE, 2, &allocation));
+
+    // Without alignment the allocations fill the block to the last byte
+    std::vector<TLSFAllocator::Allocation> allocations;
+    while (allocator.Allocate(4 * KiB, 1, &allocation)) {
+        allocations.push_back(allocation);
+    }
+
+    CHECK(allocations.size() == BLOCK_SIZE / (4 * KiB));
+    CHECK(allocator.FreeBytes() == 0);
+    CHECK(allocator.FreeRegionCount() == 0);
+    CHECK(allocator.LargestFreeRegion() == 0);
+    CHECK(!allocator.Allocate(1, 1, &allocation));
+
+    // A freed allocation can be handed out again
+    allocator.Free(allocations[10].node);
+    CHECK(allocator.Allocate(4 * KiB, 1, &allocation));
+    CHECK(allocation.offset == allocations[10].offset);
+    allocations[10] = allocation;
+
+    for (const TLSFAllocator::Allocation& it : allocations) {
+        allocator.Free(it.node);
+    }
+    CHECK(allocator.IsEmpty());
+
+    // Reset drops every allocation at once
+    CHECK(allocator.Allocate(BLOCK_SIZE, 1, &allocation));
+    allocator.Reset(BLOCK_SIZE / 2);
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.Size() == BLOCK_SIZE / 2);
+    CHECK(allocator.LargestFreeRegion() == BLOCK_SIZE / 2);
+}
+
+void TestRandomized()
+{
+    constexpr uint64_t BLOCK_SIZE = 16 * MiB;
+
+    TLSFAllocator allocator(BLOCK_SIZE);
+    Reference     reference;
+    std::mt19937  random(1234);
+
+    std::uniform_int_distribution<uint64_t> sizeDist(1, 256 * KiB);
+    std::uniform_int_distribution<uint32_t> alignmentLog2Dist(0, 12);
+
+    for (uint32_t step = 0; step < 20000; step++) {
+        const bool doFree = !reference.byOffset.empty() && (random() % 100) < 45;
+        if (doFree) {
+            auto it = reference.byOffset.begin();
+            std::advance(it, random() % reference.byOffset.size());
+
+            allocator.Free(it->second.node);
+            reference.Remove(it->first);
+        } else {
+            const uint64_t alignment = 1ull << alignmentLog2Dist(random);
+
+            TLSFAllocator::Allocation allocation;
+            if (allocator.Allocate(sizeDist(random), alignment, &allocation)) {
+                CHECK(allocation.offset % alignment == 0);
+                CHECK(reference.Add(allocation, BLOCK_SIZE));
+            }
+        }
+
+        CHECK(allocator.UsedBytes() == reference.usedBytes);
+        CHECK(allocator.AllocationCount() == reference.byOffset.size());
+        if (g_checkFailures > 0) {
+            return;
+        }
+    }
+
+    for (const auto& [offset, allocation] : reference.byOffset) {
+        allocator.Free(allocation.node);
+    }
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.FreeRegionCount() == 1);
+    CHECK(allocator.LargestFreeRegion() == BLOCK_SIZE);
+}
+
+} // anonymous namespace
+
+int main()
+{
+    TestAlignment();
+    TestSplitMerge();
+    TestFragmentation();
+    TestExhaustion();
+    TestRandomized();
+
+    return TestResult("tlsf_test");
+}
@@ -1,14 +1,104 @@
 #include "texture.h"
 
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+
 #include <vulkan/vulkan_core.h>
 
-#include "buffer.h"
+#include "ktx2.h"
+#include "memory_allocator.h"
+#include "pixel_convert.h"
+#include "sampler_cache.h"
 #include "stb_image.h"
+#include "texture_disk_cache.h"
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>* outData) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    outData->resize((size_t)file.tellg());
+    file.seekg(0);
+
+    return (bool)file.read((char*)outData->data(), (std::streamsize)outData->size());
+}
+
+// Channels of the formats the textures are created with, 0 for formats without a known layout
+static uint32_t FormatChannelCount(const VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        return 2;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        return 3;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static bool IsSrgbFormat(const VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A baked image can stand in for the source when it has the requested channels and can be sampled the same way:
+// a BC7 bake of a normal map is no R8G8 texture, a BC5 one can not be sampled as sRGB.
+// RGB blocks are accepted for 4 channel formats, their alpha reads as 1 like the alpha of a decoded RGB file.
+static bool IsCompatibleKtx2Format(const VkFormat requested, const VkFormat baked) {
+    const uint32_t requestedChannels = FormatChannelCount(requested);
+    const uint32_t bakedChannels     = FormatChannelCount(baked);
+
+    const bool sameLayout = (requestedChannels == bakedChannels) || (requestedChannels == 4 && bakedChannels == 3);
+    if (requestedChannels == 0 || !sameLayout) {
+        return false;
+    }
+
+    if (IsSrgbFormat(requested)) {
+        // UNORM blocks are sampled through their sRGB variant, see AcceptKtx2
+        return IsSrgbFormat(SrgbBlockFormat(baked));
+    }
+
+    return !IsSrgbFormat(baked);
+}
 
 VkImageView Create2DImageView(
     const VkDevice  device,
     const VkFormat  format,
-    const VkImage   image) {
+    const VkImage   image,
+    uint32_t        mipLevels) {
 
     VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     if (format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D32_SFLOAT_S8_UINT) {
@@ -30,7 +120,7 @@ VkImageView Create2DImageView(
         .subresourceRange = {
             .aspectMask     = aspectMask,
             .baseMipLevel   = 0,
-            .levelCount     = 1,
+            .levelCount     = mipLevels,
             .baseArrayLayer = 0,
             .layerCount     = 1,
         }
@@ -101,122 +191,330 @@ ImageInfo Texture::Create2DImage(
 
 */
 
-static uint32_t FindMemoryTypeIndex(const VkPhysicalDevice phyDevice, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags) {
-    VkPhysicalDeviceMemoryProperties memoryProperties = {};
-    vkGetPhysicalDeviceMemoryProperties(phyDevice, &memoryProperties);
+Texture *Texture::LoadFromFile(
+    const VkPhysicalDevice  phyDevice,
+    const VkDevice          device,
+    UploadManager&          uploads,
+    const std::string&      path,
+    const VkFormat          format,
+    VkImageUsageFlags       usage,
+    const TextureDiskCache* diskCache) {
 
-    for (uint32_t idx = 0; idx < memoryProperties.memoryTypeCount; idx++) {
-        if (requirements.memoryTypeBits & (1 << idx)) {
-            const VkMemoryType& memoryType = memoryProperties.memoryTypes[idx];
-            // TODO: add size check?
+    DecodedImage image;
+    if (!DecodeFile(phyDevice, path, format, &image, diskCache)) {
+        return nullptr;
+    }
 
-            if (memoryType.propertyFlags & flags) {
-                return idx;
-            }
+    return CreateFromDecoded(phyDevice, device, uploads, image, usage);
+}
+
+bool Texture::DecodeFile(
+    const VkPhysicalDevice  phyDevice,
+    const std::string&      path,
+    const VkFormat          format,
+    DecodedImage*           outImage,
+    const TextureDiskCache* diskCache) {
+
+    // Prefer the baked, block compressed version of the image ("<image>.ktx2" made by texbake)
+    if (std::filesystem::path(path).extension() == ".ktx2") {
+        return DecodeKtx2(phyDevice, path, format, outImage);
+    }
+
+    const std::string ktxPath = path + ".ktx2";
+    Ktx2Image         baked;
+    if (std::filesystem::exists(ktxPath) && LoadKtx2(ktxPath, &baked)) {
+        if (!IsCompatibleKtx2Format(format, baked.format)) {
+            printf("[WARNING] Texture: '%s' (format %d) does not fit format %d, decoding '%s'\n", ktxPath.c_str(),
+                   baked.format, format, path.c_str());
+        } else if (AcceptKtx2(phyDevice, ktxPath, format, baked, outImage)) {
+            outImage->mips = std::move(baked.mips);
+            return true;
         }
     }
 
-    return (uint32_t)-1;
+    std::vector<uint8_t> source;
+    if (!ReadFile(path, &source)) {
+        printf("[ERROR] Failed to load image: %s\n", path.c_str());
+        return false;
+    }
+
+    // Hashing the file is much cheaper than decoding it, a hit skips the decode and the mip generation
+    const bool useDiskCache = (diskCache != nullptr) && diskCache->IsEnabled();
+    uint64_t   sourceHash   = 0;
+    if (useDiskCache) {
+        sourceHash = TextureDiskCache::HashContent(source.data(), source.size());
+
+        if (diskCache->Load(sourceHash, format, outImage)) {
+            outImage->path = path;
+            printf("Loaded image: %s (%ux%u, disk cache)\n", path.c_str(), outImage->width, outImage->height);
+            return true;
+        }
+    }
+
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t channels = 0;
+
+    // Decoded with the channels of the file, the conversion kernels build the texels of the format
+    uint8_t *data = stbi_load_from_memory(source.data(), (int)source.size(), &width, &height, &channels, 0);
+    if (!data) {
+        printf("[ERROR] Failed to decode image: %s\n", path.c_str());
+        return false;
+    }
+
+    printf("Loaded image: %s (%dx%d)\n", path.c_str(), width, height);
+
+    // Linear blits need the format features, without them the chain is built on the CPU
+    VkFormatProperties formatProperties = {};
+    vkGetPhysicalDeviceFormatProperties(phyDevice, format, &formatProperties);
+
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT
+                                            | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                                            | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    outImage->path         = path;
+    outImage->format       = format;
+    outImage->width        = width;
+    outImage->height       = height;
+    outImage->mipLevels    = MipLevelCount(width, height);
+    outImage->generateMips = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+    // The cache stores the complete chain, it is built on the CPU once and reused on every later start
+    if (useDiskCache) {
+        outImage->generateMips = false;
+    }
+
+    const PixelConversion conversion = ChoosePixelConversion(format);
+    const uint64_t        rawSize    = (uint64_t)width * height * conversion.pixelSize;
+
+    if (outImage->generateMips) {
+        outImage->mips.levels = { { (uint32_t)width, (uint32_t)height, 0, rawSize } };
+        outImage->mips.data.resize(rawSize);
+        ConvertPixels(conversion, data, channels, outImage->mips.data.data(), (size_t)width * height);
+    } else {
+        std::vector<uint8_t> texels(rawSize);
+        ConvertPixels(conversion, data, channels, texels.data(), (size_t)width * height);
+
+        outImage->mips = BuildMipChain(texels.data(), width, height, outImage->mipLevels, conversion.pixelSize,
+                                       conversion.srgb);
+    }
+
+    stbi_image_free(data);
+
+    if (useDiskCache) {
+        diskCache->Store(sourceHash, *outImage);
+    }
+
+    return true;
 }
 
-bool Texture::InitFromBuffer(
+bool Texture::DecodeKtx2(
     const VkPhysicalDevice  phyDevice,
-    const VkDevice          device,
-    const VkQueue           queue,
-    const VkCommandPool     cmdPool,
-    VkImageUsageFlags       usage,
-    const VkBuffer          buffer) {
+    const std::string&      path,
+    const VkFormat          format,
+    DecodedImage*           outImage) {
 
-    CreateImage(phyDevice, device, usage);
+    Ktx2Image image;
+    if (!LoadKtx2(path, &image)) {
+        return false;
+    }
 
-    UploadFromBuffer(device, queue, cmdPool, buffer);
+    if (!AcceptKtx2(phyDevice, path, format, image, outImage)) {
+        return false;
+    }
 
-    m_view = Create2DImageView(device, m_format, m_image);
-    Create2DSampler(device);
+    outImage->mips = std::move(image.mips);
+
+    return true;
+}
+
+bool Texture::AcceptKtx2(
+    const VkPhysicalDevice  phyDevice,
+    const std::string&      name,
+    const VkFormat          format,
+    const Ktx2Image&        image,
+    DecodedImage*           outImage) {
+
+    // The bake tool stores UNORM data, sample it as sRGB when the caller asked for an sRGB format
+    VkFormat imageFormat = image.format;
+    if (format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB) {
+        imageFormat = SrgbBlockFormat(image.format);
+    }
+
+    VkFormatProperties formatProperties = {};
+    vkGetPhysicalDeviceFormatProperties(phyDevice, imageFormat, &formatProperties);
+
+    const VkFormatFeatureFlags sampleFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+                                              | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((formatProperties.optimalTilingFeatures & sampleFeatures) != sampleFeatures) {
+        printf("[WARNING] Texture: format %d of '%s' is not supported by the device\n", imageFormat, name.c_str());
+        return false;
+    }
+
+    printf("Loaded image: %s (%ux%u, %zu levels)\n", name.c_str(), image.width, image.height,
+           image.mips.levels.size());
+
+    outImage->path         = name;
+    outImage->format       = imageFormat;
+    outImage->width        = image.width;
+    outImage->height       = image.height;
+    outImage->mipLevels    = (uint32_t)image.mips.levels.size();
+    outImage->generateMips = false;
 
     return true;
 }
 
-/*
 Texture *Texture::LoadFromData(
     const VkPhysicalDevice  phyDevice,
     const VkDevice          device,
-    const VkQueue           queue,
-    const VkCommandPool     cmdPool,
-    const std::string&      path,
+    UploadManager&          uploads,
+    const std::string&      name,
+    const uint8_t*          data,
+    size_t                  size,
     const VkFormat          format,
     VkImageUsageFlags       usage) {
 
-    struct Resource rs = GetResource(path.c_str());
-
-    if (rs.data == nullptr) {
-        printf("[ERROR] Resource: '%s' not found\n", path.c_str());
+    DecodedImage decoded;
+    if (!DecodeData(phyDevice, name, data, size, format, &decoded)) {
         return nullptr;
     }
 
-    int32_t width = 0;
-    int32_t height = 0;
-    int32_t channels = 0;
+    return CreateFromDecoded(phyDevice, device, uploads, decoded, usage);
+}
 
-    uint8_t *data = stbi_load_from_memory(rs.data, rs.size, &width, &height, &channels, 4);
-    if (!data) {
-        return nullptr;
+bool Texture::DecodeData(
+    const VkPhysicalDevice  phyDevice,
+    const std::string&      name,
+    const uint8_t*          data,
+    size_t                  size,
+    const VkFormat          format,
+    DecodedImage*           outImage) {
+
+    Ktx2Image image;
+    if (!ParseKtx2(data, size, &image, name.c_str()) || image.mips.levels.empty()) {
+        printf("[ERROR] Failed to load embedded image: %s\n", name.c_str());
+        return false;
     }
 
-    printf("Loaded (rs) image: %s (%dx%d)\n", path.c_str(), width, height);
+    if (!IsCompatibleKtx2Format(format, image.format)) {
+        printf("[WARNING] Texture: embedded '%s' (format %d) does not fit format %d\n", name.c_str(), image.format,
+               format);
+        return false;
+    }
 
-    // 2) Upload image data to a staging buffer
-    const uint32_t rawSize = width * height * 4;
-    BufferInfo rawBuffer = BufferInfo::Create(phyDevice, device, rawSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    rawBuffer.Update(device, data, rawSize);
+    if (!AcceptKtx2(phyDevice, name, format, image, outImage)) {
+        return false;
+    }
 
-    stbi_image_free(data);
+    // The levels are stored from the smallest, the staging copy starts at the first stored level
+    // instead of the header. The upload reads straight from 'data', nothing is copied before it.
+    uint64_t first = image.mips.levels[0].offset;
+    uint64_t end   = 0;
+    for (const MipLevel& level : image.mips.levels) {
+        first = std::min(first, level.offset);
+        end   = std::max(end, level.offset + level.size);
+    }
 
-    Texture *texture = new Texture(format, width, height);
-    texture->InitFromBuffer(phyDevice, device, queue, cmdPool, usage, rawBuffer.buffer);
+    for (MipLevel& level : image.mips.levels) {
+        level.offset -= first;
+    }
 
-    rawBuffer.Destroy(device);
+    outImage->mips       = std::move(image.mips);
+    outImage->mappedData = data + first;
+    outImage->mappedSize = end - first;
 
-    return texture;
+    return true;
 }
-*/
 
-Texture *Texture::LoadFromFile(
+Texture *Texture::CreateFromDecoded(
     const VkPhysicalDevice  phyDevice,
     const VkDevice          device,
-    const VkQueue           queue,
-    const VkCommandPool     cmdPool,
-    const std::string&      path,
-    const VkFormat          format,
+    UploadManager&          uploads,
+    const DecodedImage&     image,
     VkImageUsageFlags       usage) {
 
-    // 1) Load the image file contents
-    int32_t width = 0;
-    int32_t height = 0;
-    int32_t channels = 0;
+    Texture *texture = new Texture(image.format, image.width, image.height);
+    texture->m_mipLevels = image.mipLevels;
 
-    uint8_t *data = stbi_load(path.c_str(), &width, &height, &channels, 4);
-    if (!data) {
+    if (image.generateMips && image.mipLevels > 1) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
+    if (texture->CreateImage(phyDevice, device, usage) != VK_SUCCESS) {
+        delete texture;
         return nullptr;
     }
 
-    printf("Loaded image: %s (%dx%d)\n", path.c_str(), width, height);
+    // The texels are copied into the staging ring, the decoded image can be freed right away
+    if (image.generateMips) {
+        texture->m_uploadTicket = uploads.UploadImageGenerateMips(texture->m_image, {image.width, image.height, 1},
+                                                                  image.Data(), image.DataSize(), image.mipLevels);
+    } else {
+        texture->UploadMipChain(uploads, image.mips.levels, image.Data(), image.DataSize());
+    }
 
-    // 2) Upload image data to a staging buffer
-    const uint32_t rawSize = width * height * 4;
-    BufferInfo rawBuffer = BufferInfo::Create(phyDevice, device, rawSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-    rawBuffer.Update(device, data, rawSize);
+    texture->m_view = Create2DImageView(device, image.format, texture->m_image, texture->m_mipLevels);
+    texture->Create2DSampler(device);
 
-    stbi_image_free(data);
+    return texture;
+}
+
+Texture *Texture::CreateFromDecodedLevels(
+    const VkPhysicalDevice  phyDevice,
+    const VkDevice          device,
+    UploadManager&          uploads,
+    const DecodedImage&     image,
+    uint32_t                baseLevel,
+    VkImageUsageFlags       usage) {
+
+    assert(!image.generateMips && baseLevel < image.mips.levels.size());
+
+    const MipLevel& base = image.mips.levels[baseLevel];
+
+    Texture *texture = new Texture(image.format, base.width, base.height);
+    texture->m_mipLevels = (uint32_t)image.mips.levels.size() - baseLevel;
 
-    Texture *texture = new Texture(format, width, height);
-    texture->InitFromBuffer(phyDevice, device, queue, cmdPool, usage, rawBuffer.buffer);
+    if (texture->CreateImage(phyDevice, device, usage) != VK_SUCCESS) {
+        delete texture;
+        return nullptr;
+    }
+
+    // The levels are stored after each other, rebase their offsets onto the first uploaded level
+    std::vector<MipLevel> levels(image.mips.levels.begin() + baseLevel, image.mips.levels.end());
+    for (MipLevel& level : levels) {
+        level.offset -= base.offset;
+    }
 
-    rawBuffer.Destroy(device);
+    texture->UploadMipChain(uploads, levels, image.Data() + base.offset, image.DataSize() - base.offset);
+
+    texture->m_view = Create2DImageView(device, image.format, texture->m_image, texture->m_mipLevels);
+    texture->Create2DSampler(device);
 
     return texture;
 }
 
+void Texture::UploadMipChain(
+    UploadManager&                  uploads,
+    const std::vector<MipLevel>&    levels,
+    const uint8_t*                  data,
+    uint64_t                        size) {
+
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        const MipLevel& mip = levels[level];
+        regions.push_back({
+            .bufferOffset       = mip.offset,
+            .bufferRowLength    = 0,
+            .bufferImageHeight  = 0,
+            .imageSubresource   = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+            .imageOffset        = { 0, 0, 0 },
+            .imageExtent        = { mip.width, mip.height, 1 },
+        });
+    }
+
+    m_uploadTicket = uploads.UploadImageRegions(m_image, data, size, regions, m_mipLevels);
+}
+
 Texture Texture::Create2D(
     const VkPhysicalDevice  phyDevice,
     const VkDevice          device,
@@ -231,6 +529,45 @@ Texture Texture::Create2D(
         return {VK_FORMAT_UNDEFINED, 0, 0};
     }
 
+    texture.CreateViewAndSampler(device);
+
+    return texture;
+}
+
+Texture Texture::Create2DUnbound(
+    const VkDevice          device,
+    const VkFormat          format,
+    VkExtent2D              extent,
+    VkImageUsageFlags       usage) {
+
+    Texture texture(format, extent.width, extent.height);
+
+    if (texture.CreateImageHandle(device, usage, VK_SAMPLE_COUNT_1_BIT) != VK_SUCCESS) {
+        return {VK_FORMAT_UNDEFINED, 0, 0};
+    }
+
+    return texture;
+}
+
+VkMemoryRequirements Texture::MemoryRequirements(const VkDevice device) const {
+    VkMemoryRequirements requirements = {};
+    vkGetImageMemoryRequirements(device, m_image, &requirements);
+
+    return requirements;
+}
+
+VkResult Texture::BindMemory(const VkDevice device, const VkDeviceMemory memory, VkDeviceSize offset) {
+    VkResult result = vkBindImageMemory(device, m_image, memory, offset);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    CreateViewAndSampler(device);
+
+    return VK_SUCCESS;
+}
+
+void Texture::CreateViewAndSampler(const VkDevice device) {
     static VkImageUsageFlags requiresView = 0
         | VK_IMAGE_USAGE_SAMPLED_BIT
         | VK_IMAGE_USAGE_STORAGE_BIT
@@ -240,21 +577,46 @@ Texture Texture::Create2D(
         | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
     ;
 
-    if ((usage & requiresView) != 0) {
-        texture.m_view = Create2DImageView(device, texture.m_format, texture.m_image);
-        texture.Create2DSampler(device);
+    if ((m_usage & requiresView) != 0) {
+        m_view = Create2DImageView(device, m_format, m_image);
     }
 
-    return texture;
+    if ((m_usage & VK_IMAGE_USAGE_SAMPLED_BIT) != 0) {
+        Create2DSampler(device);
+    }
 }
 
-
 VkResult Texture::CreateImage(
     const VkPhysicalDevice  phyDevice,
     const VkDevice          device,
     VkImageUsageFlags       usage,
     VkSampleCountFlagBits   msaaSamples) {
 
+    VkResult createResult = CreateImageHandle(device, usage, msaaSamples);
+    if (createResult != VK_SUCCESS) {
+        return createResult;
+    }
+
+    // Transient attachments never leave the tile, lazily allocated memory is enough for them
+    const MemoryUsage memoryUsage = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+                                  ? MemoryUsage::TransientAttachment
+                                  : MemoryUsage::GpuOnly;
+
+    return MemoryAllocator::Get(phyDevice, device)
+        .AllocateForImage(m_image, memoryUsage, &m_allocation,
+                          MemoryCategoryFromImageUsage(usage));
+}
+
+VkResult Texture::CreateImageHandle(
+    const VkDevice          device,
+    VkImageUsageFlags       usage,
+    VkSampleCountFlagBits   msaaSamples) {
+
+    // Transient attachments may only have attachment usages
+    if ((usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) == 0) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+
     VkImageCreateInfo createInfo = {
         .sType                  = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext                  = nullptr,
@@ -262,151 +624,31 @@ VkResult Texture::CreateImage(
         .imageType              = VK_IMAGE_TYPE_2D,
         .format                 = m_format,
         .extent                 = { (uint32_t)m_width, (uint32_t)m_height, 1 },
-        .mipLevels              = 1,
+        .mipLevels              = m_mipLevels,
         .arrayLayers            = 1,
         .samples                = msaaSamples,
         .tiling                 = VK_IMAGE_TILING_OPTIMAL,
-        .usage                  = VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage,
+        .usage                  = usage,
         .sharingMode            = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount  = 0,
         .pQueueFamilyIndices    = nullptr,
         .initialLayout          = VK_IMAGE_LAYOUT_UNDEFINED,
     };
 
-    VkResult createResult = vkCreateImage(device, &createInfo, nullptr, &m_image);
-    (void)createResult;
-
-    VkMemoryRequirements requirements = {};
-    vkGetImageMemoryRequirements(device, m_image, &requirements);
-
-    const uint32_t memoryTypeIdx = FindMemoryTypeIndex(phyDevice, requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    // TODO: check for error
-
-    VkMemoryAllocateInfo allocInfo = {
-        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext           = 0,
-        .allocationSize  = requirements.size,
-        .memoryTypeIndex = memoryTypeIdx,
-    };
-
-    vkAllocateMemory(device, &allocInfo, nullptr, &m_memory);
-    vkBindImageMemory(device, m_image, m_memory, 0);
+    m_usage = usage;
 
-    return VK_SUCCESS;
+    return vkCreateImage(device, &createInfo, nullptr, &m_image);
 }
 
 void Texture::Destroy(const VkDevice device) {
-    vkDestroySampler(device, m_sampler, nullptr);
     vkDestroyImageView(device, m_view, nullptr);
     vkDestroyImage(device, m_image, nullptr);
-    vkFreeMemory(device, m_memory, nullptr);
+    MemoryAllocator::Find(device)->Free(m_allocation);
 }
 
 bool Texture::Create2DSampler(const VkDevice device) {
-    VkSamplerCreateInfo createInfo = {
-        .sType              = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-        .pNext              = nullptr,
-        .flags              = 0,
-        .magFilter          = VK_FILTER_LINEAR,
-        .minFilter          = VK_FILTER_LINEAR,
-        .mipmapMode         = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-        .addressModeU       = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .addressModeV       = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .addressModeW       = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        .mipLodBias         = 0,
-        .anisotropyEnable   = VK_FALSE,
-        .maxAnisotropy      = 0.0f,
-        .compareEnable      = VK_FALSE,
-        .compareOp          = VK_COMPARE_OP_NEVER,
-        .minLod             = 0.0f,
-        .maxLod             = 0.0f,
-        .borderColor        = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
-        .unnormalizedCoordinates = VK_FALSE,
-    };
-    VkResult result = vkCreateSampler(device, &createInfo, nullptr, &m_sampler);
+    // Shared with every texture using the default settings, destroyed by SamplerCache::Destroy
+    m_sampler = SamplerCache::Get(device).Get(SamplerSettings{});
 
-    return result == VK_SUCCESS;
+    return m_sampler != VK_NULL_HANDLE;
 }
-
-
-bool Texture::UploadFromBuffer(
-    const VkDevice      device,
-    const VkQueue       queue,
-    const VkCommandPool cmdPool,
-    const VkBuffer&     rawBuffer) {
-    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
-
-    VkCommandBufferAllocateInfo allocInfo = {
-        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext              = nullptr,
-        .commandPool        = cmdPool,
-        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1u,
-    };
-
-    // TODO: check result
-    vkAllocateCommandBuffers(device, &allocInfo, &cmdBuffer);
-
-    VkCommandBufferBeginInfo beginInfo = {
-        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext              = nullptr,
-        .flags              = 0,
-        .pInheritanceInfo   = nullptr,
-    };
-
-    vkBeginCommandBuffer(cmdBuffer, &beginInfo);
-
-    VkImageMemoryBarrier startBarrier = {
-        .sType                  = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .pNext                  = nullptr,
-        .srcAccessMask          = 0,
-        .dstAccessMask          = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .oldLayout              = VK_IMAGE_LAYOUT_UNDEFINED,
-        .newLayout              = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        .srcQueueFamilyIndex    = 0,
-        .dstQueueFamilyIndex    = 0,
-        .image                  = m_image,
-        .subresourceRange       = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
-    };
-
-    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &startBarrier);
-
-    VkBufferImageCopy range = {
-        .bufferOffset       = 0,
-        .bufferRowLength    = 0,
-        .bufferImageHeight  = 0,
-        .imageSubresource   = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
-        .imageOffset        = { 0, 0, 0 },
-        .imageExtent        = { m_width, m_height, 1 },
-    };
-    vkCmdCopyBufferToImage(cmdBuffer, rawBuffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &range);
-
-    VkImageMemoryBarrier endBarrier = startBarrier;
-    endBarrier.srcAccessMask    = startBarrier.dstAccessMask;
-    endBarrier.oldLayout        = startBarrier.newLayout;
-    endBarrier.newLayout        = VK_IMAGE_LAYOUT_GENERAL;
-
-    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &endBarrier);
-
-    vkEndCommandBuffer(cmdBuffer);
-
-    // Submit
-    VkSubmitInfo submitInfo = {
-        .sType                  = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext                  = nullptr,
-        .waitSemaphoreCount     = 0,
-        .pWaitSemaphores        = nullptr,
-        .pWaitDstStageMask      = nullptr,
-        .commandBufferCount     = 1,
-        .pCommandBuffers        = &cmdBuffer,
-        .signalSemaphoreCount   = 0,
-        .pSignalSemaphores      = nullptr,
-    };
-
-    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-
-    vkDeviceWaitIdle(device);
-
-    return true;
-}
-
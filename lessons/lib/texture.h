@@ -1,38 +1,113 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include <vulkan/vulkan_core.h>
 
+#include "mapped_file.h"
+#include "memory_allocator.h"
+#include "mip_generator.h"
+#include "upload_manager.h"
+
 VkImageView Create2DImageView(
     const VkDevice  device,
     const VkFormat  format,
-    const VkImage   image);
+    const VkImage   image,
+    uint32_t        mipLevels = 1);
 
 
 struct BufferInfo;
+struct Ktx2Image;
+class TextureDiskCache;
+
+// CPU side result of decoding an image file, see Texture::DecodeFile
+struct DecodedImage {
+    std::string path;
+    VkFormat    format       = VK_FORMAT_UNDEFINED;
+    uint32_t    width        = 0;
+    uint32_t    height       = 0;
+    uint32_t    mipLevels    = 1;
+    bool        generateMips = false; // 'mips' only holds level 0, the rest is blitted on the GPU
+    MipChain    mips;
+
+    // Set when the texels come from the disk cache ('mapped' keeps the mapping alive) or from data
+    // embedded into the executable, 'mips.data' is empty then
+    std::shared_ptr<MappedFile> mapped;
+    const uint8_t*              mappedData = nullptr;
+    uint64_t                    mappedSize = 0;
+
+    const uint8_t* Data() const { return (mappedData != nullptr) ? mappedData : mips.data.data(); }
+    uint64_t       DataSize() const { return (mappedData != nullptr) ? mappedSize : mips.data.size(); }
+};
 
 class Texture {
 public:
+    // Queues the texel upload on the upload manager and returns without waiting for it,
+    // the texture can be used on the GPU once uploadTicket() completed.
+    // A full mip chain is built: blitted on the GPU if the format supports linear blits, otherwise on the CPU.
+    // A baked "<image>.ktx2" next to the image is used instead when it has the channels of 'format' (or its sRGB
+    // variant) and the device can sample it.
     static Texture *LoadFromFile(
         const VkPhysicalDevice  phyDevice,
         const VkDevice          device,
-        const VkQueue           queue,
-        const VkCommandPool     cmdPool,
+        UploadManager&          uploads,
+        const std::string&      path,
+        const VkFormat          format,
+        VkImageUsageFlags       usage,
+        const TextureDiskCache* diskCache = nullptr);
+
+    // Decodes the file (or its baked KTX2 version) and prepares the mip levels on the CPU.
+    // With a disk cache the decoded mip chain is mapped from, or stored into, the cache.
+    // Only touches the physical device, it can run on any thread.
+    static bool DecodeFile(
+        const VkPhysicalDevice  phyDevice,
         const std::string&      path,
         const VkFormat          format,
+        DecodedImage*           outImage,
+        const TextureDiskCache* diskCache = nullptr);
+
+    // Creates the texture and queues the upload of a decoded image
+    static Texture *CreateFromDecoded(
+        const VkPhysicalDevice  phyDevice,
+        const VkDevice          device,
+        UploadManager&          uploads,
+        const DecodedImage&     image,
         VkImageUsageFlags       usage);
 
-/*
+    // Creates the texture from the levels [baseLevel, mipLevels) of a decoded image, 'baseLevel' becomes mip 0.
+    // The image must hold its complete mip chain on the CPU (generateMips == false). Used for streaming.
+    static Texture *CreateFromDecodedLevels(
+        const VkPhysicalDevice  phyDevice,
+        const VkDevice          device,
+        UploadManager&          uploads,
+        const DecodedImage&     image,
+        uint32_t                baseLevel,
+        VkImageUsageFlags       usage);
+
+    // Creates the texture from KTX2 data already in memory, e.g. embedded into the executable by add_texture
+    // (see texture.cmake). Nothing is read from disk or decoded, the levels go from 'data' straight into the
+    // staging ring. 'name' is only used in the messages.
     static Texture *LoadFromData(
         const VkPhysicalDevice  phyDevice,
         const VkDevice          device,
-        const VkQueue           queue,
-        const VkCommandPool     cmdPool,
-        const std::string&      path,
+        UploadManager&          uploads,
+        const std::string&      name,
+        const uint8_t*          data,
+        size_t                  size,
         const VkFormat          format,
         VkImageUsageFlags       usage);
-*/
+
+    // The CPU side of LoadFromData: the levels of 'outImage' point into 'data' (e.g. to build an atlas from them).
+    // Like a baked file next to an image, the data is only accepted when it has the channels of 'format' (or its
+    // sRGB variant), so it is sampled the same way as the decoded source image.
+    static bool DecodeData(
+        const VkPhysicalDevice  phyDevice,
+        const std::string&      name,
+        const uint8_t*          data,
+        size_t                  size,
+        const VkFormat          format,
+        DecodedImage*           outImage);
 
     static Texture Create2D(
         const VkPhysicalDevice  phyDevice,
@@ -42,16 +117,26 @@ public:
         VkImageUsageFlags       usage,
         VkSampleCountFlagBits   msaaSamples = VK_SAMPLE_COUNT_1_BIT);
 
+    // Creates the image without memory, BindMemory must be called before use (ex.: aliased attachments)
+    static Texture Create2DUnbound(
+        const VkDevice          device,
+        const VkFormat          format,
+        VkExtent2D              extent,
+        VkImageUsageFlags       usage);
+
+    VkMemoryRequirements MemoryRequirements(const VkDevice device) const;
+
+    // Binds memory owned by the caller and creates the view/sampler. Destroy does not free this memory.
+    VkResult BindMemory(const VkDevice device, const VkDeviceMemory memory, VkDeviceSize offset);
+
     VkImage image() const { return m_image; }
     VkImageView view() const { return m_view; }
     VkSampler sampler() const { return m_sampler; }
+    UploadTicket uploadTicket() const { return m_uploadTicket; }
+    // Bytes of device memory owned by the texture, 0 for memory bound by the caller
+    VkDeviceSize MemorySize() const { return m_allocation.size; }
 
-    bool UploadFromBuffer(
-        const VkDevice      device,
-        const VkQueue       queue,
-        const VkCommandPool cmdPool,
-        const VkBuffer&     rawBuffer);
-
+    // Takes the default sampler from the device's SamplerCache, the sampler is not owned by the texture
     bool Create2DSampler(const VkDevice device);
 
     void Destroy(const VkDevice device);
@@ -60,6 +145,7 @@ public:
 
     uint32_t Width() const { return m_width; }
     uint32_t Height() const { return m_height; }
+    uint32_t MipLevels() const { return m_mipLevels; }
 
     VkExtent2D Extent2D() const { return { m_width, m_height }; }
 
@@ -80,22 +166,43 @@ private:
         VkImageUsageFlags       usage,
         VkSampleCountFlagBits   msaaSamples = VK_SAMPLE_COUNT_1_BIT);
 
-    bool InitFromBuffer(
-        const VkPhysicalDevice  phyDevice,
+    VkResult CreateImageHandle(
         const VkDevice          device,
-        const VkQueue           queue,
-        const VkCommandPool     cmdPool,
         VkImageUsageFlags       usage,
-        const VkBuffer          buffer);
+        VkSampleCountFlagBits   msaaSamples);
+
+    void CreateViewAndSampler(const VkDevice device);
+
+    static bool DecodeKtx2(
+        const VkPhysicalDevice  phyDevice,
+        const std::string&      path,
+        const VkFormat          format,
+        DecodedImage*           outImage);
+
+    // Picks the sampled format of a KTX2 image and fills everything of 'outImage' but the texels,
+    // false when the device can not sample it
+    static bool AcceptKtx2(
+        const VkPhysicalDevice  phyDevice,
+        const std::string&      name,
+        const VkFormat          format,
+        const Ktx2Image&        image,
+        DecodedImage*           outImage);
+
+    // Uploads every level of the chain from 'data', m_mipLevels must match the chain
+    void UploadMipChain(UploadManager& uploads, const std::vector<MipLevel>& levels, const uint8_t* data, uint64_t size);
 
 
     VkFormat m_format;
     uint32_t m_width;
     uint32_t m_height;
+    uint32_t m_mipLevels = 1;
 
     VkImage m_image;
-    VkDeviceMemory m_memory;
+    VkImageUsageFlags m_usage = 0;
+    MemoryAllocation m_allocation;
 
     VkImageView m_view;
     VkSampler m_sampler;
+
+    UploadTicket m_uploadTicket = 0;
 };
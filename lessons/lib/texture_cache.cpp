@@ -0,0 +1,267 @@
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+TextureRef::TextureRef(TextureCache* cache, TextureCacheEntry* entry)
+    : m_cache(cache)
+    , m_entry(entry)
+{
+    m_cache->AddRef(m_entry);
+}
+
+TextureRef::TextureRef(const TextureRef& other)
+    : m_cache(other.m_cache)
+    , m_entry(other.m_entry)
+{
+    if (m_entry != nullptr) {
+        m_cache->AddRef(m_entry);
+    }
+}
+
+TextureRef::TextureRef(TextureRef&& other) noexcept
+    : m_cache(other.m_cache)
+    , m_entry(other.m_entry)
+{
+    other.m_cache = nullptr;
+    other.m_entry = nullptr;
+}
+
+TextureRef& TextureRef::operator=(const TextureRef& other)
+{
+    if (this != &other) {
+        TextureRef copy(other);
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
+TextureRef& TextureRef::operator=(TextureRef&& other) noexcept
+{
+    if (this != &other) {
+        Reset();
+
+        m_cache       = other.m_cache;
+        m_entry       = other.m_entry;
+        other.m_cache = nullptr;
+        other.m_entry = nullptr;
+    }
+
+    return *this;
+}
+
+TextureRef::~TextureRef()
+{
+    Reset();
+}
+
+const Texture* TextureRef::Get() const
+{
+    return (m_entry != nullptr) ? m_cache->Resolve(m_entry) : nullptr;
+}
+
+void TextureRef::Reset()
+{
+    if (m_entry != nullptr) {
+        m_cache->Release(m_entry);
+    }
+
+    m_cache = nullptr;
+    m_entry = nullptr;
+}
+
+void TextureCache::Create(const VkDevice device, TextureLoader& loader, VkDeviceSize budget)
+{
+    m_device = device;
+    m_loader = &loader;
+    m_budget = budget;
+}
+
+void TextureCache::Destroy()
+{
+    for (auto& [key, entry] : m_entries) {
+        Resolve(&entry);
+
+        if (entry.texture != nullptr) {
+            entry.texture->Destroy(m_device);
+            delete entry.texture;
+        }
+    }
+
+    m_entries.clear();
+    m_residentBytes = 0;
+}
+
+TextureRef TextureCache::Acquire(const std::string& path, const VkFormat format, VkImageUsageFlags usage)
+{
+    assert(m_loader != nullptr && "TextureCache::Create was not called");
+
+    const std::string key = path + "|" + std::to_string(format) + "|" + std::to_string(usage);
+
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        m_hits++;
+        return TextureRef(this, &it->second);
+    }
+
+    m_misses++;
+
+    Entry entry;
+    entry.loadHandle = m_loader->LoadAsync(path, format, usage);
+
+    it = m_entries.emplace(key, entry).first;
+    return TextureRef(this, &it->second);
+}
+
+TextureRef TextureCache::AcquireData(const std::string& name,
+                                     const uint8_t*     data,
+                                     size_t             size,
+                                     const VkFormat     format,
+                                     VkImageUsageFlags  usage)
+{
+    assert(m_loader != nullptr && "TextureCache::Create was not called");
+
+    // Prefixed so embedded data never shares an entry with a file of the same name
+    const std::string key = "embedded:" + name + "|" + std::to_string(format) + "|" + std::to_string(usage);
+
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        m_hits++;
+        return TextureRef(this, &it->second);
+    }
+
+    m_misses++;
+
+    Entry entry;
+    entry.texture = m_loader->LoadFromData(name, data, size, format, usage);
+    entry.failed  = (entry.texture == nullptr);
+    if (entry.texture != nullptr) {
+        entry.bytes = entry.texture->MemorySize();
+        m_residentBytes += entry.bytes;
+    }
+
+    it = m_entries.emplace(key, entry).first;
+    return TextureRef(this, &it->second);
+}
+
+TextureRef TextureCache::Adopt(const std::string& name, Texture* texture)
+{
+    assert(texture != nullptr);
+
+    const std::string key = "adopted:" + name;
+    assert(m_entries.find(key) == m_entries.end() && "TextureCache::Adopt: name already in use");
+
+    Entry entry;
+    entry.texture = texture;
+    entry.bytes   = texture->MemorySize();
+    m_residentBytes += entry.bytes;
+
+    const auto it = m_entries.emplace(key, entry).first;
+    return TextureRef(this, &it->second);
+}
+
+void TextureCache::BeginFrame()
+{
+    m_frame++;
+    EvictOverBudget();
+}
+
+void TextureCache::SetBudget(VkDeviceSize budget)
+{
+    m_budget = budget;
+    EvictOverBudget();
+}
+
+TextureCache::Stats TextureCache::GetStats() const
+{
+    Stats stats = {
+        .hits          = m_hits,
+        .misses        = m_misses,
+        .evictions     = m_evictions,
+        .residentCount = 0,
+        .residentBytes = m_residentBytes,
+        .budget        = m_budget,
+    };
+
+    for (const auto& [key, entry] : m_entries) {
+        stats.residentCount += (entry.texture != nullptr) ? 1 : 0;
+    }
+
+    return stats;
+}
+
+void TextureCache::PrintStats() const
+{
+    const Stats stats = GetStats();
+
+    printf("Texture cache: %u hits, %u misses, %u evictions, %u resident (%.2f of %.2f MiB)\n", stats.hits, stats.misses,
+           stats.evictions, stats.residentCount, stats.residentBytes / (1024.0 * 1024.0),
+           stats.budget / (1024.0 * 1024.0));
+}
+
+void TextureCache::AddRef(Entry* entry)
+{
+    entry->refCount++;
+}
+
+void TextureCache::Release(Entry* entry)
+{
+    assert(entry->refCount > 0);
+
+    entry->refCount--;
+    if (entry->refCount == 0) {
+        entry->releaseFrame = m_frame;
+    }
+}
+
+const Texture* TextureCache::Resolve(Entry* entry)
+{
+    if (entry->loadHandle != TextureLoader::INVALID_HANDLE) {
+        entry->texture    = m_loader->Wait(entry->loadHandle);
+        entry->failed     = (entry->texture == nullptr);
+        entry->loadHandle = TextureLoader::INVALID_HANDLE;
+
+        if (entry->texture != nullptr) {
+            entry->bytes = entry->texture->MemorySize();
+            m_residentBytes += entry->bytes;
+        }
+    }
+
+    return entry->texture;
+}
+
+void TextureCache::EvictOverBudget()
+{
+    if (m_residentBytes <= m_budget) {
+        return;
+    }
+
+    // Unreferenced, loaded textures which no frame in flight can use anymore, oldest release first
+    std::vector<decltype(m_entries)::iterator> candidates;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        const Entry& entry = it->second;
+        if (entry.refCount == 0 && entry.texture != nullptr && entry.releaseFrame + RELEASE_DELAY_FRAMES <= m_frame) {
+            candidates.push_back(it);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs->second.releaseFrame < rhs->second.releaseFrame; });
+
+    for (auto it : candidates) {
+        if (m_residentBytes <= m_budget) {
+            break;
+        }
+
+        Entry& entry = it->second;
+        entry.texture->Destroy(m_device);
+        delete entry.texture;
+
+        m_residentBytes -= entry.bytes;
+        m_evictions++;
+        m_entries.erase(it);
+    }
+}
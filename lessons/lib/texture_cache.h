@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include <vulkan/vulkan_core.h>
+
+#include "texture.h"
+#include "texture_loader.h"
+
+class TextureCache;
+
+// Shared state of one cached texture, only used through TextureRef and TextureCache
+struct TextureCacheEntry {
+    TextureLoader::Handle loadHandle   = TextureLoader::INVALID_HANDLE; // valid until the load is resolved
+    Texture*              texture      = nullptr;
+    bool                  failed       = false;
+    uint32_t              refCount     = 0;
+    VkDeviceSize          bytes        = 0;
+    uint64_t              releaseFrame = 0; // frame of the last release
+};
+
+/**
+ * Reference counted handle to a cached texture.
+ *
+ * Copies share the same texture, the last released reference makes the texture evictable
+ * but it stays resident until the cache needs the memory.
+ */
+class TextureRef {
+public:
+    TextureRef() = default;
+    TextureRef(const TextureRef& other);
+    TextureRef(TextureRef&& other) noexcept;
+    TextureRef& operator=(const TextureRef& other);
+    TextureRef& operator=(TextureRef&& other) noexcept;
+    ~TextureRef();
+
+    // Waits for the load if it is still in progress, nullptr when the load failed
+    const Texture* Get() const;
+    const Texture* operator->() const { return Get(); }
+
+    bool IsValid() const { return m_entry != nullptr; }
+    void Reset();
+
+private:
+    friend class TextureCache;
+
+    TextureRef(TextureCache* cache, TextureCacheEntry* entry);
+
+    TextureCache*      m_cache = nullptr;
+    TextureCacheEntry* m_entry = nullptr;
+};
+
+/**
+ * Shares textures between identical requests: one VkImage, view and sampler per path, format and usage.
+ *
+ * Misses start an asynchronous load on the TextureLoader, so several textures requested up front
+ * still decode in parallel. Unreferenced textures are kept resident and are destroyed least recently
+ * used first when the resident bytes exceed the budget. A texture is only destroyed a few frames after
+ * its last release, so frames still in flight can keep sampling it.
+ */
+class TextureCache {
+public:
+    static constexpr VkDeviceSize DEFAULT_BUDGET       = 512ull * 1024 * 1024;
+    // More frames than any swapchain keeps in flight
+    static constexpr uint64_t     RELEASE_DELAY_FRAMES = 4;
+
+    struct Stats {
+        uint32_t     hits          = 0;
+        uint32_t     misses        = 0;
+        uint32_t     evictions     = 0;
+        uint32_t     residentCount = 0;
+        VkDeviceSize residentBytes = 0;
+        VkDeviceSize budget        = 0;
+    };
+
+    void Create(const VkDevice device, TextureLoader& loader, VkDeviceSize budget = DEFAULT_BUDGET);
+    // Destroys every texture, the GPU must be idle. References still alive become dangling.
+    void Destroy();
+
+    TextureRef Acquire(const std::string& path, const VkFormat format, VkImageUsageFlags usage);
+    // Same for KTX2 data embedded into the executable (see add_texture), 'name' identifies the data.
+    // A miss creates the texture immediately, there is no file to read or decode.
+    TextureRef AcquireData(const std::string& name,
+                           const uint8_t*     data,
+                           size_t             size,
+                           const VkFormat     format,
+                           VkImageUsageFlags  usage);
+
+    // Hands a texture created elsewhere (e.g. from a TextureAtlas) to the cache, which owns it from then on.
+    // The texture is shared and evicted like a loaded one, 'name' must not be in use yet.
+    TextureRef Adopt(const std::string& name, Texture* texture);
+
+    // Advances the frame counter used to delay the destruction of released textures and evicts over budget.
+    void BeginFrame();
+
+    void         SetBudget(VkDeviceSize budget);
+    VkDeviceSize budget() const { return m_budget; }
+
+    Stats GetStats() const;
+    void  PrintStats() const;
+
+private:
+    friend class TextureRef;
+    using Entry = TextureCacheEntry;
+
+    void           AddRef(Entry* entry);
+    void           Release(Entry* entry);
+    const Texture* Resolve(Entry* entry);
+    void           EvictOverBudget();
+
+    VkDevice       m_device = VK_NULL_HANDLE;
+    TextureLoader* m_loader = nullptr;
+    VkDeviceSize   m_budget = DEFAULT_BUDGET;
+    uint64_t       m_frame  = 0;
+
+    // Node based map: entry addresses stay valid while other entries are added or removed
+    std::unordered_map<std::string, Entry> m_entries;
+
+    uint32_t     m_hits          = 0;
+    uint32_t     m_misses        = 0;
+    uint32_t     m_evictions     = 0;
+    VkDeviceSize m_residentBytes = 0;
+};
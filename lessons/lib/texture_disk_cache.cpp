@@ -0,0 +1,165 @@
+#include "texture_disk_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#include "hash_util.h"
+#include "texture.h"
+
+namespace {
+
+constexpr uint32_t BLOB_MAGIC = 0x42544B56; // "VKTB"
+
+struct BlobHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint64_t dataOffset; // from the start of the file
+    uint64_t dataSize;
+};
+
+// Texel data starts at this alignment, copies out of the mapping stay aligned
+constexpr uint64_t BLOB_DATA_ALIGNMENT = 16;
+
+} // namespace
+
+TextureDiskCache::TextureDiskCache(const std::string& directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        printf("[WARNING] Texture disk cache: can not create '%s', caching disabled\n", directory.c_str());
+        return;
+    }
+
+    m_directory = directory;
+}
+
+uint64_t TextureDiskCache::HashContent(const void* data, size_t size)
+{
+    return HashBytes(data, size);
+}
+
+std::string TextureDiskCache::BlobPath(uint64_t sourceHash, const VkFormat format) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx_%u.texblob", (unsigned long long)sourceHash, (uint32_t)format);
+
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+bool TextureDiskCache::Load(uint64_t sourceHash, const VkFormat format, DecodedImage* outImage) const
+{
+    if (!IsEnabled()) {
+        return false;
+    }
+
+    std::shared_ptr<MappedFile> mapping = MappedFile::Open(BlobPath(sourceHash, format));
+    if (!mapping || mapping->size() < sizeof(BlobHeader)) {
+        m_misses++;
+        return false;
+    }
+
+    const BlobHeader* header = (const BlobHeader*)mapping->data();
+    const uint64_t    tableEnd = sizeof(BlobHeader) + (uint64_t)header->levelCount * sizeof(MipLevel);
+
+    const bool valid = header->magic == BLOB_MAGIC && header->version == VERSION && header->sourceHash == sourceHash
+                    && header->format == (uint32_t)format && header->levelCount > 0 && tableEnd <= header->dataOffset
+                    && header->dataOffset + header->dataSize <= mapping->size();
+    if (!valid) {
+        printf("[WARNING] Texture disk cache: ignoring invalid blob %016llx\n", (unsigned long long)sourceHash);
+        m_misses++;
+        return false;
+    }
+
+    const MipLevel* levels = (const MipLevel*)(mapping->data() + sizeof(BlobHeader));
+    for (uint32_t levelIdx = 0; levelIdx < header->levelCount; levelIdx++) {
+        if (levels[levelIdx].offset + levels[levelIdx].size > header->dataSize) {
+            m_misses++;
+            return false;
+        }
+    }
+
+    outImage->format       = format;
+    outImage->width        = header->width;
+    outImage->height       = header->height;
+    outImage->mipLevels    = header->levelCount;
+    outImage->generateMips = false;
+    outImage->mips.levels.assign(levels, levels + header->levelCount);
+    outImage->mips.data.clear();
+    outImage->mapped       = mapping;
+    outImage->mappedData   = mapping->data() + header->dataOffset;
+    outImage->mappedSize   = header->dataSize;
+
+    m_hits++;
+
+    return true;
+}
+
+bool TextureDiskCache::Store(uint64_t sourceHash, const DecodedImage& image) const
+{
+    if (!IsEnabled() || image.generateMips) {
+        return false;
+    }
+
+    const uint32_t levelCount = (uint32_t)image.mips.levels.size();
+    const uint64_t tableEnd   = sizeof(BlobHeader) + (uint64_t)levelCount * sizeof(MipLevel);
+    const uint64_t dataOffset = (tableEnd + BLOB_DATA_ALIGNMENT - 1) / BLOB_DATA_ALIGNMENT * BLOB_DATA_ALIGNMENT;
+
+    const BlobHeader header = {
+        .magic      = BLOB_MAGIC,
+        .version    = VERSION,
+        .sourceHash = sourceHash,
+        .format     = (uint32_t)image.format,
+        .width      = image.width,
+        .height     = image.height,
+        .levelCount = levelCount,
+        .dataOffset = dataOffset,
+        .dataSize   = image.DataSize(),
+    };
+
+    // Unique per process and thread, the final name only appears once the file is complete
+    const std::string finalPath = BlobPath(sourceHash, image.format);
+    const uint64_t    unique    = std::hash<std::thread::id>{}(std::this_thread::get_id())
+                           ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()
+                           ^ std::random_device{}();
+    const std::string tempPath  = finalPath + "." + std::to_string(unique) + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        const char padding[BLOB_DATA_ALIGNMENT] = {};
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)image.mips.levels.data(), levelCount * sizeof(MipLevel));
+        file.write(padding, (std::streamsize)(dataOffset - tableEnd));
+        file.write((const char*)image.Data(), (std::streamsize)image.DataSize());
+
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tempPath);
+            return false;
+        }
+    }
+
+    // Atomic replace on POSIX. If another process won the race (Windows refuses to replace an
+    // existing file) its blob has the same content, the temporary file is just dropped.
+    std::error_code error;
+    std::filesystem::rename(tempPath, finalPath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return std::filesystem::exists(finalPath);
+    }
+
+    return true;
+}
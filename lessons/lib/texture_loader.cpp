@@ -0,0 +1,168 @@
+#include "texture_loader.h"
+
+#include <cassert>
+#include <chrono>
+
+#include "pixel_convert.h"
+
+void TextureLoader::Create(const VkPhysicalDevice phyDevice,
+                           const VkDevice         device,
+                           UploadManager&         uploads,
+                           uint32_t               threadCount)
+{
+    m_phyDevice = phyDevice;
+    m_device    = device;
+    m_uploads   = &uploads;
+    m_pool      = std::make_unique<ThreadPool>(threadCount);
+}
+
+void TextureLoader::Destroy()
+{
+    // Joins the workers after the queued decodes finished, the results are dropped
+    m_pool.reset();
+    m_requests.clear();
+
+    m_diskCache.reset();
+}
+
+void TextureLoader::EnableDiskCache(const std::string& directory)
+{
+    assert(PendingCount() == 0 && "The disk cache must be enabled before loading");
+
+    m_diskCache = std::make_unique<TextureDiskCache>(directory);
+}
+
+TextureLoader::Handle TextureLoader::LoadAsync(const std::string& path, const VkFormat format, VkImageUsageFlags usage)
+{
+    assert(m_pool && "TextureLoader::Create was not called");
+
+    const VkPhysicalDevice  phyDevice = m_phyDevice;
+    const TextureDiskCache* diskCache = m_diskCache.get();
+
+    Request request;
+    request.usage  = usage;
+    request.decode = m_pool->Submit([phyDevice, diskCache, path, format]() -> std::unique_ptr<DecodedImage> {
+        std::unique_ptr<DecodedImage> image = std::make_unique<DecodedImage>();
+        if (!Texture::DecodeFile(phyDevice, path, format, image.get(), diskCache)) {
+            return nullptr;
+        }
+
+        return image;
+    });
+
+    m_requests.push_back(std::move(request));
+
+    return (Handle)(m_requests.size() - 1);
+}
+
+Texture* TextureLoader::LoadFromData(const std::string& name,
+                                     const uint8_t*     data,
+                                     size_t             size,
+                                     const VkFormat     format,
+                                     VkImageUsageFlags  usage)
+{
+    assert(m_uploads != nullptr && "TextureLoader::Create was not called");
+
+    return Texture::LoadFromData(m_phyDevice, m_device, *m_uploads, name, data, size, format, usage);
+}
+
+std::future<std::unique_ptr<DecodedImage>> TextureLoader::DecodeAsync(const std::string& path, const VkFormat format)
+{
+    assert(m_pool && "TextureLoader::Create was not called");
+
+    const VkPhysicalDevice  phyDevice = m_phyDevice;
+    const TextureDiskCache* diskCache = m_diskCache.get();
+
+    return m_pool->Submit([phyDevice, diskCache, path, format]() -> std::unique_ptr<DecodedImage> {
+        std::unique_ptr<DecodedImage> image = std::make_unique<DecodedImage>();
+        if (!Texture::DecodeFile(phyDevice, path, format, image.get(), diskCache)) {
+            return nullptr;
+        }
+
+        // Only uncompressed decodes leave the chain to the GPU
+        if (image->generateMips) {
+            const PixelConversion conversion = ChoosePixelConversion(image->format);
+
+            image->mips         = BuildMipChain(image->Data(), image->width, image->height, image->mipLevels,
+                                                conversion.pixelSize, conversion.srgb);
+            image->generateMips = false;
+        }
+
+        return image;
+    });
+}
+
+uint32_t TextureLoader::Update()
+{
+    uint32_t finished = 0;
+
+    for (Request& request : m_requests) {
+        if (request.state != State::Decoding) {
+            continue;
+        }
+
+        if (request.decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            Finish(request);
+            finished++;
+        }
+    }
+
+    return finished;
+}
+
+Texture* TextureLoader::Get(Handle handle) const
+{
+    assert(handle < m_requests.size());
+
+    return m_requests[handle].texture;
+}
+
+bool TextureLoader::IsFailed(Handle handle) const
+{
+    assert(handle < m_requests.size());
+
+    return m_requests[handle].state == State::Failed;
+}
+
+Texture* TextureLoader::Wait(Handle handle)
+{
+    assert(handle < m_requests.size());
+
+    Request& request = m_requests[handle];
+    if (request.state == State::Decoding) {
+        Finish(request);
+    }
+
+    return request.texture;
+}
+
+void TextureLoader::WaitAll()
+{
+    for (Request& request : m_requests) {
+        if (request.state == State::Decoding) {
+            Finish(request);
+        }
+    }
+}
+
+uint32_t TextureLoader::PendingCount() const
+{
+    uint32_t count = 0;
+    for (const Request& request : m_requests) {
+        count += (request.state == State::Decoding) ? 1 : 0;
+    }
+
+    return count;
+}
+
+void TextureLoader::Finish(Request& request)
+{
+    const std::unique_ptr<DecodedImage> image = request.decode.get();
+    if (image == nullptr) {
+        request.state = State::Failed;
+        return;
+    }
+
+    request.texture = Texture::CreateFromDecoded(m_phyDevice, m_device, *m_uploads, *image, request.usage);
+    request.state   = (request.texture != nullptr) ? State::Ready : State::Failed;
+}
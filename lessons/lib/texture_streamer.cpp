@@ -0,0 +1,373 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+void TextureStreamer::Create(const VkPhysicalDevice phyDevice,
+                             const VkDevice         device,
+                             UploadManager&         uploads,
+                             TextureLoader&         loader,
+                             VkDeviceSize           frameBudget,
+                             VkDeviceSize           memoryCap)
+{
+    m_phyDevice   = phyDevice;
+    m_device      = device;
+    m_uploads     = &uploads;
+    m_loader      = &loader;
+    m_frameBudget = frameBudget;
+    m_memoryCap   = memoryCap;
+}
+
+void TextureStreamer::Destroy()
+{
+    for (Entry& entry : m_entries) {
+        // The worker still writes the result of a running decode, wait for it before dropping the entry
+        if (entry.decode.valid()) {
+            entry.decode.wait();
+        }
+
+        if (entry.texture != nullptr) {
+            entry.texture->Destroy(m_device);
+            delete entry.texture;
+        }
+    }
+
+    DestroyRetired(true);
+
+    m_entries.clear();
+    m_residentBytes = 0;
+    m_retiredBytes  = 0;
+}
+
+TextureStreamer::Handle TextureStreamer::Add(const std::string& path, const VkFormat format)
+{
+    assert(m_loader != nullptr && "TextureStreamer::Create was not called");
+
+    Entry entry;
+    entry.path   = path;
+    entry.format = format;
+    entry.decode = m_loader->DecodeAsync(path, format);
+
+    m_entries.push_back(std::move(entry));
+
+    return (Handle)(m_entries.size() - 1);
+}
+
+bool TextureStreamer::WaitResident(Handle handle)
+{
+    assert(handle < m_entries.size());
+
+    Entry& entry = m_entries[handle];
+    if (entry.decode.valid()) {
+        FinishDecode(entry);
+    }
+
+    return entry.texture != nullptr;
+}
+
+void TextureStreamer::RequestScreenSize(Handle handle, float pixels)
+{
+    assert(handle < m_entries.size());
+
+    Entry& entry        = m_entries[handle];
+    entry.requestPixels = std::max(entry.requestPixels, pixels);
+    entry.lastUsedFrame = m_frame;
+}
+
+float TextureStreamer::ProjectedSize(const glm::mat4& projection,
+                                     const glm::mat4& view,
+                                     const glm::vec3& center,
+                                     float            radius,
+                                     float            viewportHeight)
+{
+    const glm::vec3 viewCenter = glm::vec3(view * glm::vec4(center, 1.0f));
+
+    // The camera looks down -Z in view space
+    if (viewCenter.z > radius) {
+        return 0.0f;
+    }
+
+    // projection[1][1] is 1 / tan(fov / 2): a unit at distance 1 covers projection[1][1] * height / 2 pixels.
+    // Inside the sphere the distance is clamped to the radius, the object covers more than the screen then.
+    const float distance = std::max(glm::length(viewCenter), radius);
+
+    return radius * std::abs(projection[1][1]) * viewportHeight / distance;
+}
+
+void TextureStreamer::Update()
+{
+    DestroyRetired(false);
+
+    for (Entry& entry : m_entries) {
+        if (entry.decode.valid() && entry.decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            FinishDecode(entry);
+        }
+    }
+
+    // Applies a lowered cap even when nothing has to grow
+    MakeRoom(0, 0, nullptr);
+
+    // Textures missing the most levels go first
+    std::vector<Entry*> candidates;
+    for (Entry& entry : m_entries) {
+        if (entry.texture != nullptr && DesiredBase(entry) < entry.residentBase) {
+            candidates.push_back(&entry);
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Entry* lhs, const Entry* rhs) {
+        return (lhs->residentBase - DesiredBase(*lhs)) > (rhs->residentBase - DesiredBase(*rhs));
+    });
+
+    for (Entry* entry : candidates) {
+        const uint32_t desired = DesiredBase(*entry);
+
+        // Finest level the remaining budget allows, the first upload of a frame may exceed it by one level
+        uint32_t base = entry->residentBase;
+        while (base > desired) {
+            const bool firstUpload = (m_uploadedThisFrame == 0) && (base == entry->residentBase);
+            if (!firstUpload && m_uploadedThisFrame + ChainBytes(*entry, base - 1) > m_frameBudget) {
+                break;
+            }
+            base--;
+        }
+
+        if (base == entry->residentBase) {
+            continue;
+        }
+
+        const VkDeviceSize imageBytes = ChainBytes(*entry, base);
+        const VkDeviceSize growth     = imageBytes - ChainBytes(*entry, entry->residentBase);
+        if (!MakeRoom(growth, imageBytes, entry)) {
+            continue;
+        }
+
+        // Evictions may have used up the budget, the growth waits for the next frame then
+        if (m_uploadedThisFrame > 0 && m_uploadedThisFrame + imageBytes > m_frameBudget) {
+            continue;
+        }
+
+        SetResidency(*entry, base);
+    }
+
+    for (Entry& entry : m_entries) {
+        entry.requestPixels = 0.0f;
+    }
+
+    // Frames submitted after the flush are ordered after the uploads, the new views can be bound right away
+    if (m_uploadedThisFrame > 0) {
+        m_uploads->Flush();
+    }
+
+    m_uploadedLastFrame = m_uploadedThisFrame;
+    m_uploadedThisFrame = 0;
+    m_frame++;
+}
+
+const Texture* TextureStreamer::Get(Handle handle) const
+{
+    assert(handle < m_entries.size());
+
+    return m_entries[handle].texture;
+}
+
+uint32_t TextureStreamer::Version(Handle handle) const
+{
+    assert(handle < m_entries.size());
+
+    return m_entries[handle].version;
+}
+
+uint32_t TextureStreamer::ResidentLevels(Handle handle) const
+{
+    assert(handle < m_entries.size());
+
+    const Entry& entry = m_entries[handle];
+    return (entry.texture != nullptr) ? entry.texture->MipLevels() : 0;
+}
+
+uint32_t TextureStreamer::LevelCount(Handle handle) const
+{
+    assert(handle < m_entries.size());
+
+    const Entry& entry = m_entries[handle];
+    return (entry.image != nullptr) ? (uint32_t)entry.image->mips.levels.size() : 0;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const
+{
+    Stats stats = {
+        .textureCount      = (uint32_t)m_entries.size(),
+        .pendingCount      = 0,
+        .evictions         = m_evictions,
+        .residentBytes     = m_residentBytes,
+        .retiredBytes      = m_retiredBytes,
+        .fullBytes         = 0,
+        .uploadedLastFrame = m_uploadedLastFrame,
+        .frameBudget       = m_frameBudget,
+        .memoryCap         = m_memoryCap,
+    };
+
+    for (const Entry& entry : m_entries) {
+        stats.pendingCount += entry.decode.valid() ? 1 : 0;
+        stats.fullBytes += (entry.image != nullptr) ? ChainBytes(entry, 0) : 0;
+    }
+
+    return stats;
+}
+
+void TextureStreamer::PrintStats() const
+{
+    const Stats stats = GetStats();
+
+    printf("Texture streamer: %u textures, %.2f of %.2f MiB resident, %.2f MiB retired (cap %.2f MiB), "
+           "%u levels evicted\n",
+           stats.textureCount, stats.residentBytes / (1024.0 * 1024.0), stats.fullBytes / (1024.0 * 1024.0),
+           stats.retiredBytes / (1024.0 * 1024.0), stats.memoryCap / (1024.0 * 1024.0), stats.evictions);
+}
+
+VkDeviceSize TextureStreamer::ChainBytes(const Entry& entry, uint32_t base)
+{
+    const std::vector<MipLevel>& levels = entry.image->mips.levels;
+
+    VkDeviceSize bytes = 0;
+    for (uint32_t level = base; level < levels.size(); level++) {
+        bytes += levels[level].size;
+    }
+
+    return bytes;
+}
+
+uint32_t TextureStreamer::DesiredBase(const Entry& entry)
+{
+    // Not drawn in this frame: keep what is resident, MakeRoom decides when it goes
+    if (entry.requestPixels <= 0.0f) {
+        return entry.residentBase;
+    }
+
+    // One texel per pixel is enough, finer levels would only be minified away
+    const MipLevel& top   = entry.image->mips.levels[0];
+    const float     ratio = (float)std::max(top.width, top.height) / entry.requestPixels;
+    if (ratio <= 1.0f) {
+        return 0;
+    }
+
+    return std::min((uint32_t)std::floor(std::log2(ratio)), entry.minBase);
+}
+
+void TextureStreamer::FinishDecode(Entry& entry)
+{
+    entry.image = entry.decode.get();
+    if (entry.image == nullptr) {
+        entry.failed = true;
+        return;
+    }
+
+    // The coarse end of the chain up to the initial size is always resident
+    const std::vector<MipLevel>& levels = entry.image->mips.levels;
+    entry.minBase = (uint32_t)levels.size() - 1;
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        if (std::max(levels[level].width, levels[level].height) <= INITIAL_RESIDENT_SIZE) {
+            entry.minBase = level;
+            break;
+        }
+    }
+
+    entry.lastUsedFrame = m_frame;
+    if (!SetResidency(entry, entry.minBase)) {
+        entry.failed = true;
+    }
+}
+
+bool TextureStreamer::SetResidency(Entry& entry, uint32_t base)
+{
+    Texture* texture = Texture::CreateFromDecodedLevels(m_phyDevice, m_device, *m_uploads, *entry.image, base,
+                                                        VK_IMAGE_USAGE_SAMPLED_BIT);
+    if (texture == nullptr) {
+        printf("[ERROR] TextureStreamer: failed to create level %u of '%s'\n", base, entry.path.c_str());
+        return false;
+    }
+
+    // Frames in flight may still sample the previous image, its memory counts until DestroyRetired frees it
+    if (entry.texture != nullptr) {
+        m_residentBytes -= entry.texture->MemorySize();
+        m_retiredBytes += entry.texture->MemorySize();
+        m_retired.push_back({entry.texture, m_frame});
+    }
+
+    entry.texture      = texture;
+    entry.residentBase = base;
+    entry.version++;
+
+    m_residentBytes += texture->MemorySize();
+    m_uploadedThisFrame += ChainBytes(entry, base);
+
+    return true;
+}
+
+bool TextureStreamer::MakeRoom(VkDeviceSize growth, VkDeviceSize imageBytes, const Entry* requester)
+{
+    while (m_residentBytes + growth > m_memoryCap) {
+        // The copies of further evictions would pile up on the replaced images, wait until those are freed
+        if (m_retiredBytes > 0 && m_residentBytes + m_retiredBytes > m_memoryCap) {
+            return false;
+        }
+
+        // Least recently drawn first. Textures drawn in this frame only give up levels finer than they need.
+        Entry* victim = nullptr;
+        for (Entry& entry : m_entries) {
+            if (&entry == requester || entry.texture == nullptr || entry.residentBase >= entry.minBase) {
+                continue;
+            }
+
+            const bool idle = entry.lastUsedFrame < m_frame;
+            if (!idle && entry.residentBase >= DesiredBase(entry)) {
+                continue;
+            }
+
+            if (victim == nullptr || entry.lastUsedFrame < victim->lastUsedFrame) {
+                victim = &entry;
+            }
+        }
+
+        if (victim == nullptr) {
+            return false;
+        }
+
+        // The remaining chain of the victim is uploaded again, from the same budget as the growths
+        const VkDeviceSize upload = ChainBytes(*victim, victim->residentBase + 1);
+        if (m_uploadedThisFrame > 0 && m_uploadedThisFrame + upload > m_frameBudget) {
+            return false;
+        }
+
+        if (!SetResidency(*victim, victim->residentBase + 1)) {
+            return false;
+        }
+
+        m_evictions++;
+    }
+
+    // The new image is allocated before the replaced images are freed
+    return m_residentBytes + m_retiredBytes + imageBytes <= m_memoryCap;
+}
+
+void TextureStreamer::DestroyRetired(bool all)
+{
+    for (size_t idx = 0; idx < m_retired.size();) {
+        const Retired& retired = m_retired[idx];
+        if (!all && retired.frame + RELEASE_DELAY_FRAMES > m_frame) {
+            idx++;
+            continue;
+        }
+
+        m_retiredBytes -= retired.texture->MemorySize();
+        retired.texture->Destroy(m_device);
+        delete retired.texture;
+
+        m_retired[idx] = m_retired.back();
+        m_retired.pop_back();
+    }
+}
@@ -0,0 +1,307 @@
+#include "tlsf.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+TLSFAllocator::TLSFAllocator(uint64_t size)
+{
+    Reset(size);
+}
+
+void TLSFAllocator::Reset(uint64_t size)
+{
+    m_size            = size;
+    m_usedBytes       = 0;
+    m_allocationCount = 0;
+    m_flBitmap        = 0;
+
+    std::fill(std::begin(m_slBitmap), std::end(m_slBitmap), 0u);
+    for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+        std::fill(std::begin(m_freeHeads[fl]), std::end(m_freeHeads[fl]), INVALID_NODE);
+    }
+
+    m_nodes.clear();
+    m_unusedNodes.clear();
+
+    if (size > 0) {
+        const uint32_t nodeIdx = NewNode();
+        m_nodes[nodeIdx].offset = 0;
+        m_nodes[nodeIdx].size   = size;
+        InsertFree(nodeIdx);
+    }
+}
+
+void TLSFAllocator::Mapping(uint64_t size, uint32_t* outFl, uint32_t* outSl)
+{
+    if (size < SMALL_SIZE) {
+        *outFl = 0;
+        *outSl = (uint32_t)(size / (SMALL_SIZE / SL_COUNT));
+        return;
+    }
+
+    const uint32_t msb = 63 - std::countl_zero(size);
+    *outFl             = msb - SMALL_LOG2 + 1;
+    *outSl             = (uint32_t)(size >> (msb - SL_COUNT_LOG2)) - SL_COUNT;
+}
+
+void TLSFAllocator::MappingRoundUp(uint64_t size, uint32_t* outFl, uint32_t* outSl)
+{
+    // Round the size up to the next list boundary, so every region in the selected list is large enough.
+    if (size < SMALL_SIZE) {
+        size += (SMALL_SIZE / SL_COUNT) - 1;
+    } else {
+        const uint32_t msb = 63 - std::countl_zero(size);
+        size += (1ull << (msb - SL_COUNT_LOG2)) - 1;
+    }
+
+    Mapping(size, outFl, outSl);
+}
+
+uint32_t TLSFAllocator::NewNode()
+{
+    if (!m_unusedNodes.empty()) {
+        const uint32_t nodeIdx = m_unusedNodes.back();
+        m_unusedNodes.pop_back();
+        m_nodes[nodeIdx] = Node{};
+        return nodeIdx;
+    }
+
+    m_nodes.push_back(Node{});
+    return (uint32_t)(m_nodes.size() - 1);
+}
+
+void TLSFAllocator::ReleaseNode(uint32_t nodeIdx)
+{
+    m_nodes[nodeIdx] = Node{};
+    m_unusedNodes.push_back(nodeIdx);
+}
+
+void TLSFAllocator::InsertFree(uint32_t nodeIdx)
+{
+    Node& node  = m_nodes[nodeIdx];
+    node.isFree = true;
+
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    Mapping(node.size, &fl, &sl);
+
+    const uint32_t head = m_freeHeads[fl][sl];
+    node.prevFree       = INVALID_NODE;
+    node.nextFree       = head;
+    if (head != INVALID_NODE) {
+        m_nodes[head].prevFree = nodeIdx;
+    }
+
+    m_freeHeads[fl][sl] = nodeIdx;
+    m_flBitmap |= 1ull << fl;
+    m_slBitmap[fl] |= 1u << sl;
+}
+
+void TLSFAllocator::RemoveFree(uint32_t nodeIdx)
+{
+    Node& node = m_nodes[nodeIdx];
+    assert(node.isFree);
+
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    Mapping(node.size, &fl, &sl);
+
+    if (node.prevFree != INVALID_NODE) {
+        m_nodes[node.prevFree].nextFree = node.nextFree;
+    } else {
+        m_freeHeads[fl][sl] = node.nextFree;
+    }
+
+    if (node.nextFree != INVALID_NODE) {
+        m_nodes[node.nextFree].prevFree = node.prevFree;
+    }
+
+    if (m_freeHeads[fl][sl] == INVALID_NODE) {
+        m_slBitmap[fl] &= ~(1u << sl);
+        if (m_slBitmap[fl] == 0) {
+            m_flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    node.isFree   = false;
+    node.prevFree = INVALID_NODE;
+    node.nextFree = INVALID_NODE;
+}
+
+uint32_t TLSFAllocator::FindFree(uint64_t size) const
+{
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    MappingRoundUp(size, &fl, &sl);
+
+    if (fl >= FL_COUNT) {
+        return INVALID_NODE;
+    }
+
+    uint32_t slMap = m_slBitmap[fl] & (~0u << sl);
+    if (slMap == 0) {
+        const uint64_t flMap = (fl + 1 < 64) ? (m_flBitmap & (~0ull << (fl + 1))) : 0;
+        if (flMap == 0) {
+            return INVALID_NODE;
+        }
+
+        fl    = std::countr_zero(flMap);
+        slMap = m_slBitmap[fl];
+    }
+
+    sl = std::countr_zero(slMap);
+    return m_freeHeads[fl][sl];
+}
+
+uint32_t TLSFAllocator::SplitFront(uint32_t nodeIdx, uint64_t size)
+{
+    const uint32_t restIdx = NewNode();
+
+    Node& node = m_nodes[nodeIdx];
+    Node& rest = m_nodes[restIdx];
+
+    rest.offset   = node.offset + size;
+    rest.size     = node.size - size;
+    rest.prevPhys = nodeIdx;
+    rest.nextPhys = node.nextPhys;
+
+    if (node.nextPhys != INVALID_NODE) {
+        m_nodes[node.nextPhys].prevPhys = restIdx;
+    }
+
+    node.nextPhys = restIdx;
+    node.size     = size;
+
+    return restIdx;
+}
+
+bool TLSFAllocator::Allocate(uint64_t size, uint64_t alignment, Allocation* outAllocation)
+{
+    assert(size > 0);
+    alignment = std::max<uint64_t>(alignment, 1);
+    assert(std::has_single_bit(alignment));
+
+    const uint64_t searchSize = size + alignment - 1;
+    if (searchSize > m_size - m_usedBytes) {
+        return false;
+    }
+
+    uint32_t nodeIdx = FindFree(searchSize);
+    if (nodeIdx == INVALID_NODE) {
+        return false;
+    }
+
+    RemoveFree(nodeIdx);
+
+    const uint64_t offset  = m_nodes[nodeIdx].offset;
+    const uint64_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+
+    // Keep the alignment padding as a separate free region
+    if (aligned != offset) {
+        const uint32_t restIdx = SplitFront(nodeIdx, aligned - offset);
+        InsertFree(nodeIdx);
+        nodeIdx = restIdx;
+    }
+
+    if (m_nodes[nodeIdx].size > size) {
+        const uint32_t tailIdx = SplitFront(nodeIdx, size);
+        InsertFree(tailIdx);
+    }
+
+    m_usedBytes += size;
+    m_allocationCount++;
+
+    outAllocation->offset = aligned;
+    outAllocation->size   = size;
+    outAllocation->node   = nodeIdx;
+
+    return true;
+}
+
+void TLSFAllocator::Free(uint32_t nodeIdx)
+{
+    assert(nodeIdx < m_nodes.size() && !m_nodes[nodeIdx].isFree);
+
+    m_usedBytes -= m_nodes[nodeIdx].size;
+    m_allocationCount--;
+
+    // Merge with the previous region if it is free
+    const uint32_t prevIdx = m_nodes[nodeIdx].prevPhys;
+    if (prevIdx != INVALID_NODE && m_nodes[prevIdx].isFree) {
+        RemoveFree(prevIdx);
+
+        Node& prev    = m_nodes[prevIdx];
+        prev.size     += m_nodes[nodeIdx].size;
+        prev.nextPhys = m_nodes[nodeIdx].nextPhys;
+        if (prev.nextPhys != INVALID_NODE) {
+            m_nodes[prev.nextPhys].prevPhys = prevIdx;
+        }
+
+        ReleaseNode(nodeIdx);
+        nodeIdx = prevIdx;
+    }
+
+    // Merge with the next region if it is free
+    const uint32_t nextIdx = m_nodes[nodeIdx].nextPhys;
+    if (nextIdx != INVALID_NODE && m_nodes[nextIdx].isFree) {
+        RemoveFree(nextIdx);
+
+        Node& node    = m_nodes[nodeIdx];
+        node.size     += m_nodes[nextIdx].size;
+        node.nextPhys = m_nodes[nextIdx].nextPhys;
+        if (node.nextPhys != INVALID_NODE) {
+            m_nodes[node.nextPhys].prevPhys = nodeIdx;
+        }
+
+        ReleaseNode(nextIdx);
+    }
+
+    InsertFree(nodeIdx);
+}
+
+uint64_t TLSFAllocator::LargestFreeRegion() const
+{
+    if (m_flBitmap == 0) {
+        return 0;
+    }
+
+    const uint32_t fl = 63 - std::countl_zero(m_flBitmap);
+    const uint32_t sl = 31 - std::countl_zero(m_slBitmap[fl]);
+
+    uint64_t largest = 0;
+    for (uint32_t nodeIdx = m_freeHeads[fl][sl]; nodeIdx != INVALID_NODE; nodeIdx = m_nodes[nodeIdx].nextFree) {
+        largest = std::max(largest, m_nodes[nodeIdx].size);
+    }
+
+    return largest;
+}
+
+uint32_t TLSFAllocator::FreeRegionCount() const
+{
+    uint32_t count = 0;
+    for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+        if ((m_flBitmap & (1ull << fl)) == 0) {
+            continue;
+        }
+
+        for (uint32_t sl = 0; sl < SL_COUNT; sl++) {
+            for (uint32_t nodeIdx = m_freeHeads[fl][sl]; nodeIdx != INVALID_NODE;
+                 nodeIdx          = m_nodes[nodeIdx].nextFree) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+float TLSFAllocator::Fragmentation() const
+{
+    const uint64_t freeBytes = FreeBytes();
+    if (freeBytes == 0) {
+        return 0.0f;
+    }
+
+    return 1.0f - (float)LargestFreeRegion() / (float)freeBytes;
+}
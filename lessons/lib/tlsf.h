@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Two-Level Segregated Fit sub-allocator working on plain offsets.
+ *
+ * The allocator does not own any memory, it only manages the [0, size) range.
+ * This makes it usable for any kind of backing storage (VkDeviceMemory blocks,
+ * staging arenas, etc.) and keeps it free of Vulkan calls.
+ *
+ * Allocation and free are O(1): free regions are kept in segregated lists
+ * indexed by a first level (power of two) and a second level (linear subdivision)
+ * bitmap, neighbouring free regions are merged on free.
+ */
+class TLSFAllocator {
+public:
+    static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+    struct Allocation {
+        uint64_t offset = 0;
+        uint64_t size   = 0;
+        uint32_t node   = INVALID_NODE;
+    };
+
+    explicit TLSFAllocator(uint64_t size = 0);
+
+    void Reset(uint64_t size);
+
+    bool Allocate(uint64_t size, uint64_t alignment, Allocation* outAllocation);
+    void Free(uint32_t node);
+
+    uint64_t Size() const { return m_size; }
+    uint64_t UsedBytes() const { return m_usedBytes; }
+    uint64_t FreeBytes() const { return m_size - m_usedBytes; }
+    uint32_t AllocationCount() const { return m_allocationCount; }
+    bool     IsEmpty() const { return m_allocationCount == 0; }
+
+    uint64_t LargestFreeRegion() const;
+    uint32_t FreeRegionCount() const;
+
+    // 0.0 = all free bytes are in one region, approaching 1.0 = free bytes are scattered
+    float Fragmentation() const;
+
+private:
+    static constexpr uint32_t SL_COUNT_LOG2 = 5;
+    static constexpr uint32_t SL_COUNT      = 1u << SL_COUNT_LOG2;
+    static constexpr uint32_t SMALL_LOG2    = 8;
+    static constexpr uint64_t SMALL_SIZE    = 1ull << SMALL_LOG2;
+    static constexpr uint32_t FL_COUNT      = 64 - SMALL_LOG2 + 1;
+
+    struct Node {
+        uint64_t offset   = 0;
+        uint64_t size     = 0;
+        uint32_t prevPhys = INVALID_NODE;
+        uint32_t nextPhys = INVALID_NODE;
+        uint32_t prevFree = INVALID_NODE;
+        uint32_t nextFree = INVALID_NODE;
+        bool     isFree   = false;
+    };
+
+    static void Mapping(uint64_t size, uint32_t* outFl, uint32_t* outSl);
+    static void MappingRoundUp(uint64_t size, uint32_t* outFl, uint32_t* outSl);
+
+    uint32_t NewNode();
+    void     ReleaseNode(uint32_t nodeIdx);
+
+    void     InsertFree(uint32_t nodeIdx);
+    void     RemoveFree(uint32_t nodeIdx);
+    uint32_t FindFree(uint64_t size) const;
+
+    // Cuts 'size' bytes from the start of the node, the remainder becomes a new free node
+    uint32_t SplitFront(uint32_t nodeIdx, uint64_t size);
+
+    uint64_t m_size            = 0;
+    uint64_t m_usedBytes       = 0;
+    uint32_t m_allocationCount = 0;
+
+    uint64_t m_flBitmap = 0;
+    uint32_t m_slBitmap[FL_COUNT];
+    uint32_t m_freeHeads[FL_COUNT][SL_COUNT];
+
+    std::vector<Node>     m_nodes;
+    std::vector<uint32_t> m_unusedNodes;
+};